@@ -20,7 +20,14 @@
 
 #include "AssetManager.h"
 #include "MeshGenerator.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "CookedMesh.h"
+#include "TextureCompressor.h"
+#include "../Render/GLThread.h"
+#include <cassert>
 #include <sstream>
+#include <algorithm>
 
 TextureInfo AssetManager::s_noTextureInfo(0,0);
 
@@ -28,6 +35,8 @@ TextureInfo AssetManager::s_noTextureInfo(0,0);
 // Name : AssetManager (constructor)
 //-----------------------------------------------------------------------------
 AssetManager::AssetManager()
+    :m_textureCompression(true), m_textureCacheDirectory("data/cache/textures"),
+     m_meshResidency(MESH_RESIDENCY_FULL), m_objWeldEpsilon(0.0f), m_meshStatsOutput(false), m_fallbackMeshMade(false)
 {
 }
 
@@ -36,7 +45,8 @@ AssetManager::AssetManager()
 //-----------------------------------------------------------------------------
 AssetManager::~AssetManager()
 {
-
+    for (auto& sampler : m_samplerCache)
+        glDeleteSamplers(1, &sampler.second);
 }
 
 //-----------------------------------------------------------------------------
@@ -53,22 +63,11 @@ GLuint AssetManager::getTexture(const std::string& filePath)
     // else load the textrue
     else
     {
-        std::string suffix;
-        std::stringstream s(filePath);
-        // gets the file name
-        std::getline(s, suffix, '.');
-        // gets the file suffix
-        std::getline(s, suffix, '.');
-        // load the texutre using the appropriate method
-        if (suffix == "png")
-            return loadPng(filePath);
-        if (suffix == "jpg")
-            return loadJPEG(filePath);
-        if (suffix == "bmp")
-            return loadBMP(filePath);
+        PackedTexture texture;
+        if (!prepareTexture(filePath, useTextureCompression(), m_textureCacheDirectory, texture))
+            return 0;
 
-        std::cout << suffix << " is not a supported texture type\n";
-        return 0;
+        return createTexture(filePath, texture);
     }
 }
 
@@ -84,12 +83,156 @@ const TextureInfo& AssetManager::getTextureInfo(GLuint textureName)
 }
 
 //-----------------------------------------------------------------------------
-// Name : loadPng
+// Name : setTextureCompression
+//-----------------------------------------------------------------------------
+void AssetManager::setTextureCompression(bool compress)
+{
+    m_textureCompression = compress;
+}
+
+//-----------------------------------------------------------------------------
+// Name : getTextureCompression
+//-----------------------------------------------------------------------------
+bool AssetManager::getTextureCompression() const
+{
+    return m_textureCompression;
+}
+
+//-----------------------------------------------------------------------------
+// Name : setTextureCacheDirectory
+//-----------------------------------------------------------------------------
+void AssetManager::setTextureCacheDirectory(const std::string& directory)
+{
+    m_textureCacheDirectory = directory;
+}
+
+//-----------------------------------------------------------------------------
+// Name : getTextureCacheDirectory
+//-----------------------------------------------------------------------------
+const std::string& AssetManager::getTextureCacheDirectory() const
+{
+    return m_textureCacheDirectory;
+}
+
+//-----------------------------------------------------------------------------
+// Name : useTextureCompression
+// Desc : has to be called on the GL thread, GLEW is asked for S3TC support
+//-----------------------------------------------------------------------------
+bool AssetManager::useTextureCompression() const
+{
+    return m_textureCompression && GLEW_EXT_texture_compression_s3tc;
+}
+
+//-----------------------------------------------------------------------------
+// Name : prepareTexture
+// Desc : a compressed texture is looked up in the cache by the hash of its
+//        file before anything is decoded, textures that aren't compressed
+//        keep their mips as RGBA8
+//-----------------------------------------------------------------------------
+bool AssetManager::prepareTexture(const std::string& filePath, bool compress, const std::string& cacheDirectory,
+                                  PackedTexture& texture)
+{
+    bool useCache = compress && !cacheDirectory.empty();
+    uint64_t sourceHash = 0;
+    std::string cachePath;
+    if (useCache)
+    {
+        MappedFile source;
+        if (!source.Open(filePath))
+            return false;
+
+        sourceHash = CookedTexture::HashData(source.GetData(), source.GetSize());
+        cachePath = CookedTexture::GetCachePath(cacheDirectory, sourceHash);
+        if (CookedTexture::Load(cachePath, sourceHash, texture))
+            return true;
+    }
+
+    DecodedImage image;
+    if (!decodeImage(filePath, image))
+        return false;
+
+    std::vector<GLubyte> rgba;
+    TextureCompressor::ConvertToRGBA(image.pixels.data(), image.width, image.height, image.format, image.bytesPerPixel, rgba);
+    image.pixels.clear();
+    image.pixels.shrink_to_fit();
+    bool hasAlpha = compress && TextureCompressor::HasAlpha(rgba);
+
+    std::vector<std::vector<GLubyte>> mips;
+    TextureCompressor::GenerateMips(std::move(rgba), image.width, image.height, mips);
+
+    texture.levels.clear();
+    texture.internalFormat = GL_RGBA8;
+    texture.format = GL_RGBA;
+    if (compress)
+        texture.internalFormat = hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+    GLsizei width = image.width;
+    GLsizei height = image.height;
+    for (std::vector<GLubyte>& mip : mips)
+    {
+        TextureLevel level;
+        level.width = width;
+        level.height = height;
+        if (compress)
+        {
+            std::vector<GLubyte> blocks;
+            if (hasAlpha)
+                TextureCompressor::CompressBC3(mip.data(), width, height, blocks);
+            else
+                TextureCompressor::CompressBC1(mip.data(), width, height, blocks);
+            std::vector<GLubyte>().swap(mip);
+            level.size = blocks.size();
+            level.data = MakeUploadData(std::move(blocks));
+        }
+        else
+        {
+            level.size = mip.size();
+            level.data = MakeUploadData(std::move(mip));
+        }
+        texture.levels.push_back(std::move(level));
+
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+
+    // a texture that can't be cooked is still used, it is encoded again on
+    // the next run
+    if (useCache)
+        CookedTexture::Save(cachePath, sourceHash, texture);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : decodeImage
+// Desc : picks the decoder by the file suffix
+//-----------------------------------------------------------------------------
+bool AssetManager::decodeImage(const std::string& filePath, DecodedImage& image)
+{
+    std::string suffix;
+    std::stringstream s(filePath);
+    // gets the file name
+    std::getline(s, suffix, '.');
+    // gets the file suffix
+    std::getline(s, suffix, '.');
+    // load the texutre using the appropriate method
+    if (suffix == "png")
+        return decodePng(filePath, image);
+    if (suffix == "jpg")
+        return decodeJPEG(filePath, image);
+    if (suffix == "bmp")
+        return decodeBMP(filePath, image);
+
+    std::cout << suffix << " is not a supported texture type\n";
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : decodePng
 //-----------------------------------------------------------------------------
-GLuint AssetManager::loadPng(const std::string &filePath)
+bool AssetManager::decodePng(const std::string &filePath, DecodedImage& image)
 {
     int number_of_passes = 0;
-    unsigned int format = 0;
 
     // header for testing if it is a png
     png_byte header[8];
@@ -99,7 +242,7 @@ GLuint AssetManager::loadPng(const std::string &filePath)
     if (!fp)
     {
         std::cout << "Failed to open " << filePath << "\n";
-        return 0;
+        return false;
     }
 
     // read header
@@ -111,7 +254,7 @@ GLuint AssetManager::loadPng(const std::string &filePath)
     {
         fclose(fp);
         std::cout<<"The given file is not a valid png file\n";
-        return 0;
+        return false;
     }
 
     // create png struct
@@ -120,7 +263,7 @@ GLuint AssetManager::loadPng(const std::string &filePath)
     {
         fclose(fp);
         std::cout << "Failed to create png struct\n";
-        return 0;
+        return false;
     }
 
     // create png info struct
@@ -129,7 +272,7 @@ GLuint AssetManager::loadPng(const std::string &filePath)
     {
         png_destroy_read_struct(&png_ptr, (png_infopp) nullptr, (png_infopp) nullptr);
         fclose(fp);
-        return 0;
+        return false;
     }
 
     // create png info struct
@@ -139,7 +282,7 @@ GLuint AssetManager::loadPng(const std::string &filePath)
         png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)nullptr);
         fclose(fp);
         std::cout << "Failed to create png info struct\n";
-        return 0;
+        return false;
     }
 
     // png error stuff, not sure libpng man suggests this.
@@ -148,7 +291,7 @@ GLuint AssetManager::loadPng(const std::string &filePath)
         png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
         fclose(fp);
         std::cout << "png error stuff\n";
-        return 0;
+        return false;
     }
 
     // init png reading
@@ -171,65 +314,44 @@ GLuint AssetManager::loadPng(const std::string &filePath)
 
     // set the correct image format
     if (color_type == PNG_COLOR_TYPE_RGB)
-        format = GL_RGB;
-    if (color_type == PNG_COLOR_TYPE_RGBA)
-        format = GL_RGBA;
-
-    // Update the png info struct
-    png_read_update_info(png_ptr, info_ptr);
-
-    // Row size in bytes
-    int rowBytes = png_get_rowbytes(png_ptr, info_ptr);
-
-    // Allocate the image_data as a big block, to be given to opengl
-    png_byte* image_data = new png_byte[rowBytes * height];
-    if (!image_data)
-    {
-        //clean up memory and close stuff
-        std::cout << "Fail to allocate buffer for image\n";
-        png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
-        fclose(fp);
-        return 0;
-    }
-
-    // row_pointers is for the pointing to image_data for reading the png with libpng
-    png_bytep* row_pointers = new png_bytep[height];
-    if (!row_pointers)
+        image.format = GL_RGB;
+    else if (color_type == PNG_COLOR_TYPE_RGBA)
+        image.format = GL_RGBA;
+    else
     {
-        //clean up memory and close stuff
         png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
-        delete[] image_data;
         fclose(fp);
-        return 0;
+        std::cout << filePath << ": only RGB and RGBA pngs are supported\n";
+        return false;
     }
 
-    // set the individual row_pointers to point at the correct offsets of image_data
-    for (int i = 0; i < height; i++)
-        row_pointers[height - 1 - i] = image_data + i * rowBytes;
-
-    // read the png into image data through row_pointers
-    png_read_image(png_ptr, row_pointers);
+    // Update the png info struct
+    png_read_update_info(png_ptr, info_ptr);
 
+    image.width = width;
+    image.height = height;
+    image.bytesPerPixel = png_get_rowbytes(png_ptr, info_ptr) / width;
 
-    // now generate the OpenGL texture
-    GLuint textureID = createTexture(width, height, format, image_data);
+    // rows are read straight into their place in the texture, bottom row first
+    GLsizeiptr rowSize = UploadManager::GetTextureRowSize(width, image.bytesPerPixel);
+    image.pixels.resize(rowSize * height);
+    for (int pass = 0; pass < number_of_passes; pass++)
+    {
+        for (png_uint_32 i = 0; i < height; i++)
+            png_read_row(png_ptr, image.pixels.data() + (height - 1 - i) * rowSize, nullptr);
+    }
 
     //clean up memory and close stuff
     png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
-    delete[] image_data;
-    delete[] row_pointers;
     fclose(fp);
 
-    // cached the loaded texture
-    m_textureCache.insert(std::pair<std::string, GLuint>(filePath,textureID));
-    m_textureInfoCache.insert(std::pair<GLuint, TextureInfo>(textureID, TextureInfo(width, height)));
-    return textureID;
+    return true;
 }
 
 //-----------------------------------------------------------------------------
-// Name : loadBMP
+// Name : decodeBMP
 //-----------------------------------------------------------------------------
-GLuint AssetManager::loadBMP(const std::string &filePath)
+bool AssetManager::decodeBMP(const std::string &filePath, DecodedImage& image)
 {
     // Each BMP file begins by a 54-bytes header
     unsigned char header[54];
@@ -237,7 +359,6 @@ GLuint AssetManager::loadBMP(const std::string &filePath)
     unsigned int dataPos;
     unsigned int width, height;
     unsigned int imageSize;
-    unsigned char* data;
 
     // open file
     std::ifstream file;
@@ -245,7 +366,7 @@ GLuint AssetManager::loadBMP(const std::string &filePath)
     if (!file.is_open())
     {
         std::cout << "Failed to open "<< filePath << "\n";
-        return 0;
+        return false;
     }
 
     file.read((char*)header, 54);
@@ -253,95 +374,78 @@ GLuint AssetManager::loadBMP(const std::string &filePath)
     {
         file.close();
         std::cout << "Not a correct BMP file\n";
-        return 0;
+        return false;
     }
 
     if (header[0] != 'B' || header[1] != 'M' )
     {
         file.close();
         std::cout << "Not a correct BMP file\n";
-        return 0;
+        return false;
     }
 
     if (header[28] != 24 && header[28] != 32)
     {
         file.close();
         std::cout << "Invalid file format. only 24 or 32 are supported \n";
-        return 0;
+        return false;
     }
 
     // Read ints from the byte array
     dataPos   =   *(int*)&(header[0x0A]);
-    imageSize =   *(int*)&(header[0x22]);
     width     =   *(int*)&(header[0x12]);
     height    =   *(int*)&(header[0x16]);
     unsigned int bitsPerPixel = header[28];
     //width     =   header[18] + (header[19] << 8);
     //height    =   header[22] + (header[23] << 8);
     //dataPos   = header[10] + (header[11] << 8);
+    // BMP rows are padded to 4 bytes just like the texture rows
     imageSize = ((width * bitsPerPixel + 31) /32)* 4 * height;
 
-
     // Some BMP files are misformatted, guess missing information
-    if (imageSize == 0)
-        imageSize = width * height * 3; // one byte per color RGB
     if (dataPos == 0)
         dataPos = 54;
 
-    // create a buffer
-    data = new unsigned char[imageSize];
-
-    if (!data)
-    {
-        //clean up memory and close stuff
-        std::cout << "Fail to allocate buffer for image\n";
-        file.close();
-        return 0;
-    }
+    image.width = width;
+    image.height = height;
+    image.format = (bitsPerPixel == 32) ? GL_BGRA : GL_BGR;
+    image.bytesPerPixel = bitsPerPixel / 8;
+    image.pixels.resize(imageSize);
 
     // read the actual data from the file into the buffer
     file.seekg(dataPos, std::ifstream::beg);
-    file.read((char*)data, imageSize);
-
-    GLuint textureID = createTexture(width, height, GL_BGR, data);
+    file.read((char*)image.pixels.data(), imageSize);
 
     // clean up memory and close stuff
     file.close();
-    delete[] data;
 
-    // cache the loaded texture
-    m_textureCache.insert(std::pair<std::string, GLuint>(filePath,textureID));
-    m_textureInfoCache.insert(std::pair<GLuint, TextureInfo>(textureID, TextureInfo(width, height)));
-
-    return textureID;
+    return true;
 }
 
 //-----------------------------------------------------------------------------
-// Name : loadJPEG
+// Name : decodeJPEG
 //-----------------------------------------------------------------------------
-GLuint AssetManager::loadJPEG(const std::string &filePath)
+bool AssetManager::decodeJPEG(const std::string &filePath, DecodedImage& image)
 {
     unsigned int width, height;
     int channels; //  3 =>RGB   4 =>RGBA
-    unsigned int format = 0;
 
     unsigned char * rowptr[1];    // pointer to an array
-    unsigned char * jdata;        // data for the image
     struct jpeg_decompress_struct info; //for our jpeg info
     struct jpeg_error_mgr err;          //the error handler
 
     FILE* file = fopen(filePath.c_str(), "rb");  //open the file
 
-    info.err = jpeg_std_error(&err);
-    jpeg_create_decompress(&info);   //fills info structure
-
     //if the jpeg file doesn't load
     if(!file)
     {
         std::cout << "Falied to open " << filePath << "\n";
-        return 0;
+        return false;
     }
 
+    info.err = jpeg_std_error(&err);
+    jpeg_create_decompress(&info);   //fills info structure
+
     jpeg_stdio_src(&info, file);
     jpeg_read_header(&info, TRUE);
 
@@ -356,59 +460,98 @@ GLuint AssetManager::loadJPEG(const std::string &filePath)
     if (channels < 3)
     {
         std::cout << "jpegs with less than 3 channels are not supported\n";
-        return 0;
+        jpeg_destroy_decompress(&info);
+        fclose(file);
+        return false;
     }
 
-    format = GL_RGB;
-    if(channels == 4) format = GL_RGBA;
+    image.width = width;
+    image.height = height;
+    image.format = (channels == 4) ? GL_RGBA : GL_RGB;
+    image.bytesPerPixel = channels;
 
-    unsigned long data_size = width * height * info.output_components;
-    unsigned int rowStride = channels * info.output_width;
+    GLsizeiptr rowSize = UploadManager::GetTextureRowSize(width, channels);
 
-    // read scanlines one at a time into jdata[] array
-    jdata = new unsigned char[data_size];
+    // read scanlines one at a time into the image
+    image.pixels.resize(rowSize * height);
     while (info.output_scanline < info.output_height)
     {
-
         // point rowptr to the current row to be filled with data
-        // libjpeg loads from end to start to rowptr starts from the end of jdata
-        //          start +         end        -  current line  - line(to get to the start of the line)
-        rowptr[0] = jdata + rowStride * height - rowStride * info.output_scanline - rowStride;
+        // libjpeg loads from end to start to rowptr starts from the end of the image
+        rowptr[0] = image.pixels.data() + rowSize * (height - 1 - info.output_scanline);
 
         // load data to the current line
         jpeg_read_scanlines(&info, rowptr, 1);
-
     }
 
     jpeg_finish_decompress(&info);
-    GLuint textureID = createTexture(width, height, format, jdata);
 
     // free resources
     jpeg_destroy_decompress(&info);
     fclose(file);
-    delete[] jdata;
 
-    // cache the loaded texture
-    m_textureCache.insert(std::pair<std::string, GLuint>(filePath,textureID));
-    m_textureInfoCache.insert(std::pair<GLuint, TextureInfo>(textureID, TextureInfo(width, height)));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : createTexture
+// Desc : the texture is cached under filePath
+//-----------------------------------------------------------------------------
+GLuint AssetManager::createTexture(const std::string& filePath, PackedTexture& texture)
+{
+    std::shared_ptr<UploadStatus> upload;
+    GLuint textureID = uploadTexture(texture, upload);
+    if (textureID != 0)
+        addTexture(filePath, textureID, TextureInfo(texture.levels[0].width, texture.levels[0].height), upload);
 
     return textureID;
 }
 
 //-----------------------------------------------------------------------------
-// Name : createTexture
+// Name : uploadTexture
+// Desc : the storage of every level is allocated here and the levels are
+//        streamed by the UploadManager
 //-----------------------------------------------------------------------------
-GLuint AssetManager::createTexture(GLsizei width, GLsizei height, GLenum format, unsigned char *data)
+GLuint AssetManager::uploadTexture(const PackedTexture& texture, std::shared_ptr<UploadStatus>& upload)
 {
+    assert(GLThread::IsCurrent());
     // generate the OpenGL texture
     GLuint textureID;
     glGenTextures(1, &textureID);
     
     if (textureID != 0)
     {
+        GLuint blockSize = TextureCompressor::GetBlockSize(texture.internalFormat);
+        GLint levelCount = GLint(texture.levels.size());
+
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, format, GL_UNSIGNED_BYTE, (GLvoid*)data);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        for (GLint i = 0; i < levelCount; i++)
+        {
+            const TextureLevel& level = texture.levels[i];
+            if (blockSize != 0)
+                glCompressedTexImage2D(GL_TEXTURE_2D, i, texture.internalFormat, level.width, level.height, 0,
+                                       GLsizei(level.size), nullptr);
+            else
+                glTexImage2D(GL_TEXTURE_2D, i, texture.internalFormat, level.width, level.height, 0,
+                             texture.format, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        // the texture is ready once every level was streamed
+        upload = std::make_shared<UploadStatus>();
+        for (GLint i = 0; i < levelCount; i++)
+        {
+            const TextureLevel& level = texture.levels[i];
+            if (blockSize != 0)
+                UploadManager::Get().EnqueueCompressedTexture(textureID, i, level.width, level.height, texture.internalFormat,
+                                                              blockSize, level.data, upload);
+            else
+                UploadManager::Get().EnqueueTexture(textureID, i, level.width, level.height, texture.format, 4,
+                                                    level.data, upload);
+        }
     }
     else
         std::cout << "Failed to generate a texture name\n";
@@ -416,99 +559,293 @@ GLuint AssetManager::createTexture(GLsizei width, GLsizei height, GLenum format,
     return textureID;
 }
 
+//-----------------------------------------------------------------------------
+// Name : addTexture
+//-----------------------------------------------------------------------------
+void AssetManager::addTexture(const std::string& filePath, GLuint textureID, const TextureInfo& info,
+                              const std::shared_ptr<UploadStatus>& upload)
+{
+    m_textureUploads[textureID] = upload;
+
+    // cache the loaded texture
+    m_textureCache.insert(std::pair<std::string, GLuint>(filePath,textureID));
+    m_textureInfoCache.insert(std::pair<GLuint, TextureInfo>(textureID, info));
+}
+
+//-----------------------------------------------------------------------------
+// Name : isTextureReady
+// Desc : false while the texture pixels are still streaming to the GPU
+//-----------------------------------------------------------------------------
+bool AssetManager::isTextureReady(GLuint textureName) const
+{
+    auto it = m_textureUploads.find(textureName);
+    return it == m_textureUploads.end() || it->second->IsReady();
+}
+
 //-----------------------------------------------------------------------------
 // Name : getMesh
 //-----------------------------------------------------------------------------
 Mesh* AssetManager::getMesh(const std::string& meshPath)
 {
-    // check if the texture is already loaded
-    if (m_meshCache.count(meshPath) != 0)
+    // check if the mesh is already loaded
+    auto it = m_meshCache.find(meshPath);
+    if (it != m_meshCache.end())
     {
-        // return textrue id(name)
-        return &m_meshCache[meshPath];
+        return &it->second;
     }
     // else load the textrue
     else
     {
-        std::string suffix;
-        std::stringstream s(meshPath);
-        // gets the file name
-        std::getline(s, suffix, '.');
-        // gets the file suffix
-        std::getline(s, suffix, '.');
-        Mesh* ret = nullptr;
-        bool knowSuffix = false;
-        // load the texutre using the appropriate method
-        if (suffix == "obj")
-        {
-            ret = loadObjMesh(meshPath);
-            knowSuffix = true;
-        }
-        if (suffix == "fbx")
-        {
-            #ifdef FBX
-            ret = loadFBXMesh(meshPath);
-            knowSuffix = true;
-            #endif
-        }
-        if (suffix == "gen")
-        {
-            ret = generateMesh(meshPath);
-            knowSuffix = true;
-        }
-
-        if (!knowSuffix)
-            std::cout << suffix << " is not a supported mesh type\n";
-        
+        Mesh* ret = loadMesh(meshPath);
         if (ret != nullptr)
+        {
+            applyMeshResidency(*ret);
             return ret;
+        }
         else
             return getMesh("cube.gen");
     }
 }
 
+//-----------------------------------------------------------------------------
+// Name : loadMesh
+// Desc : picks the loader by the file suffix, nullptr if the mesh failed to load
+//-----------------------------------------------------------------------------
+Mesh* AssetManager::loadMesh(const std::string& meshPath)
+{
+    std::string suffix;
+    std::stringstream s(meshPath);
+    // gets the file name
+    std::getline(s, suffix, '.');
+    // gets the file suffix
+    std::getline(s, suffix, '.');
+    Mesh* ret = nullptr;
+    bool knowSuffix = false;
+    // load the texutre using the appropriate method
+    if (suffix == "obj")
+    {
+        ret = loadObjMesh(meshPath);
+        knowSuffix = true;
+    }
+    if (suffix == "fbx")
+    {
+        #ifdef FBX
+        ret = loadFBXMesh(meshPath);
+        knowSuffix = true;
+        #endif
+    }
+    if (suffix == "gen")
+    {
+        ret = generateMesh(meshPath);
+        knowSuffix = true;
+    }
+    if (suffix == "cmesh")
+    {
+        ret = loadCookedMesh(meshPath);
+        knowSuffix = true;
+    }
+
+    if (!knowSuffix)
+        std::cout << suffix << " is not a supported mesh type\n";
+
+    return ret;
+}
+
+//-----------------------------------------------------------------------------
+// Name : applyMeshResidency
+//-----------------------------------------------------------------------------
+void AssetManager::applyMeshResidency(Mesh& mesh)
+{
+    mesh.SetResidency(m_meshResidency);
+}
+
+//-----------------------------------------------------------------------------
+// Name : cookMesh
+// Desc : the mesh is loaded with MESH_RESIDENCY_FULL if it isn't loaded yet
+//        since the cooked file is written from its vertices
+//-----------------------------------------------------------------------------
+bool AssetManager::cookMesh(const std::string& meshPath, const std::string& cookedPath)
+{
+    if (m_meshCache.count(meshPath) == 0)
+    {
+        MeshResidency residency = m_meshResidency;
+        m_meshResidency = MESH_RESIDENCY_FULL;
+        getMesh(meshPath);
+        m_meshResidency = residency;
+    }
+
+    // getMesh returns the fallback cube for meshes that failed to load
+    auto it = m_meshCache.find(meshPath);
+    if (it == m_meshCache.end())
+    {
+        std::cout << "cookMesh(): failed to load " << meshPath << "\n";
+        return false;
+    }
+
+    bool cooked = CookedMesh::Save(cookedPath, it->second, *this);
+    it->second.SetResidency(m_meshResidency);
+
+    return cooked;
+}
+
+//-----------------------------------------------------------------------------
+// Name : setMeshResidency
+//-----------------------------------------------------------------------------
+void AssetManager::setMeshResidency(MeshResidency residency)
+{
+    m_meshResidency = residency;
+}
+
+//-----------------------------------------------------------------------------
+// Name : getMeshResidency
+//-----------------------------------------------------------------------------
+MeshResidency AssetManager::getMeshResidency() const
+{
+    return m_meshResidency;
+}
+
+//-----------------------------------------------------------------------------
+// Name : setObjWeldEpsilon
+//-----------------------------------------------------------------------------
+void AssetManager::setObjWeldEpsilon(float epsilon)
+{
+    m_objWeldEpsilon = std::max(epsilon, 0.0f);
+}
+
+//-----------------------------------------------------------------------------
+// Name : getObjWeldEpsilon
+//-----------------------------------------------------------------------------
+float AssetManager::getObjWeldEpsilon() const
+{
+    return m_objWeldEpsilon;
+}
+
+//-----------------------------------------------------------------------------
+// Name : getMeshMemoryUsage
+// Desc : the total of every loaded mesh
+//-----------------------------------------------------------------------------
+MeshMemoryUsage AssetManager::getMeshMemoryUsage() const
+{
+    MeshMemoryUsage usage;
+    for (const auto& mesh : m_meshCache)
+        usage.Add(mesh.second.GetMemoryUsage());
+
+    return usage;
+}
+
+//-----------------------------------------------------------------------------
+// Name : printMeshMemoryUsage
+//-----------------------------------------------------------------------------
+void AssetManager::printMeshMemoryUsage() const
+{
+    for (const auto& mesh : m_meshCache)
+    {
+        MeshMemoryUsage usage = mesh.second.GetMemoryUsage();
+        std::cout << mesh.first << ": " << usage.cpuBytes / 1024 << " KB in memory, "
+                  << usage.gpuBytes / 1024 << " KB in the geometry arena\n";
+    }
+
+    MeshMemoryUsage total = getMeshMemoryUsage();
+    std::cout << "meshes: " << total.cpuBytes / 1024 << " KB in memory, " << total.gpuBytes / 1024
+              << " KB in the geometry arena (" << GeometryArena::Get().GetMemoryUsage() / 1024 << " KB allocated)\n";
+}
+
+//-----------------------------------------------------------------------------
+// Name : setMeshStatsOutput
+//-----------------------------------------------------------------------------
+void AssetManager::setMeshStatsOutput(bool output)
+{
+    m_meshStatsOutput = output;
+}
+
+//-----------------------------------------------------------------------------
+// Name : getMeshStatsOutput
+//-----------------------------------------------------------------------------
+bool AssetManager::getMeshStatsOutput() const
+{
+    return m_meshStatsOutput;
+}
+
 //-----------------------------------------------------------------------------
 // Name : loadObjMesh
 //-----------------------------------------------------------------------------
 Mesh* AssetManager::loadObjMesh(const std::string& meshPath)
 {
-    Model model(meshPath);
-    std::ifstream in;
-    
-    in.open(meshPath);
-    
-    if (!in.is_open())
-    {
-        std::cout << "Failed to open "<< meshPath << "\n";
+    Mesh mesh;
+    std::vector<Material> materials;
+    if (!buildObjMesh(meshPath, m_objWeldEpsilon, m_meshStatsOutput, mesh, materials))
         return nullptr;
-    }
-    
-    objFirstPass(*this, in, model);
-    
-    // return to start of file
-    in.clear();
-    in.seekg(0, std::ios::beg);
+
+    return addObjMesh(meshPath, std::move(mesh), materials);
+}
+
+//-----------------------------------------------------------------------------
+// Name : buildObjMesh
+//-----------------------------------------------------------------------------
+bool AssetManager::buildObjMesh(const std::string& meshPath, GLfloat weldEpsilon, bool printStats, Mesh& mesh,
+                                std::vector<Material>& materials)
+{
+    Model model(meshPath, weldEpsilon);
     
-    objSecondPass(in, model);
+    if (!objLoad(model))
+        return false;
     
     // convert obj groups to subMeshes
     std::vector<SubMesh> subMeshes;
     std::vector<GLuint> meshMaterials;
+    MeshOptimizeStats meshStats;
     for (Group& g : model.groups)
     {
         // ignore empty groups
         if (g.vertices.size() != 0)
         {
-            subMeshes.emplace_back(g.vertices, g.indices);
+            MeshOptimizeStats groupStats;
+            MeshOptimizer::Optimize(g.vertices, g.indices, &groupStats);
+            meshStats.Add(groupStats);
+
+            std::vector<VertexIndex> lodIndices;
+            std::vector<LodLevel> lods;
+            MeshSimplifier::BuildLodChain(g.vertices, g.indices, lodIndices, lods);
+
+            subMeshes.emplace_back(std::move(g.vertices), std::move(g.indices), false);
+            subMeshes.back().SetLodChain(std::move(lodIndices), std::move(lods));
             if (g.material != -1)
                 meshMaterials.push_back(g.material);
         }
     }
+    if (printStats)
+        MeshOptimizer::PrintStats(meshPath, meshStats);
+    
+    mesh = Mesh(std::move(subMeshes), std::move(meshMaterials), std::vector<std::string>());
+    materials = std::move(model.materialList);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : addObjMesh
+// Desc : uploads a mesh made by buildObjMesh and adds it to the cache
+//-----------------------------------------------------------------------------
+Mesh* AssetManager::addObjMesh(const std::string& meshPath, Mesh&& mesh, const std::vector<Material>& materials)
+{
+    mesh.Upload();
     
-    m_meshCache.insert(std::pair<std::string, Mesh>(meshPath, 
-    Mesh(std::move(subMeshes), std::move(meshMaterials),std::vector<std::string>())) );
+    return addMesh(meshPath, std::move(mesh), materials);
+}
+
+//-----------------------------------------------------------------------------
+// Name : addMesh
+// Desc : the default materials of mesh index materials, they are replaced by
+//        the indices of the materials in the material vector
+//-----------------------------------------------------------------------------
+Mesh* AssetManager::addMesh(const std::string& meshPath, Mesh&& mesh, const std::vector<Material>& materials)
+{
+    for (GLuint& material : mesh.getDefaultMaterials())
+        material = getMaterialIndex(materials[material]);
+
+    auto it = m_meshCache.emplace(meshPath, std::move(mesh)).first;
     
-    return &m_meshCache[meshPath];
+    return &it->second;
 }
 
 #ifdef FBX
@@ -517,54 +854,116 @@ Mesh* AssetManager::loadObjMesh(const std::string& meshPath)
 //-----------------------------------------------------------------------------
 Mesh *AssetManager::loadFBXMesh(const std::string &meshPath)
 {
-    std::vector<GLuint> meshMaterials;
+    Mesh mesh;
+    if (!buildFBXMesh(meshPath, mesh))
+        return nullptr;
+
+    auto it = m_meshCache.emplace(meshPath, std::move(mesh)).first;
+
+    return &it->second;
+}
+
+//-----------------------------------------------------------------------------
+// Name : buildFBXMesh
+// Desc : the subMeshes are uploaded as they are made
+//-----------------------------------------------------------------------------
+bool AssetManager::buildFBXMesh(const std::string& meshPath, Mesh& mesh)
+{
     std::vector<SubMesh> subMeshes;
-    if (m_fbxLoader.LoadMesh(meshPath, subMeshes))
-    {
-        m_meshCache.insert(std::pair<std::string, Mesh>(meshPath,
-                        Mesh(std::move(subMeshes), std::move(meshMaterials), std::vector<std::string>())) );
+    if (!m_fbxLoader.LoadMesh(meshPath, subMeshes))
+        return false;
 
-        return &m_meshCache[meshPath];
-    }
-    else
-        return nullptr;
+    mesh = Mesh(std::move(subMeshes), std::vector<GLuint>(), std::vector<std::string>());
+
+    return true;
 }
 #endif
 
+//-----------------------------------------------------------------------------
+// Name : loadCookedMesh
+//-----------------------------------------------------------------------------
+Mesh* AssetManager::loadCookedMesh(const std::string& meshPath)
+{
+    std::vector<SubMesh> subMeshes;
+    std::vector<GLuint> meshMaterials;
+    std::vector<std::string> meshTextures;
+    if (!CookedMesh::Load(meshPath, *this, m_meshResidency, subMeshes, meshMaterials, meshTextures))
+        return nullptr;
+
+    auto it = m_meshCache.emplace(meshPath, Mesh(std::move(subMeshes), std::move(meshMaterials), std::move(meshTextures))).first;
+
+    return &it->second;
+}
+
+//-----------------------------------------------------------------------------
+// Name : buildCookedMesh
+// Desc : loads from a file that was already mapped, like buildObjMesh the
+//        materials of mesh index materials
+//-----------------------------------------------------------------------------
+bool AssetManager::buildCookedMesh(const std::string& meshPath, const std::shared_ptr<MappedFile>& file, MeshResidency residency,
+                                   Mesh& mesh, std::vector<Material>& materials)
+{
+    std::vector<SubMesh> subMeshes;
+    std::vector<std::string> meshTextures;
+    if (!CookedMesh::Load(meshPath, file, residency, subMeshes, materials, meshTextures))
+        return false;
+
+    std::vector<GLuint> meshMaterials(materials.size());
+    for (GLuint i = 0; i < meshMaterials.size(); i++)
+        meshMaterials[i] = i;
+
+    mesh = Mesh(std::move(subMeshes), std::move(meshMaterials), std::move(meshTextures));
+
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 // Name : generateMesh
 //-----------------------------------------------------------------------------
 Mesh*  AssetManager::generateMesh(const std::string& meshString)
+{
+    Mesh mesh;
+    std::vector<Material> materials;
+    if (!buildGeneratedMesh(meshString, mesh, materials))
+        return nullptr;
+
+    return addMesh(meshString, std::move(mesh), materials);
+}
+
+//-----------------------------------------------------------------------------
+// Name : buildGeneratedMesh
+// Desc : like buildObjMesh the materials of mesh index materials, the
+//        subMeshes are uploaded as they are made
+//-----------------------------------------------------------------------------
+bool AssetManager::buildGeneratedMesh(const std::string& meshString, Mesh& mesh, std::vector<Material>& materials)
 {
     if (meshString == "board.gen")
     {
-        m_meshCache.insert(std::pair<std::string, Mesh>(meshString, MeshGenerator::createBoardMesh(*this, glm::vec2(10.0f, 10.0f))));
-        
-        return &m_meshCache[meshString];
+        mesh = MeshGenerator::createBoardMesh(glm::vec2(10.0f, 10.0f));
+        materials.push_back(WHITE_MATERIAL);
+        return true;
     }
     
     if (meshString == "square.gen")
     {
-        m_meshCache.insert(std::pair<std::string, Mesh>(meshString, MeshGenerator::createSquareMesh(*this, glm::vec2(10.0f, 10.0f))));
-        
-        return &m_meshCache[meshString];
+        mesh = MeshGenerator::createSquareMesh(glm::vec2(10.0f, 10.0f));
+        materials.push_back(WHITE_MATERIAL);
+        return true;
     }
     
     if (meshString == "skybox.gen")
     {
-        m_meshCache.insert(std::pair<std::string, Mesh>(meshString, MeshGenerator::createSkyBoxMesh()));
-        
-        return &m_meshCache[meshString];
+        mesh = MeshGenerator::createSkyBoxMesh();
+        return true;
     }
     
     if (meshString == "cube.gen")
     {
-        m_meshCache.insert(std::pair<std::string, Mesh>(meshString, MeshGenerator::createCubeMesh()));
-        
-        return &m_meshCache[meshString];
+        mesh = MeshGenerator::createCubeMesh();
+        return true;
     }
     
-    return nullptr;
+    return false;
 }
 
 //-----------------------------------------------------------------------------
@@ -572,20 +971,31 @@ Mesh*  AssetManager::generateMesh(const std::string& meshString)
 //-----------------------------------------------------------------------------
 Shader* AssetManager::getShader(const std::string& shaderPath)
 {
+    return getShader(shaderPath, "");
+}
+
+//-----------------------------------------------------------------------------
+// Name : getShader
+// Desc : returns a variant of the shader compiled with the given defines
+//-----------------------------------------------------------------------------
+Shader* AssetManager::getShader(const std::string& shaderPath, const std::string& defines)
+{
+    std::string shaderKey = shaderPath + defines;
+
 	// check if the shader is loaded in the cache
-    if (m_shaderCache.count(shaderPath) != 0)
+    if (m_shaderCache.count(shaderKey) != 0)
     {
         // return textrue id(name)
-        return m_shaderCache[shaderPath];
+        return m_shaderCache[shaderKey];
     }
 
     // no such shader in cache , adding a new one 
     std::string vertexShader = shaderPath + ".vs";
     std::string fragmentShader = shaderPath + ".frag";
     
-    Shader* shader = new Shader(vertexShader.c_str(), fragmentShader.c_str());
+    Shader* shader = new Shader(vertexShader.c_str(), fragmentShader.c_str(), defines);
     
-    m_shaderCache.insert(std::pair<std::string, Shader*>(shaderPath,shader));
+    m_shaderCache.insert(std::pair<std::string, Shader*>(shaderKey,shader));
     
     return shader;
 }
@@ -603,6 +1013,7 @@ int AssetManager::getMaterialIndex(const Material& mat)
     
     // no matching material found , adding a new one
     m_materials.push_back(mat);
+    m_materialsDirty.Mark(m_materials.size() - 1);
     
     return m_materials.size() - 1;
 }
@@ -610,11 +1021,44 @@ int AssetManager::getMaterialIndex(const Material& mat)
 //-----------------------------------------------------------------------------
 // Name : getMaterial
 //-----------------------------------------------------------------------------
-Material& AssetManager::getMaterial(int materialIndex)
+const Material& AssetManager::getMaterial(int materialIndex)
 {
     return m_materials[materialIndex];
 }
 
+//-----------------------------------------------------------------------------
+// Name : setMaterial
+//-----------------------------------------------------------------------------
+void AssetManager::setMaterial(int materialIndex, const Material& mat)
+{
+    m_materials[materialIndex] = mat;
+    m_materialsDirty.Mark(materialIndex);
+}
+
+//-----------------------------------------------------------------------------
+// Name : getMaterialVector
+//-----------------------------------------------------------------------------
+const std::vector<Material>& AssetManager::getMaterialVector()
+{
+    return m_materials;
+}
+
+//-----------------------------------------------------------------------------
+// Name : getMaterialDirtyRange
+//-----------------------------------------------------------------------------
+const DirtyRange& AssetManager::getMaterialDirtyRange()
+{
+    return m_materialsDirty;
+}
+
+//-----------------------------------------------------------------------------
+// Name : clearMaterialDirtyRange
+//-----------------------------------------------------------------------------
+void AssetManager::clearMaterialDirtyRange()
+{
+    m_materialsDirty.Clear();
+}
+
 //-----------------------------------------------------------------------------
 // Name : getAttribute
 // Desc : returns the attribute index that correlate to the given properties
@@ -649,10 +1093,78 @@ int AssetManager::getAttribute(const std::string &texPath, GLint wrapMode, GLuin
         getShader(shaderPath);
 
     m_attributes.push_back(attrib);
+    m_resolvedAttributes.push_back(resolveAttribute(attrib));
 
     return m_attributes.size() - 1;
 }
 
+//-----------------------------------------------------------------------------
+// Name : resolveAttribute
+//-----------------------------------------------------------------------------
+ResolvedAttribute AssetManager::resolveAttribute(const Attribute& attrib)
+{
+    assert(GLThread::IsCurrent());
+    ResolvedAttribute resolved;
+    resolved.program = 0;
+    resolved.texture = NO_TEXTURE;
+    resolved.sampler = getSampler(attrib.wrapMode);
+    resolved.matIndex = attrib.matIndex;
+    resolved.texturedLoc = -1;
+    resolved.materialIndexLoc = -1;
+    resolved.textureUpload = nullptr;
+
+    if (attrib.texIndex != "")
+    {
+        resolved.texture = getTexture(attrib.texIndex);
+        auto it = m_textureUploads.find(resolved.texture);
+        if (it != m_textureUploads.end())
+            resolved.textureUpload = it->second.get();
+    }
+
+    if (attrib.shaderIndex != "")
+    {
+        resolved.program = getShader(attrib.shaderIndex)->Program;
+        resolved.texturedLoc = glGetUniformLocation(resolved.program, "textured");
+        resolved.materialIndexLoc = glGetUniformLocation(resolved.program, "materialIndex");
+    }
+
+    return resolved;
+}
+
+//-----------------------------------------------------------------------------
+// Name : resolveAttributes
+//-----------------------------------------------------------------------------
+void AssetManager::resolveAttributes()
+{
+    m_resolvedAttributes.clear();
+    for (const Attribute& attrib : m_attributes)
+        m_resolvedAttributes.push_back(resolveAttribute(attrib));
+}
+
+//-----------------------------------------------------------------------------
+// Name : getSampler
+// Desc : the sampler replaces the wrap mode that used to be set on the texture
+//        on every bind, the filtering matches createTexture and uses the mips
+//-----------------------------------------------------------------------------
+GLuint AssetManager::getSampler(GLint wrapMode)
+{
+    assert(GLThread::IsCurrent());
+    auto it = m_samplerCache.find(wrapMode);
+    if (it != m_samplerCache.end())
+        return it->second;
+
+    GLuint sampler;
+    glGenSamplers(1, &sampler);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, wrapMode);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, wrapMode);
+    glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    m_samplerCache[wrapMode] = sampler;
+
+    return sampler;
+}
+
 //-----------------------------------------------------------------------------
 // Name : getFont
 //-----------------------------------------------------------------------------
@@ -665,27 +1177,371 @@ mkFont* AssetManager::getFont(std::string fontName, int fontSize, bool isPath/*
         fontPath = mkFont::getFontPath(fontName);
 
 
-    std::string fontFileName = mkFont::getFontNameFromPath(fontPath);
-    std::stringstream fontNameStream;
-    fontNameStream << fontFileName << fontSize;
+    std::string fontKey = getFontKey(fontPath, fontSize);
 
     // check if the font is loaded in the cache
-    if (m_fontCache.count(fontNameStream.str()) != 0)
+    if (m_fontCache.count(fontKey) != 0)
     {
-        return &m_fontCache[fontNameStream.str()];
+        return &m_fontCache[fontKey];
     }
     else
     {
         mkFont newFont(fontPath, true);
         if (newFont.init(fontSize, 96, 96) == 0)
         {
-            m_fontCache.insert(std::pair<std::string, mkFont>(fontNameStream.str(), std::move(newFont)));
-            return &m_fontCache[fontNameStream.str()];
+            m_fontCache.insert(std::pair<std::string, mkFont>(fontKey, std::move(newFont)));
+            return &m_fontCache[fontKey];
         }
         else
             return nullptr;
     }
 }
+
+//-----------------------------------------------------------------------------
+// Name : getFontKey
+// Desc : the font cache key of a font file in a size
+//-----------------------------------------------------------------------------
+std::string AssetManager::getFontKey(const std::string& fontPath, int fontSize)
+{
+    std::string fontFileName = mkFont::getFontNameFromPath(fontPath);
+    std::stringstream fontNameStream;
+    fontNameStream << fontFileName << fontSize;
+
+    return fontNameStream.str();
+}
+
+//-----------------------------------------------------------------------------
+// Name : getTextureAsync
+//-----------------------------------------------------------------------------
+TextureHandle AssetManager::getTextureAsync(const std::string& filePath)
+{
+    TextureHandle handle;
+    auto it = m_textureCache.find(filePath);
+    if (it != m_textureCache.end())
+    {
+        handle.Finish(it->second, true);
+        return handle;
+    }
+
+    // the texture is already loading
+    auto pending = m_pendingTextures.find(filePath);
+    if (pending != m_pendingTextures.end())
+        return pending->second;
+
+    m_pendingTextures.emplace(filePath, handle);
+    // the settings are read here, the worker must not touch the AssetManager
+    bool compress = useTextureCompression();
+    std::string cacheDirectory = m_textureCacheDirectory;
+    m_asyncLoader.Enqueue([this, filePath, compress, cacheDirectory]() -> AsyncLoader::FinishFunc
+    {
+        std::shared_ptr<PackedTexture> texture = std::make_shared<PackedTexture>();
+        bool prepared = prepareTexture(filePath, compress, cacheDirectory, *texture);
+
+        return [this, filePath, texture, prepared]() -> AsyncLoader::CompleteFunc
+        {
+            std::shared_ptr<UploadStatus> upload;
+            GLuint textureID = prepared ? uploadTexture(*texture, upload) : 0;
+            TextureInfo info;
+            if (textureID != 0)
+                info = TextureInfo(texture->levels[0].width, texture->levels[0].height);
+
+            return [this, filePath, textureID, info, upload]()
+            {
+                TextureHandle handle = m_pendingTextures[filePath];
+                m_pendingTextures.erase(filePath);
+
+                // getTexture could have loaded it meanwhile
+                auto it = m_textureCache.find(filePath);
+                if (it != m_textureCache.end())
+                {
+                    handle.Finish(it->second, true);
+                    if (textureID != 0)
+                        m_asyncLoader.EnqueueGLJob([textureID]() { glDeleteTextures(1, &textureID); });
+                }
+                else
+                {
+                    if (textureID != 0)
+                        addTexture(filePath, textureID, info, upload);
+                    handle.Finish(textureID, textureID != 0);
+                }
+            };
+        };
+    });
+
+    return handle;
+}
+
+//-----------------------------------------------------------------------------
+// Name : getMeshAsync
+// Desc : obj meshes are parsed, optimized and simplified on the worker and
+//        cooked meshes are read from disk there, fbx and generated meshes are
+//        made on the GL thread since they are uploaded as they are made
+//-----------------------------------------------------------------------------
+MeshHandle AssetManager::getMeshAsync(const std::string& meshPath)
+{
+    MeshHandle handle;
+    auto it = m_meshCache.find(meshPath);
+    if (it != m_meshCache.end())
+    {
+        handle.Finish(&it->second, true);
+        return handle;
+    }
+
+    // the mesh is already loading
+    auto pending = m_pendingMeshes.find(meshPath);
+    if (pending != m_pendingMeshes.end())
+        return pending->second;
+
+    m_pendingMeshes.emplace(meshPath, handle);
+
+    std::string suffix;
+    std::stringstream s(meshPath);
+    // gets the file name
+    std::getline(s, suffix, '.');
+    // gets the file suffix
+    std::getline(s, suffix, '.');
+
+    if (suffix == "obj")
+    {
+        GLfloat weldEpsilon = m_objWeldEpsilon;
+        bool printStats = m_meshStatsOutput;
+        m_asyncLoader.Enqueue([this, meshPath, weldEpsilon, printStats]() -> AsyncLoader::FinishFunc
+        {
+            std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+            std::shared_ptr<std::vector<Material>> materials = std::make_shared<std::vector<Material>>();
+            bool built = buildObjMesh(meshPath, weldEpsilon, printStats, *mesh, *materials);
+
+            return [this, meshPath, mesh, materials, built]() -> AsyncLoader::CompleteFunc
+            {
+                if (built)
+                    mesh->Upload();
+                std::shared_ptr<Mesh> fallback = built ? nullptr : makeFallbackMesh();
+
+                return [this, meshPath, mesh, materials, built, fallback]()
+                {
+                    completeMeshLoad(meshPath, built ? mesh : nullptr, *materials, fallback);
+                };
+            };
+        });
+    }
+    else if (suffix == "cmesh")
+    {
+        MeshResidency residency = m_meshResidency;
+        m_asyncLoader.Enqueue([this, meshPath, residency]() -> AsyncLoader::FinishFunc
+        {
+            std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+            bool opened = file->Open(meshPath);
+            if (opened)
+                file->Prefetch();
+
+            return [this, meshPath, residency, file, opened]() -> AsyncLoader::CompleteFunc
+            {
+                // the subMeshes are uploaded as they are made
+                std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+                std::shared_ptr<std::vector<Material>> materials = std::make_shared<std::vector<Material>>();
+                bool built = opened && buildCookedMesh(meshPath, file, residency, *mesh, *materials);
+                std::shared_ptr<Mesh> fallback = built ? nullptr : makeFallbackMesh();
+
+                return [this, meshPath, mesh, materials, built, fallback]()
+                {
+                    completeMeshLoad(meshPath, built ? mesh : nullptr, *materials, fallback);
+                };
+            };
+        });
+    }
+    else
+    {
+        m_asyncLoader.Enqueue([this, meshPath, suffix]() -> AsyncLoader::FinishFunc
+        {
+            return [this, meshPath, suffix]() -> AsyncLoader::CompleteFunc
+            {
+                std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+                std::shared_ptr<std::vector<Material>> materials = std::make_shared<std::vector<Material>>();
+                bool built = false;
+                if (suffix == "gen")
+                    built = buildGeneratedMesh(meshPath, *mesh, *materials);
+                #ifdef FBX
+                else if (suffix == "fbx")
+                    built = buildFBXMesh(meshPath, *mesh);
+                #endif
+                else
+                    std::cout << suffix << " is not a supported mesh type\n";
+                std::shared_ptr<Mesh> fallback = built ? nullptr : makeFallbackMesh();
+
+                return [this, meshPath, mesh, materials, built, fallback]()
+                {
+                    completeMeshLoad(meshPath, built ? mesh : nullptr, *materials, fallback);
+                };
+            };
+        });
+    }
+
+    return handle;
+}
+
+//-----------------------------------------------------------------------------
+// Name : completeMeshLoad
+// Desc : mesh is null if the load failed. A mesh that was loaded by getMesh
+//        meanwhile is dropped on the GL thread since its geometry was uploaded
+//-----------------------------------------------------------------------------
+void AssetManager::completeMeshLoad(const std::string& meshPath, const std::shared_ptr<Mesh>& mesh,
+                                    const std::vector<Material>& materials, const std::shared_ptr<Mesh>& fallback)
+{
+    MeshHandle handle = m_pendingMeshes[meshPath];
+    m_pendingMeshes.erase(meshPath);
+
+    auto it = m_meshCache.find(meshPath);
+    if (it != m_meshCache.end())
+    {
+        handle.Finish(&it->second, true);
+        if (mesh)
+        {
+            // moved so the job holds the only reference
+            m_asyncLoader.EnqueueGLJob([unused = std::make_shared<Mesh>(std::move(*mesh))]() mutable { unused.reset(); });
+        }
+        return;
+    }
+
+    if (mesh)
+    {
+        Mesh* added = addMesh(meshPath, std::move(*mesh), materials);
+        applyMeshResidency(*added);
+        handle.Finish(added, true);
+        return;
+    }
+
+    // failed loads get the cube like getMesh gives them, it is only made by
+    // the first failed load unless getMesh made it already
+    auto cube = m_meshCache.find("cube.gen");
+    if (cube == m_meshCache.end() && fallback)
+    {
+        cube = m_meshCache.emplace("cube.gen", std::move(*fallback)).first;
+        applyMeshResidency(cube->second);
+    }
+    else if (fallback)
+        m_asyncLoader.EnqueueGLJob([unused = std::make_shared<Mesh>(std::move(*fallback))]() mutable { unused.reset(); });
+
+    handle.Finish(cube != m_meshCache.end() ? &cube->second : nullptr, false);
+}
+
+//-----------------------------------------------------------------------------
+// Name : makeFallbackMesh
+// Desc : runs on the GL thread, the cube failed loads fall back to is only
+//        made for the first of them
+//-----------------------------------------------------------------------------
+std::shared_ptr<Mesh> AssetManager::makeFallbackMesh()
+{
+    if (m_fallbackMeshMade)
+        return nullptr;
+
+    m_fallbackMeshMade = true;
+    return std::make_shared<Mesh>(MeshGenerator::createCubeMesh());
+}
+
+//-----------------------------------------------------------------------------
+// Name : getFontAsync
+// Desc : the glyphs are rasterized on the worker
+//-----------------------------------------------------------------------------
+FontHandle AssetManager::getFontAsync(std::string fontName, int fontSize, bool isPath/* = false*/)
+{
+    std::string fontPath;
+    if (isPath)
+        fontPath = fontName;
+    else
+        fontPath = mkFont::getFontPath(fontName);
+
+    std::string fontKey = getFontKey(fontPath, fontSize);
+
+    FontHandle handle;
+    auto it = m_fontCache.find(fontKey);
+    if (it != m_fontCache.end())
+    {
+        handle.Finish(&it->second, true);
+        return handle;
+    }
+
+    // the font is already loading
+    auto pending = m_pendingFonts.find(fontKey);
+    if (pending != m_pendingFonts.end())
+        return pending->second;
+
+    m_pendingFonts.emplace(fontKey, handle);
+    m_asyncLoader.Enqueue([this, fontPath, fontSize, fontKey]() -> AsyncLoader::FinishFunc
+    {
+        std::shared_ptr<mkFont> font = std::make_shared<mkFont>(fontPath, true);
+        bool rasterized = font->rasterize(fontSize, 96, 96) == 0;
+
+        return [this, fontKey, font, rasterized]() -> AsyncLoader::CompleteFunc
+        {
+            if (rasterized)
+                font->createTextures();
+
+            return [this, fontKey, font, rasterized]()
+            {
+                FontHandle handle = m_pendingFonts[fontKey];
+                m_pendingFonts.erase(fontKey);
+
+                // getFont could have loaded it meanwhile, the textures of
+                // this one are deleted on the GL thread
+                auto it = m_fontCache.find(fontKey);
+                if (it != m_fontCache.end() && rasterized)
+                {
+                    m_asyncLoader.EnqueueGLJob([unused = std::make_shared<mkFont>(std::move(*font))]() mutable { unused.reset(); });
+                }
+                else if (rasterized)
+                    it = m_fontCache.emplace(fontKey, std::move(*font)).first;
+
+                if (it != m_fontCache.end())
+                    handle.Finish(&it->second, true);
+                else
+                    handle.Finish(nullptr, false);
+            };
+        };
+    });
+
+    return handle;
+}
+
+//-----------------------------------------------------------------------------
+// Name : processAsyncLoads
+//-----------------------------------------------------------------------------
+void AssetManager::processAsyncLoads()
+{
+    m_asyncLoader.Process();
+}
+
+//-----------------------------------------------------------------------------
+// Name : completeAsyncLoads
+//-----------------------------------------------------------------------------
+void AssetManager::completeAsyncLoads()
+{
+    m_asyncLoader.Complete();
+}
+
+//-----------------------------------------------------------------------------
+// Name : setAsyncFrameBudget
+//-----------------------------------------------------------------------------
+void AssetManager::setAsyncFrameBudget(GLuint budget)
+{
+    m_asyncLoader.SetFrameBudget(budget);
+}
+
+//-----------------------------------------------------------------------------
+// Name : getAsyncFrameBudget
+//-----------------------------------------------------------------------------
+GLuint AssetManager::getAsyncFrameBudget() const
+{
+    return m_asyncLoader.GetFrameBudget();
+}
+
+//-----------------------------------------------------------------------------
+// Name : getPendingLoadCount
+//-----------------------------------------------------------------------------
+GLuint AssetManager::getPendingLoadCount() const
+{
+    return m_asyncLoader.GetPendingCount();
+}
+
 //-----------------------------------------------------------------------------
 // Name : getAttributeVector
 //-----------------------------------------------------------------------------
@@ -693,3 +1549,11 @@ const std::vector<Attribute>& AssetManager::getAttributeVector()
 {
     return m_attributes;
 }
+
+//-----------------------------------------------------------------------------
+// Name : getResolvedAttributeVector
+//-----------------------------------------------------------------------------
+const std::vector<ResolvedAttribute>& AssetManager::getResolvedAttributeVector()
+{
+    return m_resolvedAttributes;
+}
@@ -40,10 +40,14 @@
 #include "../Render/Shader.h"
 #include "../Render/Mesh.h"
 #include "../Render/Font.h"
+#include "../Render/UploadManager.h"
 #ifdef FBX
 #include "FbxLoader.h"
 #endif
 #include "ObjLoader.h"
+#include "AsyncLoader.h"
+#include "MappedFile.h"
+#include "CookedTexture.h"
 
 #ifndef _WIN32
 #define MAX_PATH 256
@@ -64,6 +68,25 @@ struct TextureInfo
         int height;
 };
 
+// the pixels of a texture file as it was decoded, every row starts on 4 bytes
+// and the bottom row comes first
+struct DecodedImage
+{
+    DecodedImage()
+        :width(0), height(0), format(0), bytesPerPixel(0)
+    {}
+
+    GLsizei width;
+    GLsizei height;
+    GLenum  format;
+    GLuint  bytesPerPixel;
+    std::vector<GLubyte> pixels;
+};
+
+typedef AssetHandle<GLuint>  TextureHandle;
+typedef AssetHandle<Mesh*>   MeshHandle;
+typedef AssetHandle<mkFont*> FontHandle;
+
 class AssetManager
 {
 public:
@@ -72,44 +95,148 @@ public:
 
     GLuint    getTexture(const std::string& filePath);
     const TextureInfo& getTextureInfo(GLuint textureName);
+    bool      isTextureReady(GLuint textureName) const;
+    // textures are compressed to BC1/BC3 with their mips when the driver
+    // supports S3TC, the result is cooked to the cache directory so only the
+    // first load pays for the encoding. An empty directory disables the cache
+    void      setTextureCompression(bool compress);
+    bool      getTextureCompression() const;
+    void      setTextureCacheDirectory(const std::string& directory);
+    const std::string& getTextureCacheDirectory() const;
 
 
     Mesh*     getMesh(const std::string& meshPath);
+    // writes meshPath as a cooked mesh (.cmesh) that loads without parsing
+    bool      cookMesh(const std::string& meshPath, const std::string& cookedPath);
+    // what loaded meshes keep in memory after their upload, meshes that were
+    // already loaded are not changed
+    void      setMeshResidency(MeshResidency residency);
+    MeshResidency getMeshResidency() const;
+    MeshMemoryUsage getMeshMemoryUsage() const;
+    // obj vertices closer than epsilon are welded, 0 only welds equal ones
+    void      setObjWeldEpsilon(float epsilon);
+    float     getObjWeldEpsilon() const;
+    void      printMeshMemoryUsage() const;
+    // prints what MeshOptimizer changed for every optimized mesh that loads
+    void      setMeshStatsOutput(bool output);
+    bool      getMeshStatsOutput() const;
 
     Shader*   getShader(const std::string& shaderPath);
+    Shader*   getShader(const std::string& shaderPath, const std::string& defines);
     int       getMaterialIndex(const Material& mat);
-    Material& getMaterial(int materialIndex);
+    const Material& getMaterial(int materialIndex);
+    void      setMaterial(int materialIndex, const Material& mat);
+    const std::vector<Material>& getMaterialVector();
+    // materials added or changed since the range was last cleared
+    const DirtyRange& getMaterialDirtyRange();
+    void      clearMaterialDirtyRange();
     int       getAttribute(const std::string& texPath, GLint wrapMode, const Material& mat,const std::string& shaderPath);
     int       getAttribute(const std::string& texPath, GLint wrapMode, GLuint matIndex, const std::string& shaderPath);
     mkFont *  getFont(std::string fontName, int fontSize, bool isPath = false);
 
+    // return at once, the file is read and decoded on a worker thread, only
+    // the GL objects are made on the GL thread by processAsyncLoads and they
+    // are added to the caches by completeAsyncLoads. A texture handle is ready
+    // once the texture exists, see isTextureReady for its pixels
+    TextureHandle getTextureAsync(const std::string& filePath);
+    MeshHandle    getMeshAsync(const std::string& meshPath);
+    FontHandle    getFontAsync(std::string fontName, int fontSize, bool isPath = false);
+    // called on the GL thread every frame, makes the GL objects of the loads
+    // that were decoded until the frame budget (in microseconds) is used
+    void      processAsyncLoads();
+    // called every frame on the thread that uses the AssetManager, which is
+    // not the GL thread when a render thread is used. The caches and the
+    // materials are only changed here
+    void      completeAsyncLoads();
+    void      setAsyncFrameBudget(GLuint budget);
+    GLuint    getAsyncFrameBudget() const;
+    // asynchronous loads that are not done yet
+    GLuint    getPendingLoadCount() const;
+
     const std::vector<Attribute>& getAttributeVector();
+    // parallel to the attribute vector
+    const std::vector<ResolvedAttribute>& getResolvedAttributeVector();
+    // has to be called after a shader or texture used by an attribute was reloaded
+    void      resolveAttributes();
+    GLuint    getSampler(GLint wrapMode);
 
 private:
     static TextureInfo s_noTextureInfo;
-    GLuint createTexture(GLsizei width, GLsizei height, GLenum format,unsigned char* data);
-
-    GLuint loadPng(const std::string& filePath);
-    GLuint loadBMP(const std::string& filePath);
-    GLuint loadJPEG(const std::string& filePath);
-
+    // decodes filePath and builds its mip chain, compressed or read from the
+    // cache when compress is set, doesn't touch GL so it can run on any thread
+    static bool prepareTexture(const std::string& filePath, bool compress, const std::string& cacheDirectory,
+                               PackedTexture& texture);
+    bool   useTextureCompression() const;
+    GLuint createTexture(const std::string& filePath, PackedTexture& texture);
+    // only makes the GL texture so it doesn't touch the AssetManager
+    static GLuint uploadTexture(const PackedTexture& texture, std::shared_ptr<UploadStatus>& upload);
+    void   addTexture(const std::string& filePath, GLuint textureID, const TextureInfo& info,
+                      const std::shared_ptr<UploadStatus>& upload);
+
+    // the decoders don't touch the AssetManager so they can run on any thread
+    static bool decodeImage(const std::string& filePath, DecodedImage& image);
+    static bool decodePng(const std::string& filePath, DecodedImage& image);
+    static bool decodeBMP(const std::string& filePath, DecodedImage& image);
+    static bool decodeJPEG(const std::string& filePath, DecodedImage& image);
+
+    Mesh*  loadMesh(const std::string& meshPath);
     Mesh*  loadObjMesh(const std::string& meshPath);
+    // builds the subMeshes without uploading them, the materials of mesh
+    // index materials, can run on any thread
+    static bool buildObjMesh(const std::string& meshPath, GLfloat weldEpsilon, bool printStats, Mesh& mesh,
+                             std::vector<Material>& materials);
+    Mesh*  addObjMesh(const std::string& meshPath, Mesh&& mesh, const std::vector<Material>& materials);
+    Mesh*  addMesh(const std::string& meshPath, Mesh&& mesh, const std::vector<Material>& materials);
     Mesh*  loadFBXMesh(const std::string& meshPath);
+    bool   buildFBXMesh(const std::string& meshPath, Mesh& mesh);
+    Mesh*  loadCookedMesh(const std::string& meshPath);
+    // uploads the subMeshes but doesn't touch the AssetManager
+    static bool buildCookedMesh(const std::string& meshPath, const std::shared_ptr<MappedFile>& file, MeshResidency residency,
+                                Mesh& mesh, std::vector<Material>& materials);
     Mesh*  generateMesh(const std::string& meshString);
+    static bool buildGeneratedMesh(const std::string& meshString, Mesh& mesh, std::vector<Material>& materials);
+    void   applyMeshResidency(Mesh& mesh);
+    void   completeMeshLoad(const std::string& meshPath, const std::shared_ptr<Mesh>& mesh,
+                            const std::vector<Material>& materials, const std::shared_ptr<Mesh>& fallback);
+    std::shared_ptr<Mesh> makeFallbackMesh();
+
+    static std::string getFontKey(const std::string& fontPath, int fontSize);
+
+    ResolvedAttribute resolveAttribute(const Attribute& attrib);
 
     const unsigned long START_TEXTURE_SIZE = 100;
 
     std::unordered_map<std::string,GLuint>   m_textureCache;
     std::unordered_map<GLuint, TextureInfo>  m_textureInfoCache;
+    // the streaming status of every loaded texture
+    std::unordered_map<GLuint, std::shared_ptr<UploadStatus>> m_textureUploads;
+    bool m_textureCompression;
+    std::string m_textureCacheDirectory;
     std::unordered_map<std::string, Mesh>    m_meshCache;
+    MeshResidency m_meshResidency;
+    float m_objWeldEpsilon;
+    bool m_meshStatsOutput;
+    // only touched on the GL thread by makeFallbackMesh
+    bool m_fallbackMeshMade;
     std::unordered_map<std::string, Shader*> m_shaderCache;
     std::unordered_map< std::string, mkFont> m_fontCache;
     std::vector<Material> m_materials;
+    DirtyRange m_materialsDirty;
     std::vector<Attribute> m_attributes;
+    std::vector<ResolvedAttribute> m_resolvedAttributes;
+    // sampler object for every wrap mode
+    std::unordered_map<GLint, GLuint> m_samplerCache;
 
     #ifdef FBX
     FbxLoader m_fbxLoader;
     #endif
+
+    // the handles of the asynchronous loads that are not done yet
+    std::unordered_map<std::string, TextureHandle> m_pendingTextures;
+    std::unordered_map<std::string, MeshHandle>    m_pendingMeshes;
+    std::unordered_map<std::string, FontHandle>    m_pendingFonts;
+    // last so its workers are stopped before anything else is destroyed
+    AsyncLoader m_asyncLoader;
 };
 
 #endif  //_ASSETMANAGER_H
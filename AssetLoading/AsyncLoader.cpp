@@ -0,0 +1,267 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "AsyncLoader.h"
+#include "../Render/GLThread.h"
+#include <cassert>
+#include <chrono>
+#include <algorithm>
+
+//-----------------------------------------------------------------------------
+// Name : Get ()
+// Desc : the pool every AsyncLoader shares
+//-----------------------------------------------------------------------------
+AsyncWorkerPool& AsyncWorkerPool::Get()
+{
+    static AsyncWorkerPool pool;
+    return pool;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AsyncWorkerPool (constructor)
+//-----------------------------------------------------------------------------
+AsyncWorkerPool::AsyncWorkerPool()
+{
+    m_stop = false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AsyncWorkerPool (destructor)
+//-----------------------------------------------------------------------------
+AsyncWorkerPool::~AsyncWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_tasks.clear();
+    }
+    m_taskQueued.notify_all();
+
+    for (std::thread& worker : m_workers)
+        worker.join();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Run ()
+//-----------------------------------------------------------------------------
+void AsyncWorkerPool::Run(const void* owner, Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_workers.empty())
+            StartWorkers();
+
+        m_tasks.push_back({owner, std::move(task)});
+    }
+    m_taskQueued.notify_one();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Cancel ()
+//-----------------------------------------------------------------------------
+void AsyncWorkerPool::Cancel(const void* owner)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_tasks.erase(std::remove_if(m_tasks.begin(), m_tasks.end(),
+                                 [owner](const QueuedTask& queued) { return queued.owner == owner; }),
+                  m_tasks.end());
+
+    m_taskDone.wait(lock, [this, owner]()
+    {
+        return std::find(m_running.begin(), m_running.end(), owner) == m_running.end();
+    });
+}
+
+//-----------------------------------------------------------------------------
+// Name : StartWorkers ()
+// Desc : one core is left to the GL thread, called with m_mutex locked
+//-----------------------------------------------------------------------------
+void AsyncWorkerPool::StartWorkers()
+{
+    GLuint workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    for (GLuint i = 0; i < workerCount; i++)
+        m_workers.emplace_back(&AsyncWorkerPool::WorkerLoop, this);
+}
+
+//-----------------------------------------------------------------------------
+// Name : WorkerLoop ()
+//-----------------------------------------------------------------------------
+void AsyncWorkerPool::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_taskQueued.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+        if (m_stop)
+            return;
+
+        QueuedTask queued = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        m_running.push_back(queued.owner);
+
+        lock.unlock();
+        queued.task();
+        // the task can hold the last reference to what it loaded
+        queued.task = nullptr;
+        lock.lock();
+
+        m_running.erase(std::find(m_running.begin(), m_running.end(), queued.owner));
+        m_taskDone.notify_all();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : AsyncLoader (constructor)
+// Desc : the pool is made first so it outlives every loader
+//-----------------------------------------------------------------------------
+AsyncLoader::AsyncLoader()
+{
+    AsyncWorkerPool::Get();
+
+    m_pendingCount = 0;
+    m_frameBudget = DEFAULT_FRAME_BUDGET;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AsyncLoader (destructor)
+// Desc : loads that were not started yet are dropped, the ones that are
+//        running are waited for but never finished or completed
+//-----------------------------------------------------------------------------
+AsyncLoader::~AsyncLoader()
+{
+    AsyncWorkerPool::Get().Cancel(this);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Enqueue ()
+//-----------------------------------------------------------------------------
+void AsyncLoader::Enqueue(LoadFunc load)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingCount++;
+    }
+
+    AsyncWorkerPool::Get().Run(this, [this, load = std::move(load)]()
+    {
+        FinishFunc finish = load();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finishes.push_back(std::move(finish));
+    });
+}
+
+//-----------------------------------------------------------------------------
+// Name : EnqueueGLJob ()
+//-----------------------------------------------------------------------------
+void AsyncLoader::EnqueueGLJob(GLJob job)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_glJobs.push_back(std::move(job));
+}
+
+//-----------------------------------------------------------------------------
+// Name : Process ()
+// Desc : the GL jobs are cheap and run outside of the budget
+//-----------------------------------------------------------------------------
+void AsyncLoader::Process()
+{
+    assert(GLThread::IsCurrent());
+    std::deque<GLJob> glJobs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        glJobs.swap(m_glJobs);
+    }
+    for (GLJob& job : glJobs)
+        job();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::microseconds budget(m_frameBudget);
+
+    while (true)
+    {
+        FinishFunc finish;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_finishes.empty())
+                break;
+
+            finish = std::move(m_finishes.front());
+            m_finishes.pop_front();
+        }
+
+        CompleteFunc complete;
+        if (finish)
+            complete = finish();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_completes.push_back(std::move(complete));
+        }
+
+        if (std::chrono::steady_clock::now() - start >= budget)
+            break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : Complete ()
+//-----------------------------------------------------------------------------
+void AsyncLoader::Complete()
+{
+    std::deque<CompleteFunc> completes;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        completes.swap(m_completes);
+    }
+
+    for (CompleteFunc& complete : completes)
+    {
+        if (complete)
+            complete();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pendingCount -= GLuint(completes.size());
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetFrameBudget ()
+//-----------------------------------------------------------------------------
+void AsyncLoader::SetFrameBudget(GLuint budget)
+{
+    m_frameBudget = budget;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetFrameBudget ()
+//-----------------------------------------------------------------------------
+GLuint AsyncLoader::GetFrameBudget() const
+{
+    return m_frameBudget;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetPendingCount ()
+//-----------------------------------------------------------------------------
+GLuint AsyncLoader::GetPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pendingCount;
+}
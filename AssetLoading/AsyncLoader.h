@@ -0,0 +1,182 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef  _ASYNCLOADER_H
+#define  _ASYNCLOADER_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <GL/glew.h>
+
+enum AssetLoadState
+{
+    ASSET_LOADING,
+    ASSET_READY,
+    ASSET_FAILED
+};
+
+//-----------------------------------------------------------------------------
+// AssetHandle - the asset of an asynchronous load, which can be used once the
+// handle is ready. Copies of a handle share the same load, failed loads hold
+// the same fallback asset the synchronous getter would return.
+//-----------------------------------------------------------------------------
+template<class T>
+class AssetHandle
+{
+public:
+    AssetHandle()
+        :m_load(std::make_shared<Load>())
+    {}
+
+    AssetLoadState GetState() const { return m_load->state.load(std::memory_order_acquire); }
+    bool           IsReady () const { return GetState() == ASSET_READY; }
+    bool           IsFailed() const { return GetState() == ASSET_FAILED; }
+    bool           IsDone  () const { return GetState() != ASSET_LOADING; }
+    // a default value until the handle is done
+    T              Get     () const { return IsDone() ? m_load->asset : T(); }
+
+    // called once on the thread owning the AssetManager when the load is done
+    void Finish(T asset, bool succeeded)
+    {
+        m_load->asset = asset;
+        m_load->state.store(succeeded ? ASSET_READY : ASSET_FAILED, std::memory_order_release);
+    }
+
+private:
+    struct Load
+    {
+        Load()
+            :asset(), state(ASSET_LOADING)
+        {}
+
+        T asset;
+        std::atomic<AssetLoadState> state;
+    };
+
+    std::shared_ptr<Load> m_load;
+};
+
+//-----------------------------------------------------------------------------
+// AsyncWorkerPool - the worker threads every AsyncLoader runs its loads on, so
+// each AssetManager doesn't start a thread per core of its own. Every task
+// belongs to an owner whose tasks can be cancelled when it goes away. The
+// workers are only started by the first task.
+//-----------------------------------------------------------------------------
+class AsyncWorkerPool
+{
+public:
+    typedef std::function<void ()> Task;
+
+    static AsyncWorkerPool& Get();
+
+    AsyncWorkerPool(const AsyncWorkerPool&) = delete;
+    AsyncWorkerPool& operator=(const AsyncWorkerPool&) = delete;
+
+    void Run   (const void* owner, Task task);
+    // drops the tasks of owner that were not started yet and waits for the
+    // ones that are running
+    void Cancel(const void* owner);
+
+private:
+    struct QueuedTask
+    {
+        const void* owner;
+        Task task;
+    };
+
+    AsyncWorkerPool();
+    ~AsyncWorkerPool();
+
+    void StartWorkers();
+    void WorkerLoop  ();
+
+    std::vector<std::thread> m_workers;
+    bool m_stop;
+
+    std::mutex m_mutex;
+    std::condition_variable m_taskQueued;
+    std::condition_variable m_taskDone;
+    std::deque<QueuedTask> m_tasks;
+    // the owner of every task that is running
+    std::vector<const void*> m_running;
+};
+
+//-----------------------------------------------------------------------------
+// AsyncLoader - runs the part of asset loads that doesn't need GL on the
+// AsyncWorkerPool. Every load returns the GL part of its work which is queued
+// to the GL thread, Process() runs those until the frame budget is used so
+// finishing a batch of loads is spread over several frames. The GL part only
+// makes GL objects, it returns the part that adds them to the caches which is
+// queued to the thread owning the assets and run by Complete(). With a render
+// thread the two are different threads, otherwise both are called on the
+// same one.
+//-----------------------------------------------------------------------------
+class AsyncLoader
+{
+public:
+    static const GLuint DEFAULT_FRAME_BUDGET = 2000;
+
+    // the bookkeeping of a load, run on the thread owning the assets
+    typedef std::function<void ()> CompleteFunc;
+    // the GL work of a load, run on the GL thread
+    typedef std::function<CompleteFunc ()> FinishFunc;
+    // GL work that isn't part of a load, like deleting an asset that was
+    // loaded twice
+    typedef std::function<void ()> GLJob;
+    // the work of a load that runs on a worker, returns the GL work of the load
+    typedef std::function<FinishFunc ()> LoadFunc;
+
+    AsyncLoader();
+    ~AsyncLoader();
+
+    AsyncLoader(const AsyncLoader&) = delete;
+    AsyncLoader& operator=(const AsyncLoader&) = delete;
+
+    void   Enqueue(LoadFunc load);
+    void   EnqueueGLJob(GLJob job);
+    // runs on the GL thread once per frame, at least one finished load is run
+    // every call so a small budget still makes progress
+    void   Process();
+    // runs on the thread owning the assets once per frame, completes every
+    // load whose GL work is done
+    void   Complete();
+
+    // in microseconds
+    void   SetFrameBudget(GLuint budget);
+    GLuint GetFrameBudget() const;
+    // loads that were not completed yet
+    GLuint GetPendingCount() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::deque<FinishFunc> m_finishes;
+    std::deque<GLJob>      m_glJobs;
+    std::deque<CompleteFunc> m_completes;
+    GLuint m_pendingCount;
+
+    GLuint m_frameBudget;
+};
+
+#endif  //_ASYNCLOADER_H
@@ -0,0 +1,442 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CookedMesh.h"
+#include "AssetManager.h"
+#include "MappedFile.h"
+#include <fstream>
+#include <memory>
+#include <cstring>
+
+// the blobs are raw copies of these so any change to them needs a new
+// COOKED_MESH_VERSION
+static_assert(sizeof(Vertex) == 32, "cooked meshes store Vertex as 32 bytes");
+static_assert(sizeof(QuantizedVertex) == 16, "cooked meshes store QuantizedVertex as 16 bytes");
+static_assert(sizeof(LodLevel) == 12, "cooked meshes store LodLevel as 12 bytes");
+static_assert(sizeof(BVHNode) == 32, "cooked meshes store BVHNode as 32 bytes");
+static_assert(sizeof(CookedMeshHeader) == 32, "CookedMeshHeader must stay 32 bytes");
+static_assert(sizeof(CookedMaterial) == 80, "CookedMaterial must stay 80 bytes");
+static_assert(sizeof(CookedSubMesh) == 128, "CookedSubMesh must stay 128 bytes");
+
+//-----------------------------------------------------------------------------
+// Name : AlignOffset ()
+//-----------------------------------------------------------------------------
+static uint64_t AlignOffset(uint64_t offset)
+{
+    return (offset + COOKED_MESH_ALIGNMENT - 1) & ~(COOKED_MESH_ALIGNMENT - 1);
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddBlob ()
+// Desc : reserves an aligned blob of size bytes and returns its offset
+//-----------------------------------------------------------------------------
+static uint64_t AddBlob(uint64_t& fileSize, uint64_t size)
+{
+    uint64_t offset = AlignOffset(fileSize);
+    fileSize = offset + size;
+    return offset;
+}
+
+//-----------------------------------------------------------------------------
+// Name : WriteBlob ()
+// Desc : pads the file up to offset and writes data there, blobs have to be
+//        written in the order of their offsets
+//-----------------------------------------------------------------------------
+static void WriteBlob(std::ofstream& out, uint64_t& position, uint64_t offset, const void* data, size_t size)
+{
+    static const char padding[COOKED_MESH_ALIGNMENT] = {};
+    while (position < offset)
+    {
+        uint64_t padSize = std::min<uint64_t>(offset - position, sizeof(padding));
+        out.write(padding, padSize);
+        position += padSize;
+    }
+
+    out.write(static_cast<const char*>(data), size);
+    position += size;
+}
+
+//-----------------------------------------------------------------------------
+// Name : WriteIndices ()
+// Desc : writes indices as indexType
+//-----------------------------------------------------------------------------
+static void WriteIndices(std::ofstream& out, uint64_t& position, uint64_t offset, GLenum indexType,
+                         const std::vector<VertexIndex>& indices)
+{
+    if (indexType == GL_UNSIGNED_SHORT)
+    {
+        std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+        WriteBlob(out, position, offset, shortIndices.data(), shortIndices.size() * sizeof(GLushort));
+    }
+    else
+        WriteBlob(out, position, offset, indices.data(), indices.size() * sizeof(VertexIndex));
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsInFile ()
+// Desc : checks that a blob read from the file is inside of it and aligned
+//-----------------------------------------------------------------------------
+static bool IsInFile(size_t fileSize, uint64_t offset, uint64_t size)
+{
+    return offset % COOKED_MESH_ALIGNMENT == 0 && offset <= fileSize && size <= fileSize - offset;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsIndexInRange ()
+// Desc : checks that every index of a blob points at one of the vertices
+//-----------------------------------------------------------------------------
+template <typename T>
+static bool IsIndexInRange(const GLubyte* indices, GLuint indexCount, GLuint vertexCount)
+{
+    const T* typedIndices = reinterpret_cast<const T*>(indices);
+    for (GLuint i = 0; i < indexCount; i++)
+    {
+        if (typedIndices[i] >= vertexCount)
+            return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsValidSubMesh ()
+// Desc : checks everything a SubMesh later indexes with, the lod levels
+//        against the lod indices, the bvh nodes against each other and the
+//        triangles and every index against the vertices. The blobs must
+//        already be known to be inside of the file
+//-----------------------------------------------------------------------------
+static bool IsValidSubMesh(const GLubyte* data, const CookedSubMesh& cooked)
+{
+    const LodLevel* lods = reinterpret_cast<const LodLevel*>(data + cooked.lodsOffset);
+    for (GLuint i = 0; i < cooked.lodCount; i++)
+    {
+        if (uint64_t(lods[i].firstIndex) + lods[i].indexCount > cooked.lodIndexCount)
+            return false;
+    }
+
+    // the children are always stored after their parent, which keeps the tree
+    // from looping and lets the depth be checked in a single pass
+    const BVHNode* nodes = reinterpret_cast<const BVHNode*>(data + cooked.bvhNodesOffset);
+    std::vector<GLuint> depths(cooked.bvhNodeCount, 0);
+    for (GLuint i = 0; i < cooked.bvhNodeCount; i++)
+    {
+        const BVHNode& node = nodes[i];
+        if (node.triCount > 0)
+        {
+            if (uint64_t(node.leftOrFirst) + node.triCount > cooked.bvhTriangleCount)
+                return false;
+            continue;
+        }
+
+        if (node.leftOrFirst <= i || uint64_t(node.leftOrFirst) + 1 >= cooked.bvhNodeCount ||
+            depths[i] >= TriangleBVH::MAX_DEPTH)
+            return false;
+        depths[node.leftOrFirst] = depths[i] + 1;
+        depths[node.leftOrFirst + 1] = depths[i] + 1;
+    }
+
+    const GLuint* triangles = reinterpret_cast<const GLuint*>(data + cooked.bvhTrianglesOffset);
+    for (GLuint i = 0; i < cooked.bvhTriangleCount; i++)
+    {
+        if (triangles[i] >= cooked.indexCount / 3)
+            return false;
+    }
+
+    if (cooked.indexType == GL_UNSIGNED_SHORT)
+    {
+        return IsIndexInRange<GLushort>(data + cooked.indicesOffset, cooked.indexCount, cooked.vertexCount) &&
+               IsIndexInRange<GLushort>(data + cooked.lodIndicesOffset, cooked.lodIndexCount, cooked.vertexCount);
+    }
+
+    return IsIndexInRange<GLuint>(data + cooked.indicesOffset, cooked.indexCount, cooked.vertexCount) &&
+           IsIndexInRange<GLuint>(data + cooked.lodIndicesOffset, cooked.lodIndexCount, cooked.vertexCount);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Save ()
+//-----------------------------------------------------------------------------
+bool CookedMesh::Save(const std::string& filePath, Mesh& mesh, AssetManager& assetManager)
+{
+    GLuint subMeshCount = mesh.getSubMeshCount();
+    for (GLuint i = 0; i < subMeshCount; i++)
+    {
+        if (mesh.getSubMesh(i).GetResidency() != MESH_RESIDENCY_FULL)
+        {
+            std::cout << "Failed to cook " << filePath << ", the mesh vertices were already released\n";
+            return false;
+        }
+    }
+
+    const std::vector<GLuint>& materials = mesh.getDefaultMaterials();
+    const std::vector<std::string>& textures = mesh.getDefaultTextures();
+
+    // lay out the whole file first so it is written front to back
+    CookedMeshHeader header;
+    header.magic = COOKED_MESH_MAGIC;
+    header.version = COOKED_MESH_VERSION;
+    header.subMeshCount = subMeshCount;
+    header.materialCount = materials.size();
+
+    uint64_t fileSize = sizeof(CookedMeshHeader);
+    header.materialsOffset = AddBlob(fileSize, uint64_t(header.materialCount) * sizeof(CookedMaterial));
+    header.subMeshesOffset = AddBlob(fileSize, uint64_t(header.subMeshCount) * sizeof(CookedSubMesh));
+
+    std::vector<CookedMaterial> cookedMaterials(header.materialCount);
+    for (GLuint i = 0; i < header.materialCount; i++)
+    {
+        const Material& material = assetManager.getMaterial(materials[i]);
+        CookedMaterial& cooked = cookedMaterials[i];
+        for (int c = 0; c < 4; c++)
+        {
+            cooked.diffuse[c] = material.diffuse[c];
+            cooked.ambient[c] = material.ambient[c];
+            cooked.specular[c] = material.specular[c];
+            cooked.emissive[c] = material.emissive[c];
+        }
+        cooked.power = material.power;
+        cooked.textureLength = (i < textures.size()) ? textures[i].size() : 0;
+        cooked.textureOffset = fileSize;
+        fileSize += cooked.textureLength;
+    }
+
+    std::vector<CookedSubMesh> cookedSubMeshes(subMeshCount);
+    for (GLuint i = 0; i < subMeshCount; i++)
+    {
+        const SubMesh& subMesh = mesh.getSubMesh(i);
+        CookedSubMesh& cooked = cookedSubMeshes[i];
+
+        cooked.vertexFormat = subMesh.GetVertexFormat();
+        cooked.indexType = subMesh.GetGeometry().indexType;
+        cooked.vertexCount = subMesh.GetVertices().size();
+        cooked.indexCount = subMesh.GetIndices().size();
+        cooked.lodIndexCount = subMesh.GetLodIndices().size();
+        cooked.lodCount = subMesh.GetLods().size();
+        cooked.bvhNodeCount = subMesh.GetBVH().GetNodes().size();
+        cooked.bvhTriangleCount = subMesh.GetBVH().GetTriangleIndices().size();
+
+        const AABB& bounds = subMesh.GetBounds();
+        const BoundingSphere& sphere = subMesh.GetBoundingSphere();
+        for (int c = 0; c < 3; c++)
+        {
+            cooked.boundsMin[c] = bounds.min[c];
+            cooked.boundsMax[c] = bounds.max[c];
+            cooked.sphereCenter[c] = sphere.center[c];
+        }
+        cooked.sphereRadius = sphere.radius;
+
+        GLuint indexSize = (cooked.indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+        cooked.verticesOffset = AddBlob(fileSize, uint64_t(cooked.vertexCount) * sizeof(Vertex));
+        if (cooked.vertexFormat == VERTEX_FORMAT_QUANTIZED)
+            cooked.gpuVerticesOffset = AddBlob(fileSize, uint64_t(cooked.vertexCount) * sizeof(QuantizedVertex));
+        else
+            cooked.gpuVerticesOffset = cooked.verticesOffset;
+        cooked.indicesOffset = AddBlob(fileSize, uint64_t(cooked.indexCount) * indexSize);
+        cooked.lodIndicesOffset = AddBlob(fileSize, uint64_t(cooked.lodIndexCount) * indexSize);
+        cooked.lodsOffset = AddBlob(fileSize, uint64_t(cooked.lodCount) * sizeof(LodLevel));
+        cooked.bvhNodesOffset = AddBlob(fileSize, uint64_t(cooked.bvhNodeCount) * sizeof(BVHNode));
+        cooked.bvhTrianglesOffset = AddBlob(fileSize, uint64_t(cooked.bvhTriangleCount) * sizeof(GLuint));
+    }
+
+    std::ofstream out(filePath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cout << "Failed to open " << filePath << " for writing\n";
+        return false;
+    }
+
+    uint64_t position = 0;
+    WriteBlob(out, position, 0, &header, sizeof(CookedMeshHeader));
+    WriteBlob(out, position, header.materialsOffset, cookedMaterials.data(), cookedMaterials.size() * sizeof(CookedMaterial));
+    WriteBlob(out, position, header.subMeshesOffset, cookedSubMeshes.data(), cookedSubMeshes.size() * sizeof(CookedSubMesh));
+    for (GLuint i = 0; i < header.materialCount; i++)
+    {
+        if (cookedMaterials[i].textureLength > 0)
+            WriteBlob(out, position, cookedMaterials[i].textureOffset, textures[i].data(), cookedMaterials[i].textureLength);
+    }
+
+    for (GLuint i = 0; i < subMeshCount; i++)
+    {
+        const SubMesh& subMesh = mesh.getSubMesh(i);
+        const CookedSubMesh& cooked = cookedSubMeshes[i];
+        const std::vector<Vertex>& vertices = subMesh.GetVertices();
+
+        WriteBlob(out, position, cooked.verticesOffset, vertices.data(), vertices.size() * sizeof(Vertex));
+        if (cooked.vertexFormat == VERTEX_FORMAT_QUANTIZED)
+        {
+            std::vector<QuantizedVertex> quantizedVertices;
+            QuantizeVertices(vertices, subMesh.GetBounds(), quantizedVertices);
+            WriteBlob(out, position, cooked.gpuVerticesOffset, quantizedVertices.data(), quantizedVertices.size() * sizeof(QuantizedVertex));
+        }
+
+        WriteIndices(out, position, cooked.indicesOffset, cooked.indexType, subMesh.GetIndices());
+        WriteIndices(out, position, cooked.lodIndicesOffset, cooked.indexType, subMesh.GetLodIndices());
+
+        const TriangleBVH& bvh = subMesh.GetBVH();
+        WriteBlob(out, position, cooked.lodsOffset, subMesh.GetLods().data(), cooked.lodCount * sizeof(LodLevel));
+        WriteBlob(out, position, cooked.bvhNodesOffset, bvh.GetNodes().data(), cooked.bvhNodeCount * sizeof(BVHNode));
+        WriteBlob(out, position, cooked.bvhTrianglesOffset, bvh.GetTriangleIndices().data(), cooked.bvhTriangleCount * sizeof(GLuint));
+    }
+
+    if (!out.good())
+    {
+        std::cout << "Failed to write " << filePath << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Load ()
+// Desc : the subMeshes stream their GPU data straight from the mapped file,
+//        the mapping is closed once the last of the uploads finished
+//-----------------------------------------------------------------------------
+bool CookedMesh::Load(const std::string& filePath, AssetManager& assetManager, MeshResidency residency,
+                      std::vector<SubMesh>& subMeshes, std::vector<GLuint>& materials, std::vector<std::string>& textures)
+{
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->Open(filePath))
+        return false;
+
+    std::vector<Material> fileMaterials;
+    if (!Load(filePath, file, residency, subMeshes, fileMaterials, textures))
+        return false;
+
+    for (const Material& material : fileMaterials)
+        materials.push_back(assetManager.getMaterialIndex(material));
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Load ()
+//-----------------------------------------------------------------------------
+bool CookedMesh::Load(const std::string& filePath, const std::shared_ptr<MappedFile>& file, MeshResidency residency,
+                      std::vector<SubMesh>& subMeshes, std::vector<Material>& materials, std::vector<std::string>& textures)
+{
+
+    const GLubyte* data = file->GetData();
+    size_t fileSize = file->GetSize();
+
+    CookedMeshHeader header;
+    if (fileSize < sizeof(CookedMeshHeader))
+    {
+        std::cout << filePath << " is not a cooked mesh\n";
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(CookedMeshHeader));
+
+    if (header.magic != COOKED_MESH_MAGIC)
+    {
+        std::cout << filePath << " is not a cooked mesh\n";
+        return false;
+    }
+
+    if (header.version != COOKED_MESH_VERSION)
+    {
+        std::cout << filePath << " was cooked with version " << header.version << ", it has to be cooked again\n";
+        return false;
+    }
+
+    if (!IsInFile(fileSize, header.materialsOffset, uint64_t(header.materialCount) * sizeof(CookedMaterial)) ||
+        !IsInFile(fileSize, header.subMeshesOffset, uint64_t(header.subMeshCount) * sizeof(CookedSubMesh)))
+    {
+        std::cout << filePath << " is truncated\n";
+        return false;
+    }
+
+    const CookedMaterial* cookedMaterials = reinterpret_cast<const CookedMaterial*>(data + header.materialsOffset);
+    for (GLuint i = 0; i < header.materialCount; i++)
+    {
+        const CookedMaterial& cooked = cookedMaterials[i];
+        // the texture paths are not aligned
+        if (cooked.textureOffset > fileSize || cooked.textureLength > fileSize - cooked.textureOffset)
+        {
+            std::cout << filePath << " is truncated\n";
+            return false;
+        }
+
+        materials.emplace_back(glm::vec4(cooked.diffuse[0], cooked.diffuse[1], cooked.diffuse[2], cooked.diffuse[3]),
+                               glm::vec4(cooked.ambient[0], cooked.ambient[1], cooked.ambient[2], cooked.ambient[3]),
+                               glm::vec4(cooked.specular[0], cooked.specular[1], cooked.specular[2], cooked.specular[3]),
+                               glm::vec4(cooked.emissive[0], cooked.emissive[1], cooked.emissive[2], cooked.emissive[3]),
+                               cooked.power);
+        textures.emplace_back(reinterpret_cast<const char*>(data + cooked.textureOffset), cooked.textureLength);
+    }
+
+    const CookedSubMesh* cookedSubMeshes = reinterpret_cast<const CookedSubMesh*>(data + header.subMeshesOffset);
+    subMeshes.reserve(header.subMeshCount);
+    for (GLuint i = 0; i < header.subMeshCount; i++)
+    {
+        const CookedSubMesh& cooked = cookedSubMeshes[i];
+        if (cooked.vertexFormat >= VERTEX_FORMAT_COUNT ||
+            (cooked.indexType != GL_UNSIGNED_SHORT && cooked.indexType != GL_UNSIGNED_INT))
+        {
+            std::cout << filePath << " has an unknown vertex or index format\n";
+            return false;
+        }
+
+        GLuint indexSize = (cooked.indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+        if (!IsInFile(fileSize, cooked.verticesOffset, uint64_t(cooked.vertexCount) * sizeof(Vertex)) ||
+            !IsInFile(fileSize, cooked.gpuVerticesOffset, uint64_t(cooked.vertexCount) * VERTEX_FORMATS[cooked.vertexFormat].stride) ||
+            !IsInFile(fileSize, cooked.indicesOffset, uint64_t(cooked.indexCount) * indexSize) ||
+            !IsInFile(fileSize, cooked.lodIndicesOffset, uint64_t(cooked.lodIndexCount) * indexSize) ||
+            !IsInFile(fileSize, cooked.lodsOffset, uint64_t(cooked.lodCount) * sizeof(LodLevel)) ||
+            !IsInFile(fileSize, cooked.bvhNodesOffset, uint64_t(cooked.bvhNodeCount) * sizeof(BVHNode)) ||
+            !IsInFile(fileSize, cooked.bvhTrianglesOffset, uint64_t(cooked.bvhTriangleCount) * sizeof(GLuint)))
+        {
+            std::cout << filePath << " is truncated\n";
+            return false;
+        }
+
+        if (!IsValidSubMesh(data, cooked))
+        {
+            std::cout << filePath << " has a lod, bvh or index out of range\n";
+            return false;
+        }
+
+        PackedSubMesh packed;
+        packed.vertexFormat = VertexFormat(cooked.vertexFormat);
+        packed.indexType = cooked.indexType;
+        packed.vertexCount = cooked.vertexCount;
+        packed.indexCount = cooked.indexCount;
+        packed.lodIndexCount = cooked.lodIndexCount;
+        packed.lodCount = cooked.lodCount;
+        packed.bvhNodeCount = cooked.bvhNodeCount;
+        packed.bvhTriangleCount = cooked.bvhTriangleCount;
+
+        // the upload data shares the ownership of the mapping
+        packed.vertices = reinterpret_cast<const Vertex*>(data + cooked.verticesOffset);
+        packed.gpuVertices = UploadData(file, data + cooked.gpuVerticesOffset);
+        packed.indices = UploadData(file, data + cooked.indicesOffset);
+        packed.lodIndices = UploadData(file, data + cooked.lodIndicesOffset);
+        packed.lods = reinterpret_cast<const LodLevel*>(data + cooked.lodsOffset);
+        packed.bvhNodes = reinterpret_cast<const BVHNode*>(data + cooked.bvhNodesOffset);
+        packed.bvhTriangles = reinterpret_cast<const GLuint*>(data + cooked.bvhTrianglesOffset);
+
+        packed.bounds = AABB(glm::vec3(cooked.boundsMin[0], cooked.boundsMin[1], cooked.boundsMin[2]),
+                             glm::vec3(cooked.boundsMax[0], cooked.boundsMax[1], cooked.boundsMax[2]));
+        packed.boundingSphere = BoundingSphere(glm::vec3(cooked.sphereCenter[0], cooked.sphereCenter[1], cooked.sphereCenter[2]),
+                                               cooked.sphereRadius);
+
+        subMeshes.emplace_back(packed, residency);
+    }
+
+    return true;
+}
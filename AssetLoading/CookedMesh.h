@@ -0,0 +1,117 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef  _COOKEDMESH_H
+#define  _COOKEDMESH_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <GL/glew.h>
+#include "../Render/Mesh.h"
+#include "MappedFile.h"
+
+class AssetManager;
+
+// file layout of a cooked mesh (.cmesh):
+//   CookedMeshHeader
+//   CookedMaterial[materialCount]
+//   CookedSubMesh[subMeshCount]
+//   the texture paths and the blobs of every subMesh
+// every blob starts on COOKED_MESH_ALIGNMENT bytes and is stored exactly as
+// the SubMesh and the GPU use it, in the byte order of the machine that
+// cooked it. COOKED_MESH_VERSION changes whenever one of the layouts does.
+const uint32_t COOKED_MESH_MAGIC     = 0x48534d43; // "CMSH"
+const uint32_t COOKED_MESH_VERSION   = 1;
+const uint64_t COOKED_MESH_ALIGNMENT = 16;
+
+struct CookedMeshHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t subMeshCount;
+    uint32_t materialCount;
+    uint64_t materialsOffset;
+    uint64_t subMeshesOffset;
+};
+
+struct CookedMaterial
+{
+    float    diffuse[4];
+    float    ambient[4];
+    float    specular[4];
+    float    emissive[4];
+    float    power;
+    uint32_t textureLength;
+    uint64_t textureOffset;
+};
+
+struct CookedSubMesh
+{
+    uint32_t vertexFormat;
+    uint32_t indexType;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t lodIndexCount;
+    uint32_t lodCount;
+    uint32_t bvhNodeCount;
+    uint32_t bvhTriangleCount;
+
+    float    boundsMin[3];
+    float    boundsMax[3];
+    float    sphereCenter[3];
+    float    sphereRadius;
+
+    // Vertex array, equal to gpuVerticesOffset for VERTEX_FORMAT_FLOAT
+    uint64_t verticesOffset;
+    // vertices in vertexFormat, indices and lod indices in indexType
+    uint64_t gpuVerticesOffset;
+    uint64_t indicesOffset;
+    uint64_t lodIndicesOffset;
+    // LodLevel, BVHNode and GLuint arrays
+    uint64_t lodsOffset;
+    uint64_t bvhNodesOffset;
+    uint64_t bvhTrianglesOffset;
+};
+
+//-----------------------------------------------------------------------------
+// CookedMesh - reads and writes the binary mesh format. A cooked mesh is
+// written once from a loaded mesh with everything calculated at load time
+// (optimized indices, lod chain, picking BVH) and is then loaded by mapping
+// the file and streaming its blobs to the GPU as they are, nothing is parsed
+// or calculated again.
+//-----------------------------------------------------------------------------
+class CookedMesh
+{
+public:
+    // every subMesh of mesh must still have MESH_RESIDENCY_FULL
+    static bool Save(const std::string& filePath, Mesh& mesh, AssetManager& assetManager);
+    static bool Load(const std::string& filePath, AssetManager& assetManager, MeshResidency residency,
+                     std::vector<SubMesh>& subMeshes, std::vector<GLuint>& materials, std::vector<std::string>& textures);
+    // loads from a file that was already mapped, filePath is only used for
+    // errors. The materials are returned as they are in the file so the
+    // AssetManager isn't touched
+    static bool Load(const std::string& filePath, const std::shared_ptr<MappedFile>& file, MeshResidency residency,
+                     std::vector<SubMesh>& subMeshes, std::vector<Material>& materials, std::vector<std::string>& textures);
+};
+
+#endif  //_COOKEDMESH_H
@@ -0,0 +1,221 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CookedTexture.h"
+#include "MappedFile.h"
+#include "TextureCompressor.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+//-----------------------------------------------------------------------------
+// Name : AlignOffset ()
+//-----------------------------------------------------------------------------
+static uint64_t AlignOffset(uint64_t offset)
+{
+    return (offset + COOKED_TEXTURE_ALIGNMENT - 1) & ~(COOKED_TEXTURE_ALIGNMENT - 1);
+}
+
+//-----------------------------------------------------------------------------
+// Name : HashData ()
+//-----------------------------------------------------------------------------
+uint64_t CookedTexture::HashData(const GLubyte* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetCachePath ()
+//-----------------------------------------------------------------------------
+std::string CookedTexture::GetCachePath(const std::string& cacheDirectory, uint64_t sourceHash)
+{
+    std::stringstream path;
+    path << cacheDirectory;
+    if (!cacheDirectory.empty() && cacheDirectory.back() != '/' && cacheDirectory.back() != '\\')
+        path << '/';
+    path << std::hex << std::setw(16) << std::setfill('0') << sourceHash << ".ctex";
+
+    return path.str();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Save ()
+// Desc : the file is written under a temporary name and renamed once it is
+//        complete, so a texture that is loaded meanwhile never sees half of it
+//-----------------------------------------------------------------------------
+bool CookedTexture::Save(const std::string& filePath, uint64_t sourceHash, const PackedTexture& texture)
+{
+    if (TextureCompressor::GetBlockSize(texture.internalFormat) == 0)
+    {
+        std::cout << "Failed to cook " << filePath << ", only compressed textures are cooked\n";
+        return false;
+    }
+
+    CookedTextureHeader header;
+    header.magic = COOKED_TEXTURE_MAGIC;
+    header.version = COOKED_TEXTURE_VERSION;
+    header.internalFormat = texture.internalFormat;
+    header.levelCount = texture.levels.size();
+    header.sourceHash = sourceHash;
+
+    std::vector<CookedTextureLevel> cookedLevels(texture.levels.size());
+    uint64_t fileSize = sizeof(CookedTextureHeader) + cookedLevels.size() * sizeof(CookedTextureLevel);
+    for (size_t i = 0; i < texture.levels.size(); i++)
+    {
+        cookedLevels[i].width = texture.levels[i].width;
+        cookedLevels[i].height = texture.levels[i].height;
+        cookedLevels[i].offset = AlignOffset(fileSize);
+        cookedLevels[i].size = texture.levels[i].size;
+        fileSize = cookedLevels[i].offset + cookedLevels[i].size;
+    }
+
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::path(filePath).parent_path();
+    if (!directory.empty())
+        std::filesystem::create_directories(directory, error);
+
+    std::stringstream tempPath;
+    tempPath << filePath << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+
+    std::ofstream out(tempPath.str(), std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cout << "Failed to open " << tempPath.str() << " for writing\n";
+        return false;
+    }
+
+    static const char padding[COOKED_TEXTURE_ALIGNMENT] = {};
+    uint64_t position = sizeof(CookedTextureHeader) + cookedLevels.size() * sizeof(CookedTextureLevel);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(CookedTextureHeader));
+    out.write(reinterpret_cast<const char*>(cookedLevels.data()), cookedLevels.size() * sizeof(CookedTextureLevel));
+    for (size_t i = 0; i < texture.levels.size(); i++)
+    {
+        out.write(padding, cookedLevels[i].offset - position);
+        out.write(reinterpret_cast<const char*>(texture.levels[i].data.get()), cookedLevels[i].size);
+        position = cookedLevels[i].offset + cookedLevels[i].size;
+    }
+
+    bool written = out.good();
+    out.close();
+
+    if (!written)
+    {
+        std::cout << "Failed to write " << tempPath.str() << "\n";
+        std::remove(tempPath.str().c_str());
+        return false;
+    }
+
+    std::filesystem::rename(tempPath.str(), filePath, error);
+    if (error)
+    {
+        // another thread cooked the same source first
+        std::remove(tempPath.str().c_str());
+        return std::filesystem::exists(filePath, error);
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Load ()
+// Desc : the levels stream straight from the mapped file
+//-----------------------------------------------------------------------------
+bool CookedTexture::Load(const std::string& filePath, uint64_t sourceHash, PackedTexture& texture)
+{
+    std::error_code error;
+    if (!std::filesystem::exists(filePath, error))
+        return false;
+
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->Open(filePath))
+        return false;
+
+    const GLubyte* data = file->GetData();
+    size_t fileSize = file->GetSize();
+
+    CookedTextureHeader header;
+    if (fileSize < sizeof(CookedTextureHeader))
+    {
+        std::cout << filePath << " is not a cooked texture\n";
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(CookedTextureHeader));
+
+    if (header.magic != COOKED_TEXTURE_MAGIC)
+    {
+        std::cout << filePath << " is not a cooked texture\n";
+        return false;
+    }
+
+    // older cooks are simply replaced
+    if (header.version != COOKED_TEXTURE_VERSION)
+        return false;
+
+    if (header.sourceHash != sourceHash)
+    {
+        std::cout << filePath << " was cooked from another source\n";
+        return false;
+    }
+
+    if (TextureCompressor::GetBlockSize(header.internalFormat) == 0 || header.levelCount == 0 ||
+        header.levelCount > (fileSize - sizeof(CookedTextureHeader)) / sizeof(CookedTextureLevel))
+    {
+        std::cout << filePath << " is truncated\n";
+        return false;
+    }
+
+    std::vector<CookedTextureLevel> cookedLevels(header.levelCount);
+    std::memcpy(cookedLevels.data(), data + sizeof(CookedTextureHeader), header.levelCount * sizeof(CookedTextureLevel));
+
+    texture.internalFormat = header.internalFormat;
+    texture.levels.clear();
+    for (const CookedTextureLevel& cooked : cookedLevels)
+    {
+        uint64_t size = TextureCompressor::GetCompressedSize(header.internalFormat, cooked.width, cooked.height);
+        if (cooked.width == 0 || cooked.height == 0 || cooked.size != size || cooked.offset % COOKED_TEXTURE_ALIGNMENT != 0 ||
+            cooked.offset > fileSize || size > fileSize - cooked.offset)
+        {
+            std::cout << filePath << " is truncated\n";
+            texture.levels.clear();
+            return false;
+        }
+
+        TextureLevel level;
+        level.width = cooked.width;
+        level.height = cooked.height;
+        level.size = cooked.size;
+        level.data = UploadData(file, data + cooked.offset);
+        texture.levels.push_back(level);
+    }
+
+    return true;
+}
@@ -0,0 +1,97 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef  _COOKEDTEXTURE_H
+#define  _COOKEDTEXTURE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <GL/glew.h>
+#include "../Render/UploadManager.h"
+
+// a level of a mip chain as it is uploaded
+struct TextureLevel
+{
+    GLsizei    width;
+    GLsizei    height;
+    GLsizeiptr size;
+    UploadData data;
+};
+
+// a texture with its whole mip chain, format is the pixel format of the
+// levels when internalFormat isn't a compressed one
+struct PackedTexture
+{
+    PackedTexture()
+        :internalFormat(GL_RGBA8), format(GL_RGBA)
+    {}
+
+    GLenum internalFormat;
+    GLenum format;
+    std::vector<TextureLevel> levels;
+};
+
+// file layout of a cooked texture (.ctex):
+//   CookedTextureHeader
+//   CookedTextureLevel[levelCount]
+//   the blocks of every level, each starting on COOKED_TEXTURE_ALIGNMENT bytes
+// the file is named by the hash of the source file it was cooked from so a
+// changed source is cooked again. COOKED_TEXTURE_VERSION changes whenever the
+// layout or the encoder does.
+const uint32_t COOKED_TEXTURE_MAGIC     = 0x58455443; // "CTEX"
+const uint32_t COOKED_TEXTURE_VERSION   = 1;
+const uint64_t COOKED_TEXTURE_ALIGNMENT = 16;
+
+struct CookedTextureHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t internalFormat;
+    uint32_t levelCount;
+    uint64_t sourceHash;
+};
+
+struct CookedTextureLevel
+{
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+};
+
+//-----------------------------------------------------------------------------
+// CookedTexture - the on disk cache of compressed textures. Encoding a mip
+// chain is only done the first time a texture is loaded, later loads map the
+// cooked file and stream its levels to the GPU as they are.
+//-----------------------------------------------------------------------------
+class CookedTexture
+{
+public:
+    // FNV-1a of the source file
+    static uint64_t    HashData    (const GLubyte* data, size_t size);
+    static std::string GetCachePath(const std::string& cacheDirectory, uint64_t sourceHash);
+
+    // only compressed textures are cooked, the directory is created if needed
+    static bool Save(const std::string& filePath, uint64_t sourceHash, const PackedTexture& texture);
+    // fails without a message when there is no cooked file yet
+    static bool Load(const std::string& filePath, uint64_t sourceHash, PackedTexture& texture);
+};
+
+#endif  //_COOKEDTEXTURE_H
@@ -19,6 +19,8 @@
 //
 
 #include "FbxLoader.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 #include <iostream>
 #include <exception>
 
@@ -79,6 +81,9 @@ bool FbxLoader::LoadMesh(std::string meshPath, std::vector<SubMesh>& subMeshes)
 
             FbxVector4* pFBXVertices = pMesh->GetControlPoints();
             GLuint vertexCount = 0;
+            // every node is its own subMesh with indices starting from 0
+            vertices.clear();
+            indices.clear();
 
             for (int j = 0; j < pMesh->GetPolygonCount(); j++)
             {
@@ -106,7 +111,14 @@ bool FbxLoader::LoadMesh(std::string meshPath, std::vector<SubMesh>& subMeshes)
 
             }
 
-            subMeshes.emplace_back(vertices, indices);
+            MeshOptimizer::Optimize(vertices, indices);
+
+            std::vector<VertexIndex> lodIndices;
+            std::vector<LodLevel> lods;
+            MeshSimplifier::BuildLodChain(vertices, indices, lodIndices, lods);
+
+            subMeshes.emplace_back(std::move(vertices), std::move(indices));
+            subMeshes.back().SetLodChain(std::move(lodIndices), std::move(lods));
         }
 
         return true;
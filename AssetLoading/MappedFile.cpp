@@ -0,0 +1,170 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // _WIN32
+
+//-----------------------------------------------------------------------------
+// Name : MappedFile (constructor)
+//-----------------------------------------------------------------------------
+MappedFile::MappedFile()
+    :m_data(nullptr), m_size(0)
+#ifdef _WIN32
+    ,m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+#endif // _WIN32
+{
+}
+
+//-----------------------------------------------------------------------------
+// Name : MappedFile (destructor)
+//-----------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Open ()
+// Desc : maps the whole file, empty files can't be mapped and fail
+//-----------------------------------------------------------------------------
+bool MappedFile::Open(const std::string& filePath)
+{
+    Close();
+
+#ifdef _WIN32
+    m_file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        std::cout << "Failed to open " << filePath << "\n";
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        std::cout << "Failed to map " << filePath << ", the file is empty\n";
+        Close();
+        return false;
+    }
+
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping != nullptr)
+        m_data = static_cast<const GLubyte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+
+    if (m_data == nullptr)
+    {
+        std::cout << "Failed to map " << filePath << "\n";
+        Close();
+        return false;
+    }
+
+    m_size = size_t(fileSize.QuadPart);
+#else
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        std::cout << "Failed to open " << filePath << "\n";
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == -1 || fileStat.st_size == 0)
+    {
+        std::cout << "Failed to map " << filePath << ", the file is empty\n";
+        close(fd);
+        return false;
+    }
+
+    // the mapping keeps the file alive so the descriptor isn't needed anymore
+    void* data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        std::cout << "Failed to map " << filePath << "\n";
+        return false;
+    }
+
+    m_data = static_cast<const GLubyte*>(data);
+    m_size = size_t(fileStat.st_size);
+#endif // _WIN32
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Close ()
+//-----------------------------------------------------------------------------
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr)
+        CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file);
+
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+#else
+    if (m_data != nullptr)
+        munmap(const_cast<GLubyte*>(m_data), m_size);
+#endif // _WIN32
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetData ()
+//-----------------------------------------------------------------------------
+const GLubyte* MappedFile::GetData() const
+{
+    return m_data;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetSize ()
+//-----------------------------------------------------------------------------
+size_t MappedFile::GetSize() const
+{
+    return m_size;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Prefetch ()
+//-----------------------------------------------------------------------------
+void MappedFile::Prefetch() const
+{
+    const size_t pageSize = 4096;
+
+    volatile GLubyte sum = 0;
+    for (size_t offset = 0; offset < m_size; offset += pageSize)
+        sum = sum + m_data[offset];
+}
@@ -0,0 +1,61 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef  _MAPPEDFILE_H
+#define  _MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+#include <GL/glew.h>
+
+//-----------------------------------------------------------------------------
+// MappedFile - a read only memory mapping of a whole file. The pages are only
+// read from disk when they are touched, so a loader can hand slices of the
+// file to the GPU upload without copying or parsing them first.
+//-----------------------------------------------------------------------------
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open (const std::string& filePath);
+    void Close();
+
+    const GLubyte* GetData() const;
+    size_t         GetSize() const;
+    // reads every page of the file on the calling thread, so a loader that
+    // only maps the file on a worker doesn't wait on the disk later
+    void           Prefetch() const;
+
+private:
+    const GLubyte* m_data;
+    size_t         m_size;
+#ifdef _WIN32
+    void*          m_file;
+    void*          m_mapping;
+#endif // _WIN32
+};
+
+#endif  //_MAPPEDFILE_H
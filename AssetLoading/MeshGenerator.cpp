@@ -38,7 +38,7 @@ const glm::vec2 MeshGenerator::reverseVerticalUvValues[4] = {glm::vec2(0,1),
 //-----------------------------------------------------------------------------
 // Name : createBoardMesh
 //-----------------------------------------------------------------------------
-Mesh MeshGenerator::createBoardMesh(AssetManager& assetManager, const glm::vec2& scale)
+Mesh MeshGenerator::createBoardMesh(const glm::vec2& scale)
 {
     float stepX = 1.0f * scale.x;
     float stepZ = 1.0f * scale.y;
@@ -49,7 +49,7 @@ Mesh MeshGenerator::createBoardMesh(AssetManager& assetManager, const glm::vec2&
     createBoardSubMeshes(stepX, stepZ, boardSubMeshes);
     createFrameSubMeshes(stepX, stepZ, boardSubMeshes);
         
-    GLuint materialIndex = assetManager.getMaterialIndex(WHITE_MATERIAL);
+    GLuint materialIndex = 0;
     std::vector<GLuint> materials = 
     {
         materialIndex, materialIndex, materialIndex, materialIndex,
@@ -126,8 +126,9 @@ void MeshGenerator::createBoardSubMeshes(float stepX, float stepZ, std::vector<S
         vIndex++;
     }
     
-    boardSubMeshes.emplace_back(boardSquaresVertices, blackSqureIndices);
-    boardSubMeshes.emplace_back(boardSquaresVertices, whiteSqureIndices);
+    // both colors share the vertices so only the last one takes them
+    boardSubMeshes.emplace_back(boardSquaresVertices, std::move(blackSqureIndices));
+    boardSubMeshes.emplace_back(std::move(boardSquaresVertices), std::move(whiteSqureIndices));
 }
 
 //-----------------------------------------------------------------------------
@@ -163,7 +164,7 @@ void MeshGenerator::createFrameSubMeshes(float stepX, float stepZ, std::vector<S
         
         createVerticalFrameSquare(frameVertices, frameIndices, framePos, stepX, stepZ, i);
         
-        boardSubMeshes.emplace_back(frameVertices, frameIndices); 
+        boardSubMeshes.emplace_back(std::move(frameVertices), std::move(frameIndices)); 
     }
     
     for (int i = 1; i < nVertX; i++)
@@ -173,13 +174,13 @@ void MeshGenerator::createFrameSubMeshes(float stepX, float stepZ, std::vector<S
         
         createHorizontalFrameSquare(frameVertices, frameIndices, framePos, stepX, stepZ, i);
         
-        boardSubMeshes.emplace_back(frameVertices, frameIndices);
+        boardSubMeshes.emplace_back(std::move(frameVertices), std::move(frameIndices));
     }
     
     std::vector<Vertex> frameCornerVertices;
     std::vector<VertexIndex> frameCornerIndices;
     createCornersFrameSquare(frameCornerVertices, frameCornerIndices,framePos, stepX, stepZ);
-    boardSubMeshes.emplace_back(frameCornerVertices, frameCornerIndices);
+    boardSubMeshes.emplace_back(std::move(frameCornerVertices), std::move(frameCornerIndices));
 }
 
 //-----------------------------------------------------------------------------
@@ -272,7 +273,7 @@ void MeshGenerator::createFrameSquare(glm::vec3 pos, float stepX, float stepZ, c
 //-----------------------------------------------------------------------------
 // Name : createSquareMesh
 //-----------------------------------------------------------------------------
-Mesh MeshGenerator::createSquareMesh(AssetManager& assetManager, const glm::vec2& scale)
+Mesh MeshGenerator::createSquareMesh(const glm::vec2& scale)
 {
     std::vector<Vertex> squareVertices;
     std::vector<VertexIndex> squareIndices;
@@ -288,10 +289,9 @@ Mesh MeshGenerator::createSquareMesh(AssetManager& assetManager, const glm::vec2
     createSquareIndices(squareIndices);
     
     std::vector<SubMesh> squareSubMesh;
-    squareSubMesh.emplace_back(squareVertices, squareIndices);
+    squareSubMesh.emplace_back(std::move(squareVertices), std::move(squareIndices));
     
-    GLuint materialIndex = assetManager.getMaterialIndex(WHITE_MATERIAL);
-    std::vector<GLuint> squareMatrial = {materialIndex};
+    std::vector<GLuint> squareMatrial = {0};
     std::vector<std::string> squareTexture = {""};
     
     return Mesh(std::move(squareSubMesh), std::move(squareMatrial), std::move(squareTexture));
@@ -331,7 +331,7 @@ Mesh MeshGenerator::createSkyBoxMesh()
     cubeVertices.emplace_back(glm::vec3(-10.0f, -10.0f, -10.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(0.0f, 0.0f));
     createSquareIndices(cubeIndices);
     
-    cubeFaces.emplace_back(cubeVertices, cubeIndices);
+    cubeFaces.emplace_back(std::move(cubeVertices), std::move(cubeIndices));
     cubeVertices.clear();
     cubeIndices.clear();
     
@@ -342,7 +342,7 @@ Mesh MeshGenerator::createSkyBoxMesh()
     cubeVertices.emplace_back(glm::vec3(-10.0f, 10.0f, -10.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec2(0.0f, 0.0f));
     createSquareIndices(cubeIndices);
     
-    cubeFaces.emplace_back(cubeVertices, cubeIndices);
+    cubeFaces.emplace_back(std::move(cubeVertices), std::move(cubeIndices));
     cubeVertices.clear();
     cubeIndices.clear();
 
@@ -353,7 +353,7 @@ Mesh MeshGenerator::createSkyBoxMesh()
     cubeVertices.emplace_back(glm::vec3(10.0f, 10.0f, -10.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec2(0.0f, 1.0f));
     createSquareIndices(cubeIndices);
     
-    cubeFaces.emplace_back(cubeVertices, cubeIndices);
+    cubeFaces.emplace_back(std::move(cubeVertices), std::move(cubeIndices));
     cubeVertices.clear();
     cubeIndices.clear();
     
@@ -364,7 +364,7 @@ Mesh MeshGenerator::createSkyBoxMesh()
     cubeVertices.emplace_back(glm::vec3(-10.0f, -10.0f, -10.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec2(1.0f, 0.0f));
     createSquareIndices(cubeIndices);
     
-    cubeFaces.emplace_back(cubeVertices, cubeIndices);
+    cubeFaces.emplace_back(std::move(cubeVertices), std::move(cubeIndices));
     cubeVertices.clear();
     cubeIndices.clear();
     
@@ -375,7 +375,7 @@ Mesh MeshGenerator::createSkyBoxMesh()
     cubeVertices.emplace_back(glm::vec3(-10.0f, -10.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(0.0f, 1.0f));
     createSquareIndices(cubeIndices);
     
-    cubeFaces.emplace_back(cubeVertices, cubeIndices);
+    cubeFaces.emplace_back(std::move(cubeVertices), std::move(cubeIndices));
     cubeVertices.clear();
     cubeIndices.clear();
     
@@ -386,7 +386,7 @@ Mesh MeshGenerator::createSkyBoxMesh()
     cubeVertices.emplace_back(glm::vec3(10.0f, 10.0f, 10.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 1.0f));
     createSquareIndices(cubeIndices);
     
-    cubeFaces.emplace_back(cubeVertices, cubeIndices);
+    cubeFaces.emplace_back(std::move(cubeVertices), std::move(cubeIndices));
     cubeVertices.clear();
     cubeIndices.clear();
         
@@ -449,7 +449,7 @@ Mesh MeshGenerator::createCubeMesh()
     cubeVertices.emplace_back(glm::vec3(cubeSize, -cubeSize, -cubeSize), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(0.0f, 0.0f));
     cubeVertices.emplace_back(glm::vec3(-cubeSize, -cubeSize, -cubeSize), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(1.0f, 1.0f));
     
-    cubeFaces.emplace_back(cubeVertices, cubeIndices);
+    cubeFaces.emplace_back(std::move(cubeVertices), std::move(cubeIndices));
         
     std::vector<GLuint> cubeMatrial;
     std::vector<std::string> cubeTexture;
@@ -26,8 +26,10 @@
 class MeshGenerator
 {
 public:
-    static Mesh createBoardMesh(AssetManager& assetManager, const glm::vec2& scale);
-    static Mesh createSquareMesh(AssetManager& assetManager, const glm::vec2& scale);
+    // the default materials of the board and the square are index 0 of the
+    // material vector they are added with, the AssetManager isn't touched
+    static Mesh createBoardMesh(const glm::vec2& scale);
+    static Mesh createSquareMesh(const glm::vec2& scale);
     static Mesh createSkyBoxMesh();
     static Mesh createCubeMesh();
     
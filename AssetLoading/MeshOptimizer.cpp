@@ -0,0 +1,379 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+//-----------------------------------------------------------------------------
+// Name : Optimize ()
+// Desc : runs every stage on a triangle list, stats receives the cache
+//        statistics before and after the index reordering stages
+//-----------------------------------------------------------------------------
+void MeshOptimizer::Optimize(std::vector<Vertex>& vertices, std::vector<VertexIndex>& indices,
+                             MeshOptimizeStats* stats /*= nullptr*/, bool optimizeOverdraw /*= true*/)
+{
+    if (indices.size() < 3)
+        return;
+
+    GLuint vertexCount = vertices.size();
+    if (stats)
+        stats->original = AnalyzeVertexCache(indices, vertexCount);
+
+    std::vector<GLuint> clusters;
+    OptimizeVertexCache(indices, vertexCount, &clusters);
+    if (stats)
+        stats->vertexCache = AnalyzeVertexCache(indices, vertexCount);
+
+    if (optimizeOverdraw)
+        OptimizeOverdraw(vertices, indices, clusters);
+    if (stats)
+        stats->overdraw = AnalyzeVertexCache(indices, vertexCount);
+
+    // doesn't change the triangle order so the stats stay the same
+    OptimizeVertexFetch(vertices, indices);
+}
+
+//-----------------------------------------------------------------------------
+// Name : OptimizeVertexCache ()
+// Desc : Tipsify (Sander, Nehab and Barczak 2007). Fans around the last
+//        vertex that is still likely to be in the cache, when there is none
+//        it restarts from a recently used vertex or the next unused one.
+//        clusters receives the first triangle of every restart.
+//-----------------------------------------------------------------------------
+void MeshOptimizer::OptimizeVertexCache(std::vector<VertexIndex>& indices, GLuint vertexCount, std::vector<GLuint>* clusters /*= nullptr*/)
+{
+    GLuint triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // triangles of every vertex, adjacency[offsets[v], offsets[v + 1])
+    std::vector<GLuint> offsets(vertexCount + 1, 0);
+    for (GLuint i = 0; i < triangleCount * 3; i++)
+        offsets[indices[i] + 1]++;
+    for (GLuint v = 0; v < vertexCount; v++)
+        offsets[v + 1] += offsets[v];
+
+    std::vector<GLuint> adjacency(triangleCount * 3);
+    std::vector<GLuint> fill(offsets.begin(), offsets.end() - 1);
+    for (GLuint t = 0; t < triangleCount; t++)
+    {
+        for (GLuint k = 0; k < 3; k++)
+            adjacency[fill[indices[t * 3 + k]]++] = t;
+    }
+
+    // triangles of every vertex that weren't emitted yet
+    std::vector<GLuint> liveCount(vertexCount);
+    for (GLuint v = 0; v < vertexCount; v++)
+        liveCount[v] = offsets[v + 1] - offsets[v];
+
+    std::vector<GLuint> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<VertexIndex> deadEnd;
+    std::vector<VertexIndex> candidates;
+    std::vector<VertexIndex> result;
+    result.reserve(triangleCount * 3);
+
+    if (clusters)
+    {
+        clusters->clear();
+        clusters->push_back(0);
+    }
+
+    GLuint time = CACHE_SIZE + 1;
+    GLuint scanCursor = 0;
+    GLint fanVertex = 0;
+
+    while (fanVertex >= 0)
+    {
+        candidates.clear();
+        for (GLuint a = offsets[fanVertex]; a < offsets[fanVertex + 1]; a++)
+        {
+            GLuint t = adjacency[a];
+            if (emitted[t])
+                continue;
+
+            for (GLuint k = 0; k < 3; k++)
+            {
+                VertexIndex v = indices[t * 3 + k];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveCount[v]--;
+
+                if (time - cacheTime[v] > CACHE_SIZE)
+                    cacheTime[v] = time++;
+            }
+
+            emitted[t] = true;
+        }
+
+        // the candidate that will still be in the cache after its remaining
+        // triangles are emitted and that has been there the longest
+        GLint nextVertex = -1;
+        GLint bestPriority = -1;
+        for (VertexIndex v : candidates)
+        {
+            if (liveCount[v] == 0)
+                continue;
+
+            GLint priority = 0;
+            if (time - cacheTime[v] + 2 * liveCount[v] <= CACHE_SIZE)
+                priority = time - cacheTime[v];
+
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                nextVertex = v;
+            }
+        }
+
+        if (nextVertex == -1)
+        {
+            // dead end, continue from a recent vertex or the next unused one
+            while (!deadEnd.empty() && nextVertex == -1)
+            {
+                VertexIndex v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveCount[v] > 0)
+                    nextVertex = v;
+            }
+
+            while (scanCursor < vertexCount && nextVertex == -1)
+            {
+                if (liveCount[scanCursor] > 0)
+                    nextVertex = scanCursor;
+                scanCursor++;
+            }
+
+            if (clusters && nextVertex != -1)
+                clusters->push_back(result.size() / 3);
+        }
+
+        fanVertex = nextVertex;
+    }
+
+    // indices past the last whole triangle are dropped
+    indices.swap(result);
+}
+
+//-----------------------------------------------------------------------------
+// Name : OptimizeOverdraw ()
+// Desc : splits the clusters further where the cache is still warm enough
+//        that the ACMR stays under threshold times the cluster ACMR, then
+//        sorts the clusters so the ones facing away from the mesh center are
+//        drawn first and occlude the rest
+//-----------------------------------------------------------------------------
+void MeshOptimizer::OptimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<VertexIndex>& indices,
+                                     const std::vector<GLuint>& clusters, float threshold /*= 1.05f*/)
+{
+    GLuint triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || clusters.empty())
+        return;
+
+    std::vector<GLuint> cacheTime(vertices.size(), 0);
+    GLuint time = CACHE_SIZE + 1;
+
+    std::vector<GLuint> softClusters;
+    for (GLuint c = 0; c < clusters.size(); c++)
+    {
+        GLuint start = clusters[c];
+        GLuint end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+        if (start >= end)
+            continue;
+
+        // a reordered cluster starts with a cold cache
+        time += CACHE_SIZE + 1;
+        GLuint clusterMisses = SimulateCache(&indices[start * 3], end - start, cacheTime, time);
+        float clusterThreshold = threshold * float(clusterMisses) / float(end - start);
+
+        softClusters.push_back(start);
+        time += CACHE_SIZE + 1;
+        GLuint runMisses = 0;
+        GLuint runTriangles = 0;
+        for (GLuint t = start; t < end; t++)
+        {
+            runMisses += SimulateCache(&indices[t * 3], 1, cacheTime, time);
+            runTriangles++;
+
+            if (t + 1 < end && float(runMisses) / float(runTriangles) <= clusterThreshold)
+            {
+                softClusters.push_back(t + 1);
+                runMisses = 0;
+                runTriangles = 0;
+                time += CACHE_SIZE + 1;
+            }
+        }
+    }
+
+    // area weighted centroid and normal of every cluster and of the mesh
+    std::vector<float> sortKeys(softClusters.size());
+    std::vector<glm::vec3> centroids(softClusters.size());
+    std::vector<glm::vec3> normals(softClusters.size());
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (GLuint c = 0; c < softClusters.size(); c++)
+    {
+        GLuint start = softClusters[c];
+        GLuint end = (c + 1 < softClusters.size()) ? softClusters[c + 1] : triangleCount;
+
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (GLuint t = start; t < end; t++)
+        {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].Position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].Position;
+
+            glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(cross);
+
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += cross;
+            area += triangleArea;
+        }
+
+        meshCentroid += centroid;
+        meshArea += area;
+
+        centroids[c] = area > 0.0f ? centroid / area : centroid;
+        normals[c] = normal;
+    }
+
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    for (GLuint c = 0; c < softClusters.size(); c++)
+    {
+        float normalLength = glm::length(normals[c]);
+        glm::vec3 normal = normalLength > 0.0f ? normals[c] / normalLength : normals[c];
+        sortKeys[c] = glm::dot(centroids[c] - meshCentroid, normal);
+    }
+
+    std::vector<GLuint> order(softClusters.size());
+    for (GLuint c = 0; c < order.size(); c++)
+        order[c] = c;
+
+    // stable so equal keys keep the Tipsify order
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](GLuint a, GLuint b)
+    {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<VertexIndex> result;
+    result.reserve(triangleCount * 3);
+    for (GLuint c : order)
+    {
+        GLuint start = softClusters[c];
+        GLuint end = (c + 1 < softClusters.size()) ? softClusters[c + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+    }
+
+    indices.swap(result);
+}
+
+//-----------------------------------------------------------------------------
+// Name : OptimizeVertexFetch ()
+// Desc : orders the vertices by their first use in indices, vertices no
+//        triangle uses are dropped
+//-----------------------------------------------------------------------------
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<VertexIndex>& indices)
+{
+    const VertexIndex unused = -1;
+    std::vector<VertexIndex> remap(vertices.size(), unused);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+
+    for (VertexIndex& index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = result.size();
+            result.push_back(vertices[index]);
+        }
+
+        index = remap[index];
+    }
+
+    vertices.swap(result);
+}
+
+//-----------------------------------------------------------------------------
+// Name : AnalyzeVertexCache ()
+//-----------------------------------------------------------------------------
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<VertexIndex>& indices, GLuint vertexCount)
+{
+    VertexCacheStats stats;
+    stats.triangleCount = indices.size() / 3;
+    if (stats.triangleCount == 0)
+        return stats;
+
+    std::vector<GLuint> cacheTime(vertexCount, 0);
+    GLuint time = CACHE_SIZE + 1;
+    stats.transformedVertices = SimulateCache(indices.data(), stats.triangleCount, cacheTime, time);
+
+    // ATVR is relative to the vertices that are actually used
+    std::vector<bool> used(vertexCount, false);
+    for (GLuint i = 0; i < stats.triangleCount * 3; i++)
+    {
+        if (!used[indices[i]])
+        {
+            used[indices[i]] = true;
+            stats.vertexCount++;
+        }
+    }
+
+    return stats;
+}
+
+//-----------------------------------------------------------------------------
+// Name : PrintStats ()
+//-----------------------------------------------------------------------------
+void MeshOptimizer::PrintStats(const std::string& meshName, const MeshOptimizeStats& stats)
+{
+    std::cout << std::fixed << std::setprecision(3) << meshName
+              << ": ACMR " << stats.original.GetACMR() << " -> " << stats.vertexCache.GetACMR() << " -> " << stats.overdraw.GetACMR()
+              << ", ATVR " << stats.original.GetATVR() << " -> " << stats.vertexCache.GetATVR() << " -> " << stats.overdraw.GetATVR()
+              << " (original -> vertex cache -> overdraw)\n" << std::defaultfloat;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SimulateCache ()
+// Desc : returns the cache misses of the triangles in a FIFO cache of
+//        CACHE_SIZE entries, a vertex is cached while time - cacheTime[v] is
+//        at most CACHE_SIZE. Advancing time by CACHE_SIZE + 1 empties it.
+//-----------------------------------------------------------------------------
+GLuint MeshOptimizer::SimulateCache(const VertexIndex* indices, GLuint triangleCount, std::vector<GLuint>& cacheTime, GLuint& time)
+{
+    GLuint misses = 0;
+    for (GLuint i = 0; i < triangleCount * 3; i++)
+    {
+        VertexIndex v = indices[i];
+        if (time - cacheTime[v] > CACHE_SIZE)
+        {
+            cacheTime[v] = time++;
+            misses++;
+        }
+    }
+
+    return misses;
+}
@@ -0,0 +1,96 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef  _MESHOPTIMIZER_H
+#define  _MESHOPTIMIZER_H
+
+#include <vector>
+#include <string>
+#include <GL/glew.h>
+#include "../Render/RenderTypes.h"
+#include "../Render/VertexFormat.h"
+
+// result of running an index buffer through a simulated FIFO vertex cache
+struct VertexCacheStats
+{
+    VertexCacheStats()
+        :transformedVertices(0), triangleCount(0), vertexCount(0)
+    {}
+
+    void Add(const VertexCacheStats& stats)
+    {
+        transformedVertices += stats.transformedVertices;
+        triangleCount += stats.triangleCount;
+        vertexCount += stats.vertexCount;
+    }
+
+    // average cache miss ratio, vertex shader runs per triangle
+    float GetACMR() const { return triangleCount ? float(transformedVertices) / triangleCount : 0.0f; }
+    // average transform to vertex ratio, 1.0 is the best possible
+    float GetATVR() const { return vertexCount ? float(transformedVertices) / vertexCount : 0.0f; }
+
+    GLuint transformedVertices;
+    GLuint triangleCount;
+    GLuint vertexCount;
+};
+
+// the cache statistics after each stage of MeshOptimizer::Optimize
+struct MeshOptimizeStats
+{
+    void Add(const MeshOptimizeStats& stats)
+    {
+        original.Add(stats.original);
+        vertexCache.Add(stats.vertexCache);
+        overdraw.Add(stats.overdraw);
+    }
+
+    VertexCacheStats original;
+    VertexCacheStats vertexCache;
+    VertexCacheStats overdraw;
+};
+
+//-----------------------------------------------------------------------------
+// MeshOptimizer - reorders a triangle list before it is uploaded. Triangles
+// are ordered for the post transform cache with Tipsify, clusters of them are
+// then ordered so outward facing ones are drawn first to reduce overdraw and
+// finally the vertices are ordered by first use for fetch locality.
+// Every stage is deterministic so the result can be cooked.
+//-----------------------------------------------------------------------------
+class MeshOptimizer
+{
+public:
+    static const GLuint CACHE_SIZE = 16;
+
+    static void Optimize(std::vector<Vertex>& vertices, std::vector<VertexIndex>& indices,
+                         MeshOptimizeStats* stats = nullptr, bool optimizeOverdraw = true);
+
+    static void OptimizeVertexCache(std::vector<VertexIndex>& indices, GLuint vertexCount, std::vector<GLuint>* clusters = nullptr);
+    static void OptimizeOverdraw   (const std::vector<Vertex>& vertices, std::vector<VertexIndex>& indices,
+                                    const std::vector<GLuint>& clusters, float threshold = 1.05f);
+    static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<VertexIndex>& indices);
+
+    static VertexCacheStats AnalyzeVertexCache(const std::vector<VertexIndex>& indices, GLuint vertexCount);
+    static void             PrintStats        (const std::string& meshName, const MeshOptimizeStats& stats);
+
+private:
+    static GLuint SimulateCache(const VertexIndex* indices, GLuint triangleCount, std::vector<GLuint>& cacheTime, GLuint& time);
+};
+
+#endif  //_MESHOPTIMIZER_H
@@ -0,0 +1,382 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <queue>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <cstring>
+
+// symmetric 4x4 matrix, the sum of squared distances to a set of planes
+struct Quadric
+{
+    Quadric()
+        :a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0)
+    {}
+
+    void AddPlane(double a, double b, double c, double d)
+    {
+        a2 += a * a; ab += a * b; ac += a * c; ad += a * d;
+        b2 += b * b; bc += b * c; bd += b * d;
+        c2 += c * c; cd += c * d;
+        d2 += d * d;
+    }
+
+    void Add(const Quadric& q)
+    {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+    }
+
+    double Evaluate(const glm::vec3& p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double result = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                      + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                      + c2 * z * z + 2 * cd * z
+                      + d2;
+        // rounding can make it slightly negative
+        return result > 0.0 ? result : 0.0;
+    }
+
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+};
+
+// collapsing vertex into target costs cost, stamp invalidates old entries
+struct Collapse
+{
+    double cost;
+    GLuint vertex;
+    GLuint target;
+    GLuint stamp;
+
+    bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+struct PositionHash
+{
+    size_t operator()(const glm::vec3& p) const
+    {
+        GLuint bits[3];
+        std::memcpy(bits, &p.x, sizeof(bits));
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+};
+
+struct PositionEqual
+{
+    bool operator()(const glm::vec3& a, const glm::vec3& b) const
+    {
+        return a.x == b.x && a.y == b.y && a.z == b.z;
+    }
+};
+
+//-----------------------------------------------------------------------------
+// Name : Simplify ()
+// Desc : collapses edges until at most targetIndexCount indices are left or
+//        no collapse is possible. Returns the error of the result, the square
+//        root of the largest quadric error of a collapse.
+//-----------------------------------------------------------------------------
+float MeshSimplifier::Simplify(const std::vector<Vertex>& vertices, const std::vector<VertexIndex>& indices,
+                               GLuint targetIndexCount, std::vector<VertexIndex>& result)
+{
+    GLuint vertexCount = vertices.size();
+    GLuint triangleCount = indices.size() / 3;
+    result.clear();
+
+    // vertices at the same position are one vertex for the simplification
+    // unless their attributes differ
+    std::unordered_map<glm::vec3, GLuint, PositionHash, PositionEqual> positionGroups;
+    std::vector<GLuint> group(vertexCount);
+    for (GLuint v = 0; v < vertexCount; v++)
+        group[v] = positionGroups.emplace(vertices[v].Position, v).first->second;
+
+    std::vector<bool> locked(vertexCount, false);
+    for (GLuint v = 0; v < vertexCount; v++)
+    {
+        const Vertex& first = vertices[group[v]];
+        if (first.Normal != vertices[v].Normal || first.TexCoords != vertices[v].TexCoords)
+            locked[group[v]] = true;
+    }
+
+    std::vector<GLuint> work(vertexCount);
+    for (GLuint v = 0; v < vertexCount; v++)
+        work[v] = locked[group[v]] ? v : group[v];
+
+    // an edge used by a single triangle is on an open border
+    std::unordered_map<uint64_t, GLuint> edgeUse;
+    for (GLuint t = 0; t < triangleCount; t++)
+    {
+        for (GLuint k = 0; k < 3; k++)
+        {
+            GLuint a = group[indices[t * 3 + k]];
+            GLuint b = group[indices[t * 3 + (k + 1) % 3]];
+            if (a > b)
+                std::swap(a, b);
+            edgeUse[(uint64_t(a) << 32) | b]++;
+        }
+    }
+
+    for (const std::pair<const uint64_t, GLuint>& edge : edgeUse)
+    {
+        if (edge.second == 1)
+        {
+            locked[edge.first >> 32] = true;
+            locked[edge.first & 0xFFFFFFFF] = true;
+        }
+    }
+
+    for (GLuint v = 0; v < vertexCount; v++)
+        locked[v] = locked[group[v]];
+
+    std::vector<VertexIndex> triangles(triangleCount * 3);
+    std::vector<bool> triangleAlive(triangleCount, true);
+    std::vector<std::vector<GLuint>> vertexTriangles(vertexCount);
+    std::vector<Quadric> quadrics(vertexCount);
+    GLuint aliveCount = 0;
+
+    for (GLuint t = 0; t < triangleCount; t++)
+    {
+        VertexIndex i0 = work[indices[t * 3 + 0]];
+        VertexIndex i1 = work[indices[t * 3 + 1]];
+        VertexIndex i2 = work[indices[t * 3 + 2]];
+        triangles[t * 3 + 0] = i0;
+        triangles[t * 3 + 1] = i1;
+        triangles[t * 3 + 2] = i2;
+
+        if (i0 == i1 || i1 == i2 || i0 == i2)
+        {
+            triangleAlive[t] = false;
+            continue;
+        }
+
+        aliveCount++;
+        for (GLuint k = 0; k < 3; k++)
+            vertexTriangles[triangles[t * 3 + k]].push_back(t);
+
+        const glm::vec3& p0 = vertices[i0].Position;
+        glm::vec3 normal = glm::cross(vertices[i1].Position - p0, vertices[i2].Position - p0);
+        float length = glm::length(normal);
+        if (length <= 0.0f)
+            continue;
+
+        normal = normal / length;
+        double d = -glm::dot(normal, p0);
+        for (GLuint k = 0; k < 3; k++)
+            quadrics[triangles[t * 3 + k]].AddPlane(normal.x, normal.y, normal.z, d);
+    }
+
+    std::vector<bool> vertexAlive(vertexCount, true);
+    std::vector<GLuint> stamps(vertexCount, 0);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+    // the cheapest collapse of vertex into one of its neighbours
+    auto pushBestCollapse = [&](GLuint vertex)
+    {
+        if (locked[vertex] || !vertexAlive[vertex])
+            return;
+
+        Collapse best = {0.0, vertex, vertex, stamps[vertex]};
+        for (GLuint t : vertexTriangles[vertex])
+        {
+            if (!triangleAlive[t])
+                continue;
+
+            for (GLuint k = 0; k < 3; k++)
+            {
+                GLuint target = triangles[t * 3 + k];
+                if (target == vertex)
+                    continue;
+
+                Quadric q = quadrics[vertex];
+                q.Add(quadrics[target]);
+                double cost = q.Evaluate(vertices[target].Position);
+                if (best.target == vertex || cost < best.cost)
+                {
+                    best.cost = cost;
+                    best.target = target;
+                }
+            }
+        }
+
+        if (best.target != vertex)
+            queue.push(best);
+    };
+
+    for (GLuint v = 0; v < vertexCount; v++)
+    {
+        if (work[v] == v)
+            pushBestCollapse(v);
+    }
+
+    double maxCost = 0.0;
+    while (aliveCount * 3 > targetIndexCount && !queue.empty())
+    {
+        Collapse collapse = queue.top();
+        queue.pop();
+
+        GLuint vertex = collapse.vertex;
+        GLuint target = collapse.target;
+        if (!vertexAlive[vertex] || collapse.stamp != stamps[vertex])
+            continue;
+
+        if (!vertexAlive[target])
+        {
+            stamps[vertex]++;
+            pushBestCollapse(vertex);
+            continue;
+        }
+
+        // the triangles that stay must not flip
+        const glm::vec3& newPos = vertices[target].Position;
+        bool flips = false;
+        for (GLuint t : vertexTriangles[vertex])
+        {
+            if (!triangleAlive[t])
+                continue;
+
+            const VertexIndex* tri = &triangles[t * 3];
+            if (tri[0] == target || tri[1] == target || tri[2] == target)
+                continue;
+
+            glm::vec3 p[3], moved[3];
+            for (GLuint k = 0; k < 3; k++)
+            {
+                p[k] = vertices[tri[k]].Position;
+                moved[k] = (tri[k] == vertex) ? newPos : p[k];
+            }
+
+            glm::vec3 oldNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::vec3 newNormal = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+            if (glm::dot(oldNormal, newNormal) <= 0.0f)
+            {
+                flips = true;
+                break;
+            }
+        }
+
+        // dropped until a neighbour collapse changes its surroundings
+        if (flips)
+        {
+            stamps[vertex]++;
+            continue;
+        }
+
+        for (GLuint t : vertexTriangles[vertex])
+        {
+            if (!triangleAlive[t])
+                continue;
+
+            VertexIndex* tri = &triangles[t * 3];
+            if (tri[0] == target || tri[1] == target || tri[2] == target)
+            {
+                triangleAlive[t] = false;
+                aliveCount--;
+                continue;
+            }
+
+            for (GLuint k = 0; k < 3; k++)
+            {
+                if (tri[k] == vertex)
+                    tri[k] = target;
+            }
+            vertexTriangles[target].push_back(t);
+        }
+
+        vertexAlive[vertex] = false;
+        vertexTriangles[vertex].clear();
+        quadrics[target].Add(quadrics[vertex]);
+        maxCost = std::max(maxCost, collapse.cost);
+
+        // the target and its neighbours have new costs
+        std::vector<GLuint>& targetTriangles = vertexTriangles[target];
+        targetTriangles.erase(std::remove_if(targetTriangles.begin(), targetTriangles.end(),
+                                             [&triangleAlive](GLuint t) { return !triangleAlive[t]; }),
+                              targetTriangles.end());
+
+        stamps[target]++;
+        pushBestCollapse(target);
+        for (GLuint t : targetTriangles)
+        {
+            for (GLuint k = 0; k < 3; k++)
+            {
+                GLuint neighbour = triangles[t * 3 + k];
+                if (neighbour == target)
+                    continue;
+
+                stamps[neighbour]++;
+                pushBestCollapse(neighbour);
+            }
+        }
+    }
+
+    // the triangles keep their original order
+    result.reserve(aliveCount * 3);
+    for (GLuint t = 0; t < triangleCount; t++)
+    {
+        if (triangleAlive[t])
+            result.insert(result.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+    }
+
+    return std::sqrt(maxCost);
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildLodChain ()
+// Desc : every level halves the triangles of the previous one, the levels are
+//        appended to lodIndices. Stops early when a level can't remove at
+//        least a quarter of the triangles, usually because of locked vertices.
+//-----------------------------------------------------------------------------
+void MeshSimplifier::BuildLodChain(const std::vector<Vertex>& vertices, const std::vector<VertexIndex>& indices,
+                                   std::vector<VertexIndex>& lodIndices, std::vector<LodLevel>& lods)
+{
+    lodIndices.clear();
+    lods.clear();
+
+    std::vector<VertexIndex> source = indices;
+    std::vector<VertexIndex> level;
+    float error = 0.0f;
+
+    for (GLuint i = 0; i < MAX_LOD_LEVELS; i++)
+    {
+        GLuint sourceTriangles = source.size() / 3;
+        if (sourceTriangles < MIN_LOD_TRIANGLES * 2)
+            break;
+
+        // simplified from the previous level so the errors add up
+        error += Simplify(vertices, source, (sourceTriangles / 2) * 3, level);
+        if (level.size() > source.size() * 3 / 4)
+            break;
+
+        MeshOptimizer::OptimizeVertexCache(level, vertices.size());
+
+        LodLevel lod;
+        lod.firstIndex = lodIndices.size();
+        lod.indexCount = level.size();
+        lod.error = error;
+        lods.push_back(lod);
+
+        lodIndices.insert(lodIndices.end(), level.begin(), level.end());
+        source.swap(level);
+    }
+}
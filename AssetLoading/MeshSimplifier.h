@@ -0,0 +1,50 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef  _MESHSIMPLIFIER_H
+#define  _MESHSIMPLIFIER_H
+
+#include <vector>
+#include <GL/glew.h>
+#include "../Render/subMesh.h"
+
+//-----------------------------------------------------------------------------
+// MeshSimplifier - quadric error metric edge collapse (Garland and Heckbert).
+// Vertices are only collapsed into other existing vertices so a simplified
+// index buffer can be drawn with the vertices of the original mesh.
+// Vertices on open borders and on attribute seams (same position, different
+// normal or texture coordinates) are never moved, which keeps the outline and
+// the texture mapping of the mesh intact.
+//-----------------------------------------------------------------------------
+class MeshSimplifier
+{
+public:
+    // levels generated after the full detail mesh
+    static const GLuint MAX_LOD_LEVELS = 4;
+    // levels stop once they would have fewer triangles than this
+    static const GLuint MIN_LOD_TRIANGLES = 64;
+
+    static float Simplify     (const std::vector<Vertex>& vertices, const std::vector<VertexIndex>& indices,
+                               GLuint targetIndexCount, std::vector<VertexIndex>& result);
+    static void  BuildLodChain(const std::vector<Vertex>& vertices, const std::vector<VertexIndex>& indices,
+                               std::vector<VertexIndex>& lodIndices, std::vector<LodLevel>& lods);
+};
+
+#endif  //_MESHSIMPLIFIER_H
@@ -19,99 +19,364 @@
 //
 
 #include "ObjLoader.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <functional>
+
+// a face read by a chunk, its corners are cornerCount entries of the chunk
+// corners. The counts are the attributes the chunk read before the face,
+// negative obj indices count back from them
+struct ObjFace
+{
+    GLuint firstCorner;
+    GLuint cornerCount;
+    GLuint vertexCount;
+    GLuint texCordCount;
+    GLuint normalCount;
+};
+
+// the indices as written in the file, 0 when missing
+struct ObjCorner
+{
+    GLint v;
+    GLint t;
+    GLint n;
+};
+
+// a usemtl line, the faces from firstFace on use the material
+struct ObjMaterialSwitch
+{
+    GLuint firstFace;
+    std::string name;
+};
+
+// everything read from one line aligned part of the file
+struct ObjChunk
+{
+    std::vector<GLfloat> verticesPos;
+    std::vector<GLfloat> normals;
+    std::vector<GLfloat> texCords;
+
+    std::vector<ObjCorner> corners;
+    std::vector<ObjFace> faces;
+    std::vector<ObjMaterialSwitch> materialSwitches;
+    std::vector<std::string> materialLibs;
 
-#include<algorithm>
+    // attributes read by the chunks before this one
+    GLuint vertexBase;
+    GLuint normalBase;
+    GLuint texCordBase;
+};
 
 //-----------------------------------------------------------------------------
-// Name : Group::Group(constructor)
+// Name : objSkipSpaces
 //-----------------------------------------------------------------------------
-Group::Group(std::string &rName)
+static const char* objSkipSpaces(const char* p, const char* end)
 {
-    name = rName;
-    numTrinagles = 0;
-    material = -1;
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+
+    return p;
 }
 
 //-----------------------------------------------------------------------------
-// Name : Group::addVertex
+// Name : objTokenEnd
+//-----------------------------------------------------------------------------
+static const char* objTokenEnd(const char* p, const char* end)
+{
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+        p++;
+
+    return p;
+}
+
+//-----------------------------------------------------------------------------
+// Name : objIsToken
+//-----------------------------------------------------------------------------
+static bool objIsToken(const char* token, const char* tokenEnd, const char* name)
+{
+    size_t length = std::strlen(name);
+    return size_t(tokenEnd - token) == length && std::memcmp(token, name, length) == 0;
+}
+
 //-----------------------------------------------------------------------------
-GLushort Group::addVertex(glm::vec3 pos, glm::vec3 normal, glm::vec2 texCords)
+// Name : objReadToken
+// Desc : reads the next word of the line as a string
+//-----------------------------------------------------------------------------
+static std::string objReadToken(const char* p, const char* end)
 {
-    for (GLushort i = 0; i  < vertices.size(); i++)
+    p = objSkipSpaces(p, end);
+    return std::string(p, objTokenEnd(p, end));
+}
+
+//-----------------------------------------------------------------------------
+// Name : objParseFloat
+// Desc : value is 0 when there is no number, returns the end of the number
+//-----------------------------------------------------------------------------
+static const char* objParseFloat(const char* p, const char* end, GLfloat& value)
+{
+    p = objSkipSpaces(p, end);
+    // from_chars doesn't accept a plus sign
+    if (p < end && *p == '+')
+        p++;
+
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc())
     {
-        if (vertices[i].Position == pos && vertices[i].Normal == normal &&
-            vertices[i].TexCoords == texCords)
-            return i;
+        value = 0.0f;
+        return p;
+    }
+
+    return result.ptr;
+}
+
+//-----------------------------------------------------------------------------
+// Name : objParseInt
+// Desc : value is 0 when there is no number, returns the end of the number
+//-----------------------------------------------------------------------------
+static const char* objParseInt(const char* p, const char* end, GLint& value)
+{
+    if (p < end && *p == '+')
+        p++;
 
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc())
+    {
+        value = 0;
+        return p;
     }
 
-    vertices.emplace_back(pos, normal, texCords);
-    return vertices.size() - 1;
+    return result.ptr;
 }
 
 //-----------------------------------------------------------------------------
-// Name : Group::addVertex
+// Name : objParseCorner
+// Desc : one of v, v/t, v//n or v/t/n
 //-----------------------------------------------------------------------------
-GLushort Group::addVertex(Model& model,int* v, int* t, int* n)
+static const char* objParseCorner(const char* p, const char* end, ObjCorner& corner)
 {
-    glm::vec3 pos;
-    glm::vec3 normal = {0.0f, 0.0f, 0.0f};
-    glm::vec2 texCords = {0.0f, 0.0f};
+    corner.v = corner.t = corner.n = 0;
 
-    if (v != nullptr)
+    p = objParseInt(p, end, corner.v);
+    if (p < end && *p == '/')
     {
-        if (*v >= 0)
-        {
-            pos.x = model.verticesPos[3*(*v - 1) + 0];
-            pos.y = model.verticesPos[3*(*v - 1) + 1];
-            pos.z = model.verticesPos[3*(*v - 1) + 2];
-        }
-        else
-        {
-            pos.x = model.verticesPos[3*(*v + model.numVertices) + 0];
-            pos.y = model.verticesPos[3*(*v + model.numVertices) + 1];
-            pos.z = model.verticesPos[3*(*v + model.numVertices) + 2];
-        }
+        p++;
+        if (p < end && *p != '/')
+            p = objParseInt(p, end, corner.t);
+
+        if (p < end && *p == '/')
+            p = objParseInt(p + 1, end, corner.n);
     }
 
-    if (n != nullptr)
+    return p;
+}
+
+//-----------------------------------------------------------------------------
+// Name : objParseChunk
+// Desc : parses the whole lines in [begin, end), the indices of the faces
+//        are resolved later once every chunk was read
+//-----------------------------------------------------------------------------
+static void objParseChunk(const char* begin, const char* end, ObjChunk& chunk)
+{
+    const char* line = begin;
+    while (line < end)
     {
-        if (*n >= 0)
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (lineEnd == nullptr)
+            lineEnd = end;
+
+        const char* token = objSkipSpaces(line, lineEnd);
+        const char* tokenEnd = objTokenEnd(token, lineEnd);
+        const char* p = tokenEnd;
+
+        if (objIsToken(token, tokenEnd, "v"))
         {
-            normal.x = model.normals[3*(*n - 1) + 0];
-            normal.y = model.normals[3*(*n - 1) + 1];
-            normal.z = model.normals[3*(*n - 1) + 2];
+            GLfloat pos[3];
+            for (int i = 0; i < 3; i++)
+                p = objParseFloat(p, lineEnd, pos[i]);
+            chunk.verticesPos.insert(chunk.verticesPos.end(), pos, pos + 3);
         }
-        else
+        else if (objIsToken(token, tokenEnd, "vn"))
         {
-            normal.x = model.normals[3*(*n + model.numNormals) + 0];
-            normal.y = model.normals[3*(*n + model.numNormals) + 1];
-            normal.z = model.normals[3*(*n + model.numNormals) + 2];
+            GLfloat normal[3];
+            for (int i = 0; i < 3; i++)
+                p = objParseFloat(p, lineEnd, normal[i]);
+            chunk.normals.insert(chunk.normals.end(), normal, normal + 3);
         }
-    }
-
-    if (t != nullptr)
-    {
-        if (*t != 0)
+        else if (objIsToken(token, tokenEnd, "vt"))
+        {
+            GLfloat texCord[2];
+            for (int i = 0; i < 2; i++)
+                p = objParseFloat(p, lineEnd, texCord[i]);
+            chunk.texCords.insert(chunk.texCords.end(), texCord, texCord + 2);
+        }
+        else if (objIsToken(token, tokenEnd, "f"))
         {
-            texCords.x = model.texCords[2*(*t - 1) + 0];
-            texCords.y = model.texCords[2*(*t - 1) + 1];
+            ObjFace face;
+            face.firstCorner = chunk.corners.size();
+            face.vertexCount = chunk.verticesPos.size() / 3;
+            face.normalCount = chunk.normals.size() / 3;
+            face.texCordCount = chunk.texCords.size() / 2;
+
+            p = objSkipSpaces(p, lineEnd);
+            while (p < lineEnd)
+            {
+                ObjCorner corner;
+                const char* cornerEnd = objParseCorner(p, lineEnd, corner);
+                if (cornerEnd == p)
+                    break;
+
+                chunk.corners.push_back(corner);
+                p = objSkipSpaces(cornerEnd, lineEnd);
+            }
+
+            face.cornerCount = chunk.corners.size() - face.firstCorner;
+            if (face.cornerCount >= 3)
+                chunk.faces.push_back(face);
+            else
+                chunk.corners.resize(face.firstCorner);
         }
-        else
+        else if (objIsToken(token, tokenEnd, "usemtl"))
         {
-            texCords.x = model.texCords[2*(*t + model.numTexCords) + 0];
-            texCords.y = model.texCords[2*(*t + model.numTexCords) + 1];
+            ObjMaterialSwitch materialSwitch;
+            materialSwitch.firstFace = chunk.faces.size();
+            materialSwitch.name = objReadToken(p, lineEnd);
+            chunk.materialSwitches.push_back(std::move(materialSwitch));
         }
+        else if (objIsToken(token, tokenEnd, "mtllib"))
+            chunk.materialLibs.push_back(objReadToken(p, lineEnd));
+
+        // comments, groups, objects and smoothing groups are skipped, the
+        // groups are made by material
+        line = lineEnd + 1;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : objResolveIndex
+// Desc : returns the 0 based index or -1 when it is missing or out of range
+//-----------------------------------------------------------------------------
+static GLint objResolveIndex(GLint index, GLuint readBefore, GLuint count)
+{
+    // obj indices start at 1, negative indices count back from the last
+    // element read before the face
+    GLint resolved = -1;
+    if (index > 0)
+        resolved = index - 1;
+    else if (index < 0)
+        resolved = GLint(readBefore) + index;
+
+    return (resolved >= 0 && GLuint(resolved) < count) ? resolved : -1;
+}
+
+//-----------------------------------------------------------------------------
+// Name : VertexWeldKey::operator==
+//-----------------------------------------------------------------------------
+bool VertexWeldKey::operator==(const VertexWeldKey& key) const
+{
+    return std::memcmp(values, key.values, sizeof(values)) == 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : VertexWeldKeyHash::operator()
+// Desc : FNV-1a over the key values
+//-----------------------------------------------------------------------------
+size_t VertexWeldKeyHash::operator()(const VertexWeldKey& key) const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (GLint value : key.values)
+    {
+        hash ^= GLuint(value);
+        hash *= 1099511628211ULL;
+    }
+
+    return size_t(hash ^ (hash >> 32));
+}
+
+//-----------------------------------------------------------------------------
+// Name : objWeldValue
+// Desc : the grid point of value, or its bits when epsilon is 0
+//-----------------------------------------------------------------------------
+static GLint objWeldValue(GLfloat value, GLfloat invEpsilon)
+{
+    if (invEpsilon == 0.0f)
+    {
+        // adding 0 turns -0 into 0 so both weld like they compare
+        GLfloat exact = value + 0.0f;
+        GLint bits;
+        std::memcpy(&bits, &exact, sizeof(bits));
+        return bits;
     }
 
+    double snapped = std::floor(double(value) * invEpsilon + 0.5);
+    const double limit = std::numeric_limits<GLint>::max();
+    return GLint(std::max(-limit, std::min(snapped, limit)));
+}
+
+//-----------------------------------------------------------------------------
+// Name : Group::Group(constructor)
+//-----------------------------------------------------------------------------
+Group::Group(std::string &rName, GLfloat rWeldEpsilon)
+{
+    name = rName;
+    numTrinagles = 0;
+    material = -1;
+    weldEpsilon = rWeldEpsilon;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Group::addVertex
+//-----------------------------------------------------------------------------
+VertexIndex Group::addVertex(const glm::vec3& pos, const glm::vec3& normal, const glm::vec2& texCords)
+{
+    GLfloat invEpsilon = (weldEpsilon > 0.0f) ? 1.0f / weldEpsilon : 0.0f;
+
+    VertexWeldKey key;
+    for (int i = 0; i < 3; i++)
+    {
+        key.values[i] = objWeldValue(pos[i], invEpsilon);
+        key.values[3 + i] = objWeldValue(normal[i], invEpsilon);
+    }
+    key.values[6] = objWeldValue(texCords[0], invEpsilon);
+    key.values[7] = objWeldValue(texCords[1], invEpsilon);
+
+    auto inserted = weldTable.emplace(key, VertexIndex(vertices.size()));
+    if (inserted.second)
+        vertices.emplace_back(pos, normal, texCords);
+
+    return inserted.first->second;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Group::addVertex
+//-----------------------------------------------------------------------------
+VertexIndex Group::addVertex(const Model& model, GLint v, GLint t, GLint n)
+{
+    glm::vec3 pos(model.verticesPos[3 * v + 0], model.verticesPos[3 * v + 1], model.verticesPos[3 * v + 2]);
+    glm::vec3 normal = {0.0f, 0.0f, 0.0f};
+    glm::vec2 texCords = {0.0f, 0.0f};
+
+    if (n >= 0)
+        normal = glm::vec3(model.normals[3 * n + 0], model.normals[3 * n + 1], model.normals[3 * n + 2]);
+
+    if (t >= 0)
+        texCords = glm::vec2(model.texCords[2 * t + 0], model.texCords[2 * t + 1]);
+
     return addVertex(pos, normal, texCords);
 }
 
 //-----------------------------------------------------------------------------
 // Name : Model::Model(constructor)
 //-----------------------------------------------------------------------------
-Model::Model(std::string newMeshPath)
-    :pos(0.0f, 0.0f, 0.0f)
+Model::Model(std::string newMeshPath, GLfloat newWeldEpsilon /*= 0.0f*/)
+    :pos(0.0f, 0.0f, 0.0f), weldEpsilon(newWeldEpsilon)
 {
     meshPath = newMeshPath;
 
@@ -162,524 +427,157 @@ Group& Model::addGroup(std::string name)
             return groups[i];
     }
 
-    groups.emplace_back(name);
+    groups.emplace_back(name, weldEpsilon);
     return groups[groups.size() - 1];
 }
 
 //-----------------------------------------------------------------------------
-// Name : objFirstPass
+// Name : objLoad
+// Desc : maps the file and parses line aligned chunks of it in parallel,
+//        the chunks are then merged in order so the groups and the vertex
+//        order are the same as reading the file from start to end
 //-----------------------------------------------------------------------------
-void objFirstPass(AssetManager& asset, std::ifstream& in ,Model& model)
+bool objLoad(Model& model)
 {
-    //char buf[128];
-    std::string buf;
-    Group* group = nullptr;
-    bool readNextLine = true;
+    MappedFile file;
+    if (!file.Open(model.meshPath))
+        return false;
 
-    int v, n, t;
+    const char* data = reinterpret_cast<const char*>(file.GetData());
+    const char* dataEnd = data + file.GetSize();
 
-    group = &model.addGroup("defualt");
+    size_t maxChunks = std::max<size_t>(1, file.GetSize() / OBJ_MIN_CHUNK_SIZE);
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), maxChunks));
 
-    in >> buf;
-    while (!in.eof())
+    // every chunk starts at the beginning of a line
+    std::vector<const char*> chunkStarts(chunkCount + 1, dataEnd);
+    chunkStarts[0] = data;
+    for (size_t i = 1; i < chunkCount; i++)
     {
-        switch(buf[0])
-        {
-            case '#':
-            {
-                // jump to the end of the line
-                std::getline(in, buf);
-                //in.getline(buf, 128);
-            }break;
+        const char* start = std::max(data + file.GetSize() * i / chunkCount, chunkStarts[i - 1]);
+        const char* lineEnd = static_cast<const char*>(std::memchr(start, '\n', dataEnd - start));
+        chunkStarts[i] = (lineEnd != nullptr) ? lineEnd + 1 : dataEnd;
+    }
 
-            case 'v':
-            {
-                switch(buf[1])
-                {
-                    case '\0':
-                    {
-                        // jump to the end of the line
-                        std::getline(in, buf);
-                        //in.getline(buf, 128);
-                        model.numVertices++;
-                    }break;
-
-                    case 'n':
-                    {
-                        // jump to the end of the line
-                        std::getline(in, buf);
-                        //in.getline(buf, 128);
-                        model.numNormals++;
-                    }break;
-
-                    case 't':
-                    {
-                        // jump to the end of the line
-                        std::getline(in, buf);
-                        //in.getline(buf, 128);
-                        model.numTexCords++;
-                    }break;
-
-                    default:
-                        std::cout << "objFirstPass() - Unknown token\n";
-                        break;
-                }
-            }break;
+    std::vector<ObjChunk> chunks(chunkCount);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunkCount; i++)
+        workers.emplace_back(objParseChunk, chunkStarts[i], chunkStarts[i + 1], std::ref(chunks[i]));
 
-            case 'm':
-            {
-                std::getline(in, buf);
-                //in.getline(buf, 128);
-                std::stringstream sStream(buf);
-                sStream >> buf;
-                sStream >> buf;
-                model.matrialPath = buf;
-                objReadMatrial(asset, model, buf);
-            }break;
-
-            case 'u':
-                std::getline(in, buf);
-                //in.getline(buf, 128);
-            break;
-
-            case 'g':
-            {
-                std::getline(in, buf);
-                //std::stringstream sStream(buf);
-                //sStream >> buf;
-                group = &model.addGroup(buf);
-            }
-            break;
+    objParseChunk(chunkStarts[0], chunkStarts[1], chunks[0]);
 
-            case 'f':
-            {
-                //std::string buf;
-                v = n = t = 0;
-                in >> buf;
-                // can be one of v , v//n, v/t, v/t/n, x//x
-                if (buf.find("//") != std::string::npos)
-                {
-                    // v//n
-                    //TODO: add a function to read v and n
-                    std::stringstream s(buf);
-                    s >> v;
-                    s = std::stringstream(buf.substr(buf.find_last_of('/') + 1, buf.size() ));
-                    s >> n;
-
-                    in >> buf;
-                    s = std::stringstream(buf);
-                    s >> v;
-                    s = std::stringstream(buf.substr(buf.find_last_of('/') + 1, buf.size() ));
-                    s >> n;
-
-                    in >> buf;
-                    s = std::stringstream(buf);
-                    s >> v;
-                    s = std::stringstream(buf.substr(buf.find_last_of('/') + 1, buf.size() ));
-                    s >> n;
-
-                    model.numTrinagles++;
-                    group->numTrinagles++;
-
-                    in >> buf;
-                    readNextLine = false;
-                    while (buf.find("//") != std::string::npos && !in.eof())
-                    {
-                        model.numTrinagles++;
-                        group->numTrinagles++;
-
-                        in >> buf;
-                    }
-                }
-                else if (std::count(buf.begin(), buf.end(), '/') == 2)
-                {
-                    // v/t/
-                    std::replace(buf.begin(), buf.end(), '/', ' ');
-                    std::stringstream s(buf);
-                    s >> v;
-                    s >> t;
-                    s >> n;
-
-                    in >> buf;
-                    std::replace(buf.begin(), buf.end(), '/', ' ');
-                    s = std::stringstream(buf);
-                    s >> v;
-                    s >> t;
-                    s >> n;
-                    
-                    in >> buf;
-                    std::replace(buf.begin(), buf.end(), '/', ' ');
-                    s = std::stringstream(buf);
-                    s >> v;
-                    s >> t;
-                    s >> n;
-
-                    model.numTrinagles++;
-                    group->numTrinagles++;
-
-                    in >> buf;
-                    readNextLine = false;
-                    while (buf.find("/") != std::string::npos && !in.eof())
-                    {
-                        model.numTrinagles++;
-                        group->numTrinagles++;
-
-                        in >> buf;
-                    }
-                }
-                else if (std::count(buf.begin(), buf.end(), '/') == 1)
-                {
-                    // v/t
-                    std::replace(buf.begin(), buf.end(), '/', ' ');
-                    std::stringstream s(buf);
-                    s >> v;
-                    s >> t;
-
-                    in >> buf;
-                    std::replace(buf.begin(), buf.end(), '/', ' ');
-                    s = std::stringstream(buf);
-                    s >> v;
-                    s >> t;
-
-                    model.numTrinagles++;
-                    group->numTrinagles++;
-
-                    in >> buf;
-                    readNextLine = false;
-                    while ( std::count(buf.begin(), buf.end(), '/') > 0 )
-                    {
-                        model.numTrinagles++;
-                        group->numTrinagles++;
-
-                        in >> buf;
-                    }
-                }
-                else
-                {
-                    // v
-                    in >> v;
-
-                    model.numTrinagles++;
-                    group->numTrinagles++;
-
-                    in >> buf;
-                    readNextLine = false;
-                    std::stringstream s(buf);
-                    s >> v;
-                    while (!s.fail() && !in.eof())
-                    {
-                        model.numTrinagles++;
-                        group->numTrinagles++;
-
-                        in >> buf;
-                        s = std::stringstream(buf);
-                        s >> v;
-                    }
-                }
-            }break;
+    for (std::thread& worker : workers)
+        worker.join();
 
-            default:
-                std::getline(in, buf);
-                //in.getline(buf, 128);
-                break;
+    // the attributes of every chunk are appended after the ones before it
+    model.numVertices = model.numNormals = model.numTexCords = 0;
+    for (ObjChunk& chunk : chunks)
+    {
+        chunk.vertexBase = model.numVertices;
+        chunk.normalBase = model.numNormals;
+        chunk.texCordBase = model.numTexCords;
 
-        }
-        // next line was already read
-        if (readNextLine)
-            in >> buf;
-        else
-            readNextLine = true;
+        model.numVertices += chunk.verticesPos.size() / 3;
+        model.numNormals += chunk.normals.size() / 3;
+        model.numTexCords += chunk.texCords.size() / 2;
     }
 
-    for (Group& g : model.groups)
+    model.verticesPos = new GLfloat[model.numVertices * 3];
+    model.normals = new GLfloat[model.numNormals * 3];
+    model.texCords = new GLfloat[model.numTexCords * 2];
+    for (ObjChunk& chunk : chunks)
     {
-        //g.triangles = new GLuint[g.numTrinagles];
-        g.numTrinagles = 0;
+        std::copy(chunk.verticesPos.begin(), chunk.verticesPos.end(), model.verticesPos + chunk.vertexBase * 3);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), model.normals + chunk.normalBase * 3);
+        std::copy(chunk.texCords.begin(), chunk.texCords.end(), model.texCords + chunk.texCordBase * 2);
+        std::vector<GLfloat>().swap(chunk.verticesPos);
+        std::vector<GLfloat>().swap(chunk.normals);
+        std::vector<GLfloat>().swap(chunk.texCords);
     }
-}
-
-//-----------------------------------------------------------------------------
-// Name : objSecondPass
-//-----------------------------------------------------------------------------
-void objSecondPass(std::ifstream& in, Model& model)
-{
-    int v, n, t;
-    GLuint numVertices;
-    GLuint numNormals;
-    GLuint numTexCords;
-    GLuint numTrinagles;
-
-    GLuint material;
-    Group* group;
 
-    std::string buf;
-    bool readNextLine = true;
-
-    group = &model.addGroup("defualt");
-
-    numVertices = numNormals = numTexCords = 0;
-    numTrinagles = 0;
-    material = 0;
-
-    model.verticesPos = new float[model.numVertices * 3];
-    model.normals = new float[model.numNormals * 3];
-    model.texCords = new float[model.numTexCords * 2];
-
-    in >> buf;
-    while (!in.eof())
+    // every material has to be known before the first usemtl is resolved
+    for (const ObjChunk& chunk : chunks)
     {
-        switch(buf[0])
+        for (const std::string& materialLib : chunk.materialLibs)
         {
-            case '#':
-            {
-                // jump to the end of the line
-                std::getline(in, buf);
-                //in.getline(buf, 128);
-            }break;
-
-            case 'v':
-            {
-                switch(buf[1])
-                {
-                    case '\0':
-                    {
-                        in >> model.verticesPos[3 * numVertices + 0];
-                        in >> model.verticesPos[3 * numVertices + 1];
-                        in >> model.verticesPos[3 * numVertices + 2];
-                        numVertices++;
-                    }break;
-
-                    case 'n':
-                    {
-                        in >> model.normals[3 * numNormals + 0];
-                        in >> model.normals[3 * numNormals + 1];
-                        in >> model.normals[3 * numNormals + 2];
-                        numNormals++;
-                    }break;
-
-                    case 't':
-                    {
-                        in >> model.texCords[2 * numTexCords + 0];
-                        in >> model.texCords[2 * numTexCords + 1];
-                        numTexCords++;
-                    }break;
-                }
-            }break;
+            model.matrialPath = materialLib;
+            objReadMatrial(model, materialLib);
+        }
+    }
 
-            case 'u':
-            {
-                std::getline(in, buf);
-                std::stringstream s(buf);
-
-                s >> buf;
-                s >> buf;
-                // group by material
-                group = &model.addGroup(buf);
-                group->material = material = model.materials[buf];
-            }break;
-            case 'g':
-            {
-                // Seems like I can ignore groups for now
-                std::getline(in, buf);
-                //in >> buf;
-                //group = &model.addGroup(buf);
-                //group->material = material;
-            }break;
-
-            case 'f':
+    Group* group = &model.addGroup("defualt");
+    GLuint skippedFaces = 0;
+    std::vector<VertexIndex> faceIndices;
+    for (const ObjChunk& chunk : chunks)
+    {
+        size_t nextSwitch = 0;
+        for (GLuint f = 0; f <= chunk.faces.size(); f++)
+        {
+            // group by material
+            for (; nextSwitch < chunk.materialSwitches.size() && chunk.materialSwitches[nextSwitch].firstFace == f; nextSwitch++)
             {
-                //std::string buf;
-                v = n = t = 0;
+                const std::string& name = chunk.materialSwitches[nextSwitch].name;
+                group = &model.addGroup(name);
 
-                in >> buf;
-                // can be one of v , v//n, v/t, v/t/n, x//x
-                if (buf.find("//") != std::string::npos)
+                // materials missing from the .mtl files get the default one
+                auto material = model.materials.find(name);
+                if (material == model.materials.end())
                 {
-                    // v//n
-                    // make the string easier to parse
-                    std::stringstream s;
-
-                    GLushort index;
-                    // merge all the face vertex data together and add to the vector
-                    for (int i = 0; i < 3; i ++)
-                    {
-                        // make the string easier to parse
-                        std::replace(buf.begin(), buf.end(), '/', ' ');
-                        std::stringstream s(buf);
-                        s >> v;
-                        s >> n;
-
-                        index = group->addVertex(model,&v, nullptr, &n);
-                        group->indices.push_back(index);
-
-                        // will read the next word before quitting the loop
-                        in >> buf;
-                    }
-
-                    readNextLine = false;
-                    while (buf.find("//") != std::string::npos)
-                    {
-                        // make the string easier to parse
-                        std::replace(buf.begin(), buf.end(), '/', ' ');
-                        std::stringstream s(buf);
-                        s >> v;
-                        s >> n;
-
-                        int indicesSize = group->indices.size();
-                        group->indices.push_back(group->indices[indicesSize - 3]);
-                        group->indices.push_back(group->indices[indicesSize - 1]);
-
-                        index = group->addVertex(model, &v, nullptr, &n);
-                        group->indices.push_back(index);
-
-                        in >> buf;
-                    }
-
-                }
-                else if (std::count(buf.begin(), buf.end(), '/') == 2)
-                {
-                    // v/t/n
-                    GLushort index;
-
-                    for (int i = 0; i < 3; i++)
-                    {
-                        std::replace(buf.begin(), buf.end(), '/', ' ');
-                        std::stringstream s(buf);
-                        s >> v;
-                        s >> t;
-                        s >> n;
-
-                        index = group->addVertex(model ,&v, &t, &n);
-                        group->indices.push_back(index);
-
-                        in >> buf;
-                    }
-
-                    readNextLine = false;
-                    while (std::count(buf.begin(), buf.end(), '/') > 0)
-                    {
-                        std::replace(buf.begin(), buf.end(), '/', ' ');
-                        std::stringstream s(buf);
-                        s >> v;
-                        s >> t;
-                        s >> n;
-
-                        int indicesSize = group->indices.size();
-                        group->indices.push_back(group->indices[indicesSize - 3]);
-                        group->indices.push_back(group->indices[indicesSize - 1]);
-
-                        index = group->addVertex(model, &v, &t, &n);
-                        group->indices.push_back(index);
-
-                        in >> buf;
-                    }
-
+                    material = model.materials.emplace(name, model.materialList.size()).first;
+                    model.materialList.push_back(Material());
                 }
-                else if (std::count(buf.begin(), buf.end(), '/') == 1)
-                {
-                    // v/t
-                    GLushort index;
-
-                    for (int i = 0; i < 3; i++)
-                    {
-                        std::replace(buf.begin(), buf.end(), '/', ' ');
-                        std::stringstream s(buf);
-                        s >> v;
-                        s >> t;
-
-                        index = group->addVertex(model, &v, &t, nullptr);
-                        group->indices.push_back(index);
-
-                        in >> buf;
-                    }
-
-                    readNextLine = false;
-                    while (std::count(buf.begin(), buf.end(), '/') > 0)
-                    {
-                        std::replace(buf.begin(), buf.end(), '/', ' ');
-                        std::stringstream s(buf);
-                        s >> v;
-                        s >> t;
+                group->material = material->second;
+            }
 
-                        int indicesSize = group->indices.size();
-                        group->indices.push_back(group->indices[indicesSize - 3]);
-                        group->indices.push_back(group->indices[indicesSize - 1]);
+            if (f == chunk.faces.size())
+                break;
 
-                        index = group->addVertex(model, &v, &t, nullptr);
-                        group->indices.push_back(index);
+            const ObjFace& face = chunk.faces[f];
+            faceIndices.clear();
+            for (GLuint c = 0; c < face.cornerCount; c++)
+            {
+                const ObjCorner& corner = chunk.corners[face.firstCorner + c];
+                GLint v = objResolveIndex(corner.v, chunk.vertexBase + face.vertexCount, model.numVertices);
+                GLint t = objResolveIndex(corner.t, chunk.texCordBase + face.texCordCount, model.numTexCords);
+                GLint n = objResolveIndex(corner.n, chunk.normalBase + face.normalCount, model.numNormals);
+                if (v < 0)
+                    break;
 
-                        in >> buf;
-                    }
+                faceIndices.push_back(group->addVertex(model, v, t, n));
+            }
 
-                }
-                else
-                {
-                    // v
-                    GLushort index;
-                    std::stringstream s(buf);
-                    s >> v;
-
-                    //std::cout << v;
-
-                    index = group->addVertex(model, &v, nullptr, nullptr);
-                    group->indices.push_back(index);
-
-                    for (int i = 0; i < 2; i++)
-                    {
-                        in >> v;
-                        //std::cout <<" "<< v;
-
-                        index = group->addVertex(model, &v, nullptr, nullptr);
-                        group->indices.push_back(index);
-                    }
-
-                    //std::cout << "\n";
-
-                    in >> buf;
-                    readNextLine = false;
-                    s = std::stringstream(buf);
-                    s >> v;
-                    while (!s.fail() && !in.eof())
-                    {
-                        //s = std::stringstream(buf);
-                        //s >> v;
-                        int indicesSize = group->indices.size();
-                        group->indices.push_back(group->indices[indicesSize - 3]);
-                        group->indices.push_back(group->indices[indicesSize - 1]);
-
-                        index = group->addVertex(model,&v, nullptr, nullptr);
-                        group->indices.push_back(index);
-
-                        in >> buf;
-                        s = std::stringstream(buf);
-                        s >> v;
-                    }
-                }
-            }break;
+            if (faceIndices.size() != face.cornerCount)
+            {
+                skippedFaces++;
+                continue;
+            }
 
-            default:
-                std::getline(in, buf);
-            break;
+            // polygons are split into a fan of triangles
+            for (GLuint c = 2; c < face.cornerCount; c++)
+            {
+                group->indices.push_back(faceIndices[0]);
+                group->indices.push_back(faceIndices[c - 1]);
+                group->indices.push_back(faceIndices[c]);
+            }
 
+            model.numTrinagles += face.cornerCount - 2;
+            group->numTrinagles += face.cornerCount - 2;
         }
-
-        if (readNextLine)
-            in >> buf;
-        else
-            readNextLine = true;
     }
 
+    if (skippedFaces > 0)
+        std::cout << model.meshPath << ": skipped " << skippedFaces << " faces with invalid vertex indices\n";
+
+    return true;
 }
 
 //-----------------------------------------------------------------------------
 // Name : objReadMatrial
 //-----------------------------------------------------------------------------
-void objReadMatrial(AssetManager& asset, Model& model, std::string matrialPath)
+void objReadMatrial(Model& model, std::string matrialPath)
 {
-    std::ifstream in;
     std::string& meshPath = model.meshPath;
     std::string dir;
-    char buf[128];
 
     GLuint numMaterials;
     Material curMaterial;
@@ -691,110 +589,64 @@ void objReadMatrial(AssetManager& asset, Model& model, std::string matrialPath)
     else
         dir = "";
 
-    in.open(dir + matrialPath);
-
-    if (!in.is_open())
+    MappedFile file;
+    if (!file.Open(dir + matrialPath))
     {
         std::cout << "objReadMatrial() failed: can't open material file "<< dir + matrialPath << "\n";
         return;
     }
 
-    // first pass of the file
-    numMaterials = 1;
-
-    in >> buf;
-    while (!in.eof())
-    {
-        switch(buf[0])
-        {
-            case '#':
-                in.getline(buf, 128);
-            break;
-            case 'n':
-                in.getline(buf, 128);
-                numMaterials++;
-            break;
-            default:
-                in.getline(buf, 128);
-            break;
-        }
-
-        in >> buf;
-    }
-
-    in.clear();
-    in.seekg(0, std::ios::beg);
+    const char* line = reinterpret_cast<const char*>(file.GetData());
+    const char* end = line + file.GetSize();
 
-    //model.materials = new Material[numMaterials];
-    model.numMaterials = numMaterials;
-
-    // second pass
     numMaterials = 0;
-
-    in >> buf;
-    while (!in.eof())
+    while (line < end)
     {
-        switch(buf[0])
-        {
-            case '#':
-                in.getline(buf, 128);
-            break;
-            case 'n':
-                GLuint materialIndex;
-
-                if (numMaterials != 0)
-                {
-                    // new material detected
-                    // save the pervious material
-                    materialIndex = asset.getMaterialIndex(curMaterial);
-                    model.materials.insert(std::pair<std::string, GLuint>(curMaterialName, materialIndex));
-                    curMaterial = Material();
-                }
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (lineEnd == nullptr)
+            lineEnd = end;
 
-                numMaterials++;
+        const char* token = objSkipSpaces(line, lineEnd);
+        const char* tokenEnd = objTokenEnd(token, lineEnd);
+        const char* p = tokenEnd;
 
-                in >> buf;
-                curMaterialName = buf;
-            break;
-            case 'N':
+        if (objIsToken(token, tokenEnd, "newmtl"))
+        {
+            if (numMaterials != 0)
             {
-                float shininess;
-                in >> curMaterial.power;
-                curMaterial.power /= 1000.0;
-                curMaterial.power *= 128.0;
+                // new material detected
+                // save the pervious material
+                model.materials.insert(std::pair<std::string, GLuint>(curMaterialName, model.materialList.size()));
+                model.materialList.push_back(curMaterial);
+                curMaterial = Material();
             }
-            break;
 
-            case 'K':
-                switch (buf[1])
-                {
-                    case 'd':
-                        in >> curMaterial.diffuse.r;
-                        in >> curMaterial.diffuse.g;
-                        in >> curMaterial.diffuse.b;
-                        curMaterial.diffuse.a = 1.0f;
-                    break;
-                    case 's':
-                        in >> curMaterial.specular.r;
-                        in >> curMaterial.specular.g;
-                        in >> curMaterial.specular.b;
-                        curMaterial.specular.a = 1.0f;
-                    break;
-                    case 'a':
-                        in >> curMaterial.ambient.r;
-                        in >> curMaterial.ambient.g;
-                        in >> curMaterial.ambient.b;
-                        curMaterial.ambient.a = 1.0f;
-                    break;
-                    default:
-                        in.getline(buf, 128);
-                    break;
-                }
+            numMaterials++;
+            curMaterialName = objReadToken(p, lineEnd);
         }
-        in >> buf;
+        else if (objIsToken(token, tokenEnd, "Ns"))
+        {
+            objParseFloat(p, lineEnd, curMaterial.power);
+            curMaterial.power /= 1000.0;
+            curMaterial.power *= 128.0;
+        }
+        else if (objIsToken(token, tokenEnd, "Kd") || objIsToken(token, tokenEnd, "Ks") || objIsToken(token, tokenEnd, "Ka"))
+        {
+            glm::vec4& color = (token[1] == 'd') ? curMaterial.diffuse : (token[1] == 's') ? curMaterial.specular : curMaterial.ambient;
+            for (int i = 0; i < 3; i++)
+                p = objParseFloat(p, lineEnd, color[i]);
+            color.a = 1.0f;
+        }
+
+        line = lineEnd + 1;
     }
 
+    model.numMaterials = numMaterials;
+
     // save the last material added
-    GLuint materialIndex = asset.getMaterialIndex(curMaterial);
-    model.materials.insert(std::pair<std::string, GLuint>(curMaterialName, materialIndex));
+    if (numMaterials != 0)
+    {
+        model.materials.insert(std::pair<std::string, GLuint>(curMaterialName, model.materialList.size()));
+        model.materialList.push_back(curMaterial);
+    }
 }
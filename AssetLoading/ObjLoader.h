@@ -21,6 +21,8 @@
 #define  _OBJLOADER_H
 
 #include <unordered_map>
+#include <vector>
+#include <string>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include "../Render/RenderTypes.h"
@@ -32,12 +34,28 @@
 class AssetManager;
 struct Model;
 
+// the position, normal and texture coordinates of a vertex, either snapped
+// to the weld epsilon or as the bits of the floats for exact welding
+struct VertexWeldKey
+{
+    GLint values[8];
+
+    bool operator==(const VertexWeldKey& key) const;
+};
+
+struct VertexWeldKeyHash
+{
+    size_t operator()(const VertexWeldKey& key) const;
+};
+
 struct Group
 {
-    Group(std::string& rName);
+    Group(std::string& rName, GLfloat rWeldEpsilon);
 
-    GLushort addVertex(glm::vec3 pos, glm::vec3 normal, glm::vec2 texCords);
-    GLushort addVertex(Model& model,int* v, int* t, int* n);
+    // returns the index of an equal vertex added before if there is one
+    VertexIndex addVertex(const glm::vec3& pos, const glm::vec3& normal, const glm::vec2& texCords);
+    // the indices start at 0, -1 for a missing texture coordinate or normal
+    VertexIndex addVertex(const Model& model, GLint v, GLint t, GLint n);
 
     std::string name;
     GLuint numTrinagles;
@@ -46,11 +64,16 @@ struct Group
     std::vector<VertexIndex> indices;
 
     GLuint material;
+
+    // 0 welds only equal vertices, otherwise vertices that snap to the same
+    // point of a grid with this spacing are welded to the first of them
+    GLfloat weldEpsilon;
+    std::unordered_map<VertexWeldKey, VertexIndex, VertexWeldKeyHash> weldTable;
 };
 
 struct Model
 {
-    Model(std::string newMeshPath);
+    Model(std::string newMeshPath, GLfloat newWeldEpsilon = 0.0f);
     ~Model();
 
     Group& addGroup(std::string name);
@@ -75,13 +98,20 @@ struct Model
     GLuint numGroups;
     
     std::vector<Group> groups;
+    // the materials of the .mtl files, the groups and materials map index
+    // materialList until the mesh is added to the AssetManager
+    std::vector<Material> materialList;
     std::unordered_map<std::string,GLuint> materials;
 
     glm::vec3 pos;
+    GLfloat weldEpsilon;
 };
 
-void objFirstPass(AssetManager &asset, std::ifstream& in , Model& model);
-void objSecondPass(std::ifstream& in ,Model& model);
-void objReadMatrial(AssetManager& asset, Model& model, std::string matrialPath);
+// files smaller than this are parsed by a single thread
+const size_t OBJ_MIN_CHUNK_SIZE = 1 << 20;
+
+// doesn't use the AssetManager so it can run on any thread
+bool objLoad(Model& model);
+void objReadMatrial(Model& model, std::string matrialPath);
 
 #endif // _OBJLOADER_H
@@ -0,0 +1,383 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TextureCompressor.h"
+#include "../Render/UploadManager.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+//-----------------------------------------------------------------------------
+// Name : ConvertToRGBA ()
+//-----------------------------------------------------------------------------
+void TextureCompressor::ConvertToRGBA(const GLubyte* pixels, GLsizei width, GLsizei height, GLenum format, GLuint bytesPerPixel,
+                                      std::vector<GLubyte>& rgba)
+{
+    GLsizeiptr rowSize = UploadManager::GetTextureRowSize(width, bytesPerPixel);
+    bool swapRedBlue = (format == GL_BGR || format == GL_BGRA);
+    bool hasAlpha = (bytesPerPixel == 4);
+
+    rgba.resize(size_t(width) * height * 4);
+    GLubyte* dst = rgba.data();
+    for (GLsizei y = 0; y < height; y++)
+    {
+        const GLubyte* src = pixels + y * rowSize;
+        for (GLsizei x = 0; x < width; x++)
+        {
+            dst[0] = src[swapRedBlue ? 2 : 0];
+            dst[1] = src[1];
+            dst[2] = src[swapRedBlue ? 0 : 2];
+            dst[3] = hasAlpha ? src[3] : 255;
+
+            src += bytesPerPixel;
+            dst += 4;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : GenerateMips ()
+// Desc : the last row and column of odd sized levels are sampled twice
+//-----------------------------------------------------------------------------
+void TextureCompressor::GenerateMips(std::vector<GLubyte>&& rgba, GLsizei width, GLsizei height,
+                                     std::vector<std::vector<GLubyte>>& levels)
+{
+    levels.clear();
+    levels.push_back(std::move(rgba));
+
+    while (width > 1 || height > 1)
+    {
+        GLsizei mipWidth = std::max(width / 2, 1);
+        GLsizei mipHeight = std::max(height / 2, 1);
+        const GLubyte* src = levels.back().data();
+
+        std::vector<GLubyte> mip(size_t(mipWidth) * mipHeight * 4);
+        for (GLsizei y = 0; y < mipHeight; y++)
+        {
+            const GLubyte* row0 = src + size_t(std::min(y * 2, height - 1)) * width * 4;
+            const GLubyte* row1 = src + size_t(std::min(y * 2 + 1, height - 1)) * width * 4;
+            for (GLsizei x = 0; x < mipWidth; x++)
+            {
+                GLsizei x0 = std::min(x * 2, width - 1) * 4;
+                GLsizei x1 = std::min(x * 2 + 1, width - 1) * 4;
+                GLubyte* dst = &mip[(size_t(y) * mipWidth + x) * 4];
+                for (int c = 0; c < 4; c++)
+                    dst[c] = GLubyte((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+            }
+        }
+
+        levels.push_back(std::move(mip));
+        width = mipWidth;
+        height = mipHeight;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : HasAlpha ()
+//-----------------------------------------------------------------------------
+bool TextureCompressor::HasAlpha(const std::vector<GLubyte>& rgba)
+{
+    for (size_t i = 3; i < rgba.size(); i += 4)
+    {
+        if (rgba[i] != 255)
+            return true;
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CompressBC1 ()
+//-----------------------------------------------------------------------------
+void TextureCompressor::CompressBC1(const GLubyte* rgba, GLsizei width, GLsizei height, std::vector<GLubyte>& blocks)
+{
+    GLsizei blocksX = (width + 3) / 4;
+    GLsizei blocksY = (height + 3) / 4;
+    blocks.resize(size_t(blocksX) * blocksY * BC1_BLOCK_SIZE);
+
+    GLubyte texels[16][4];
+    GLubyte* block = blocks.data();
+    for (GLsizei y = 0; y < blocksY; y++)
+    {
+        for (GLsizei x = 0; x < blocksX; x++)
+        {
+            ReadBlock(rgba, width, height, x, y, texels);
+            EncodeColorBlock(texels, block);
+            block += BC1_BLOCK_SIZE;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : CompressBC3 ()
+// Desc : every block is an alpha block followed by a BC1 color block
+//-----------------------------------------------------------------------------
+void TextureCompressor::CompressBC3(const GLubyte* rgba, GLsizei width, GLsizei height, std::vector<GLubyte>& blocks)
+{
+    GLsizei blocksX = (width + 3) / 4;
+    GLsizei blocksY = (height + 3) / 4;
+    blocks.resize(size_t(blocksX) * blocksY * BC3_BLOCK_SIZE);
+
+    GLubyte texels[16][4];
+    GLubyte* block = blocks.data();
+    for (GLsizei y = 0; y < blocksY; y++)
+    {
+        for (GLsizei x = 0; x < blocksX; x++)
+        {
+            ReadBlock(rgba, width, height, x, y, texels);
+            EncodeAlphaBlock(texels, block);
+            EncodeColorBlock(texels, block + 8);
+            block += BC3_BLOCK_SIZE;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBlockSize ()
+// Desc : 0 for formats that are not block compressed
+//-----------------------------------------------------------------------------
+GLuint TextureCompressor::GetBlockSize(GLenum internalFormat)
+{
+    if (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+        return BC1_BLOCK_SIZE;
+    if (internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+        return BC3_BLOCK_SIZE;
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetCompressedSize ()
+//-----------------------------------------------------------------------------
+GLsizeiptr TextureCompressor::GetCompressedSize(GLenum internalFormat, GLsizei width, GLsizei height)
+{
+    return GLsizeiptr((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(internalFormat);
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReadBlock ()
+//-----------------------------------------------------------------------------
+void TextureCompressor::ReadBlock(const GLubyte* rgba, GLsizei width, GLsizei height, GLsizei blockX, GLsizei blockY,
+                                  GLubyte texels[16][4])
+{
+    for (int y = 0; y < 4; y++)
+    {
+        GLsizei row = std::min(blockY * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++)
+        {
+            GLsizei column = std::min(blockX * 4 + x, width - 1);
+            const GLubyte* texel = rgba + (size_t(row) * width + column) * 4;
+            for (int c = 0; c < 4; c++)
+                texels[y * 4 + x][c] = texel[c];
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : PackRGB565 ()
+//-----------------------------------------------------------------------------
+static GLushort PackRGB565(const float color[3])
+{
+    int r = int(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    int g = int(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+    int b = int(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+
+    return GLushort((r << 11) | (g << 5) | b);
+}
+
+//-----------------------------------------------------------------------------
+// Name : UnpackRGB565 ()
+// Desc : the color a decoder reads back, the high bits are replicated
+//-----------------------------------------------------------------------------
+static void UnpackRGB565(GLushort packed, int color[3])
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+//-----------------------------------------------------------------------------
+// Name : EncodeColorBlock ()
+// Desc : the endpoints are the extremes of the texels projected on the
+//        principal axis of their colors, found by power iteration on the
+//        covariance matrix. color0 is kept above color1 so BC1 uses its four
+//        color mode
+//-----------------------------------------------------------------------------
+void TextureCompressor::EncodeColorBlock(const GLubyte texels[16][4], GLubyte* block)
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 3; c++)
+            mean[c] += texels[i][c];
+    }
+    for (int c = 0; c < 3; c++)
+        mean[c] /= 16.0f;
+
+    // rr, rg, rb, gg, gb, bb
+    float covariance[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++)
+    {
+        float r = texels[i][0] - mean[0];
+        float g = texels[i][1] - mean[1];
+        float b = texels[i][2] - mean[2];
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float r = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+        float g = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+        float b = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+
+        float largest = std::max(std::fabs(r), std::max(std::fabs(g), std::fabs(b)));
+        if (largest == 0.0f)
+            break;
+
+        axis[0] = r / largest;
+        axis[1] = g / largest;
+        axis[2] = b / largest;
+    }
+
+    float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    for (int c = 0; c < 3; c++)
+        axis[c] /= length;
+
+    float minProjection = 0.0f;
+    float maxProjection = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        float projection = (texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] +
+                           (texels[i][2] - mean[2]) * axis[2];
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    float endpoint0[3];
+    float endpoint1[3];
+    for (int c = 0; c < 3; c++)
+    {
+        endpoint0[c] = mean[c] + axis[c] * maxProjection;
+        endpoint1[c] = mean[c] + axis[c] * minProjection;
+    }
+
+    GLushort color0 = PackRGB565(endpoint0);
+    GLushort color1 = PackRGB565(endpoint1);
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        UnpackRGB565(color0, palette[0]);
+        UnpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            int bestIndex = 0;
+            int bestDistance = 0;
+            for (int p = 0; p < 4; p++)
+            {
+                int distance = 0;
+                for (int c = 0; c < 3; c++)
+                    distance += (texels[i][c] - palette[p][c]) * (texels[i][c] - palette[p][c]);
+
+                if (p == 0 || distance < bestDistance)
+                {
+                    bestIndex = p;
+                    bestDistance = distance;
+                }
+            }
+
+            indices |= uint32_t(bestIndex) << (i * 2);
+        }
+    }
+
+    // little endian like every field of the block formats
+    block[0] = GLubyte(color0 & 0xff);
+    block[1] = GLubyte(color0 >> 8);
+    block[2] = GLubyte(color1 & 0xff);
+    block[3] = GLubyte(color1 >> 8);
+    for (int i = 0; i < 4; i++)
+        block[4 + i] = GLubyte(indices >> (i * 8));
+}
+
+//-----------------------------------------------------------------------------
+// Name : EncodeAlphaBlock ()
+// Desc : the endpoints are the alpha extremes using the 8 value mode
+//-----------------------------------------------------------------------------
+void TextureCompressor::EncodeAlphaBlock(const GLubyte texels[16][4], GLubyte* block)
+{
+    int alpha0 = 0;
+    int alpha1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        alpha0 = std::max<int>(alpha0, texels[i][3]);
+        alpha1 = std::min<int>(alpha1, texels[i][3]);
+    }
+
+    uint64_t indices = 0;
+    if (alpha0 != alpha1)
+    {
+        int palette[8];
+        palette[0] = alpha0;
+        palette[1] = alpha1;
+        for (int p = 2; p < 8; p++)
+            palette[p] = ((8 - p) * alpha0 + (p - 1) * alpha1) / 7;
+
+        for (int i = 0; i < 16; i++)
+        {
+            int bestIndex = 0;
+            int bestDistance = 256;
+            for (int p = 0; p < 8; p++)
+            {
+                int distance = std::abs(texels[i][3] - palette[p]);
+                if (distance < bestDistance)
+                {
+                    bestIndex = p;
+                    bestDistance = distance;
+                }
+            }
+
+            indices |= uint64_t(bestIndex) << (i * 3);
+        }
+    }
+
+    block[0] = GLubyte(alpha0);
+    block[1] = GLubyte(alpha1);
+    for (int i = 0; i < 6; i++)
+        block[2 + i] = GLubyte(indices >> (i * 8));
+}
@@ -0,0 +1,62 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef  _TEXTURECOMPRESSOR_H
+#define  _TEXTURECOMPRESSOR_H
+
+#include <vector>
+#include <GL/glew.h>
+
+//-----------------------------------------------------------------------------
+// TextureCompressor - builds the mip chain of a texture and encodes it to the
+// S3TC block formats. Every buffer is RGBA8 with tightly packed rows, the
+// formats are picked per texture: BC1 (DXT1) when every texel is opaque and
+// BC3 (DXT5) otherwise. Blocks are fitted along the principal axis of their
+// colors, which is fast enough to run at first load on a worker thread.
+//-----------------------------------------------------------------------------
+class TextureCompressor
+{
+public:
+    static const GLuint BC1_BLOCK_SIZE = 8;
+    static const GLuint BC3_BLOCK_SIZE = 16;
+
+    // expands RGB, BGR and BGRA pixels with rows padded to 4 bytes to RGBA8
+    static void ConvertToRGBA(const GLubyte* pixels, GLsizei width, GLsizei height, GLenum format, GLuint bytesPerPixel,
+                              std::vector<GLubyte>& rgba);
+    // box filters level 0 down to 1x1, level 0 is moved to levels[0]
+    static void GenerateMips(std::vector<GLubyte>&& rgba, GLsizei width, GLsizei height,
+                             std::vector<std::vector<GLubyte>>& levels);
+    static bool HasAlpha(const std::vector<GLubyte>& rgba);
+
+    // the blocks of a level in rows of 4x4 texels, the texels of partial
+    // blocks at the edges repeat the last row or column
+    static void CompressBC1(const GLubyte* rgba, GLsizei width, GLsizei height, std::vector<GLubyte>& blocks);
+    static void CompressBC3(const GLubyte* rgba, GLsizei width, GLsizei height, std::vector<GLubyte>& blocks);
+
+    static GLuint     GetBlockSize     (GLenum internalFormat);
+    static GLsizeiptr GetCompressedSize(GLenum internalFormat, GLsizei width, GLsizei height);
+
+private:
+    static void ReadBlock       (const GLubyte* rgba, GLsizei width, GLsizei height, GLsizei blockX, GLsizei blockY,
+                                 GLubyte texels[16][4]);
+    static void EncodeColorBlock(const GLubyte texels[16][4], GLubyte* block);
+    static void EncodeAlphaBlock(const GLubyte texels[16][4], GLubyte* block);
+};
+
+#endif  //_TEXTURECOMPRESSOR_H
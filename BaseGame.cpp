@@ -38,6 +38,10 @@ BaseGame::BaseGame()
 
     m_spriteShader = nullptr;
     m_spriteTextShader = nullptr;
+
+    m_useRenderThread = false;
+    m_viewportWidth = 0;
+    m_viewportHeight = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -53,12 +57,32 @@ BaseGame::~BaseGame()
 //-----------------------------------------------------------------------------
 int BaseGame::BeginGame()
 {
+    if (m_useRenderThread)
+    {
+        // hand the context over to the render thread
+        m_window->makeContextCurrent(false);
+        m_renderThread.Start(m_window, [this](const RenderPacket& packet) { executeFrame(packet); });
+    }
+
     while (m_gameRunning && m_window->isRunning())
     {
         m_window->pumpMessages();
             
         m_timer.frameAdvanced();
 
+        if (m_useRenderThread)
+        {
+            if (!m_timer.isCap())
+            {
+                // waits only if the render thread is still on the frame before the last one
+                RenderPacket& packet = m_renderThread.BeginPacket();
+                buildFrame(packet);
+                m_renderThread.SubmitPacket();
+            }
+
+            continue;
+        }
+
         int err = glGetError();
         if (err != GL_NO_ERROR)
             std::cout <<"MsgLoop: ERROR bitches\n";
@@ -68,6 +92,13 @@ int BaseGame::BeginGame()
             drawing();
         }
     }
+
+    if (m_useRenderThread)
+    {
+        m_renderThread.Stop();
+        m_window->makeContextCurrent(true);
+        GLThread::SetCurrent();
+    }
     
     return 0;
 }
@@ -79,6 +110,11 @@ bool BaseGame::Shutdown()
 {
     if (m_window)
     {
+        // the context goes away with the window, the GL objects of the
+        // singletons are deleted first since they are destroyed without it
+        UploadManager::Get().Shutdown();
+        GeometryArena::Get().Shutdown();
+
         bool ret = m_window->closeWindow();
         delete m_window;
         m_window = nullptr;
@@ -91,7 +127,7 @@ bool BaseGame::Shutdown()
 //-----------------------------------------------------------------------------
 // Name : initGame 
 //-----------------------------------------------------------------------------
-bool BaseGame::initGame(BaseWindow* window,int width, int height)
+bool BaseGame::initGame(BaseWindow* window,int width, int height, bool useRenderThread/* = false*/)
 {
     std::cout << "InitGame started\n";
 
@@ -100,6 +136,12 @@ bool BaseGame::initGame(BaseWindow* window,int width, int height)
     
     m_window = window;
     m_window->setTimer(&m_timer);
+    // objects, fonts and the GUI still make their GL resources on the main
+    // thread when they are created, so the render thread can't own the
+    // context until that work goes through runOnRenderThread
+    if (useRenderThread)
+        std::cout << "The render thread is not supported yet, rendering on the main thread\n";
+    m_useRenderThread = false;
     
     m_window->connectToSizeChangedEvent(boost::bind(&BaseGame::reshape, this, _1, _2));
     m_window->connectToKeyEvent(boost::bind(&BaseGame::sendKeyEvent, this, _1, _2));
@@ -110,6 +152,7 @@ bool BaseGame::initGame(BaseWindow* window,int width, int height)
         return false;
     
     glewInit();
+    GLThread::SetCurrent();
     
     m_spriteShader = m_asset.getShader("data/shaders/sprite");
     m_spriteTextShader = m_asset.getShader("data/shaders/spriteText");
@@ -158,19 +201,35 @@ void BaseGame::setRenderStates()
 //-----------------------------------------------------------------------------
 void BaseGame::drawing()
 {
-    int err;
-
 //     if (m_scene && m_sceneInput)
 //     {
 //         MouseDrift mouseDrift = m_window->processInput();
 //         m_scene->processInput(m_timer.getTimeElapsed(), m_window->getKeyStatus(), mouseDrift.x, mouseDrift.y);
 //     }
 
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    buildFrame(m_framePacket);
+    executeFrame(m_framePacket);
+}
+
+//-----------------------------------------------------------------------------
+// Name : buildFrame 
+// Desc : records the scene and the GUI into packet without any GL calls
+//-----------------------------------------------------------------------------
+void BaseGame::buildFrame(RenderPacket& packet)
+{
+    // the asynchronous loads whose GL objects were made by executeFrame are
+    // added to the caches on this thread, the GUI reads them here too
+    m_asset.completeAsyncLoads();
+
+    packet.Clear();
+    packet.width = m_window->getWidth();
+    packet.height = m_window->getHeight();
 
     if (m_scene)
-        m_scene->Drawing( m_timer.getTimeElapsed());
+    {
+        m_scene->BuildFramePacket(packet.scene);
+        packet.hasScene = true;
+    }
 
     std::stringstream ss;
     if (m_scene != nullptr)
@@ -192,9 +251,10 @@ void BaseGame::drawing()
         }
         
         ss << " " << temp << " | " << temp << " " << 7 - square;
+        ss << " | visible " << m_scene->getVisibleObjectCount() << " culled " << m_scene->getCulledObjectCount();
+        ss << " | draw calls " << m_scene->getDrawCallCount();
     }
 
-    glDisable(GL_DEPTH_TEST);
 //     renderFPS(m_sprites[1], *m_font );
 //     m_font->renderToRect(m_sprites[1], ss.str(), Rect(0, 65, 500, 200),
 //                         glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
@@ -204,14 +264,61 @@ void BaseGame::drawing()
 
     renderGUI();
 
-    m_sprites[0].Render( m_spriteShader );
+    m_sprites[0].MoveStreams(packet.spriteLayers[RenderPacket::SPRITES]);
     m_sprites[0].Clear();
-    m_sprites[1].Render( m_spriteTextShader );
+    m_sprites[1].MoveStreams(packet.spriteLayers[RenderPacket::TEXT_SPRITES]);
     m_sprites[1].Clear();
-    m_topSprites[0].Render( m_spriteShader );
+    m_topSprites[0].MoveStreams(packet.spriteLayers[RenderPacket::TOP_SPRITES]);
     m_topSprites[0].Clear();
-    m_topSprites[1].Render( m_spriteTextShader );
+    m_topSprites[1].MoveStreams(packet.spriteLayers[RenderPacket::TOP_TEXT_SPRITES]);
     m_topSprites[1].Clear();
+}
+
+//-----------------------------------------------------------------------------
+// Name : executeFrame 
+// Desc : issues the GL calls for a packet made by buildFrame and presents it
+//-----------------------------------------------------------------------------
+void BaseGame::executeFrame(const RenderPacket& packet)
+{
+    int err;
+
+    // the GL part of asynchronous loads and the streamed asset data, both
+    // limited to their frame budget
+    m_asset.processAsyncLoads();
+    UploadManager::Get().Process();
+
+    if (packet.width != m_viewportWidth || packet.height != m_viewportHeight)
+    {
+        glViewport(0, 0, packet.width, packet.height);
+
+        if ( m_spriteShader != nullptr)
+        {
+            m_spriteShader->Use();
+            glUniform2i(glGetUniformLocation( m_spriteShader->Program, "screenSize"), packet.width / 2, packet.height / 2);
+        }
+
+        if ( m_spriteTextShader != nullptr)
+        {
+            m_spriteTextShader->Use();
+            glUniform2i(glGetUniformLocation( m_spriteTextShader->Program, "screenSize"), packet.width / 2, packet.height / 2);
+        }
+
+        m_viewportWidth = packet.width;
+        m_viewportHeight = packet.height;
+    }
+
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    if (packet.hasScene)
+        m_scene->SubmitFramePacket(packet.scene);
+
+    glDisable(GL_DEPTH_TEST);
+
+    m_sprites[0].Render( m_spriteShader, packet.spriteLayers[RenderPacket::SPRITES] );
+    m_sprites[1].Render( m_spriteTextShader, packet.spriteLayers[RenderPacket::TEXT_SPRITES] );
+    m_topSprites[0].Render( m_spriteShader, packet.spriteLayers[RenderPacket::TOP_SPRITES] );
+    m_topSprites[1].Render( m_spriteTextShader, packet.spriteLayers[RenderPacket::TOP_TEXT_SPRITES] );
 
     glEnable(GL_DEPTH_TEST);
 
@@ -239,26 +346,24 @@ void BaseGame::renderFPS(Sprite& textSprite, mkFont& font)
 //-----------------------------------------------------------------------------
 void BaseGame::reshape(int width, int height)
 {
+    // the viewport and the sprite shaders screen size are set by executeFrame
     if (m_scene)
         m_scene->reshape(width, height);
-    else
-        glViewport(0, 0, width, height);
-
-    if ( m_spriteShader != nullptr)
-    {
-        m_spriteShader->Use();
-        glUniform2i(glGetUniformLocation( m_spriteShader->Program, "screenSize"), width / 2, height / 2);
-    }
-
-    if ( m_spriteTextShader != nullptr)
-    {
-        m_spriteTextShader->Use();
-        glUniform2i(glGetUniformLocation( m_spriteTextShader->Program, "screenSize"), width / 2, height / 2);
-    }
 
     onSizeChanged();
 }
 
+//-----------------------------------------------------------------------------
+// Name : runOnRenderThread 
+//-----------------------------------------------------------------------------
+void BaseGame::runOnRenderThread(const RenderThread::Job& job)
+{
+    if (m_renderThread.IsRunning())
+        m_renderThread.EnqueueJob(job);
+    else
+        job();
+}
+
 //-----------------------------------------------------------------------------
 // Name : ProcessInput 
 //-----------------------------------------------------------------------------
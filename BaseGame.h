@@ -33,6 +33,9 @@
 #include "Render/Scene.h"
 #include "Input/input.h"
 #include "Render/Sprite.h"
+#include "Render/RenderPacket.h"
+#include "Render/RenderThread.h"
+#include "Render/GLThread.h"
 
 class BaseGame
 {
@@ -40,11 +43,13 @@ public:
     BaseGame();
     virtual ~BaseGame();
 
-    bool initGame(BaseWindow* window,int width, int height);
+    bool initGame(BaseWindow* window,int width, int height, bool useRenderThread = false);
 
     void setRenderStates();
 
     void drawing();
+    void buildFrame(RenderPacket& packet);
+    void executeFrame(const RenderPacket& packet);
     void renderFPS(Sprite& textSprite, mkFont& font);
 
     void reshape(int width, int height);
@@ -61,6 +66,8 @@ protected:
     virtual void sendVirtualKeyEvent(GK_VirtualKey virtualKey, bool down, const ModifierKeysStates& modifierStates) {};
     virtual void sendMouseEvent(MouseEvent event, const ModifierKeysStates &modifierStates);
     virtual void onSizeChanged() {};
+    // GL work outside of the frame has to go through here when the render thread is used
+    void runOnRenderThread(const RenderThread::Job& job);
 
     BaseWindow* m_window;
     bool m_gameRunning;
@@ -81,6 +88,16 @@ protected:
 
     Shader* m_spriteShader;
     Shader* m_spriteTextShader;
+
+    // when m_useRenderThread is set the main thread only records packets and
+    // m_renderThread owns the GL context, otherwise m_framePacket is used.
+    // initGame doesn't set it yet, see there
+    bool m_useRenderThread;
+    RenderThread m_renderThread;
+    RenderPacket m_framePacket;
+    // the window size the viewport and sprite shaders were last set to, render thread only
+    int m_viewportWidth;
+    int m_viewportHeight;
 };
 
 #endif  //_BaseGame_H
@@ -0,0 +1,179 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Checks the memory a mesh load needs. The SubMesh takes the loader buffers
+// and packing it for the GPU shares full precision vertices and 32 bit
+// indices with the upload, so the peak stays near 1x the mesh size instead
+// of a copy per stage. Nothing here needs a GL context
+
+#include "Render/subMesh.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+static std::atomic<size_t> s_curBytes(0);
+static std::atomic<size_t> s_peakBytes(0);
+
+// every block keeps its size in front of it so delete can count it
+static const size_t BLOCK_HEADER = alignof(std::max_align_t);
+
+//-----------------------------------------------------------------------------
+// Name : operator new
+//-----------------------------------------------------------------------------
+void* operator new(size_t size)
+{
+    void* block = std::malloc(size + BLOCK_HEADER);
+    if (!block)
+        throw std::bad_alloc();
+
+    *static_cast<size_t*>(block) = size;
+    size_t cur = s_curBytes += size;
+    size_t peak = s_peakBytes;
+    while (cur > peak && !s_peakBytes.compare_exchange_weak(peak, cur));
+
+    return static_cast<char*>(block) + BLOCK_HEADER;
+}
+
+//-----------------------------------------------------------------------------
+// Name : operator delete
+//-----------------------------------------------------------------------------
+void operator delete(void* ptr) noexcept
+{
+    if (!ptr)
+        return;
+
+    void* block = static_cast<char*>(ptr) - BLOCK_HEADER;
+    s_curBytes -= *static_cast<size_t*>(block);
+    std::free(block);
+}
+
+//-----------------------------------------------------------------------------
+// Name : operator delete
+//-----------------------------------------------------------------------------
+void operator delete(void* ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetPeak ()
+// Desc : returns the bytes allocated now, the peak starts again from them
+//-----------------------------------------------------------------------------
+static size_t ResetPeak()
+{
+    size_t cur = s_curBytes;
+    s_peakBytes = cur;
+    return cur;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildGrid ()
+// Desc : a grid with more than 65536 vertices so it needs 32 bit indices, the
+//        texture coordinates repeat too often for the quantized format
+//-----------------------------------------------------------------------------
+static void BuildGrid(GLuint size, std::vector<Vertex>& vertices, std::vector<VertexIndex>& indices)
+{
+    vertices.reserve(size * size);
+    for (GLuint z = 0; z < size; z++)
+    {
+        for (GLuint x = 0; x < size; x++)
+        {
+            glm::vec2 texCoords = glm::vec2(x, z) * (8.0f / (size - 1)) + glm::vec2(1.0f / 3000.0f);
+            vertices.emplace_back(glm::vec3(x, 0.0f, z), glm::vec3(0.0f, 1.0f, 0.0f), texCoords);
+        }
+    }
+
+    indices.reserve((size - 1) * (size - 1) * 6);
+    for (GLuint z = 0; z + 1 < size; z++)
+    {
+        for (GLuint x = 0; x + 1 < size; x++)
+        {
+            VertexIndex corner = z * size + x;
+            indices.insert(indices.end(), {corner, corner + size, corner + 1, corner + 1, corner + size, corner + size + 1});
+        }
+    }
+}
+
+int main()
+{
+    std::vector<Vertex> vertices;
+    std::vector<VertexIndex> indices;
+    BuildGrid(400, vertices, indices);
+    size_t meshBytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(VertexIndex);
+
+    // the memory the BVH build needs on its own, the tree and its temporaries
+    size_t bvhStart = ResetPeak();
+    {
+        TriangleBVH bvh;
+        bvh.Build(reinterpret_cast<const GLubyte*>(&vertices[0].Position), sizeof(Vertex), indices.data(), indices.size() / 3);
+    }
+    size_t bvhPeak = s_peakBytes - bvhStart;
+
+    std::vector<Vertex> loadedVertices(vertices);
+    std::vector<VertexIndex> loadedIndices(indices);
+    std::vector<Vertex>().swap(vertices);
+    std::vector<VertexIndex>().swap(indices);
+    const GLubyte* loaderVertices = reinterpret_cast<const GLubyte*>(loadedVertices.data());
+    const GLubyte* loaderIndices = reinterpret_cast<const GLubyte*>(loadedIndices.data());
+
+    // the loader buffers are part of the load
+    size_t loadStart = ResetPeak() - meshBytes;
+    SubMesh subMesh(std::move(loadedVertices), std::move(loadedIndices), false);
+
+    size_t buildPeak = s_peakBytes - loadStart;
+    size_t packStart = ResetPeak();
+    PackedSubMesh packed = subMesh.PackGeometry();
+    size_t packPeak = s_peakBytes - packStart;
+    size_t loadPeak = std::max(buildPeak, packStart - loadStart + packPeak);
+
+    std::cout << "mesh " << meshBytes / 1024 << " KB, bvh build " << bvhPeak / 1024 << " KB\n";
+    std::cout << "packing allocated " << packPeak / 1024 << " KB, load peak " << loadPeak / 1024 << " KB\n";
+
+    bool passed = true;
+    if (subMesh.GetVertexFormat() != VERTEX_FORMAT_FLOAT || packed.indexType != GL_UNSIGNED_INT)
+    {
+        std::cout << "FAILED: the grid has to use full precision vertices and 32 bit indices\n";
+        passed = false;
+    }
+
+    // the vertices and the indices are shared with the upload, not copied
+    if (packPeak > meshBytes / 100)
+    {
+        std::cout << "FAILED: packing copied the mesh buffers\n";
+        passed = false;
+    }
+
+    // the loader buffers were moved all the way to the upload
+    if (packed.gpuVertices.get() != loaderVertices || packed.indices.get() != loaderIndices)
+    {
+        std::cout << "FAILED: the upload does not share the loader buffers\n";
+        passed = false;
+    }
+
+    // the mesh is in memory once, only the BVH build needs more
+    if (loadPeak > meshBytes + bvhPeak + meshBytes / 100)
+    {
+        std::cout << "FAILED: the load copied the mesh\n";
+        passed = false;
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,149 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Times picking the nearest triangle of a mesh through the TriangleBVH every
+// SubMesh builds against testing every triangle, the way picking worked
+// before the BVH. Both find the same hits, which is checked too. Nothing here
+// needs a GL context
+//
+// usage: PickingBenchmark [grid size] [ray count]
+
+#include "Render/subMesh.h"
+#include "Render/TriangleBVH.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+// Name : BuildTerrain ()
+// Desc : a bumpy size x size grid, so rays hit it at different heights
+//-----------------------------------------------------------------------------
+static void BuildTerrain(GLuint size, std::vector<Vertex>& vertices, std::vector<VertexIndex>& indices)
+{
+    vertices.reserve(size * size);
+    for (GLuint z = 0; z < size; z++)
+    {
+        for (GLuint x = 0; x < size; x++)
+        {
+            float height = 4.0f * std::sin(x * 0.05f) * std::cos(z * 0.07f);
+            vertices.emplace_back(glm::vec3(x, height, z), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(x, z) / float(size));
+        }
+    }
+
+    indices.reserve((size - 1) * (size - 1) * 6);
+    for (GLuint z = 0; z + 1 < size; z++)
+    {
+        for (GLuint x = 0; x + 1 < size; x++)
+        {
+            VertexIndex corner = z * size + x;
+            indices.insert(indices.end(), {corner, corner + size, corner + 1, corner + 1, corner + size, corner + size + 1});
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : IntersectLinear ()
+// Desc : tests the ray against every triangle and keeps the nearest hit
+//-----------------------------------------------------------------------------
+static bool IntersectLinear(const std::vector<Vertex>& vertices, const std::vector<VertexIndex>& indices,
+                            const glm::vec3& rayOrigin, const glm::vec3& rayDir, RayHit& hit)
+{
+    bool found = false;
+
+    for (GLuint i = 0; i + 2 < indices.size(); i += 3)
+    {
+        glm::vec2 bary;
+        float distance;
+        if (glm::intersectRayTriangle(rayOrigin, rayDir, vertices[indices[i]].Position, vertices[indices[i + 1]].Position,
+                                      vertices[indices[i + 2]].Position, bary, distance) &&
+            distance >= 0.0f && distance < hit.distance)
+        {
+            hit.distance = distance;
+            hit.faceIndex = i / 3;
+            hit.barycentric = bary;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+int main(int argc, char* argv[])
+{
+    GLuint gridSize = (argc > 1) ? std::atoi(argv[1]) : 300;
+    GLuint rayCount = (argc > 2) ? std::atoi(argv[2]) : 1000;
+
+    std::vector<Vertex> vertices;
+    std::vector<VertexIndex> indices;
+    BuildTerrain(gridSize, vertices, indices);
+
+    // built the way SubMesh builds it
+    const GLubyte* positions = reinterpret_cast<const GLubyte*>(&vertices[0].Position);
+    std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+    TriangleBVH bvh;
+    bvh.Build(positions, sizeof(Vertex), indices.data(), indices.size() / 3);
+    std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - buildStart;
+
+    // the same rays for both, slightly tilted down onto the terrain
+    std::vector<glm::vec3> rayOrigins(rayCount);
+    std::vector<glm::vec3> rayDirs(rayCount);
+    srand(1);
+    for (GLuint i = 0; i < rayCount; i++)
+    {
+        rayOrigins[i] = glm::vec3(rand() % gridSize, 20.0f, rand() % gridSize);
+        rayDirs[i] = glm::normalize(glm::vec3((rand() % 200 - 100) / 400.0f, -1.0f, (rand() % 200 - 100) / 400.0f));
+    }
+
+    std::vector<RayHit> bvhHits(rayCount);
+    std::chrono::steady_clock::time_point bvhStart = std::chrono::steady_clock::now();
+    for (GLuint i = 0; i < rayCount; i++)
+        bvh.Intersect(rayOrigins[i], rayDirs[i], positions, sizeof(Vertex), indices.data(), bvhHits[i]);
+    std::chrono::duration<double, std::milli> bvhTime = std::chrono::steady_clock::now() - bvhStart;
+
+    std::vector<RayHit> linearHits(rayCount);
+    std::chrono::steady_clock::time_point linearStart = std::chrono::steady_clock::now();
+    for (GLuint i = 0; i < rayCount; i++)
+        IntersectLinear(vertices, indices, rayOrigins[i], rayDirs[i], linearHits[i]);
+    std::chrono::duration<double, std::milli> linearTime = std::chrono::steady_clock::now() - linearStart;
+
+    GLuint mismatches = 0;
+    for (GLuint i = 0; i < rayCount; i++)
+    {
+        // a ray through a shared edge can hit either triangle at the same distance
+        float difference = std::abs(bvhHits[i].distance - linearHits[i].distance);
+        if (bvhHits[i].faceIndex != linearHits[i].faceIndex && difference > 1e-4f * linearHits[i].distance)
+            mismatches++;
+    }
+
+    std::cout << indices.size() / 3 << " triangles, " << rayCount << " rays\n";
+    std::cout << "bvh build:   " << buildTime.count() << " ms\n";
+    std::cout << "bvh picking: " << bvhTime.count() * 1000.0 / rayCount << " us per ray\n";
+    std::cout << "linear scan: " << linearTime.count() * 1000.0 / rayCount << " us per ray\n";
+    std::cout << "speedup:     " << linearTime.count() / bvhTime.count() << "x\n";
+
+    if (mismatches > 0)
+    {
+        std::cout << "FAILED: " << mismatches << " rays found a different nearest triangle\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
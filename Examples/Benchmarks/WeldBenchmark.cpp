@@ -0,0 +1,160 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Times welding the corners of an OBJ group through the Group weld table
+// against searching every vertex added before, the way Group::addVertex
+// worked before. The search is quadratic, so it only runs up to a smaller
+// corner count and its time for the full count is extrapolated from there.
+// Both weld to the same vertices, which is checked too
+//
+// usage: WeldBenchmark [vertex count] [max corners for the linear search]
+
+#include "AssetLoading/ObjLoader.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+// Name : BuildCorners ()
+// Desc : a grid with about vertexCount vertices drawn as triangles, every
+//        vertex is used by up to six corners like in a typical mesh. The
+//        corners are indices into gridVertices in the order the file has them
+//-----------------------------------------------------------------------------
+static void BuildCorners(GLuint vertexCount, std::vector<Vertex>& gridVertices, std::vector<GLuint>& corners)
+{
+    GLuint size = std::max<GLuint>(2, GLuint(std::ceil(std::sqrt(double(vertexCount)))));
+
+    gridVertices.reserve(size * size);
+    for (GLuint z = 0; z < size; z++)
+    {
+        for (GLuint x = 0; x < size; x++)
+            gridVertices.emplace_back(glm::vec3(x * 0.1f, 0.0f, z * 0.1f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(x, z) / float(size));
+    }
+
+    corners.reserve((size - 1) * (size - 1) * 6);
+    for (GLuint z = 0; z + 1 < size; z++)
+    {
+        for (GLuint x = 0; x + 1 < size; x++)
+        {
+            GLuint corner = z * size + x;
+            corners.insert(corners.end(), {corner, corner + size, corner + 1, corner + 1, corner + size, corner + size + 1});
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddVertexLinear ()
+// Desc : the weld before the weld table, searches every vertex added before
+//-----------------------------------------------------------------------------
+static VertexIndex AddVertexLinear(std::vector<Vertex>& vertices, const Vertex& vertex)
+{
+    for (VertexIndex i = 0; i < vertices.size(); i++)
+    {
+        if (vertices[i].Position == vertex.Position && vertices[i].Normal == vertex.Normal &&
+            vertices[i].TexCoords == vertex.TexCoords)
+            return i;
+    }
+
+    vertices.push_back(vertex);
+    return vertices.size() - 1;
+}
+
+//-----------------------------------------------------------------------------
+// Name : WeldHashed ()
+// Desc : returns the time in ms
+//-----------------------------------------------------------------------------
+static double WeldHashed(const std::vector<Vertex>& gridVertices, const std::vector<GLuint>& corners, GLuint count, Group& group)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (GLuint i = 0; i < count; i++)
+    {
+        const Vertex& corner = gridVertices[corners[i]];
+        group.indices.push_back(group.addVertex(corner.Position, corner.Normal, corner.TexCoords));
+    }
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//-----------------------------------------------------------------------------
+// Name : WeldLinear ()
+// Desc : returns the time in ms
+//-----------------------------------------------------------------------------
+static double WeldLinear(const std::vector<Vertex>& gridVertices, const std::vector<GLuint>& corners, GLuint count,
+                         std::vector<Vertex>& vertices, std::vector<VertexIndex>& indices)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (GLuint i = 0; i < count; i++)
+        indices.push_back(AddVertexLinear(vertices, gridVertices[corners[i]]));
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    GLuint vertexCount = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+    GLuint maxLinearCount = (argc > 2) ? std::atoi(argv[2]) : 60000;
+
+    std::vector<Vertex> gridVertices;
+    std::vector<GLuint> corners;
+    BuildCorners(vertexCount, gridVertices, corners);
+    GLuint cornerCount = corners.size();
+
+    std::string name = "benchmark";
+    bool passed = true;
+    double linearTime = 0.0;
+    GLuint linearCount = 0;
+
+    // the same prefix of the corners through both, doubling the count shows
+    // the linear search taking four times as long
+    for (GLuint count = std::min(maxLinearCount, cornerCount) / 4; count > 0; count *= 2)
+    {
+        count = std::min(count, std::min(maxLinearCount, cornerCount));
+
+        Group group(name, 0.0f);
+        double hashedTime = WeldHashed(gridVertices, corners, count, group);
+
+        std::vector<Vertex> vertices;
+        std::vector<VertexIndex> indices;
+        linearTime = WeldLinear(gridVertices, corners, count, vertices, indices);
+        linearCount = count;
+
+        std::cout << count << " corners, " << vertices.size() << " vertices: hashed " << hashedTime << " ms, linear "
+                  << linearTime << " ms\n";
+
+        if (indices != group.indices || vertices.size() != group.vertices.size())
+        {
+            std::cout << "FAILED: the weld table welded different vertices than the linear search\n";
+            passed = false;
+        }
+
+        if (count == std::min(maxLinearCount, cornerCount))
+            break;
+    }
+
+    Group group(name, 0.0f);
+    double hashedTime = WeldHashed(gridVertices, corners, cornerCount, group);
+
+    double scale = double(cornerCount) / std::max<GLuint>(1, linearCount);
+    std::cout << cornerCount << " corners, " << group.vertices.size() << " vertices: hashed " << hashedTime
+              << " ms, linear about " << linearTime * scale * scale / 1000.0 << " s (extrapolated)\n";
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -84,6 +84,8 @@ public:
 
     virtual bool platformInit(int width, int height) = 0;
     virtual void glSwapBuffers() = 0;
+    // binds the GL context to the calling thread, or releases it from it
+    virtual void makeContextCurrent(bool current) = 0;
     
     void reshape(int width, int height);
     
@@ -409,6 +409,17 @@ void LinuxWaylandWindow::glSwapBuffers()
     eglSwapBuffers(m_eglDpy, m_egl_surface);
 }
 
+//-----------------------------------------------------------------------------
+// Name : makeContextCurrent ()
+//-----------------------------------------------------------------------------
+void LinuxWaylandWindow::makeContextCurrent(bool current)
+{
+    if (current)
+        eglMakeCurrent(m_eglDpy, m_egl_surface, m_egl_surface, m_eglCtx);
+    else
+        eglMakeCurrent(m_eglDpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
 //-----------------------------------------------------------------------------
 // Name : setFullScreenMode ()
 //-----------------------------------------------------------------------------
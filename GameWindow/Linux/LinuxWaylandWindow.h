@@ -169,6 +169,7 @@ private:
     bool createOpenGLContext();
     
     void glSwapBuffers();
+    void makeContextCurrent(bool current);
     void getMonitorsInfo();
     
     static const wl_registry_listener registry_listener;
@@ -99,6 +99,8 @@ bool LinuxX11Window::initDisplay()
 {
     std::cout << "initDisplay started\n";
     
+    // the render thread makes the context current and swaps buffers from its own thread
+    XInitThreads();
     m_display = XOpenDisplay(nullptr);
     
     if (!m_display)
@@ -409,7 +411,7 @@ bool LinuxX11Window::createOpenGLContext(GLXFBConfig bestFbc)
     glXCreateContextAttribsARBProc glXCreateContextAttribsARB = 0;
     glXCreateContextAttribsARB = (glXCreateContextAttribsARBProc)glXGetProcAddressARB( (const GLubyte *) "glXCreateContextAttribsARB" );
     
-    GLXContext ctx = 0;
+    ctx = 0;
 
     // Install an X error handler so the application won't exit if GL 3.0
     // context allocation fails.
@@ -509,6 +511,17 @@ void LinuxX11Window::glSwapBuffers()
     glXSwapBuffers(m_display, m_win);
 }
 
+//-----------------------------------------------------------------------------
+// Name : makeContextCurrent ()
+//-----------------------------------------------------------------------------
+void LinuxX11Window::makeContextCurrent(bool current)
+{
+    if (current)
+        glXMakeCurrent( m_display, m_win, ctx );
+    else
+        glXMakeCurrent( m_display, None, nullptr );
+}
+
 //-----------------------------------------------------------------------------
 // Name : setFullScreenMode ()
 //-----------------------------------------------------------------------------
@@ -122,6 +122,7 @@ private:
     bool createOpenGLContext(GLXFBConfig bestFbc);
     
     void glSwapBuffers();
+    void makeContextCurrent(bool current);
     void getMonitorsInfo();
     
     Display * m_display;
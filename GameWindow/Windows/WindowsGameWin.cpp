@@ -510,6 +510,17 @@ void WindowsGameWin::glSwapBuffers()
     SwapBuffers(m_hDC);
 }
 
+//-----------------------------------------------------------------------------
+// Name : makeContextCurrent ()
+//-----------------------------------------------------------------------------
+void WindowsGameWin::makeContextCurrent(bool current)
+{
+    if (current)
+        wglMakeCurrent(m_hDC, m_hRC);
+    else
+        wglMakeCurrent(NULL, NULL);
+}
+
 //-----------------------------------------------------------------------------
 // Name : setFullScreenMode ()
 //-----------------------------------------------------------------------------
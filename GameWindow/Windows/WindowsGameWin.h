@@ -121,6 +121,7 @@ private:
     bool createOpenGLContext();
     
     virtual void glSwapBuffers();
+    virtual void makeContextCurrent(bool current);
     virtual void getMonitorsInfo();
     
     HINSTANCE m_hInstance;
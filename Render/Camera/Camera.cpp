@@ -134,10 +134,7 @@ void Camera::SetViewPort(long left, long top, long width, long height,
 
     m_bProjDirty = true;
     m_bFrustumDirty = true;
-
-    //TODO: might make this line optional
-    glViewport(left,top, width, height);
-
+    // the GL viewport is set by whoever submits the frame, that might not be this thread
 }
 
 
@@ -234,7 +231,7 @@ bool Camera::BoundsInFrustum(const glm::vec3 &min, const glm::vec3& max)
         {
             if (normal.y > 0.0f)
             {
-                if (normal.y > 0.0f)
+                if (normal.z > 0.0f)
                 {
                     nearPoint.x = min.x;
                     nearPoint.y = min.y;
@@ -313,6 +310,26 @@ bool Camera::BoundsInFrustum(const glm::vec3 &min, const glm::vec3& max)
     return true;
 }
 
+//-----------------------------------------------------------------------------
+// Name : SphereInFrustum
+// Desc : Determine whether or not the sphere passed is within the frustum.
+//-----------------------------------------------------------------------------
+bool Camera::SphereInFrustum(const glm::vec3& center, float radius)
+{
+    CalcFrustumPlanes();
+
+    for (GLuint i = 0; i < 6; i++)
+    {
+        glm::vec3 normal = glm::vec3(m_Frustum[i].a, m_Frustum[i].b, m_Frustum[i].c);
+
+        // the planes normals point out of the frustum
+        if (glm::dot(normal, center) + m_Frustum[i].d > radius)
+            return false;
+    }
+
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 // Name : CalcFrustumPlanes
 // Desc : Calculate the 6 frustum planes based on the current values.
@@ -321,7 +338,7 @@ void Camera::CalcFrustumPlanes()
 {
     if (!m_bFrustumDirty) return;
 
-    glm::mat4x4 viewProj = GetViewMatrix() * GetProjMatrix();
+    glm::mat4x4 viewProj = GetProjMatrix() * GetViewMatrix();
 
     // Left clipping plane
     m_Frustum[0].a = -(viewProj[0][3] + viewProj[0][0]);
@@ -347,17 +364,17 @@ void Camera::CalcFrustumPlanes()
     m_Frustum[3].c = -(viewProj[2][3] + viewProj[2][1]);
     m_Frustum[3].d = -(viewProj[3][3] + viewProj[3][1]);
 
-    // Near clipping plane
-    m_Frustum[4].a = -(viewProj[0][2]);
-    m_Frustum[4].a = -(viewProj[1][2]);
-    m_Frustum[4].a = -(viewProj[2][2]);
-    m_Frustum[4].a = -(viewProj[3][2]);
+    // Near clipping plane (opengl clip space z is in [-w, w])
+    m_Frustum[4].a = -(viewProj[0][3] + viewProj[0][2]);
+    m_Frustum[4].b = -(viewProj[1][3] + viewProj[1][2]);
+    m_Frustum[4].c = -(viewProj[2][3] + viewProj[2][2]);
+    m_Frustum[4].d = -(viewProj[3][3] + viewProj[3][2]);
 
     // Far clipping plane
     m_Frustum[5].a = -(viewProj[0][3] - viewProj[0][2]);
-    m_Frustum[5].a = -(viewProj[1][3] - viewProj[1][2]);
-    m_Frustum[5].a = -(viewProj[2][3] - viewProj[2][2]);
-    m_Frustum[5].a = -(viewProj[3][3] - viewProj[3][2]);
+    m_Frustum[5].b = -(viewProj[1][3] - viewProj[1][2]);
+    m_Frustum[5].c = -(viewProj[2][3] - viewProj[2][2]);
+    m_Frustum[5].d = -(viewProj[3][3] - viewProj[3][2]);
 
     for (GLuint i = 0; i < 6; i++)
     {
@@ -87,7 +87,7 @@ public:
     //-----------------------------------------------------------------------------
     // Public Functions
     //-----------------------------------------------------------------------------
-    void SetFOV     (float FOV) {m_fFOV = FOV; m_bProjDirty = true;}
+    void SetFOV     (float FOV) {m_fFOV = FOV; m_bProjDirty = true; m_bFrustumDirty = true;}
     void SetViewPort(long left, long top, long width, long height,
                      float nearClip, float farclip);
     void SetLookAt  (const glm::vec3& vecLookat);
@@ -120,6 +120,7 @@ public:
     virtual CAMERA_MODE GetCameraMode() const = 0;
 
     bool BoundsInFrustum( const glm::vec3& min, const glm::vec3& max);
+    bool SphereInFrustum( const glm::vec3& center, float radius);
 
 protected:
     //-----------------------------------------------------------------------------
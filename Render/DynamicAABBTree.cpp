@@ -0,0 +1,459 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "DynamicAABBTree.h"
+#include <cassert>
+
+//-----------------------------------------------------------------------------
+// Name : DynamicAABBTree (constructor)
+//-----------------------------------------------------------------------------
+DynamicAABBTree::DynamicAABBTree()
+{
+    m_root = NULL_NODE;
+    m_freeList = NULL_NODE;
+    m_proxyCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetFatBox ()
+// Desc : the box stored in the leaves, enlarged by a tenth of its size
+//-----------------------------------------------------------------------------
+AABB DynamicAABBTree::GetFatBox(const AABB& box)
+{
+    glm::vec3 margin = (box.max - box.min) * 0.1f + glm::vec3(0.1f);
+    return AABB(box.min - margin, box.max + margin);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Contains ()
+//-----------------------------------------------------------------------------
+bool DynamicAABBTree::Contains(const AABB& outer, const AABB& inner)
+{
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+           outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AllocateNode ()
+//-----------------------------------------------------------------------------
+int DynamicAABBTree::AllocateNode()
+{
+    if (m_freeList == NULL_NODE)
+    {
+        // grow the pool and chain all the new nodes to the free list
+        int oldSize = m_nodes.size();
+        int newSize = std::max(16, oldSize * 2);
+        m_nodes.resize(newSize);
+        for (int i = oldSize; i < newSize; i++)
+        {
+            m_nodes[i].next = i + 1;
+            m_nodes[i].height = -1;
+        }
+
+        m_nodes[newSize - 1].next = NULL_NODE;
+        m_freeList = oldSize;
+    }
+
+    int nodeId = m_freeList;
+    AABBTreeNode& node = m_nodes[nodeId];
+    m_freeList = node.next;
+
+    node.parent = NULL_NODE;
+    node.child1 = NULL_NODE;
+    node.child2 = NULL_NODE;
+    node.height = 0;
+    node.userData = 0;
+
+    return nodeId;
+}
+
+//-----------------------------------------------------------------------------
+// Name : FreeNode ()
+//-----------------------------------------------------------------------------
+void DynamicAABBTree::FreeNode(int nodeId)
+{
+    m_nodes[nodeId].next = m_freeList;
+    m_nodes[nodeId].height = -1;
+    m_freeList = nodeId;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CreateProxy ()
+// Desc : adds a box to the tree, the returned id is used to move or remove it
+//-----------------------------------------------------------------------------
+int DynamicAABBTree::CreateProxy(const AABB& box, GLuint userData)
+{
+    int proxyId = AllocateNode();
+    m_nodes[proxyId].box = GetFatBox(box);
+    m_nodes[proxyId].userData = userData;
+
+    InsertLeaf(proxyId);
+    m_proxyCount++;
+
+    return proxyId;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DestroyProxy ()
+//-----------------------------------------------------------------------------
+void DynamicAABBTree::DestroyProxy(int proxyId)
+{
+    assert(m_nodes[proxyId].IsLeaf());
+
+    RemoveLeaf(proxyId);
+    FreeNode(proxyId);
+    m_proxyCount--;
+}
+
+//-----------------------------------------------------------------------------
+// Name : MoveProxy ()
+// Desc : updates the proxy box, returns true if the proxy was reinserted
+//-----------------------------------------------------------------------------
+bool DynamicAABBTree::MoveProxy(int proxyId, const AABB& box)
+{
+    assert(m_nodes[proxyId].IsLeaf());
+
+    // still inside the enlarged box, the tree is still valid
+    if (Contains(m_nodes[proxyId].box, box))
+        return false;
+
+    RemoveLeaf(proxyId);
+    m_nodes[proxyId].box = GetFatBox(box);
+    InsertLeaf(proxyId);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Clear ()
+//-----------------------------------------------------------------------------
+void DynamicAABBTree::Clear()
+{
+    m_nodes.clear();
+    m_root = NULL_NODE;
+    m_freeList = NULL_NODE;
+    m_proxyCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : InsertLeaf ()
+// Desc : walks down to the sibling that grows the tree surface area the
+//        least and puts the leaf next to it under a new parent
+//-----------------------------------------------------------------------------
+void DynamicAABBTree::InsertLeaf(int leaf)
+{
+    if (m_root == NULL_NODE)
+    {
+        m_root = leaf;
+        m_nodes[m_root].parent = NULL_NODE;
+        return;
+    }
+
+    AABB leafBox = m_nodes[leaf].box;
+    int index = m_root;
+    while (!m_nodes[index].IsLeaf())
+    {
+        const AABBTreeNode& node = m_nodes[index];
+        int child1 = node.child1;
+        int child2 = node.child2;
+
+        float area = node.box.GetSurfaceArea();
+
+        AABB combined = node.box;
+        combined.AddAABB(leafBox);
+        float combinedArea = combined.GetSurfaceArea();
+
+        // cost of creating a new parent for this node and the new leaf
+        float cost = 2.0f * combinedArea;
+
+        // minimum cost of pushing the leaf further down the tree
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float childCost[2];
+        int children[2] = {child1, child2};
+        for (int i = 0; i < 2; i++)
+        {
+            AABB childBox = m_nodes[children[i]].box;
+            childBox.AddAABB(leafBox);
+
+            if (m_nodes[children[i]].IsLeaf())
+                childCost[i] = childBox.GetSurfaceArea() + inheritanceCost;
+            else
+                childCost[i] = childBox.GetSurfaceArea() - m_nodes[children[i]].box.GetSurfaceArea() + inheritanceCost;
+        }
+
+        if (cost < childCost[0] && cost < childCost[1])
+            break;
+
+        index = childCost[0] < childCost[1] ? child1 : child2;
+    }
+
+    int sibling = index;
+
+    // create a new parent for the sibling and the leaf
+    int oldParent = m_nodes[sibling].parent;
+    int newParent = AllocateNode();
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].box = leafBox;
+    m_nodes[newParent].box.AddAABB(m_nodes[sibling].box);
+    m_nodes[newParent].height = m_nodes[sibling].height + 1;
+    m_nodes[newParent].child1 = sibling;
+    m_nodes[newParent].child2 = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if (oldParent != NULL_NODE)
+    {
+        if (m_nodes[oldParent].child1 == sibling)
+            m_nodes[oldParent].child1 = newParent;
+        else
+            m_nodes[oldParent].child2 = newParent;
+    }
+    else
+        m_root = newParent;
+
+    // walk back up fixing heights and boxes
+    index = m_nodes[leaf].parent;
+    while (index != NULL_NODE)
+    {
+        index = Balance(index);
+
+        int child1 = m_nodes[index].child1;
+        int child2 = m_nodes[index].child2;
+
+        m_nodes[index].height = 1 + std::max(m_nodes[child1].height, m_nodes[child2].height);
+        m_nodes[index].box = m_nodes[child1].box;
+        m_nodes[index].box.AddAABB(m_nodes[child2].box);
+
+        index = m_nodes[index].parent;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : RemoveLeaf ()
+// Desc : removes the leaf and its parent, the sibling takes the parent place
+//-----------------------------------------------------------------------------
+void DynamicAABBTree::RemoveLeaf(int leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    int parent = m_nodes[leaf].parent;
+    int grandParent = m_nodes[parent].parent;
+    int sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    if (grandParent != NULL_NODE)
+    {
+        if (m_nodes[grandParent].child1 == parent)
+            m_nodes[grandParent].child1 = sibling;
+        else
+            m_nodes[grandParent].child2 = sibling;
+
+        m_nodes[sibling].parent = grandParent;
+        FreeNode(parent);
+
+        int index = grandParent;
+        while (index != NULL_NODE)
+        {
+            index = Balance(index);
+
+            int child1 = m_nodes[index].child1;
+            int child2 = m_nodes[index].child2;
+
+            m_nodes[index].box = m_nodes[child1].box;
+            m_nodes[index].box.AddAABB(m_nodes[child2].box);
+            m_nodes[index].height = 1 + std::max(m_nodes[child1].height, m_nodes[child2].height);
+
+            index = m_nodes[index].parent;
+        }
+    }
+    else
+    {
+        m_root = sibling;
+        m_nodes[sibling].parent = NULL_NODE;
+        FreeNode(parent);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : Balance ()
+// Desc : rotates the higher grandchild up when the node children heights
+//        differ by more than one, returns the node that took nodeId place
+//-----------------------------------------------------------------------------
+int DynamicAABBTree::Balance(int iA)
+{
+    AABBTreeNode* A = &m_nodes[iA];
+    if (A->IsLeaf() || A->height < 2)
+        return iA;
+
+    int iB = A->child1;
+    int iC = A->child2;
+    AABBTreeNode* B = &m_nodes[iB];
+    AABBTreeNode* C = &m_nodes[iC];
+
+    int balance = C->height - B->height;
+
+    // rotate C up
+    if (balance > 1)
+    {
+        int iF = C->child1;
+        int iG = C->child2;
+        AABBTreeNode* F = &m_nodes[iF];
+        AABBTreeNode* G = &m_nodes[iG];
+
+        // swap A and C
+        C->child1 = iA;
+        C->parent = A->parent;
+        A->parent = iC;
+
+        if (C->parent != NULL_NODE)
+        {
+            if (m_nodes[C->parent].child1 == iA)
+                m_nodes[C->parent].child1 = iC;
+            else
+                m_nodes[C->parent].child2 = iC;
+        }
+        else
+            m_root = iC;
+
+        // keep the higher of F and G under C
+        if (F->height > G->height)
+        {
+            C->child2 = iF;
+            A->child2 = iG;
+            G->parent = iA;
+            A->box = B->box;
+            A->box.AddAABB(G->box);
+            C->box = A->box;
+            C->box.AddAABB(F->box);
+
+            A->height = 1 + std::max(B->height, G->height);
+            C->height = 1 + std::max(A->height, F->height);
+        }
+        else
+        {
+            C->child2 = iG;
+            A->child2 = iF;
+            F->parent = iA;
+            A->box = B->box;
+            A->box.AddAABB(F->box);
+            C->box = A->box;
+            C->box.AddAABB(G->box);
+
+            A->height = 1 + std::max(B->height, F->height);
+            C->height = 1 + std::max(A->height, G->height);
+        }
+
+        return iC;
+    }
+
+    // rotate B up
+    if (balance < -1)
+    {
+        int iD = B->child1;
+        int iE = B->child2;
+        AABBTreeNode* D = &m_nodes[iD];
+        AABBTreeNode* E = &m_nodes[iE];
+
+        // swap A and B
+        B->child1 = iA;
+        B->parent = A->parent;
+        A->parent = iB;
+
+        if (B->parent != NULL_NODE)
+        {
+            if (m_nodes[B->parent].child1 == iA)
+                m_nodes[B->parent].child1 = iB;
+            else
+                m_nodes[B->parent].child2 = iB;
+        }
+        else
+            m_root = iB;
+
+        // keep the higher of D and E under B
+        if (D->height > E->height)
+        {
+            B->child2 = iD;
+            A->child1 = iE;
+            E->parent = iA;
+            A->box = C->box;
+            A->box.AddAABB(E->box);
+            B->box = A->box;
+            B->box.AddAABB(D->box);
+
+            A->height = 1 + std::max(C->height, E->height);
+            B->height = 1 + std::max(A->height, D->height);
+        }
+        else
+        {
+            B->child2 = iE;
+            A->child1 = iD;
+            D->parent = iA;
+            A->box = C->box;
+            A->box.AddAABB(D->box);
+            B->box = A->box;
+            B->box.AddAABB(E->box);
+
+            A->height = 1 + std::max(C->height, D->height);
+            B->height = 1 + std::max(A->height, E->height);
+        }
+
+        return iB;
+    }
+
+    return iA;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetUserData ()
+//-----------------------------------------------------------------------------
+GLuint DynamicAABBTree::GetUserData(int proxyId) const
+{
+    return m_nodes[proxyId].userData;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetFatAABB ()
+//-----------------------------------------------------------------------------
+const AABB& DynamicAABBTree::GetFatAABB(int proxyId) const
+{
+    return m_nodes[proxyId].box;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetHeight ()
+//-----------------------------------------------------------------------------
+int DynamicAABBTree::GetHeight() const
+{
+    if (m_root == NULL_NODE)
+        return 0;
+
+    return m_nodes[m_root].height;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetProxyCount ()
+//-----------------------------------------------------------------------------
+GLuint DynamicAABBTree::GetProxyCount() const
+{
+    return m_proxyCount;
+}
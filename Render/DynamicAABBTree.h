@@ -0,0 +1,199 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef  _DYNAMICAABBTREE_H
+#define  _DYNAMICAABBTREE_H
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "RenderTypes.h"
+
+struct AABBTreeNode
+{
+    bool IsLeaf() const
+    {
+        return child1 == -1;
+    }
+
+    // enlarged box for leaves so small moves don't change the tree
+    AABB box;
+    GLuint userData;
+
+    union
+    {
+        int parent;
+        int next;   // next free node when the node is not used
+    };
+
+    int child1;
+    int child2;
+
+    // leaf = 0, free node = -1
+    int height;
+};
+
+//-----------------------------------------------------------------------------
+// DynamicAABBTree - incrementally updated bounding volume tree over boxes.
+// Every box is stored in a leaf (proxy) with a margin around it, moving a
+// box only changes the tree when it leaves its enlarged box. The tree is
+// kept balanced with rotations so queries stay logarithmic.
+//-----------------------------------------------------------------------------
+class DynamicAABBTree
+{
+public:
+    static const int NULL_NODE = -1;
+
+    DynamicAABBTree();
+
+    int    CreateProxy  (const AABB& box, GLuint userData);
+    void   DestroyProxy (int proxyId);
+    bool   MoveProxy    (int proxyId, const AABB& box);
+    void   Clear        ();
+
+    GLuint      GetUserData(int proxyId) const;
+    const AABB& GetFatAABB (int proxyId) const;
+    int         GetHeight  () const;
+    GLuint      GetProxyCount() const;
+
+    //-----------------------------------------------------------------------------
+    // Name : Query ()
+    // Desc : calls callback(userData) for every leaf whose box passes
+    //        overlaps(box), subtrees whose box fails the test are skipped
+    //-----------------------------------------------------------------------------
+    template <typename OverlapTest, typename Callback>
+    void Query(OverlapTest overlaps, Callback callback) const
+    {
+        if (m_root == NULL_NODE)
+            return;
+
+        m_stack.clear();
+        m_stack.push_back(m_root);
+
+        while (!m_stack.empty())
+        {
+            int nodeId = m_stack.back();
+            m_stack.pop_back();
+
+            const AABBTreeNode& node = m_nodes[nodeId];
+            if (!overlaps(node.box))
+                continue;
+
+            if (node.IsLeaf())
+                callback(node.userData);
+            else
+            {
+                m_stack.push_back(node.child1);
+                m_stack.push_back(node.child2);
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    // Name : RayCast ()
+    // Desc : visits the leaves hit by the ray nearest box first, callback
+    //        (userData, maxDist) returns the new max distance so a closer hit
+    //        prunes the rest of the tree
+    //-----------------------------------------------------------------------------
+    template <typename Callback>
+    void RayCast(const glm::vec3& origin, const glm::vec3& dir, float maxDist, Callback callback) const
+    {
+        if (m_root == NULL_NODE)
+            return;
+
+        glm::vec3 invDir = 1.0f / dir;
+        float tNear;
+        if (!m_nodes[m_root].box.IntersectRay(origin, invDir, maxDist, tNear))
+            return;
+
+        m_rayStack.clear();
+        m_rayStack.push_back(RayEntry(m_root, tNear));
+
+        while (!m_rayStack.empty())
+        {
+            RayEntry entry = m_rayStack.back();
+            m_rayStack.pop_back();
+
+            if (entry.tNear > maxDist)
+                continue;
+
+            const AABBTreeNode& node = m_nodes[entry.nodeId];
+            if (node.IsLeaf())
+            {
+                maxDist = callback(node.userData, maxDist);
+                continue;
+            }
+
+            float t1, t2;
+            bool hit1 = m_nodes[node.child1].box.IntersectRay(origin, invDir, maxDist, t1);
+            bool hit2 = m_nodes[node.child2].box.IntersectRay(origin, invDir, maxDist, t2);
+
+            // push the farther child first so the nearer one is visited first
+            if (hit1 && hit2)
+            {
+                if (t1 < t2)
+                {
+                    m_rayStack.push_back(RayEntry(node.child2, t2));
+                    m_rayStack.push_back(RayEntry(node.child1, t1));
+                }
+                else
+                {
+                    m_rayStack.push_back(RayEntry(node.child1, t1));
+                    m_rayStack.push_back(RayEntry(node.child2, t2));
+                }
+            }
+            else if (hit1)
+                m_rayStack.push_back(RayEntry(node.child1, t1));
+            else if (hit2)
+                m_rayStack.push_back(RayEntry(node.child2, t2));
+        }
+    }
+
+private:
+    struct RayEntry
+    {
+        RayEntry(int _nodeId, float _tNear)
+            :nodeId(_nodeId), tNear(_tNear)
+        {}
+
+        int nodeId;
+        float tNear;
+    };
+
+    int  AllocateNode();
+    void FreeNode    (int nodeId);
+    void InsertLeaf  (int leaf);
+    void RemoveLeaf  (int leaf);
+    int  Balance     (int nodeId);
+
+    static AABB GetFatBox(const AABB& box);
+    static bool Contains (const AABB& outer, const AABB& inner);
+
+    std::vector<AABBTreeNode> m_nodes;
+    int    m_root;
+    int    m_freeList;
+    GLuint m_proxyCount;
+
+    // traversal stacks, kept to avoid allocating on every query
+    mutable std::vector<int> m_stack;
+    mutable std::vector<RayEntry> m_rayStack;
+};
+
+#endif  //_DYNAMICAABBTREE_H
@@ -19,6 +19,8 @@
 //
 
 #include "Font.h"
+#include "GLThread.h"
+#include <cassert>
 #ifndef _WIN32
     #include <fontconfig/fontconfig.h>
 #endif 
@@ -82,7 +84,8 @@ mkFont::mkFont(const mkFont& toCopy)
 // Name : mkFont (move constructor)
 //-----------------------------------------------------------------------------
 mkFont::mkFont(mkFont&& toMove)
-    :charGlyphs(std::move(toMove.charGlyphs)), charGlyphsAtlas(std::move(toMove.charGlyphsAtlas))
+    :charGlyphs(std::move(toMove.charGlyphs)), charGlyphsAtlas(std::move(toMove.charGlyphsAtlas)),
+     m_glyphBitmaps(std::move(toMove.m_glyphBitmaps)), m_atlasData(std::move(toMove.m_atlasData))
 {
     fontPath = toMove.fontPath;
     m_fontSize = toMove.m_fontSize;
@@ -121,7 +124,9 @@ mkFont::~mkFont()
     for (auto it = charGlyphs.begin(); it != charGlyphs.end(); it++)
     {
         CharGlyph& cg = it->second;
-        glDeleteTextures(1,&cg.TextureID);
+        // fonts that were only rasterized have no textures
+        if (cg.TextureID != 0)
+            glDeleteTextures(1,&cg.TextureID);
     }
 
     if (m_textureAtlas != 0)
@@ -132,6 +137,18 @@ mkFont::~mkFont()
 // Name : init
 //-----------------------------------------------------------------------------
 int mkFont::init(int fontSize, int hDpi, int vDpi)
+{
+    if (rasterize(fontSize, hDpi, vDpi) != 0)
+        return -1;
+
+    createTextures();
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : rasterize
+//-----------------------------------------------------------------------------
+int mkFont::rasterize(int fontSize, int hDpi, int vDpi)
 {
     this->m_fontSize = fontSize;
      FT_Library ft;
@@ -147,13 +164,12 @@ int mkFont::init(int fontSize, int hDpi, int vDpi)
      if (FT_New_Face(ft, fontPath.c_str(), 0, &face))
      {
          std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+         FT_Done_FreeType(ft);
          return -1;
      }
 
      // Set size to load glyphs as
      FT_Set_Char_Size(face, fontSize*64, fontSize*64, 96, 96);
-     // Disable byte-alignment restriction
-     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
      // cache glyphs for rednerText
      cacheGlyth(ft, face);
      // create the Font Atlas
@@ -163,6 +179,78 @@ int mkFont::init(int fontSize, int hDpi, int vDpi)
      FT_Done_Face(face);
      FT_Done_FreeType(ft);
 
+     return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : createTextures
+//-----------------------------------------------------------------------------
+void mkFont::createTextures()
+{
+    assert(GLThread::IsCurrent());
+     // Disable byte-alignment restriction
+     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+     for (auto it = charGlyphs.begin(); it != charGlyphs.end(); it++)
+     {
+         CharGlyph& charGlyph = it->second;
+         const std::vector<unsigned char>& bitmap = m_glyphBitmaps[it->first];
+
+         // Generate the glyph texture
+         glGenTextures(1, &charGlyph.TextureID);
+         glBindTexture(GL_TEXTURE_2D, charGlyph.TextureID);
+         glTexImage2D(
+             GL_TEXTURE_2D,
+             0,
+             GL_RED,
+             charGlyph.Size.x,
+             charGlyph.Size.y,
+             0,
+             GL_RED,
+             GL_UNSIGNED_BYTE,
+             bitmap.empty() ? nullptr : bitmap.data()
+         );
+
+         // Set texture options
+         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+     }
+
+     // Generate the atlas texture
+     glGenTextures(1, &m_textureAtlas);
+     glBindTexture(GL_TEXTURE_2D, m_textureAtlas);
+     glTexImage2D(
+         GL_TEXTURE_2D,
+         0,
+         GL_RED,
+         m_textureAtlasWidth,
+         m_textureAtlasHeight,
+         0,
+         GL_RED,
+         GL_UNSIGNED_BYTE,
+         m_atlasData.data()
+     );
+
+     // Set texture options
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+     // Clear the current texture
+     glBindTexture(GL_TEXTURE_2D, 0);
+     // the streamed textures expect the default alignment
+     glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+     m_glyphBitmaps.clear();
+     std::vector<unsigned char>().swap(m_atlasData);
+
      // Configure VAO/VBO for texture quads
      glGenVertexArrays(1, &VAO);
      glGenBuffers(1, &VBO);
@@ -183,8 +271,6 @@ int mkFont::init(int fontSize, int hDpi, int vDpi)
      indices[3] = 2;
      indices[4] = 3;
      indices[5] = 1;
-
-     return 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -446,21 +532,9 @@ void mkFont::cacheGlyth(FT_Library ft, FT_Face face)
             continue;
         }
 
-        // Generate the glyph texture
-        GLuint texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-        );
+        // keep the glyph pixels for its texture
+        const FT_Bitmap& bitmap = face->glyph->bitmap;
+        m_glyphBitmaps[c].assign(bitmap.buffer, bitmap.buffer + bitmap.width * bitmap.rows);
 
         sumWidth += face->glyph->bitmap.width;
         m_maxRows  = std::max(m_maxRows, face->glyph->bitmap.rows);
@@ -468,17 +542,9 @@ void mkFont::cacheGlyth(FT_Library ft, FT_Face face)
         //std::cout << (int)c << "! " << c << ": Width" <<face->glyph->bitmap.width << "\n";
         //std::cout << (int)c << "! " << c << ": Height" <<face->glyph->bitmap.rows << "\n";
 
-        // Set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
-
-        // Now store character for later use
+        // Now store character for later use, the texture is made by createTextures
         CharGlyph charGlyph = {
-            texture,
+            0,
             glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
             glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
             face->glyph->advance.x
@@ -487,9 +553,6 @@ void mkFont::cacheGlyth(FT_Library ft, FT_Face face)
         charGlyphs.insert(std::pair<GLchar, CharGlyph>(c, charGlyph));
     }
 
-    // Clear the current texture
-    glBindTexture(GL_TEXTURE_2D, 0);
-
     m_avgWidth = sumWidth / 128;
 }
 
@@ -533,10 +596,8 @@ void mkFont::createFontAtlas(FT_Library ft, FT_Face face)
     int textureWidth = std::pow(2, i);
     int textureHeight = std::pow(2, j);
 
-    unsigned char * textureData = new unsigned char[textureWidth * textureHeight];
-
-    for (GLuint i = 0; i < textureWidth*textureHeight; i++)
-        textureData[i] = 0;
+    m_atlasData.assign(textureWidth * textureHeight, 0);
+    unsigned char * textureData = m_atlasData.data();
 
     int copiedWidth = 0;
     int textureNum = 0;
@@ -589,34 +650,7 @@ void mkFont::createFontAtlas(FT_Library ft, FT_Face face)
         textureWidthOffset += face->glyph->bitmap.width;
     }
 
-    // Generate the glyph texture
-    GLuint textureName;
-    glGenTextures(1, &textureName);
-    glBindTexture(GL_TEXTURE_2D, textureName);
-    glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
-        GL_RED,
-        textureWidth,
-        textureHeight,
-        0,
-        GL_RED,
-        GL_UNSIGNED_BYTE,
-        textureData
-    );
-
-    // Set texture options
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
-
-    // Clear the current texture
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    m_textureAtlas = textureName;
+    // the texture is made by createTextures
 	m_textureAtlasWidth = textureWidth;
 	m_textureAtlasHeight = textureHeight;
 }
@@ -29,6 +29,7 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include <string>
+#include <vector>
 #include "RenderTypes.h"
 #include "Shader.h"
 #include "Sprite.h"
@@ -85,6 +86,10 @@ public:
     ~mkFont();
 
     int init(int m_fontSize, int hDpi, int vDpi);
+    // init split in two, rasterize only uses FreeType and can run on any
+    // thread, createTextures has to follow it on the GL thread
+    int  rasterize(int m_fontSize, int hDpi, int vDpi);
+    void createTextures();
 
     void renderText(Shader *shader, std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color);
 
@@ -109,6 +114,9 @@ private:
     std::string fontPath;
     std::unordered_map<GLchar, CharGlyph> charGlyphs;
     std::unordered_map<GLchar, CharGlyphAtlas> charGlyphsAtlas;
+    // the pixels made by rasterize until createTextures uploads them
+    std::unordered_map<GLchar, std::vector<unsigned char>> m_glyphBitmaps;
+    std::vector<unsigned char> m_atlasData;
     GLuint VAO;
     GLuint VBO;
     VertexIndex indices[6];
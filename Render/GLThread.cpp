@@ -0,0 +1,40 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "GLThread.h"
+
+std::atomic<std::thread::id> GLThread::s_threadId;
+
+//-----------------------------------------------------------------------------
+// Name : SetCurrent ()
+//-----------------------------------------------------------------------------
+void GLThread::SetCurrent()
+{
+    s_threadId.store(std::this_thread::get_id(), std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsCurrent ()
+//-----------------------------------------------------------------------------
+bool GLThread::IsCurrent()
+{
+    std::thread::id threadId = s_threadId.load(std::memory_order_acquire);
+    return threadId == std::thread::id() || threadId == std::this_thread::get_id();
+}
@@ -0,0 +1,45 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef  _GLTHREAD_H
+#define  _GLTHREAD_H
+
+#include <thread>
+#include <atomic>
+
+//-----------------------------------------------------------------------------
+// GLThread - remembers which thread the GL context is current on. Everything
+// that makes GL calls asserts it runs there, so GL work that leaks to another
+// thread fails at the call instead of silently doing nothing.
+//-----------------------------------------------------------------------------
+class GLThread
+{
+public:
+    // called by the thread that just made the context current
+    static void SetCurrent();
+    // true before any thread made the context current, tools without a
+    // window make their own context
+    static bool IsCurrent ();
+
+private:
+    static std::atomic<std::thread::id> s_threadId;
+};
+
+#endif  //_GLTHREAD_H
@@ -0,0 +1,541 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "GeometryArena.h"
+#include "GLThread.h"
+#include <cassert>
+
+//-----------------------------------------------------------------------------
+// Name : RangeAllocator (constructor)
+//-----------------------------------------------------------------------------
+RangeAllocator::RangeAllocator()
+{
+    m_capacity = 0;
+    m_used = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Grow ()
+// Desc : appends [capacity, newCapacity) to the free list
+//-----------------------------------------------------------------------------
+void RangeAllocator::Grow(GLuint newCapacity)
+{
+    if (newCapacity <= m_capacity)
+        return;
+
+    GLuint oldCapacity = m_capacity;
+    GLuint added = newCapacity - oldCapacity;
+    m_capacity = newCapacity;
+
+    // Free() expects the range to be counted as used
+    m_used += added;
+    Free(oldCapacity, added);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Allocate ()
+// Desc : returns the offset of count free elements starting at a multiple of
+//        alignment or INVALID_OFFSET
+//-----------------------------------------------------------------------------
+GLuint RangeAllocator::Allocate(GLuint count, GLuint alignment /*= 1*/)
+{
+    for (auto it = m_freeBlocks.begin(); it != m_freeBlocks.end(); ++it)
+    {
+        GLuint blockOffset = it->first;
+        GLuint blockSize = it->second;
+        GLuint offset = (blockOffset + alignment - 1) / alignment * alignment;
+        GLuint padding = offset - blockOffset;
+        if (blockSize < padding + count)
+            continue;
+
+        GLuint remaining = blockSize - padding - count;
+        m_freeBlocks.erase(it);
+        // the padding stays free for smaller alignments
+        if (padding > 0)
+            m_freeBlocks[blockOffset] = padding;
+        if (remaining > 0)
+            m_freeBlocks[offset + count] = remaining;
+
+        m_used += count;
+        return offset;
+    }
+
+    return INVALID_OFFSET;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Free ()
+//-----------------------------------------------------------------------------
+void RangeAllocator::Free(GLuint offset, GLuint count)
+{
+    if (count == 0)
+        return;
+
+    m_used -= count;
+    auto it = m_freeBlocks.emplace(offset, count).first;
+
+    // merge with the block after us
+    auto next = std::next(it);
+    if (next != m_freeBlocks.end() && it->first + it->second == next->first)
+    {
+        it->second += next->second;
+        m_freeBlocks.erase(next);
+    }
+
+    // merge with the block before us
+    if (it != m_freeBlocks.begin())
+    {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == it->first)
+        {
+            prev->second += it->second;
+            m_freeBlocks.erase(it);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetCapacity ()
+//-----------------------------------------------------------------------------
+GLuint RangeAllocator::GetCapacity() const
+{
+    return m_capacity;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetUsed ()
+//-----------------------------------------------------------------------------
+GLuint RangeAllocator::GetUsed() const
+{
+    return m_used;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Get ()
+// Desc : the arena every SubMesh allocates from
+//-----------------------------------------------------------------------------
+GeometryArena& GeometryArena::Get()
+{
+    static GeometryArena arena;
+    return arena;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GeometryArena (constructor)
+//-----------------------------------------------------------------------------
+GeometryArena::GeometryArena()
+{
+    for (VertexPool& pool : m_vertexPools)
+    {
+        pool.VAO = 0;
+        pool.VBO = 0;
+    }
+
+    m_EBO = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GeometryArena (destructor)
+// Desc : runs during static destruction without a context, the GL objects
+//        were deleted by Shutdown()
+//-----------------------------------------------------------------------------
+GeometryArena::~GeometryArena()
+{
+}
+
+//-----------------------------------------------------------------------------
+// Name : Shutdown ()
+// Desc : deletes the GL objects while the context is still current. The
+//        ranges are kept so meshes destroyed later can still free theirs
+//-----------------------------------------------------------------------------
+void GeometryArena::Shutdown()
+{
+    if (m_EBO != 0)
+        glDeleteBuffers(1, &m_EBO);
+
+    m_EBO = 0;
+
+    for (VertexPool& pool : m_vertexPools)
+    {
+        if (pool.VBO != 0)
+            glDeleteBuffers(1, &pool.VBO);
+
+        if (pool.VAO != 0)
+            glDeleteVertexArrays(1, &pool.VAO);
+
+        pool.VAO = 0;
+        pool.VBO = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : InitPool ()
+// Desc : the GL objects are created on the first allocation since the arena
+//        can be constructed before there is a context
+//-----------------------------------------------------------------------------
+void GeometryArena::InitPool(VertexFormat format)
+{
+    VertexPool& pool = m_vertexPools[format];
+    if (pool.VAO != 0)
+        return;
+
+    if (m_EBO == 0)
+    {
+        GrowBuffer(m_EBO, 0, INITIAL_INDEX_CAPACITY * sizeof(GLushort));
+        m_indexRanges.Grow(INITIAL_INDEX_CAPACITY);
+    }
+
+    glGenVertexArrays(1, &pool.VAO);
+    GrowBuffer(pool.VBO, 0, INITIAL_VERTEX_CAPACITY * VERTEX_FORMATS[format].stride);
+    pool.ranges.Grow(INITIAL_VERTEX_CAPACITY);
+
+    SetupVertexArray(format);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Allocate ()
+// Desc : copies the vertices and indices into free ranges of the arena,
+//        the buffers are grown if there is no range big enough
+//-----------------------------------------------------------------------------
+GeometryAllocation GeometryArena::Allocate(VertexFormat format, const void* vertices, GLuint vertexCount,
+                                           GLenum indexType, const void* indices, GLuint indexCount)
+{
+    assert(GLThread::IsCurrent());
+    GeometryAllocation allocation;
+    if (vertexCount == 0 || indexCount == 0)
+        return allocation;
+
+    allocation.format = format;
+    allocation.indexType = indexType;
+    allocation.baseVertex = AllocateVertexRange(format, vertexCount);
+    allocation.vertexCount = vertexCount;
+    allocation.firstIndex = AllocateIndices(indexType, indices, indexCount);
+    allocation.indexCount = indexCount;
+
+    // the copy targets are used so the bound VAO is left untouched
+    if (vertices)
+        UpdateVertices(allocation, vertices);
+
+    return allocation;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Free ()
+//-----------------------------------------------------------------------------
+void GeometryArena::Free(GeometryAllocation& allocation)
+{
+    if (allocation.IsEmpty())
+        return;
+
+    m_vertexPools[allocation.format].ranges.Free(allocation.baseVertex, allocation.vertexCount);
+    FreeIndices(allocation.indexType, allocation.firstIndex, allocation.indexCount);
+    allocation = GeometryAllocation();
+}
+
+//-----------------------------------------------------------------------------
+// Name : AllocateIndices ()
+// Desc : copies indices to a free range of the index buffer and returns the
+//        position of the first one in indices of indexType
+//-----------------------------------------------------------------------------
+GLuint GeometryArena::AllocateIndices(GLenum indexType, const void* indices, GLuint indexCount)
+{
+    assert(GLThread::IsCurrent());
+    GLuint firstIndex = AllocateIndexRange(indexType, indexCount);
+    GLuint indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+
+    if (indices)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_EBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(firstIndex) * indexSize, GLsizeiptr(indexCount) * indexSize, indices);
+    }
+
+    return firstIndex;
+}
+
+//-----------------------------------------------------------------------------
+// Name : FreeIndices ()
+//-----------------------------------------------------------------------------
+void GeometryArena::FreeIndices(GLenum indexType, GLuint firstIndex, GLuint indexCount)
+{
+    GLuint indexUnits = (indexType == GL_UNSIGNED_SHORT) ? 1 : 2;
+    m_indexRanges.Free(firstIndex * indexUnits, indexCount * indexUnits);
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateVertices ()
+// Desc : overwrites the vertices of an allocation, vertices must hold
+//        vertexCount vertices of the allocation format
+//-----------------------------------------------------------------------------
+void GeometryArena::UpdateVertices(const GeometryAllocation& allocation, const void* vertices)
+{
+    assert(GLThread::IsCurrent());
+    if (allocation.IsEmpty())
+        return;
+
+    GLsizei stride = VERTEX_FORMATS[allocation.format].stride;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexPools[allocation.format].VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(allocation.baseVertex) * stride, GLsizeiptr(allocation.vertexCount) * stride, vertices);
+}
+
+//-----------------------------------------------------------------------------
+// Name : StreamVertices ()
+// Desc : vertices must hold vertexCount vertices of the allocation format
+//-----------------------------------------------------------------------------
+void GeometryArena::StreamVertices(const GeometryAllocation& allocation, const UploadData& vertices,
+                                   const std::shared_ptr<UploadStatus>& upload)
+{
+    if (allocation.IsEmpty())
+        return;
+
+    GLsizei stride = VERTEX_FORMATS[allocation.format].stride;
+    StreamBuffer(m_vertexPools[allocation.format].VBO, GLintptr(allocation.baseVertex) * stride, vertices,
+                 GLsizeiptr(allocation.vertexCount) * stride, stride, upload);
+}
+
+//-----------------------------------------------------------------------------
+// Name : StreamIndices ()
+//-----------------------------------------------------------------------------
+void GeometryArena::StreamIndices(GLenum indexType, GLuint firstIndex, GLuint indexCount, const UploadData& indices,
+                                  const std::shared_ptr<UploadStatus>& upload)
+{
+    GLuint indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+    StreamBuffer(m_EBO, GLintptr(firstIndex) * indexSize, indices, GLsizeiptr(indexCount) * indexSize, indexSize, upload);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Duplicate ()
+// Desc : allocates new ranges holding the same vertices and indices as source
+//-----------------------------------------------------------------------------
+GeometryAllocation GeometryArena::Duplicate(const GeometryAllocation& source)
+{
+    assert(GLThread::IsCurrent());
+    if (source.IsEmpty())
+        return source;
+
+    GeometryAllocation copy = source;
+    copy.baseVertex = AllocateVertexRange(source.format, source.vertexCount);
+    copy.firstIndex = DuplicateIndices(source.indexType, source.firstIndex, source.indexCount);
+
+    // copying between two ranges of the same buffer is fine as long as they
+    // don't overlap
+    GLsizei stride = VERTEX_FORMATS[source.format].stride;
+    GLuint VBO = m_vertexPools[source.format].VBO;
+    glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(source.baseVertex) * stride,
+                        GLintptr(copy.baseVertex) * stride, GLsizeiptr(source.vertexCount) * stride);
+
+    return copy;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DuplicateIndices ()
+//-----------------------------------------------------------------------------
+GLuint GeometryArena::DuplicateIndices(GLenum indexType, GLuint firstIndex, GLuint indexCount)
+{
+    assert(GLThread::IsCurrent());
+    GLuint copyFirstIndex = AllocateIndexRange(indexType, indexCount);
+    GLuint indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, m_EBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_EBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(firstIndex) * indexSize,
+                        GLintptr(copyFirstIndex) * indexSize, GLsizeiptr(indexCount) * indexSize);
+
+    return copyFirstIndex;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Bind ()
+//-----------------------------------------------------------------------------
+void GeometryArena::Bind(VertexFormat format)
+{
+    assert(GLThread::IsCurrent());
+    glBindVertexArray(m_vertexPools[format].VAO);
+}
+
+//-----------------------------------------------------------------------------
+// Name : BindInstanceBuffer ()
+// Desc : points the instance attributes of the bound VAO at offset in
+//        instanceBuffer
+//-----------------------------------------------------------------------------
+void GeometryArena::BindInstanceBuffer(GLuint instanceBuffer, GLintptr offset)
+{
+    assert(GLThread::IsCurrent());
+    // every mat4 takes 4 attribute locations, one per column
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (GLuint i = 0; i < 8; i++)
+    {
+        GLuint location = INSTANCE_ATTRIB_LOCATION + i;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (GLvoid*)(offset + i * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetVertexBuffer ()
+//-----------------------------------------------------------------------------
+GLuint GeometryArena::GetVertexBuffer(VertexFormat format) const
+{
+    return m_vertexPools[format].VBO;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetIndexBuffer ()
+//-----------------------------------------------------------------------------
+GLuint GeometryArena::GetIndexBuffer() const
+{
+    return m_EBO;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetMemoryUsage ()
+//-----------------------------------------------------------------------------
+GLsizeiptr GeometryArena::GetMemoryUsage() const
+{
+    GLsizeiptr bytes = GLsizeiptr(m_indexRanges.GetCapacity()) * sizeof(GLushort);
+    for (GLuint i = 0; i < VERTEX_FORMAT_COUNT; i++)
+        bytes += GLsizeiptr(m_vertexPools[i].ranges.GetCapacity()) * VERTEX_FORMATS[i].stride;
+
+    return bytes;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AllocateVertexRange ()
+// Desc : returns the first vertex of a free range of the format pool, the
+//        pool is grown if there is no range big enough
+//-----------------------------------------------------------------------------
+GLuint GeometryArena::AllocateVertexRange(VertexFormat format, GLuint vertexCount)
+{
+    InitPool(format);
+
+    VertexPool& pool = m_vertexPools[format];
+    GLsizei stride = VERTEX_FORMATS[format].stride;
+
+    GLuint vertexOffset = pool.ranges.Allocate(vertexCount);
+    if (vertexOffset == RangeAllocator::INVALID_OFFSET)
+    {
+        // after growing the last free block is at least vertexCount long
+        GLuint capacity = pool.ranges.GetCapacity();
+        GLuint newCapacity = std::max(capacity * 2, capacity + vertexCount);
+        GrowBuffer(pool.VBO, GLsizeiptr(capacity) * stride, GLsizeiptr(newCapacity) * stride);
+        pool.ranges.Grow(newCapacity);
+        SetupVertexArray(format);
+
+        vertexOffset = pool.ranges.Allocate(vertexCount);
+    }
+
+    return vertexOffset;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AllocateIndexRange ()
+// Desc : returns the position of a free range of the index buffer in indices
+//        of indexType, the buffer is grown if there is no range big enough
+//-----------------------------------------------------------------------------
+GLuint GeometryArena::AllocateIndexRange(GLenum indexType, GLuint indexCount)
+{
+    // the index ranges are in 16 bit units
+    GLuint indexUnits = (indexType == GL_UNSIGNED_SHORT) ? 1 : 2;
+    GLuint unitCount = indexCount * indexUnits;
+
+    GLuint unitOffset = m_indexRanges.Allocate(unitCount, indexUnits);
+    if (unitOffset == RangeAllocator::INVALID_OFFSET)
+    {
+        // +1 for the alignment padding
+        GLuint capacity = m_indexRanges.GetCapacity();
+        GLuint newCapacity = std::max(capacity * 2, capacity + unitCount + 1);
+        GrowBuffer(m_EBO, GLsizeiptr(capacity) * sizeof(GLushort), GLsizeiptr(newCapacity) * sizeof(GLushort));
+        m_indexRanges.Grow(newCapacity);
+
+        // every VAO holds the index buffer binding
+        for (GLuint i = 0; i < VERTEX_FORMAT_COUNT; i++)
+        {
+            if (m_vertexPools[i].VAO != 0)
+                SetupVertexArray(static_cast<VertexFormat>(i));
+        }
+
+        unitOffset = m_indexRanges.Allocate(unitCount, indexUnits);
+    }
+
+    return unitOffset / indexUnits;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GrowBuffer ()
+// Desc : replaces buffer with a bigger one holding the same first oldSize bytes
+//-----------------------------------------------------------------------------
+void GeometryArena::GrowBuffer(GLuint& buffer, GLsizeiptr oldSize, GLsizeiptr newSize)
+{
+    GLuint newBuffer;
+    glGenBuffers(1, &newBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+
+    if (buffer != 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+        glDeleteBuffers(1, &buffer);
+    }
+
+    buffer = newBuffer;
+}
+
+//-----------------------------------------------------------------------------
+// Name : StreamBuffer ()
+// Desc : the buffer is only read when the copy runs since it is replaced
+//        whenever the arena grows, chunks are whole elements
+//-----------------------------------------------------------------------------
+void GeometryArena::StreamBuffer(const GLuint& buffer, GLintptr offset, const UploadData& data, GLsizeiptr size,
+                                 GLsizeiptr elementSize, const std::shared_ptr<UploadStatus>& upload)
+{
+    const GLuint* bufferPtr = &buffer;
+    UploadManager::Get().Enqueue(data, size, elementSize, [bufferPtr, offset](GLintptr stagingOffset, GLsizeiptr dataOffset, GLsizeiptr chunkSize)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, *bufferPtr);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stagingOffset, offset + dataOffset, chunkSize);
+    }, upload);
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetupVertexArray ()
+// Desc : points the format VAO at the current buffers using the format
+//        attribute table, called again after they grow
+//-----------------------------------------------------------------------------
+void GeometryArena::SetupVertexArray(VertexFormat format)
+{
+    const VertexFormatDesc& desc = VERTEX_FORMATS[format];
+    VertexPool& pool = m_vertexPools[format];
+
+    glBindVertexArray(pool.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+
+    for (GLuint i = 0; i < desc.attributeCount; i++)
+    {
+        const VertexAttributeDesc& attribute = desc.attributes[i];
+        glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized,
+                              desc.stride, (GLvoid*)(GLintptr)attribute.offset);
+        glEnableVertexAttribArray(attribute.location);
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,159 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef  _GEOMETRYARENA_H
+#define  _GEOMETRYARENA_H
+
+#include <map>
+#include <GL/glew.h>
+#include "RenderTypes.h"
+#include "VertexFormat.h"
+#include "UploadManager.h"
+
+//-----------------------------------------------------------------------------
+// RangeAllocator - first fit free list over [0, capacity) elements, adjacent
+// free blocks are merged back together when a range is freed
+//-----------------------------------------------------------------------------
+class RangeAllocator
+{
+public:
+    static const GLuint INVALID_OFFSET = 0xFFFFFFFF;
+
+    RangeAllocator();
+
+    void   Grow       (GLuint newCapacity);
+    GLuint Allocate   (GLuint count, GLuint alignment = 1);
+    void   Free       (GLuint offset, GLuint count);
+
+    GLuint GetCapacity() const;
+    GLuint GetUsed    () const;
+
+private:
+    // offset -> size of every free block
+    std::map<GLuint, GLuint> m_freeBlocks;
+    GLuint m_capacity;
+    GLuint m_used;
+};
+
+// where a SubMesh lives inside the arena buffers, baseVertex is in vertices
+// of format and firstIndex in indices of indexType
+struct GeometryAllocation
+{
+    VertexFormat format;
+    GLenum       indexType;
+    GLint        baseVertex;
+    GLuint       vertexCount;
+    GLuint       firstIndex;
+    GLuint       indexCount;
+
+    GeometryAllocation()
+        :format(VERTEX_FORMAT_FLOAT), indexType(GL_UNSIGNED_INT),
+         baseVertex(0), vertexCount(0), firstIndex(0), indexCount(0)
+    {}
+
+    bool IsEmpty() const { return vertexCount == 0; }
+
+    GLuint GetIndexSize() const
+    {
+        return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    }
+
+    // the indices pointer argument of the glDrawElements calls
+    const GLvoid* GetIndexOffset() const
+    {
+        return (const GLvoid*)(GLintptr(firstIndex) * GetIndexSize());
+    }
+};
+
+//-----------------------------------------------------------------------------
+// GeometryArena - one vertex buffer and VAO for every VertexFormat and one
+// index buffer shared by every SubMesh. Meshes only keep the offsets of their
+// ranges and are drawn with the BaseVertex calls, so the scene only binds a
+// VAO when the vertex format changes instead of once per draw.
+// 16 and 32 bit indices share the index buffer, it is allocated in 16 bit
+// units and 32 bit ranges are kept 4 byte aligned.
+// The buffers grow by doubling and copying the old contents on the GPU.
+//-----------------------------------------------------------------------------
+class GeometryArena
+{
+public:
+    static const GLuint INITIAL_VERTEX_CAPACITY = 1 << 16;
+    // in 16 bit units
+    static const GLuint INITIAL_INDEX_CAPACITY  = 1 << 19;
+
+    static GeometryArena& Get();
+
+    GeometryArena();
+    ~GeometryArena();
+
+    // deletes the buffers, called on the GL thread before the context is
+    // destroyed. Nothing can be allocated or drawn afterwards
+    void Shutdown();
+
+    // with null data only the ranges are allocated, the data is then given
+    // to the Stream functions
+    GeometryAllocation Allocate       (VertexFormat format, const void* vertices, GLuint vertexCount,
+                                       GLenum indexType, const void* indices, GLuint indexCount);
+    void               Free           (GeometryAllocation& allocation);
+    // extra index ranges drawn with the vertices of an existing allocation
+    GLuint             AllocateIndices(GLenum indexType, const void* indices, GLuint indexCount);
+    void               FreeIndices    (GLenum indexType, GLuint firstIndex, GLuint indexCount);
+    void               UpdateVertices (const GeometryAllocation& allocation, const void* vertices);
+    // the data is copied by the UploadManager over the next frames and can
+    // only be drawn once upload is ready
+    void               StreamVertices (const GeometryAllocation& allocation, const UploadData& vertices,
+                                       const std::shared_ptr<UploadStatus>& upload);
+    void               StreamIndices  (GLenum indexType, GLuint firstIndex, GLuint indexCount, const UploadData& indices,
+                                       const std::shared_ptr<UploadStatus>& upload);
+    // copies of existing ranges made on the GPU, for meshes that no longer
+    // keep their vertices in memory
+    GeometryAllocation Duplicate       (const GeometryAllocation& source);
+    GLuint             DuplicateIndices(GLenum indexType, GLuint firstIndex, GLuint indexCount);
+
+    void   Bind             (VertexFormat format);
+    void   BindInstanceBuffer(GLuint instanceBuffer, GLintptr offset);
+    GLuint GetVertexBuffer  (VertexFormat format) const;
+    GLuint GetIndexBuffer   () const;
+    // bytes of the buffers, allocated or not
+    GLsizeiptr GetMemoryUsage() const;
+
+private:
+    struct VertexPool
+    {
+        GLuint VAO;
+        GLuint VBO;
+        RangeAllocator ranges;
+    };
+
+    void   InitPool          (VertexFormat format);
+    GLuint AllocateVertexRange(VertexFormat format, GLuint vertexCount);
+    GLuint AllocateIndexRange (GLenum indexType, GLuint indexCount);
+    void   GrowBuffer        (GLuint& buffer, GLsizeiptr oldSize, GLsizeiptr newSize);
+    void   StreamBuffer      (const GLuint& buffer, GLintptr offset, const UploadData& data, GLsizeiptr size,
+                              GLsizeiptr elementSize, const std::shared_ptr<UploadStatus>& upload);
+    void   SetupVertexArray  (VertexFormat format);
+
+    VertexPool m_vertexPools[VERTEX_FORMAT_COUNT];
+
+    GLuint m_EBO;
+    RangeAllocator m_indexRanges;
+};
+
+#endif  //_GEOMETRYARENA_H
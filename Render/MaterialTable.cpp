@@ -0,0 +1,126 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "MaterialTable.h"
+
+//-----------------------------------------------------------------------------
+// Name : MaterialTable (constructor)
+//-----------------------------------------------------------------------------
+MaterialTable::MaterialTable()
+{
+    m_buffer = 0;
+    m_capacity = 0;
+    m_boundWindow = -1;
+}
+
+//-----------------------------------------------------------------------------
+// Name : MaterialTable (destructor)
+//-----------------------------------------------------------------------------
+MaterialTable::~MaterialTable()
+{
+    if (m_buffer != 0)
+        glDeleteBuffers(1, &m_buffer);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Init ()
+//-----------------------------------------------------------------------------
+void MaterialTable::Init()
+{
+    Reserve(WINDOW_SIZE);
+    Bind(0);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Upload ()
+// Desc : writes materials [firstMaterial, firstMaterial + count) to the buffer
+//-----------------------------------------------------------------------------
+void MaterialTable::Upload(GLuint firstMaterial, const Material* materials, GLuint count)
+{
+    if (count == 0)
+        return;
+
+    Reserve(firstMaterial + count);
+
+    m_staging.resize(count);
+    for (GLuint i = 0; i < count; i++)
+    {
+        const Material& mat = materials[i];
+        MaterialData& data = m_staging[i];
+        data.diffuse = mat.diffuse;
+        data.ambient = mat.ambient;
+        data.specular = mat.specular;
+        data.emissive = mat.emissive;
+        data.power = mat.power;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, firstMaterial * sizeof(MaterialData), count * sizeof(MaterialData), m_staging.data());
+}
+
+//-----------------------------------------------------------------------------
+// Name : Bind ()
+// Desc : binds the window holding materialIndex to UB_MATERIAL and returns the
+//        index the shader should use
+//-----------------------------------------------------------------------------
+GLuint MaterialTable::Bind(GLuint materialIndex)
+{
+    GLuint window = materialIndex / WINDOW_SIZE;
+    if (window != m_boundWindow)
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, UB_MATERIAL, m_buffer,
+                          window * WINDOW_SIZE * sizeof(MaterialData), WINDOW_SIZE * sizeof(MaterialData));
+        m_boundWindow = window;
+    }
+
+    return materialIndex % WINDOW_SIZE;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Reserve ()
+// Desc : grows the buffer to whole windows, the old content is copied on the
+//        GPU so only the materials that changed have to be uploaded again
+//-----------------------------------------------------------------------------
+void MaterialTable::Reserve(GLuint materialCount)
+{
+    if (materialCount <= m_capacity)
+        return;
+
+    GLuint newCapacity = std::max(m_capacity * 2, WINDOW_SIZE);
+    while (newCapacity < materialCount)
+        newCapacity *= 2;
+    newCapacity = ((newCapacity + WINDOW_SIZE - 1) / WINDOW_SIZE) * WINDOW_SIZE;
+
+    GLuint newBuffer;
+    glGenBuffers(1, &newBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, newBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, newCapacity * sizeof(MaterialData), nullptr, GL_DYNAMIC_DRAW);
+
+    if (m_buffer != 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_UNIFORM_BUFFER, 0, 0, m_capacity * sizeof(MaterialData));
+        glDeleteBuffers(1, &m_buffer);
+    }
+
+    m_buffer = newBuffer;
+    m_capacity = newCapacity;
+    // the bound range belonged to the old buffer
+    m_boundWindow = -1;
+}
@@ -0,0 +1,69 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef  _MATERIALTABLE_H
+#define  _MATERIALTABLE_H
+
+#include <vector>
+#include <GL/glew.h>
+#include "RenderTypes.h"
+
+// std140 layout of MaterialData in objectShader4.frag
+struct MaterialData
+{
+    glm::vec4 diffuse;
+    glm::vec4 ambient;
+    glm::vec4 specular;
+    glm::vec4 emissive;
+    float     power;
+    float     pad[3]; //padding to fit the glsl struct array stride
+};
+
+//-----------------------------------------------------------------------------
+// MaterialTable - every material of the asset manager in one uniform buffer.
+// Only the changed ranges are uploaded and the buffer only reallocates when it
+// has to grow. A uniform block can't hold all the materials so the shaders
+// see a window of WINDOW_SIZE materials, Bind() selects the window and
+// returns the index of the material inside of it.
+//-----------------------------------------------------------------------------
+class MaterialTable
+{
+public:
+    // must match MATERIAL_TABLE_SIZE in objectShader4.frag, a window is
+    // 15360 bytes which keeps every window offset 256 byte aligned
+    static const GLuint WINDOW_SIZE = 192;
+
+    MaterialTable();
+    ~MaterialTable();
+
+    void   Init   ();
+    void   Upload (GLuint firstMaterial, const Material* materials, GLuint count);
+    GLuint Bind   (GLuint materialIndex);
+
+private:
+    void Reserve(GLuint materialCount);
+
+    GLuint m_buffer;
+    GLuint m_capacity;
+    GLuint m_boundWindow;
+    std::vector<MaterialData> m_staging;
+};
+
+#endif  //_MATERIALTABLE_H
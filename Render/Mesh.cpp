@@ -32,6 +32,8 @@ Mesh::Mesh()
 Mesh::Mesh(const std::vector<SubMesh>& sMeshes)
 {
     m_subMeshes = sMeshes;
+    CalcBounds();
+    CalcLodErrors();
 }
 
 //-----------------------------------------------------------------------------
@@ -45,6 +47,9 @@ Mesh::Mesh(const std::vector<SubMesh>& sMeshes, const std::vector<GLuint>& dMate
     // add empty texture for every material that doesn't have one
     for (int i = m_defaultTextures.size(); i < m_defaultMaterials.size(); i++)
         m_defaultTextures.push_back("");
+
+    CalcBounds();
+    CalcLodErrors();
 }
 
 //-----------------------------------------------------------------------------
@@ -58,6 +63,9 @@ Mesh::Mesh(std::vector<SubMesh>&& sMeshes, std::vector<GLuint>&& dMaterials, std
     // add empty texture for every material that doesn't have one
     for (int i = m_defaultTextures.size(); i < m_defaultMaterials.size(); i++)
         m_defaultTextures.push_back("");
+
+    CalcBounds();
+    CalcLodErrors();
 }
 
 //-----------------------------------------------------------------------------
@@ -66,7 +74,10 @@ Mesh::Mesh(std::vector<SubMesh>&& sMeshes, std::vector<GLuint>&& dMaterials, std
 Mesh::Mesh(const Mesh& copyMesh)
     :m_subMeshes(copyMesh.m_subMeshes), 
      m_defaultMaterials(copyMesh.m_defaultMaterials),
-     m_defaultTextures(copyMesh.m_defaultTextures)
+     m_defaultTextures(copyMesh.m_defaultTextures),
+     m_bounds(copyMesh.m_bounds),
+     m_boundingSphere(copyMesh.m_boundingSphere),
+     m_lodErrors(copyMesh.m_lodErrors)
 {
 }
 
@@ -78,6 +89,9 @@ Mesh& Mesh::operator=(const Mesh& copy)
     m_subMeshes = copy.m_subMeshes;
     m_defaultMaterials = copy.m_defaultMaterials;
     m_defaultTextures = copy.m_defaultTextures;
+    m_bounds = copy.m_bounds;
+    m_boundingSphere = copy.m_boundingSphere;
+    m_lodErrors = copy.m_lodErrors;
     
     return *this;
 }
@@ -88,7 +102,10 @@ Mesh& Mesh::operator=(const Mesh& copy)
 Mesh::Mesh(Mesh&& moveMesh)
     :m_subMeshes(std::move(moveMesh.m_subMeshes)), 
      m_defaultMaterials(std::move(moveMesh.m_defaultMaterials)),
-     m_defaultTextures(std::move(moveMesh.m_defaultTextures))
+     m_defaultTextures(std::move(moveMesh.m_defaultTextures)),
+     m_bounds(moveMesh.m_bounds),
+     m_boundingSphere(moveMesh.m_boundingSphere),
+     m_lodErrors(std::move(moveMesh.m_lodErrors))
 {
 }
 
@@ -100,6 +117,9 @@ Mesh& Mesh::operator=(Mesh&& move)
     m_subMeshes = std::move(move.m_subMeshes);
     m_defaultMaterials = std::move(move.m_defaultMaterials);
     m_defaultTextures = std::move(move.m_defaultTextures);
+    m_bounds = move.m_bounds;
+    m_boundingSphere = move.m_boundingSphere;
+    m_lodErrors = std::move(move.m_lodErrors);
     
     return *this;
 }
@@ -107,9 +127,17 @@ Mesh& Mesh::operator=(Mesh&& move)
 //-----------------------------------------------------------------------------
 // Name : Draw ()
 //-----------------------------------------------------------------------------
-void Mesh::Mesh::Draw(unsigned int subMeshIndex)
+void Mesh::Mesh::Draw(unsigned int subMeshIndex, GLuint lod /*= 0*/)
 {
-    m_subMeshes[subMeshIndex].Draw();
+    m_subMeshes[subMeshIndex].Draw(lod);
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawInstanced ()
+//-----------------------------------------------------------------------------
+void Mesh::DrawInstanced(unsigned int subMeshIndex, GLsizei instanceCount, GLuint instanceBuffer, GLuint firstInstance, GLuint lod /*= 0*/)
+{
+    m_subMeshes[subMeshIndex].DrawInstanced(instanceCount, instanceBuffer, firstInstance, lod);
 }
 
 //-----------------------------------------------------------------------------
@@ -117,24 +145,122 @@ void Mesh::Mesh::Draw(unsigned int subMeshIndex)
 //-----------------------------------------------------------------------------
 void Mesh::addSubMesh(SubMesh subMesh)
 {
-    m_subMeshes.push_back(subMesh);
+    m_subMeshes.push_back(std::move(subMesh));
+    CalcBounds();
+    CalcLodErrors();
+}
+
+//-----------------------------------------------------------------------------
+// Name : getSubMeshCount ()
+//-----------------------------------------------------------------------------
+GLuint Mesh::getSubMeshCount() const
+{
+    return m_subMeshes.size();
+}
+
+//-----------------------------------------------------------------------------
+// Name : getSubMesh ()
+//-----------------------------------------------------------------------------
+const SubMesh& Mesh::getSubMesh(unsigned int subMeshIndex) const
+{
+    return m_subMeshes[subMeshIndex];
+}
+
+//-----------------------------------------------------------------------------
+// Name : CalcBounds ()
+// Desc : merges the subMeshes bounds, the sphere is centered on the merged
+//        box and encloses all the subMeshes spheres
+//-----------------------------------------------------------------------------
+void Mesh::CalcBounds()
+{
+    m_bounds = AABB();
+    for (const SubMesh& subMesh : m_subMeshes)
+        m_bounds.AddAABB(subMesh.GetBounds());
+
+    m_boundingSphere = BoundingSphere();
+    if (m_bounds.IsEmpty())
+        return;
+
+    m_boundingSphere.center = m_bounds.GetCenter();
+    for (const SubMesh& subMesh : m_subMeshes)
+    {
+        const BoundingSphere& sphere = subMesh.GetBoundingSphere();
+        float radius = glm::length(sphere.center - m_boundingSphere.center) + sphere.radius;
+        m_boundingSphere.radius = std::max(m_boundingSphere.radius, radius);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : CalcLodErrors ()
+// Desc : the error of a level is the largest error of the subMeshes at it
+//-----------------------------------------------------------------------------
+void Mesh::CalcLodErrors()
+{
+    GLuint lodCount = 1;
+    for (const SubMesh& subMesh : m_subMeshes)
+        lodCount = std::max(lodCount, subMesh.GetLodCount());
+
+    m_lodErrors.assign(lodCount, 0.0f);
+    for (GLuint lod = 1; lod < lodCount; lod++)
+    {
+        for (const SubMesh& subMesh : m_subMeshes)
+            m_lodErrors[lod] = std::max(m_lodErrors[lod], subMesh.GetLodError(lod));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetLodCount ()
+//-----------------------------------------------------------------------------
+GLuint Mesh::GetLodCount() const
+{
+    return m_lodErrors.empty() ? 1 : m_lodErrors.size();
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetLodError ()
+//-----------------------------------------------------------------------------
+float Mesh::GetLodError(GLuint lod) const
+{
+    if (lod >= m_lodErrors.size())
+        return m_lodErrors.empty() ? 0.0f : m_lodErrors.back();
+
+    return m_lodErrors[lod];
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBounds ()
+//-----------------------------------------------------------------------------
+const AABB& Mesh::GetBounds() const
+{
+    return m_bounds;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBoundingSphere ()
+//-----------------------------------------------------------------------------
+const BoundingSphere& Mesh::GetBoundingSphere() const
+{
+    return m_boundingSphere;
 }
 
 //-----------------------------------------------------------------------------
 // Name : IntersectTriangle ()
+// Desc : finds the nearest hit on all the subMeshes
 //-----------------------------------------------------------------------------
-bool Mesh::IntersectTriangle(glm::vec3& rayObjOrigin, glm::vec3& rayObjDir, int& faceCount, int& subMeshIndex)
+bool Mesh::IntersectTriangle(const glm::vec3& rayObjOrigin, const glm::vec3& rayObjDir, RayHit& hit) const
 {
+    bool found = false;
     for (GLuint i = 0; i < m_subMeshes.size(); ++i)
     {
-        if (m_subMeshes[i].IntersectTriangle(rayObjOrigin, rayObjDir, faceCount))
+        // hit.distance only gets smaller so every subMesh has to beat the previous ones
+        if (m_subMeshes[i].IntersectTriangle(rayObjOrigin, rayObjDir, hit))
         {
-            subMeshIndex = i;
-            return true;
+            hit.subMeshIndex = i;
+            found = true;
         }
     }
 
-    return false;
+    return found;
 }
 
 //-----------------------------------------------------------------------------
@@ -148,6 +274,55 @@ void Mesh::CalcVertexNormals(GLfloat angle)
     }
 }
 
+//-----------------------------------------------------------------------------
+// Name : SetVertexFormat ()
+// Desc : overrides the format the subMeshes picked for themselves
+//-----------------------------------------------------------------------------
+void Mesh::SetVertexFormat(VertexFormat format)
+{
+    for (SubMesh& mesh : m_subMeshes)
+    {
+        mesh.SetVertexFormat(format);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : Upload ()
+// Desc : uploads the subMeshes that were built without their GPU copy
+//-----------------------------------------------------------------------------
+void Mesh::Upload()
+{
+    for (SubMesh& mesh : m_subMeshes)
+    {
+        mesh.Upload();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetResidency ()
+//-----------------------------------------------------------------------------
+void Mesh::SetResidency(MeshResidency residency)
+{
+    for (SubMesh& mesh : m_subMeshes)
+    {
+        mesh.SetResidency(residency);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetMemoryUsage ()
+//-----------------------------------------------------------------------------
+MeshMemoryUsage Mesh::GetMemoryUsage() const
+{
+    MeshMemoryUsage usage;
+    for (const SubMesh& mesh : m_subMeshes)
+    {
+        usage.Add(mesh.GetMemoryUsage());
+    }
+
+    return usage;
+}
+
 //-----------------------------------------------------------------------------
 // Name : getDefaultMaterials ()
 //-----------------------------------------------------------------------------
@@ -36,19 +36,44 @@ public:
     Mesh& operator=(Mesh&& move);
 
     // Render the mesh
-    void Draw(unsigned int subMeshIndex);
+    void Draw(unsigned int subMeshIndex, GLuint lod = 0);
+    void DrawInstanced(unsigned int subMeshIndex, GLsizei instanceCount, GLuint instanceBuffer, GLuint firstInstance, GLuint lod = 0);
     void addSubMesh(SubMesh subMesh);
+    GLuint getSubMeshCount() const;
+    const SubMesh& getSubMesh(unsigned int subMeshIndex) const;
 
-    bool IntersectTriangle(glm::vec3& rayObjOrigin,glm::vec3& rayObjDir, int& faceCount, int& subMeshIndex);
+    const AABB&           GetBounds        () const;
+    const BoundingSphere& GetBoundingSphere() const;
+
+    // levels of detail including the full mesh, the error of a level is the
+    // largest error of its subMeshes in local space
+    GLuint GetLodCount() const;
+    float  GetLodError(GLuint lod) const;
+
+    bool IntersectTriangle(const glm::vec3& rayObjOrigin, const glm::vec3& rayObjDir, RayHit& hit) const;
     void CalcVertexNormals(GLfloat angle);
+    void SetVertexFormat(VertexFormat format);
+    // has to be called on the GL thread for subMeshes built without upload
+    void Upload();
+    // applied to every subMesh, see MeshResidency
+    void SetResidency(MeshResidency residency);
+    MeshMemoryUsage GetMemoryUsage() const;
 
     std::vector<GLuint>& getDefaultMaterials();
     std::vector<std::string>& getDefaultTextures();
 
 private:
+    void CalcBounds();
+    void CalcLodErrors();
+
     std::vector<SubMesh> m_subMeshes;
     std::vector<GLuint> m_defaultMaterials;
     std::vector<std::string> m_defaultTextures;
+
+    // local space bounds of all the subMeshes
+    AABB m_bounds;
+    BoundingSphere m_boundingSphere;
+    std::vector<float> m_lodErrors;
 };
 
 
@@ -24,18 +24,18 @@
 // Name : Object (constructor)
 //-----------------------------------------------------------------------------
 Object::Object::Object(const glm::vec3& pos, const glm::vec3& angle, const glm::vec3& scale, Mesh* pMesh, std::vector<unsigned int> meshAttribute) 
-    : m_mtxScale(1.0f)
+    : m_transform(&GetTransformStore()), m_pMesh(nullptr)
 {
     assert(pMesh);
     
-    InitObject(pos, angle, scale, pMesh, meshAttribute);
+    InitObject(pos, angle, scale, pMesh, std::move(meshAttribute));
 }
 
 //-----------------------------------------------------------------------------
 // Name : Object (constructor)
 //-----------------------------------------------------------------------------
 Object::Object(AssetManager &asset, const glm::vec3 &pos, const glm::vec3 &angle, const glm::vec3 &scale, Mesh *pMesh, std::string shaderPath)
-    :m_mtxScale(1.0f)
+    :m_transform(&GetTransformStore()), m_pMesh(nullptr)
 {
     assert(pMesh);
     
@@ -62,7 +62,7 @@ Object::Object(AssetManager &asset, const glm::vec3 &pos, const glm::vec3 &angle
         objAtteributes.push_back(asset.getAttribute("", GL_REPEAT, i, shaderPath));
     }
     
-    InitObject(pos, angle, scale,pMesh,objAtteributes);
+    InitObject(pos, angle, scale,pMesh,std::move(objAtteributes));
 }
 
 //-----------------------------------------------------------------------------
@@ -70,15 +70,18 @@ Object::Object(AssetManager &asset, const glm::vec3 &pos, const glm::vec3 &angle
 //-----------------------------------------------------------------------------
 void Object::InitObject(const glm::vec3 &pos, const glm::vec3 &angle, const glm::vec3 &scale, Mesh *pMesh, std::vector<unsigned int> meshAttribute)
 {
+    m_proxyId = -1;
+    m_moveBuffer = nullptr;
+    m_objectIndex = 0;
+    m_inMoveBuffer = false;
+    m_lodLevel = 0;
+
     SetPos(pos);
     SetRotAngles(angle);
     SetScale(scale);
-    // update world matrix
-    m_worldDirty = true;
-    GetWorldMatrix();
 
     AttachMesh(pMesh);
-    SetObjectAttributes(meshAttribute);
+    SetObjectAttributes(std::move(meshAttribute));
 
     m_hideObject = false;
 }
@@ -91,41 +94,181 @@ Object::~Object()
 
 }
 
+//-----------------------------------------------------------------------------
+// Name : GetTransformStore
+// Desc : the store shared by all the objects
+//-----------------------------------------------------------------------------
+TransformStore& Object::GetTransformStore()
+{
+    static TransformStore transformStore;
+    return transformStore;
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateTransforms
+// Desc : rebuilds the matrices of every object that moved in one batch, the
+//        getters would otherwise rebuild them one object at a time
+//-----------------------------------------------------------------------------
+void Object::UpdateTransforms()
+{
+    GetTransformStore().UpdateMatrices();
+}
+
 //-----------------------------------------------------------------------------
 // Name : GetWorldMatrix
 //-----------------------------------------------------------------------------
 const glm::mat4x4& Object::GetWorldMatrix()
+{
+    return GetTransformStore().GetWorldMatrix(m_transform.GetSlot());
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetInverseTransposeWorldMatrix
+//-----------------------------------------------------------------------------
+const glm::mat4x4& Object::GetInverseTransposeWorldMatrix()
+{
+    return GetTransformStore().GetInverseTransposeMatrix(m_transform.GetSlot());
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetInverseWorldMatrix
+//-----------------------------------------------------------------------------
+glm::mat4x4 Object::GetInverseWorldMatrix()
+{
+    return glm::transpose(GetInverseTransposeWorldMatrix());
+}
+
+//-----------------------------------------------------------------------------
+// Name : CalculateWorldBounds
+//-----------------------------------------------------------------------------
+void Object::CalculateWorldBounds()
+{
+    const glm::mat4x4& world = GetWorldMatrix();
+
+    // largest axis scale, used to scale the bounding spheres radius
+    m_maxScale = std::max(glm::length(glm::vec3(world[0])),
+                 std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+
+    if (m_pMesh)
+    {
+        const BoundingSphere& sphere = m_pMesh->GetBoundingSphere();
+        m_worldBounds = m_pMesh->GetBounds().Transform(world);
+        m_worldBoundingSphere = BoundingSphere(glm::vec3(world * glm::vec4(sphere.center, 1.0f)), sphere.radius * m_maxScale);
+    }
+    else
+    {
+        m_worldBounds = AABB();
+        m_worldBoundingSphere = BoundingSphere(GetPosition(), 0.0f);
+    }
+
+    m_worldDirty = false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : MarkWorldDirty
+//-----------------------------------------------------------------------------
+void Object::MarkWorldDirty()
+{
+    m_worldDirty = true;
+
+    if (m_moveBuffer && !m_inMoveBuffer)
+    {
+        m_moveBuffer->push_back(m_objectIndex);
+        m_inMoveBuffer = true;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetMoveBuffer
+//-----------------------------------------------------------------------------
+void Object::SetMoveBuffer(std::vector<GLuint>* moveBuffer, GLuint objectIndex)
+{
+    m_moveBuffer = moveBuffer;
+    m_objectIndex = objectIndex;
+    m_inMoveBuffer = false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ClearMoved
+//-----------------------------------------------------------------------------
+void Object::ClearMoved()
+{
+    m_inMoveBuffer = false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetProxyId
+//-----------------------------------------------------------------------------
+int Object::GetProxyId() const
+{
+    return m_proxyId;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetProxyId
+//-----------------------------------------------------------------------------
+void Object::SetProxyId(int proxyId)
+{
+    m_proxyId = proxyId;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetLodLevel
+//-----------------------------------------------------------------------------
+GLuint Object::GetLodLevel() const
+{
+    return m_lodLevel;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetLodLevel
+//-----------------------------------------------------------------------------
+void Object::SetLodLevel(GLuint lod)
+{
+    m_lodLevel = lod;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetWorldBounds
+//-----------------------------------------------------------------------------
+const AABB& Object::GetWorldBounds()
 {
     if (m_worldDirty)
     {
-        CalculateWorldMatrix();
+        CalculateWorldBounds();
     }
 
-    return m_mthxWorld;
+    return m_worldBounds;
 }
 
 //-----------------------------------------------------------------------------
-// Name : GetInverseWorldMatrix
+// Name : GetWorldBoundingSphere
 //-----------------------------------------------------------------------------
-const glm::mat4x4& Object::GetInverseWorldMatrix()
+const BoundingSphere& Object::GetWorldBoundingSphere()
 {
     if (m_worldDirty)
     {
-        CalculateWorldMatrix();
+        CalculateWorldBounds();
     }
 
-    return m_mthxInverseWorld;
+    return m_worldBoundingSphere;
 }
 
 //-----------------------------------------------------------------------------
-// Name : CalculateWorldMatrix
+// Name : GetSubMeshBoundingSphere
+// Desc : world space bounding sphere of a single subMesh
 //-----------------------------------------------------------------------------
-void Object::CalculateWorldMatrix()
+BoundingSphere Object::GetSubMeshBoundingSphere(unsigned int subMeshIndex)
 {
-    m_mthxWorld = glm::translate(glm::mat4x4(1.0f), m_pos);
-    m_mthxWorld = m_mthxWorld * m_mtxScale * m_mtxRot;
-    m_mthxInverseWorld = glm::inverse(m_mthxWorld);
-    m_worldDirty = false;
+    if (m_worldDirty)
+    {
+        CalculateWorldBounds();
+    }
+
+    const glm::mat4x4& world = GetWorldMatrix();
+    const BoundingSphere& sphere = m_pMesh->getSubMesh(subMeshIndex).GetBoundingSphere();
+
+    return BoundingSphere(glm::vec3(world * glm::vec4(sphere.center, 1.0f)), sphere.radius * m_maxScale);
 }
 
 
@@ -134,7 +277,7 @@ void Object::CalculateWorldMatrix()
 //-----------------------------------------------------------------------------
 glm::vec3 Object::GetPosition()
 {
-    return m_pos;
+    return GetTransformStore().GetPosition(m_transform.GetSlot());
 }
 
 //-----------------------------------------------------------------------------
@@ -166,8 +309,8 @@ void Object::SetObjectHidden(bool newStatus)
 //-----------------------------------------------------------------------------
 void Object::SetPos(glm::vec3 newPos)
 {
-    m_pos = newPos;
-    m_worldDirty = true;
+    GetTransformStore().SetPosition(m_transform.GetSlot(), newPos);
+    MarkWorldDirty();
 }
 
 //-----------------------------------------------------------------------------
@@ -175,17 +318,8 @@ void Object::SetPos(glm::vec3 newPos)
 //-----------------------------------------------------------------------------
 void Object::SetRotAngles(glm::vec3 newRotAngles)
 {
-    glm::mat4x4 mtxRotX(1.0f);
-    glm::mat4x4 mtxRotY(1.0f);
-    glm::mat4x4 mtxRotZ(1.0f);
-
     m_rotAngles = newRotAngles;
-
-    mtxRotX = glm::rotate(mtxRotX,m_rotAngles.x,glm::vec3(1.0f,0.0f,0.0f));
-    mtxRotY = glm::rotate(mtxRotY,m_rotAngles.y,glm::vec3(0.0f,1.0f,0.0f));
-    mtxRotZ = glm::rotate(mtxRotZ,m_rotAngles.z,glm::vec3(0.0f,0.0f,1.0f));
-    m_mtxRot = mtxRotX * mtxRotY * mtxRotZ;
-    m_worldDirty = true;
+    UpdateRotation();
 }
 
 //-----------------------------------------------------------------------------
@@ -193,7 +327,8 @@ void Object::SetRotAngles(glm::vec3 newRotAngles)
 //-----------------------------------------------------------------------------
 void Object::SetScale(glm::vec3 newScale)
 {
-	m_mtxScale = glm::scale(m_mtxScale, newScale);
+	GetTransformStore().SetScale(m_transform.GetSlot(), newScale);
+	MarkWorldDirty();
 }
 
 
@@ -202,20 +337,25 @@ void Object::SetScale(glm::vec3 newScale)
 //-----------------------------------------------------------------------------
 void Object::Rotate(float x, float y, float z)
 {
-    glm::mat4x4 mtxRotX(1.0f);
-    glm::mat4x4 mtxRotY(1.0f);
-    glm::mat4x4 mtxRotZ(1.0f);
-
     m_rotAngles.x += x;
     m_rotAngles.y += y;
     m_rotAngles.z += z;
 
-    mtxRotX = glm::rotate(mtxRotX,m_rotAngles.x,glm::vec3(1.0f,0.0f,0.0f));
-    mtxRotY = glm::rotate(mtxRotY,m_rotAngles.y,glm::vec3(0.0f,1.0f,0.0f));
-    mtxRotZ = glm::rotate(mtxRotZ,m_rotAngles.z,glm::vec3(0.0f,0.0f,1.0f));
-    m_mtxRot = mtxRotX * mtxRotY * mtxRotZ;
-    
-    m_worldDirty = true;
+    UpdateRotation();
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateRotation
+// Desc : same order as rotating around x, then y, then z in matrix form
+//-----------------------------------------------------------------------------
+void Object::UpdateRotation()
+{
+    glm::quat rot = glm::angleAxis(m_rotAngles.x, glm::vec3(1.0f, 0.0f, 0.0f)) *
+                    glm::angleAxis(m_rotAngles.y, glm::vec3(0.0f, 1.0f, 0.0f)) *
+                    glm::angleAxis(m_rotAngles.z, glm::vec3(0.0f, 0.0f, 1.0f));
+
+    GetTransformStore().SetRotation(m_transform.GetSlot(), glm::normalize(rot));
+    MarkWorldDirty();
 }
 
 //-----------------------------------------------------------------------------
@@ -225,11 +365,12 @@ void Object::TranslatePos(float x, float y, float z)
 {
     if (x != 0 || y != 0 || z != 0)
     {
-        m_pos.x += x;
-        m_pos.y += y;
-        m_pos.z -= z;
+        glm::vec3 pos = GetPosition();
+        pos.x += x;
+        pos.y += y;
+        pos.z -= z;
 
-        m_worldDirty = true;
+        SetPos(pos);
     }
 }
 
@@ -239,15 +380,16 @@ void Object::TranslatePos(float x, float y, float z)
 void Object::AttachMesh(Mesh* pMesh)
 {
 	m_pMesh = pMesh;
+	MarkWorldDirty();
 }
 
 //-----------------------------------------------------------------------------
 // Name : SetObjectAttributes
+// Desc : takes the vector by value so callers can move it in
 //-----------------------------------------------------------------------------
 void Object::SetObjectAttributes(std::vector<unsigned int> meshAttribute)
 {
-	//TODO force moving on the vector paremeter to prevent pointless copying
-	m_meshAttributes = meshAttribute;
+	m_meshAttributes = std::move(meshAttribute);
 }
 
 //-----------------------------------------------------------------------------
@@ -259,40 +401,18 @@ void Object::AddObjectAttribute(unsigned int attribute)
 }
 
 //-----------------------------------------------------------------------------
-// Name : Draw
+// Name : GetObjectAttributes
 //-----------------------------------------------------------------------------
-void Object::Draw(Shader* shader, unsigned int attributeIndex, const glm::mat4x4& matViewProj)
+const std::vector<unsigned int>& Object::GetObjectAttributes()
 {
-    for (unsigned int i = 0; i < m_meshAttributes.size(); ++i)
-    {
-        if (m_meshAttributes[i] == attributeIndex)
-        {
-            glm::mat4x4 temp =  matViewProj * GetWorldMatrix();
-            glUniformMatrix4fv(glGetUniformLocation(shader->Program, "projection"), 1, GL_FALSE, glm::value_ptr(temp));
-            glUniformMatrix4fv(glGetUniformLocation(shader->Program, "matWorld"), 1, GL_FALSE, glm::value_ptr(GetWorldMatrix()));
-            glUniformMatrix4fv(glGetUniformLocation(shader->Program, "matWorldInverseT"), 1, GL_FALSE, glm::value_ptr(GetInverseWorldMatrix()));
-            m_pMesh->Draw(i);
-            break;
-        }
-    }
+    return m_meshAttributes;
 }
 
 //-----------------------------------------------------------------------------
-// Name : Draw
+// Name : DrawSubMesh
+// Desc : the object matrices are expected to be bound in the ObjectBlock
 //-----------------------------------------------------------------------------
-void Object::Draw(GLuint projectionLoc, GLuint matWorldLoc, GLuint matWorldInverseLoc, unsigned int attributeIndex, const glm::mat4x4& matViewProj)
+void Object::DrawSubMesh(unsigned int subMeshIndex)
 {
-    for (unsigned int i = 0; i < m_meshAttributes.size(); ++i)
-    {
-        if (m_meshAttributes[i] == attributeIndex)
-        {
-            glm::mat4x4 temp =  matViewProj * GetWorldMatrix();
-            glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(temp));
-            glUniformMatrix4fv(matWorldLoc, 1, GL_FALSE, glm::value_ptr(GetWorldMatrix()));
-            //TODO: cache the inverse of worldMatrix as well to reduce overhead
-            glUniformMatrix4fv(matWorldInverseLoc, 1, GL_FALSE, glm::value_ptr(GetInverseWorldMatrix()));
-            m_pMesh->Draw(i);
-            break;
-        }
-    }
+    m_pMesh->Draw(subMeshIndex);
 }
@@ -24,6 +24,7 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
 #include "Mesh.h"
+#include "TransformStore.h"
 #include "../AssetLoading/AssetManager.h"
 
 class Object
@@ -35,7 +36,11 @@ public:
     ~Object         ();
 
     const glm::mat4x4& GetWorldMatrix          ();
-    const glm::mat4x4& GetInverseWorldMatrix   ();
+    const glm::mat4x4& GetInverseTransposeWorldMatrix();
+    glm::mat4x4        GetInverseWorldMatrix   ();
+    const AABB&        GetWorldBounds          ();
+    const BoundingSphere& GetWorldBoundingSphere();
+    BoundingSphere     GetSubMeshBoundingSphere(unsigned int subMeshIndex);
     glm::vec3          GetPosition             ();
     Mesh*              GetMesh                 ();
 
@@ -51,25 +56,50 @@ public:
     void               AttachMesh              (Mesh* pMesh);
     void               SetObjectAttributes     (std::vector<unsigned int> meshAttribute);
     void               AddObjectAttribute      (unsigned int attribute);
+    const std::vector<unsigned int>& GetObjectAttributes();
     
-    void               Draw                    (Shader* shader, unsigned int attributeIndex, const glm::mat4x4 &matViewProj);
-    void               Draw                    (GLuint projectionLoc, GLuint matWorldLoc, GLuint matWorldInverseLoc, unsigned int attributeIndex, const glm::mat4x4& matViewProj);
+    void               DrawSubMesh             (unsigned int subMeshIndex);
+
+    void               SetMoveBuffer           (std::vector<GLuint>* moveBuffer, GLuint objectIndex);
+    void               ClearMoved              ();
+    int                GetProxyId              () const;
+    void               SetProxyId              (int proxyId);
+    GLuint             GetLodLevel             () const;
+    void               SetLodLevel             (GLuint lod);
+
+    static TransformStore& GetTransformStore   ();
+    static void            UpdateTransforms    ();
 
 private:
-    void CalculateWorldMatrix();
-    glm::vec3   m_pos;
-    glm::mat4x4 m_mthxWorld;
-    glm::mat4x4 m_mthxInverseWorld;
-    glm::mat4x4 m_mtxRot;
-    glm::mat4x4 m_mtxScale;
+    void CalculateWorldBounds();
+    void MarkWorldDirty();
+    void UpdateRotation();
+
+    // position, rotation and scale live in the shared transform store
+    TransformHandle m_transform;
     glm::vec3   m_rotAngles;
 
+    // mesh bounds in world space, updated when the transform changes
+    AABB           m_worldBounds;
+    BoundingSphere m_worldBoundingSphere;
+    float          m_maxScale;
+
     std::vector<unsigned int> m_meshAttributes;
     
     Mesh*       m_pMesh;
     bool        m_hideObject;
     
     bool        m_worldDirty;
+
+    // the scene spatial index proxy, every change to the world matrix adds
+    // the object index to the move buffer so the index can update its proxy
+    int                  m_proxyId;
+    std::vector<GLuint>* m_moveBuffer;
+    GLuint               m_objectIndex;
+    bool                 m_inMoveBuffer;
+
+    // the mesh level of detail picked last frame, kept for the hysteresis
+    GLuint               m_lodLevel;
 };
 
 #endif  //_OBJECT_H
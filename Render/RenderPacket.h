@@ -0,0 +1,97 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef  _RENDERPACKET_H
+#define  _RENDERPACKET_H
+
+#include <vector>
+#include <GL/glew.h>
+#include "RenderTypes.h"
+#include "Sprite.h"
+
+class Mesh;
+
+// instanceCount > 1 draws instances[firstInstance, firstInstance + instanceCount)
+// otherwise firstInstance is the index of the draw matrices in objects
+struct DrawCommand
+{
+    Mesh*  mesh;
+    GLuint subMeshIndex;
+    GLuint lod;
+    GLuint stateIndex;
+    GLuint firstInstance;
+    GLuint instanceCount;
+};
+
+// everything the scene needs to draw a frame, commands are in draw order
+struct ScenePacket
+{
+    void Clear()
+    {
+        states.clear();
+        commands.clear();
+        objects.clear();
+        instances.clear();
+        firstMaterial = 0;
+        materials.clear();
+    }
+
+    FrameUniforms                  frame;
+    // copied from the asset manager so the render thread never reads it
+    std::vector<ResolvedAttribute> states;
+    std::vector<DrawCommand>       commands;
+    std::vector<ObjectUniforms>    objects;
+    std::vector<InstanceData>      instances;
+    // materials that changed since the last packet, starting at firstMaterial
+    GLuint                         firstMaterial;
+    std::vector<Material>          materials;
+};
+
+//-----------------------------------------------------------------------------
+// RenderPacket - a whole frame as recorded by the main thread. Once submitted
+// it is only read by the render thread until it is handed back for the next
+// frame, the vectors are cleared but keep their memory between frames.
+//-----------------------------------------------------------------------------
+struct RenderPacket
+{
+    enum SpriteLayer{SPRITES, TEXT_SPRITES, TOP_SPRITES, TOP_TEXT_SPRITES, SPRITE_LAYER_MAX};
+
+    RenderPacket()
+        :width(0), height(0), hasScene(false)
+    {}
+
+    void Clear()
+    {
+        hasScene = false;
+        scene.Clear();
+        for (std::vector<StreamOfVertices>& layer : spriteLayers)
+            layer.clear();
+    }
+
+    int width;
+    int height;
+
+    bool hasScene;
+    ScenePacket scene;
+
+    std::vector<StreamOfVertices> spriteLayers[SPRITE_LAYER_MAX];
+};
+
+#endif  //_RENDERPACKET_H
@@ -0,0 +1,156 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "RenderQueue.h"
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+// Name : MakeStateKey ()
+// Desc : packs the render state part of the sort key, values that don't fit
+//        in their field are wrapped, which only costs an extra state change
+//-----------------------------------------------------------------------------
+uint64_t RenderQueue::MakeStateKey(GLuint shaderKey, GLuint textureKey, GLuint materialKey)
+{
+    uint64_t key = 0;
+    key |= (uint64_t(shaderKey)   & ((1ull << SHADER_BITS)   - 1)) << SHADER_SHIFT;
+    key |= (uint64_t(textureKey)  & ((1ull << TEXTURE_BITS)  - 1)) << TEXTURE_SHIFT;
+    key |= (uint64_t(materialKey) & ((1ull << MATERIAL_BITS) - 1)) << MATERIAL_SHIFT;
+
+    return key;
+}
+
+//-----------------------------------------------------------------------------
+// Name : MakeKey ()
+// Desc : adds the depth to a state key, depth is expected in the [0,1] range
+//-----------------------------------------------------------------------------
+uint64_t RenderQueue::MakeKey(uint64_t stateKey, float depth)
+{
+    const uint64_t maxDepth = (1ull << DEPTH_BITS) - 1;
+
+    if (depth < 0.0f)
+        depth = 0.0f;
+    if (depth > 1.0f)
+        depth = 1.0f;
+
+    return stateKey | (uint64_t(depth * maxDepth) << DEPTH_SHIFT);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetStateKey ()
+//-----------------------------------------------------------------------------
+uint64_t RenderQueue::GetStateKey(uint64_t sortKey)
+{
+    return sortKey & ~((1ull << MATERIAL_SHIFT) - 1);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Clear ()
+// Desc : empties the queue but keeps the allocated memory for the next frame
+//-----------------------------------------------------------------------------
+void RenderQueue::Clear()
+{
+    m_items.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Push ()
+//-----------------------------------------------------------------------------
+void RenderQueue::Push(uint64_t sortKey, Object* object, GLuint subMeshIndex, GLuint attribIndex)
+{
+    m_items.emplace_back(sortKey, object, subMeshIndex, attribIndex);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Sort ()
+// Desc : LSD radix sort on the 64 bit keys, one byte per pass.
+//        passes where every key has the same byte value are skipped, so unused
+//        key bits cost nothing
+//-----------------------------------------------------------------------------
+void RenderQueue::Sort()
+{
+    const GLuint itemCount = m_items.size();
+    if (itemCount < 2)
+        return;
+
+    GLuint histograms[8][256];
+    std::memset(histograms, 0, sizeof(histograms));
+
+    // build all the histograms in one go
+    for (const RenderItem& item : m_items)
+    {
+        uint64_t key = item.sortKey;
+        for (GLuint pass = 0; pass < 8; pass++)
+        {
+            histograms[pass][key & 0xFF]++;
+            key >>= 8;
+        }
+    }
+
+    m_sortBuffer.resize(itemCount, m_items[0]);
+    RenderItem* src = m_items.data();
+    RenderItem* dst = m_sortBuffer.data();
+
+    for (GLuint pass = 0; pass < 8; pass++)
+    {
+        GLuint* histogram = histograms[pass];
+        GLuint shift = pass * 8;
+
+        // all the keys share the same byte, nothing to sort in this pass
+        if (histogram[(src[0].sortKey >> shift) & 0xFF] == itemCount)
+            continue;
+
+        // turn the histogram into starting offsets
+        GLuint offset = 0;
+        for (GLuint i = 0; i < 256; i++)
+        {
+            GLuint count = histogram[i];
+            histogram[i] = offset;
+            offset += count;
+        }
+
+        for (GLuint i = 0; i < itemCount; i++)
+        {
+            GLuint bucket = (src[i].sortKey >> shift) & 0xFF;
+            dst[histogram[bucket]++] = src[i];
+        }
+
+        std::swap(src, dst);
+    }
+
+    // the sorted result ended up in the scratch buffer
+    if (src != m_items.data())
+        m_items.swap(m_sortBuffer);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetItems ()
+//-----------------------------------------------------------------------------
+const std::vector<RenderItem>& RenderQueue::GetItems() const
+{
+    return m_items;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetSize ()
+//-----------------------------------------------------------------------------
+GLuint RenderQueue::GetSize() const
+{
+    return m_items.size();
+}
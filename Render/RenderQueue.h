@@ -0,0 +1,89 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef  _RENDERQUEUE_H
+#define  _RENDERQUEUE_H
+
+#include <cinttypes>
+#include <vector>
+#include <GL/glew.h>
+
+class Object;
+
+struct RenderItem
+{
+    RenderItem(uint64_t _sortKey, Object* _object, GLuint _subMeshIndex, GLuint _attribIndex)
+        :sortKey(_sortKey), object(_object), subMeshIndex(_subMeshIndex), attribIndex(_attribIndex)
+    {}
+
+    uint64_t sortKey;
+    Object*  object;
+    GLuint   subMeshIndex;
+    GLuint   attribIndex;
+};
+
+// a single draw call, instanceCount > 1 means all the instances share the
+// subMesh and attribute of item and their matrices start at firstInstance
+struct DrawBatch
+{
+    DrawBatch(const RenderItem* _item, GLuint _firstInstance, GLuint _instanceCount)
+        :item(_item), firstInstance(_firstInstance), instanceCount(_instanceCount)
+    {}
+
+    const RenderItem* item;
+    GLuint firstInstance;
+    GLuint instanceCount;
+};
+
+//-----------------------------------------------------------------------------
+// RenderQueue - per frame list of (object, subMesh) pairs to draw.
+// Every item carries a 64 bit key packed as (from msb to lsb)
+// shader | texture | material | depth, so after sorting all the items that
+// share render state are next to each other and are drawn front to back.
+//-----------------------------------------------------------------------------
+class RenderQueue
+{
+public:
+    static const GLuint SHADER_BITS   = 12;
+    static const GLuint TEXTURE_BITS  = 16;
+    static const GLuint MATERIAL_BITS = 16;
+    static const GLuint DEPTH_BITS    = 20;
+
+    static const GLuint DEPTH_SHIFT    = 0;
+    static const GLuint MATERIAL_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+    static const GLuint TEXTURE_SHIFT  = MATERIAL_SHIFT + MATERIAL_BITS;
+    static const GLuint SHADER_SHIFT   = TEXTURE_SHIFT + TEXTURE_BITS;
+
+    static uint64_t MakeStateKey(GLuint shaderKey, GLuint textureKey, GLuint materialKey);
+    static uint64_t MakeKey     (uint64_t stateKey, float depth);
+    static uint64_t GetStateKey (uint64_t sortKey);
+
+    void Clear();
+    void Push (uint64_t sortKey, Object* object, GLuint subMeshIndex, GLuint attribIndex);
+    void Sort ();
+
+    const std::vector<RenderItem>& GetItems() const;
+    GLuint                         GetSize () const;
+
+private:
+    std::vector<RenderItem> m_items;
+    std::vector<RenderItem> m_sortBuffer;
+};
+
+#endif  //_RENDERQUEUE_H
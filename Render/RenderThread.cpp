@@ -0,0 +1,231 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "RenderThread.h"
+#include "GLThread.h"
+#include "../GameWindow/BaseWindow.h"
+
+//-----------------------------------------------------------------------------
+// Name : RenderThread (constructor)
+//-----------------------------------------------------------------------------
+RenderThread::RenderThread()
+{
+    m_window = nullptr;
+    m_running = false;
+    m_quit = false;
+    m_jobRunning = false;
+
+    for (GLuint i = 0; i < PACKET_COUNT; i++)
+        m_packetStates[i] = PACKET_FREE;
+
+    m_writeIndex = 0;
+    m_readIndex = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RenderThread (destructor)
+//-----------------------------------------------------------------------------
+RenderThread::~RenderThread()
+{
+    Stop();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Start ()
+// Desc : the caller has to release the GL context before calling Start as the
+//        render thread makes it current for itself
+//-----------------------------------------------------------------------------
+bool RenderThread::Start(BaseWindow* window, const ExecuteFunc& executePacket)
+{
+    if (m_running || window == nullptr)
+        return false;
+
+    m_window = window;
+    m_executePacket = executePacket;
+    m_quit = false;
+
+    for (GLuint i = 0; i < PACKET_COUNT; i++)
+    {
+        m_packets[i].Clear();
+        m_packetStates[i] = PACKET_FREE;
+    }
+
+    m_writeIndex = 0;
+    m_readIndex = 0;
+
+    m_running = true;
+    m_thread = std::thread(&RenderThread::ThreadLoop, this);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Stop ()
+// Desc : executes the packets and jobs that are already queued and joins the
+//        thread, the GL context is released and can be made current again
+//-----------------------------------------------------------------------------
+void RenderThread::Stop()
+{
+    if (!m_running)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_cond.notify_all();
+
+    m_thread.join();
+    m_running = false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsRunning ()
+//-----------------------------------------------------------------------------
+bool RenderThread::IsRunning() const
+{
+    return m_running;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BeginPacket ()
+// Desc : returns the next packet to record, waits while the render thread
+//        still has it from PACKET_COUNT frames ago
+//-----------------------------------------------------------------------------
+RenderPacket& RenderThread::BeginPacket()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this]{ return m_packetStates[m_writeIndex] == PACKET_FREE; });
+
+    RenderPacket& packet = m_packets[m_writeIndex];
+    packet.Clear();
+
+    return packet;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SubmitPacket ()
+// Desc : hands the packet returned by BeginPacket to the render thread
+//-----------------------------------------------------------------------------
+void RenderThread::SubmitPacket()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_packetStates[m_writeIndex] = PACKET_PENDING;
+        m_writeIndex = (m_writeIndex + 1) % PACKET_COUNT;
+    }
+    m_cond.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+// Name : EnqueueJob ()
+//-----------------------------------------------------------------------------
+void RenderThread::EnqueueJob(const Job& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(job);
+    }
+    m_cond.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+// Name : WaitIdle ()
+// Desc : waits until every submitted packet and queued job was executed
+//-----------------------------------------------------------------------------
+void RenderThread::WaitIdle()
+{
+    if (!m_running)
+        return;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this]{ return IsIdle(); });
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsIdle ()
+// Desc : expects m_mutex to be locked
+//-----------------------------------------------------------------------------
+bool RenderThread::IsIdle() const
+{
+    if (!m_jobs.empty() || m_jobRunning)
+        return false;
+
+    for (GLuint i = 0; i < PACKET_COUNT; i++)
+    {
+        if (m_packetStates[i] != PACKET_FREE)
+            return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ThreadLoop ()
+//-----------------------------------------------------------------------------
+void RenderThread::ThreadLoop()
+{
+    m_window->makeContextCurrent(true);
+    GLThread::SetCurrent();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_cond.wait(lock, [this]
+        {
+            return m_quit || !m_jobs.empty() || m_packetStates[m_readIndex] == PACKET_PENDING;
+        });
+
+        // jobs create the resources the next packets might use so they go first
+        while (!m_jobs.empty())
+        {
+            Job job = m_jobs.front();
+            m_jobs.pop_front();
+            m_jobRunning = true;
+
+            lock.unlock();
+            job();
+            lock.lock();
+
+            m_jobRunning = false;
+        }
+
+        if (m_packetStates[m_readIndex] == PACKET_PENDING)
+        {
+            GLuint packetIndex = m_readIndex;
+            m_packetStates[packetIndex] = PACKET_EXECUTING;
+
+            lock.unlock();
+            m_executePacket(m_packets[packetIndex]);
+            lock.lock();
+
+            m_packetStates[packetIndex] = PACKET_FREE;
+            m_readIndex = (m_readIndex + 1) % PACKET_COUNT;
+            m_cond.notify_all();
+            continue;
+        }
+
+        m_cond.notify_all();
+        if (m_quit)
+            break;
+    }
+    lock.unlock();
+
+    m_window->makeContextCurrent(false);
+}
@@ -0,0 +1,85 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef  _RENDERTHREAD_H
+#define  _RENDERTHREAD_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <GL/glew.h>
+#include "RenderPacket.h"
+
+class BaseWindow;
+
+//-----------------------------------------------------------------------------
+// RenderThread - owns the GL context while it runs and executes the frame
+// packets recorded by the main thread. There are PACKET_COUNT packets so the
+// main thread records frame N + 1 while frame N is being submitted to GL.
+// GL work that isn't part of a frame (creating textures, buffers...) has to be
+// queued with EnqueueJob(), jobs run before the next packet.
+//-----------------------------------------------------------------------------
+class RenderThread
+{
+public:
+    typedef std::function<void (const RenderPacket&)> ExecuteFunc;
+    typedef std::function<void ()> Job;
+
+    static const GLuint PACKET_COUNT = 2;
+
+    RenderThread();
+    ~RenderThread();
+
+    bool Start(BaseWindow* window, const ExecuteFunc& executePacket);
+    void Stop ();
+    bool IsRunning() const;
+
+    RenderPacket& BeginPacket ();
+    void          SubmitPacket();
+    void          EnqueueJob  (const Job& job);
+    void          WaitIdle    ();
+
+private:
+    enum PacketState{PACKET_FREE, PACKET_PENDING, PACKET_EXECUTING};
+
+    void ThreadLoop();
+    bool IsIdle    () const;
+
+    BaseWindow* m_window;
+    ExecuteFunc m_executePacket;
+
+    std::thread             m_thread;
+    std::mutex              m_mutex;
+    std::condition_variable m_cond;
+    bool                    m_running;
+    bool                    m_quit;
+
+    RenderPacket m_packets[PACKET_COUNT];
+    PacketState  m_packetStates[PACKET_COUNT];
+    GLuint       m_writeIndex;
+    GLuint       m_readIndex;
+
+    std::deque<Job> m_jobs;
+    bool            m_jobRunning;
+};
+
+#endif  //_RENDERTHREAD_H
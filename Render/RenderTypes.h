@@ -23,6 +23,8 @@
 #include<string>
 #include<vector>
 #include<algorithm>
+#include<limits>
+#include<cmath>
 #include<GL/glew.h>
 #include<glm/glm.hpp>
 
@@ -155,6 +157,41 @@ struct Material
     }
 };
 
+// half open range [begin, end) of items that changed since it was cleared
+struct DirtyRange
+{
+    DirtyRange()
+        :begin(0), end(0)
+    {}
+
+    void Mark(GLuint index)
+    {
+        if (IsEmpty())
+        {
+            begin = index;
+            end = index + 1;
+        }
+        else
+        {
+            begin = std::min(begin, index);
+            end = std::max(end, index + 1);
+        }
+    }
+
+    void Clear()
+    {
+        begin = end = 0;
+    }
+
+    bool IsEmpty() const
+    {
+        return begin == end;
+    }
+
+    GLuint begin;
+    GLuint end;
+};
+
 struct Attribute
 {
     std::string  texIndex;
@@ -168,6 +205,182 @@ struct Attribute
     }
 };
 
+struct UploadStatus;
+
+// an Attribute with its paths resolved to GL objects, built once when the
+// attribute is created so drawing never hashes or compares strings
+struct ResolvedAttribute
+{
+    GLuint program;
+    GLuint texture;
+    GLuint sampler;
+    GLuint matIndex;
+    GLint  texturedLoc;
+    GLint  materialIndexLoc;
+    // the texture is drawn untextured until its upload is ready
+    const UploadStatus* textureUpload;
+};
+
+// axis aligned bounding box, starts empty so points can be added to it
+struct AABB
+{
+    AABB()
+        :min(std::numeric_limits<float>::max()),
+         max(-std::numeric_limits<float>::max())
+    {}
+
+    AABB(const glm::vec3& _min, const glm::vec3& _max)
+        :min(_min), max(_max)
+    {}
+
+    void AddPoint(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void AddAABB(const AABB& box)
+    {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+
+    bool IsEmpty() const
+    {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    glm::vec3 GetCenter() const
+    {
+        return (min + max) * 0.5f;
+    }
+
+    glm::vec3 GetExtents() const
+    {
+        return (max - min) * 0.5f;
+    }
+
+    // box that bounds this box after it was transformed by mat
+    AABB Transform(const glm::mat4x4& mat) const
+    {
+        if (IsEmpty())
+            return *this;
+
+        glm::vec3 center = glm::vec3(mat * glm::vec4(GetCenter(), 1.0f));
+        glm::vec3 extents = GetExtents();
+        glm::vec3 newExtents;
+        for (int i = 0; i < 3; i++)
+            newExtents[i] = std::abs(mat[0][i]) * extents.x + std::abs(mat[1][i]) * extents.y + std::abs(mat[2][i]) * extents.z;
+
+        return AABB(center - newExtents, center + newExtents);
+    }
+
+    float GetSurfaceArea() const
+    {
+        if (IsEmpty())
+            return 0.0f;
+
+        glm::vec3 size = max - min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    // slab test, invDir is 1 / ray direction, tNear is set to the entry distance
+    bool IntersectRay(const glm::vec3& origin, const glm::vec3& invDir, float maxDist, float& tNear) const
+    {
+        tNear = 0.0f;
+        float tFar = maxDist;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float t0 = (min[axis] - origin[axis]) * invDir[axis];
+            float t1 = (max[axis] - origin[axis]) * invDir[axis];
+            if (t0 > t1)
+                std::swap(t0, t1);
+
+            // a ray running along a face of the box gives 0 * inf = NaN, the
+            // comparisons fail for NaN so that axis doesn't clip the ray
+            if (t0 > tNear)
+                tNear = t0;
+            if (t1 < tFar)
+                tFar = t1;
+        }
+
+        return tNear <= tFar;
+    }
+
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+struct BoundingSphere
+{
+    BoundingSphere()
+        :center(0.0f, 0.0f, 0.0f), radius(0.0f)
+    {}
+
+    BoundingSphere(const glm::vec3& _center, float _radius)
+        :center(_center), radius(_radius)
+    {}
+
+    glm::vec3 center;
+    float radius;
+};
+
+// nearest ray hit on a mesh, distance is in units of the ray direction length
+struct RayHit
+{
+    RayHit()
+        :distance(std::numeric_limits<float>::max()), faceIndex(0), subMeshIndex(0), barycentric(0.0f, 0.0f)
+    {}
+
+    float     distance;
+    GLuint    faceIndex;
+    GLuint    subMeshIndex;
+    glm::vec2 barycentric;
+};
+
+// per instance data of an instanced draw, read by objectShader4.vs as two
+// mat4 vertex attributes starting at INSTANCE_ATTRIB_LOCATION
+struct InstanceData
+{
+    glm::mat4x4 world;
+    glm::mat4x4 worldInverseT;
+};
+
+// the record glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;
+};
+
+// per frame constants, matches the std140 FrameBlock in objectShader4
+struct FrameUniforms
+{
+    glm::mat4x4 view;
+    glm::mat4x4 proj;
+    glm::mat4x4 viewProj;
+    glm::vec4   eye;
+};
+
+// per object constants, matches the std140 ObjectBlock in objectShader4
+struct ObjectUniforms
+{
+    glm::mat4x4 world;
+    glm::mat4x4 worldInverseT;
+};
+
+// uniform buffer binding points shared by all the shaders
+enum UniformBinding
+{
+    UB_MATERIAL = 0,
+    UB_LIGHT,
+    UB_FRAME,
+    UB_OBJECT
+};
+
 //-----------------------------------------------------------------------------
 // Common render consts
 //-----------------------------------------------------------------------------
@@ -175,5 +388,6 @@ const Rect EMPTY_RECT(0,0,0,0);
 const glm::vec4 WHITE_COLOR(1.0f, 1.0f, 1.0f, 1.0f);
 const Material WHITE_MATERIAL(WHITE_COLOR, WHITE_COLOR, WHITE_COLOR, WHITE_COLOR, 1.0f);
 const GLuint NO_TEXTURE = 0;
+const GLuint INSTANCE_ATTRIB_LOCATION = 3;
 
 #endif // _RENDERTYPES_H
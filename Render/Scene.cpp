@@ -19,8 +19,13 @@
 //
 
 #include "Scene.h"
+#include "GLThread.h"
+#include <cassert>
 
 const std::string Scene::s_meshShaderPath2 = "data/shaders/objectShader4";
+const std::string Scene::s_instancedDefines = "#define INSTANCED\n";
+const float Scene::s_lodPixelError = 1.0f;
+const float Scene::s_lodHysteresis = 0.1f;
 //-----------------------------------------------------------------------------
 // Name : Scene (constructor)
 //-----------------------------------------------------------------------------
@@ -34,6 +39,15 @@ Scene::Scene()
     
     m_curObj = nullptr;
     m_status = "";
+
+    m_drawCallCount = 0;
+    m_visibleObjectCount = 0;
+    m_culledObjectCount = 0;
+    m_indexedObjectCount = 0;
+    m_instancedShader = nullptr;
+    m_instanceBuffer = 0;
+    m_useIndirectDraw = false;
+    m_indirectBuffer = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -41,11 +55,14 @@ Scene::Scene()
 //-----------------------------------------------------------------------------
 Scene::~Scene()
 {
-    if ( m_ubMaterial != 0)
-        glDeleteBuffers(1, &m_ubMaterial );
-    
     if ( m_ubLight != 0)
         glDeleteBuffers(1, &m_ubLight );
+
+    if ( m_instanceBuffer != 0)
+        glDeleteBuffers(1, &m_instanceBuffer );
+
+    if ( m_indirectBuffer != 0)
+        glDeleteBuffers(1, &m_indirectBuffer );
 }
 
 //-----------------------------------------------------------------------------
@@ -54,18 +71,16 @@ Scene::~Scene()
 void Scene::InitScene(int width, int height, const glm::vec3& cameraPosition/* = glm::vec3(0.0f, 20.0f, 70.0f)*/, const glm::vec3& cameraLookat/* = glm::vec3(0.0f, 0.0f, 0.0f)*/)
 {
     meshShader =  m_assetManager.getShader( s_meshShaderPath2 );
+    BindUniformBlocks(meshShader->Program);
 
-    m_projectionLoc = glGetUniformLocation(meshShader->Program, "projection");
-    m_matWorldLoc = glGetUniformLocation(meshShader->Program, "matWorld");
-    m_matWorldInverseLoc = glGetUniformLocation(meshShader->Program, "matWorldInverseT");
+    // Init the material table, the materials are uploaded with the first frame
+    m_materialTable.Init();
 
-    // Init the material unifrom buffer
-    m_ubMaterialIndex = glGetUniformBlockIndex(meshShader->Program, "Material");
-    glGenBuffers(1, &m_ubMaterial );
-    glBindBufferBase(GL_UNIFORM_BUFFER, m_ubMaterialIndex, m_ubMaterial );
-    glUniformBlockBinding(meshShader->Program, m_ubMaterialIndex, m_ubMaterialIndex );
+    // room for the frame constants and a few hundred objects, grows when needed
+    m_uniformRing.Init(64 * 1024);
 
     InitLights();
+    InitInstancing();
     InitObjects();
     InitCamera(width ,height, cameraPosition, cameraLookat);
 }
@@ -94,10 +109,8 @@ void Scene::InitLights()
     m_light[0].pos = glm::vec3(0.0f, 0.0f, 0.0f);
     m_nActiveLights++;
 
-    m_ubLightIndex = glGetUniformBlockIndex(meshShader->Program, "lightBlock");
     glGenBuffers(1, &m_ubLight );
-    glBindBufferBase(GL_UNIFORM_BUFFER, m_ubLightIndex, m_ubLight );
-    glUniformBlockBinding(meshShader->Program, m_ubLightIndex, m_ubLightIndex );
+    glBindBufferBase(GL_UNIFORM_BUFFER, UB_LIGHT, m_ubLight );
 
     glBindBuffer(GL_UNIFORM_BUFFER, m_ubLight );
     glBufferData(GL_UNIFORM_BUFFER, sizeof(LIGHT_PREFS) * m_nActiveLights, m_light, GL_STATIC_DRAW);
@@ -106,6 +119,46 @@ void Scene::InitLights()
     glUniform1i(glGetUniformLocation(meshShader->Program, "nActiveLights"), m_nActiveLights );
 }
 
+//-----------------------------------------------------------------------------
+// Name : InitInstancing()
+//-----------------------------------------------------------------------------
+void Scene::InitInstancing()
+{
+    m_instancedShader = m_assetManager.getShader(s_meshShaderPath2, s_instancedDefines);
+    GLuint program = m_instancedShader->Program;
+
+    m_instancedTexturedLoc = glGetUniformLocation(program, "textured");
+    m_instancedMaterialIndexLoc = glGetUniformLocation(program, "materialIndex");
+    BindUniformBlocks(program);
+
+    m_instancedShader->Use();
+    glUniform1i(glGetUniformLocation(program, "nActiveLights"), m_nActiveLights );
+
+    glGenBuffers(1, &m_instanceBuffer );
+
+    // multi draw indirect needs baseInstance to offset the instance attributes
+    m_useIndirectDraw = GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+    if (m_useIndirectDraw)
+        glGenBuffers(1, &m_indirectBuffer );
+}
+
+//-----------------------------------------------------------------------------
+// Name : BindUniformBlocks()
+// Desc : binds the program uniform blocks to the shared binding points
+//-----------------------------------------------------------------------------
+void Scene::BindUniformBlocks(GLuint program)
+{
+    const char* blockNames[] = {"Material", "lightBlock", "FrameBlock", "ObjectBlock"};
+    const GLuint bindings[] = {UB_MATERIAL, UB_LIGHT, UB_FRAME, UB_OBJECT};
+
+    for (GLuint i = 0; i < 4; i++)
+    {
+        GLuint blockIndex = glGetUniformBlockIndex(program, blockNames[i]);
+        if (blockIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, blockIndex, bindings[i]);
+    }
+}
+
 //-----------------------------------------------------------------------------
 // Name : InitObjects ()
 //-----------------------------------------------------------------------------
@@ -134,13 +187,6 @@ void Scene::InitObjects()
     GLuint m_blackAttribute = m_assetManager.getAttribute("", GL_REPEAT ,black, s_meshShaderPath2 );
        
     
-    m_objects.emplace_back(m_assetManager,
-                           glm::vec3(18.5f, -0.5f, 0.0f), // position
-                           glm::vec3(0.0f, 0.0f, 0.0f),   // rotation
-                           glm::vec3(2.0f, 2.0f, 2.0f),   // scale
-                           m_assetManager.getMesh("data/models/knight.obj"),
-                           s_meshShaderPath2 );
-    
     std::vector<unsigned int> blackAttribute;
     blackAttribute.push_back(m_blackAttribute);
     //blackAttribute.push_back(m_blackAttribute);
@@ -148,7 +194,11 @@ void Scene::InitObjects()
     blackAttribute.push_back(m_redAttribute);
     blackAttribute.push_back(m_redAttribute);
     
-    m_objects[m_objects.size() - 1].SetObjectAttributes(blackAttribute);
+    AddObjectAsync("data/models/knight.obj",
+                   glm::vec3(18.5f, -0.5f, 0.0f), // position
+                   glm::vec3(0.0f, 0.0f, 0.0f),   // rotation
+                   glm::vec3(2.0f, 2.0f, 2.0f),   // scale
+                   s_meshShaderPath2, blackAttribute);
 
     m_curObj = &m_objects[0];
 
@@ -161,77 +211,631 @@ void Scene::InitObjects()
     
 }
 
+//-----------------------------------------------------------------------------
+// Name : AddObjectAsync ()
+//-----------------------------------------------------------------------------
+void Scene::AddObjectAsync(const std::string& meshPath, const glm::vec3& pos, const glm::vec3& angle, const glm::vec3& scale,
+                           const std::string& shaderPath, std::vector<unsigned int> attributes/* = std::vector<unsigned int>()*/)
+{
+    PendingObject pending;
+    pending.mesh = m_assetManager.getMeshAsync(meshPath);
+    pending.pos = pos;
+    pending.angle = angle;
+    pending.scale = scale;
+    pending.shaderPath = shaderPath;
+    pending.attributes = std::move(attributes);
+
+    m_pendingObjects.push_back(std::move(pending));
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddLoadedObjects ()
+// Desc : adds the pending objects whose mesh is done, a mesh that failed to
+//        load is replaced by the same fallback getMesh returns
+//-----------------------------------------------------------------------------
+void Scene::AddLoadedObjects()
+{
+    if (m_pendingObjects.empty())
+        return;
+
+    // m_objects can be reallocated
+    std::ptrdiff_t curObjIndex = (m_curObj != nullptr) ? m_curObj - m_objects.data() : -1;
+
+    auto it = m_pendingObjects.begin();
+    while (it != m_pendingObjects.end())
+    {
+        if (!it->mesh.IsDone())
+        {
+            ++it;
+            continue;
+        }
+
+        // given attributes don't need the textures of the mesh
+        if (it->attributes.empty())
+            m_objects.emplace_back(m_assetManager, it->pos, it->angle, it->scale, it->mesh.Get(), it->shaderPath);
+        else
+            m_objects.emplace_back(it->pos, it->angle, it->scale, it->mesh.Get(), std::move(it->attributes));
+
+        it = m_pendingObjects.erase(it);
+    }
+
+    if (curObjIndex >= 0)
+        m_curObj = &m_objects[curObjIndex];
+}
+
 //-----------------------------------------------------------------------------
 // Name : Darwing ()
 //-----------------------------------------------------------------------------
 void Scene::Drawing(double frameTimeDelta)
 {
-    //clear m_lastUsedAttrib
-    m_lastUsedAttrib.matIndex = -1;
-    // space used for the path as no valid path should include only a space
-    m_lastUsedAttrib.shaderIndex = " ";
-    m_lastUsedAttrib.texIndex = " ";
+    BuildFramePacket(m_framePacket);
+    SubmitFramePacket(m_framePacket);
+}
 
-    // sets the camera position in the shader
-    // TODO: this call should only happen if the camera had moved since previous frame
-    // should add a flag to represent that.
-    meshShader->Use();
-    glm::vec3 eye = m_camera.GetPosition();
-    glUniform3f(glGetUniformLocation(meshShader->Program, "vecEye"), eye.x, eye.y, eye.z);
+//-----------------------------------------------------------------------------
+// Name : BuildFramePacket ()
+// Desc : records the draw commands of the visible objects, doesn't make any
+//        GL calls so it can run while the render thread submits the last frame
+//-----------------------------------------------------------------------------
+void Scene::BuildFramePacket(ScenePacket& packet)
+{
+    packet.Clear();
 
-    auto attribVector = m_assetManager.getAttributeVector();
+    // the loads of the scene assets are added to its caches here since this
+    // is the thread that owns the asset manager
+    m_assetManager.completeAsyncLoads();
+    AddLoadedObjects();
 
     //TODO: optmize this in the camera class
-    glm::mat4x4 temp = m_camera.GetViewMatrix();
-    glm::mat4x4 projViewMat = m_camera.GetProjMatrix() * m_camera.GetViewMatrix();
-    for (GLuint i = 0; i < attribVector.size(); i++)
+    packet.frame.view = m_camera.GetViewMatrix();
+    packet.frame.proj = m_camera.GetProjMatrix();
+    packet.frame.viewProj = packet.frame.proj * packet.frame.view;
+    packet.frame.eye = glm::vec4(m_camera.GetPosition(), 1.0f);
+
+    BuildRenderQueue();
+    m_renderQueue.Sort();
+    BuildDrawBatches();
+
+    const std::vector<ResolvedAttribute>& resolvedAttribs = m_assetManager.getResolvedAttributeVector();
+    GLuint lastAttribIndex = -1;
+
+    for (const DrawBatch& batch : m_drawBatches)
     {
-        SetAttribute(attribVector[i]);
-        for (Object& obj : m_objects)
+        const RenderItem& item = *batch.item;
+
+        // the queue is sorted by render state so this only happens on a state change
+        if (item.attribIndex != lastAttribIndex)
+        {
+            packet.states.push_back(resolvedAttribs[item.attribIndex]);
+            lastAttribIndex = item.attribIndex;
+        }
+
+        DrawCommand command;
+        command.mesh = item.object->GetMesh();
+        command.subMeshIndex = item.subMeshIndex;
+        command.lod = item.object->GetLodLevel();
+        command.stateIndex = packet.states.size() - 1;
+        command.instanceCount = batch.instanceCount;
+
+        if (batch.instanceCount > 1)
+            command.firstInstance = batch.firstInstance;
+        else
         {
-            obj.Draw( m_projectionLoc, m_matWorldLoc, m_matWorldInverseLoc, i, projViewMat);
+            command.firstInstance = packet.objects.size();
+            packet.objects.push_back({GetDrawWorldMatrix(item.object, item.subMeshIndex), item.object->GetInverseTransposeWorldMatrix()});
         }
+
+        packet.commands.push_back(command);
+    }
+
+    packet.instances.assign(m_instanceData.begin(), m_instanceData.end());
+
+    // only the materials that were added or edited are sent to the table
+    const DirtyRange& dirtyMaterials = m_assetManager.getMaterialDirtyRange();
+    if (!dirtyMaterials.IsEmpty())
+    {
+        const std::vector<Material>& materials = m_assetManager.getMaterialVector();
+        packet.firstMaterial = dirtyMaterials.begin;
+        packet.materials.assign(materials.begin() + dirtyMaterials.begin, materials.begin() + dirtyMaterials.end);
+        m_assetManager.clearMaterialDirtyRange();
     }
 }
 
-//TODO: searching each time for pointers is slow
-//      consider saving them with the attribute indexes
 //-----------------------------------------------------------------------------
-// Name : SetAttribute ()
+// Name : SubmitFramePacket ()
+// Desc : issues the GL calls for a packet made by BuildFramePacket
 //-----------------------------------------------------------------------------
-void Scene::SetAttribute(Attribute &attrib)
+void Scene::SubmitFramePacket(const ScenePacket& packet)
 {
-    // set the attributes that have changed
-    // this check might be too cotly as this is in the render loop
-    if (attrib.shaderIndex != m_lastUsedAttrib.shaderIndex)
+    assert(GLThread::IsCurrent());
+    m_assetManager.processAsyncLoads();
+    m_materialTable.Upload(packet.firstMaterial, packet.materials.data(), packet.materials.size());
+    if (m_useIndirectDraw)
+        UploadIndirectCommands(packet);
+    else
+        UploadInstanceData(packet.instances);
+    // the draws would read offsets that were never written
+    if (!UploadUniforms(packet))
     {
-        m_assetManager.getShader(attrib.shaderIndex)->Use();
-    }       
-    
-    if (attrib.texIndex != m_lastUsedAttrib.texIndex)
+        m_drawCallCount = 0;
+        return;
+    }
+
+    const ResolvedAttribute* lastState = nullptr;
+    bool instancedShaderBound = false;
+    // the indirect draws read every instance relative to the start of the buffer
+    bool instanceBufferAtStart = false;
+
+    // every mesh lives in the arena so a VAO is only bound when the vertex format changes
+    GeometryArena& arena = GeometryArena::Get();
+    GLint boundFormat = -1;
+
+    // an indirect batch is a single draw call for all of its commands
+    GLuint drawCallCount = 0;
+    GLuint commandIndex = 0;
+    while (commandIndex < packet.commands.size())
     {
-        
-        if (attrib.texIndex == "")
-            glUniform1i(glGetUniformLocation(m_assetManager.getShader(attrib.shaderIndex)->Program, "textured"), 0);
+        const DrawCommand& command = packet.commands[commandIndex];
+        const ResolvedAttribute& state = packet.states[command.stateIndex];
+        GeometryAllocation geometry = command.mesh->getSubMesh(command.subMeshIndex).GetGeometry(command.lod);
+        bool indirect = IsIndirectCommand(packet, command);
+        bool instanced = indirect || command.instanceCount > 1;
+
+        if (geometry.format != boundFormat)
+        {
+            arena.Bind(geometry.format);
+            boundFormat = geometry.format;
+            // the instance attributes are part of the VAO
+            instanceBufferAtStart = false;
+        }
+
+        if (&state != lastState || instanced != instancedShaderBound)
+        {
+            ApplyDrawState(state, instanced, lastState, instancedShaderBound != instanced);
+
+            lastState = &state;
+            instancedShaderBound = instanced;
+        }
+
+        if (indirect)
+        {
+            // the commands sharing the state, vertex format and index type
+            // are consecutive in the indirect buffer
+            GLuint runEnd = commandIndex + 1;
+            while (runEnd < packet.commands.size())
+            {
+                const DrawCommand& next = packet.commands[runEnd];
+                GeometryAllocation nextGeometry = next.mesh->getSubMesh(next.subMeshIndex).GetGeometry(next.lod);
+                if (next.stateIndex != command.stateIndex || nextGeometry.format != geometry.format ||
+                    nextGeometry.indexType != geometry.indexType)
+                {
+                    break;
+                }
+
+                runEnd++;
+            }
+
+            if (!instanceBufferAtStart)
+            {
+                arena.BindInstanceBuffer(m_instanceBuffer, 0);
+                instanceBufferAtStart = true;
+            }
+
+            glMultiDrawElementsIndirect(GL_TRIANGLES, geometry.indexType, (GLvoid*)(commandIndex * sizeof(DrawElementsIndirectCommand)),
+                                        runEnd - commandIndex, 0);
+            drawCallCount++;
+            commandIndex = runEnd;
+            continue;
+        }
+
+        if (instanced)
+        {
+            command.mesh->DrawInstanced(command.subMeshIndex, command.instanceCount, m_instanceBuffer, command.firstInstance, command.lod);
+            instanceBufferAtStart = false;
+        }
         else
         {
-            glBindTexture(GL_TEXTURE_2D, m_assetManager.getTexture(attrib.texIndex));
-            // set texture warp mode
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, attrib.wrapMode);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, attrib.wrapMode);
-            
-            glUniform1i(glGetUniformLocation(m_assetManager.getShader(attrib.shaderIndex)->Program, "textured"), 1);
+            m_uniformRing.BindRange(UB_OBJECT, m_objectUniformOffsets[command.firstInstance], sizeof(ObjectUniforms));
+            command.mesh->Draw(command.subMeshIndex, command.lod);
         }
+
+        drawCallCount++;
+        commandIndex++;
     }
-    
-    if (attrib.matIndex != m_lastUsedAttrib.matIndex)
+
+    m_drawCallCount = drawCallCount;
+
+    glBindVertexArray(0);
+    // the attribute samplers would override the sprite textures wrap mode
+    glBindSampler(0, 0);
+    m_uniformRing.EndFrame();
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsIndirectCommand ()
+// Desc : only the mesh shader has an instanced variant to read the per draw
+//        matrices from, commands using other shaders take the per draw path
+//-----------------------------------------------------------------------------
+bool Scene::IsIndirectCommand(const ScenePacket& packet, const DrawCommand& command) const
+{
+    return m_useIndirectDraw && packet.states[command.stateIndex].program == meshShader->Program;
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateAttributeKeys ()
+// Desc : attributes are never removed from the asset manager, so only the
+//        ones that were added since the last call need a key
+//-----------------------------------------------------------------------------
+void Scene::UpdateAttributeKeys()
+{
+    const std::vector<ResolvedAttribute>& resolvedAttribs = m_assetManager.getResolvedAttributeVector();
+
+    for (GLuint i = m_attribStateKeys.size(); i < resolvedAttribs.size(); i++)
     {
-        Material& mat = m_assetManager.getMaterial(attrib.matIndex);
-        glBindBuffer(GL_UNIFORM_BUFFER, m_ubMaterial );
-        glBufferData(GL_UNIFORM_BUFFER, sizeof(Material), &mat, GL_DYNAMIC_DRAW);
+        const ResolvedAttribute& attrib = resolvedAttribs[i];
+        m_attribStateKeys.push_back(RenderQueue::MakeStateKey(attrib.program, attrib.texture, attrib.matIndex));
     }
-    
-    m_lastUsedAttrib = attrib;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildRenderQueue ()
+// Desc : adds every visible (object, subMesh) pair to the render queue
+//-----------------------------------------------------------------------------
+void Scene::BuildRenderQueue()
+{
+    UpdateAttributeKeys();
+    m_renderQueue.Clear();
+
+    glm::vec3 eye = m_camera.GetPosition();
+    float invFarClip = 1.0f / m_camera.GetFarClip();
+    // pixels per world unit at distance 1
+    float pixelScale = m_camera.GetViewport().height / (2.0f * std::tan(glm::radians(m_camera.GetFOV()) * 0.5f));
+
+    // the spatial index only returns objects whose enlarged box is in the frustum
+    QueryFrustum(m_visibleObjects);
+    m_visibleObjectCount = 0;
+
+    for (Object* pObj : m_visibleObjects)
+    {
+        Object& obj = *pObj;
+        if (obj.IsObjectHidden())
+            continue;
+
+        // the sphere test is cheaper and rejects most of the objects, the box is tighter
+        const BoundingSphere& sphere = obj.GetWorldBoundingSphere();
+        const AABB& bounds = obj.GetWorldBounds();
+        if (!m_camera.SphereInFrustum(sphere.center, sphere.radius) ||
+            !m_camera.BoundsInFrustum(bounds.min, bounds.max))
+        {
+            continue;
+        }
+
+        m_visibleObjectCount++;
+        SelectLod(obj, eye, pixelScale);
+
+        const std::vector<unsigned int>& objAttributes = obj.GetObjectAttributes();
+        GLuint subMeshCount = std::min<GLuint>(objAttributes.size(), obj.GetMesh()->getSubMeshCount());
+        float depth = glm::length(obj.GetPosition() - eye) * invFarClip;
+
+        for (GLuint i = 0; i < subMeshCount; i++)
+        {
+            // objects made of several subMeshes can still be partly outside of the frustum
+            if (subMeshCount > 1)
+            {
+                BoundingSphere subMeshSphere = obj.GetSubMeshBoundingSphere(i);
+                if (!m_camera.SphereInFrustum(subMeshSphere.center, subMeshSphere.radius))
+                    continue;
+            }
+
+            // still streaming to the GPU
+            if (!obj.GetMesh()->getSubMesh(i).IsReady())
+                continue;
+
+            GLuint attribIndex = objAttributes[i];
+            m_renderQueue.Push(RenderQueue::MakeKey(m_attribStateKeys[attribIndex], depth), &obj, i, attribIndex);
+        }
+    }
+
+    m_culledObjectCount = m_objects.size() - m_visibleObjectCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SelectLod ()
+// Desc : picks the coarsest level of detail whose error covers at most
+//        s_lodPixelError pixels. Every level has a largest projected bounding
+//        sphere radius it can be used at, the object only changes level once
+//        the radius is s_lodHysteresis past that threshold so objects near it
+//        don't switch back and forth every frame.
+//-----------------------------------------------------------------------------
+void Scene::SelectLod(Object& obj, const glm::vec3& eye, float pixelScale)
+{
+    const Mesh* mesh = obj.GetMesh();
+    GLuint lodCount = mesh->GetLodCount();
+    if (lodCount == 1)
+    {
+        obj.SetLodLevel(0);
+        return;
+    }
+
+    const BoundingSphere& sphere = obj.GetWorldBoundingSphere();
+    float distance = glm::length(sphere.center - eye);
+    if (distance <= sphere.radius)
+    {
+        obj.SetLodLevel(0);
+        return;
+    }
+
+    float projectedRadius = sphere.radius * pixelScale / distance;
+    float meshRadius = mesh->GetBoundingSphere().radius;
+
+    // the error scales with the object like its bounding sphere
+    auto maxRadius = [&](GLuint lod)
+    {
+        float error = mesh->GetLodError(lod);
+        if (error <= 0.0f)
+            return std::numeric_limits<float>::max();
+        return s_lodPixelError * meshRadius / error;
+    };
+
+    GLuint lod = std::min(obj.GetLodLevel(), lodCount - 1);
+    while (lod > 0 && projectedRadius > maxRadius(lod) * (1.0f + s_lodHysteresis))
+        lod--;
+    while (lod + 1 < lodCount && projectedRadius < maxRadius(lod + 1) * (1.0f - s_lodHysteresis))
+        lod++;
+
+    obj.SetLodLevel(lod);
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildDrawBatches ()
+// Desc : turns the sorted render queue into draw calls, items that share an
+//        attribute and a subMesh are merged into a single instanced draw
+//-----------------------------------------------------------------------------
+void Scene::BuildDrawBatches()
+{
+    const std::vector<ResolvedAttribute>& resolvedAttribs = m_assetManager.getResolvedAttributeVector();
+    const std::vector<RenderItem>& items = m_renderQueue.GetItems();
+
+    m_drawBatches.clear();
+    m_instanceData.clear();
+
+    GLuint runStart = 0;
+    while (runStart < items.size())
+    {
+        // find all the items that use the same attribute
+        GLuint runEnd = runStart + 1;
+        while (runEnd < items.size() && items[runEnd].attribIndex == items[runStart].attribIndex)
+            runEnd++;
+
+        // only the mesh shader has an instanced variant
+        if (runEnd - runStart >= s_minInstancedDraw &&
+            resolvedAttribs[items[runStart].attribIndex].program == meshShader->Program)
+        {
+            AddInstancedBatches(runStart, runEnd);
+        }
+        else
+        {
+            for (GLuint i = runStart; i < runEnd; i++)
+                m_drawBatches.emplace_back(&items[i], 0, 1);
+        }
+
+        runStart = runEnd;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddInstancedBatches ()
+// Desc : groups the items in [runStart, runEnd) by subMesh, all the items in
+//        the range are expected to share the same attribute
+//-----------------------------------------------------------------------------
+void Scene::AddInstancedBatches(GLuint runStart, GLuint runEnd)
+{
+    const std::vector<RenderItem>& items = m_renderQueue.GetItems();
+
+    m_batchScratch.clear();
+    for (GLuint i = runStart; i < runEnd; i++)
+        m_batchScratch.push_back(&items[i]);
+
+    // stable so every group keeps its front to back order
+    std::stable_sort(m_batchScratch.begin(), m_batchScratch.end(), [](const RenderItem* a, const RenderItem* b)
+    {
+        Mesh* meshA = a->object->GetMesh();
+        Mesh* meshB = b->object->GetMesh();
+        if (meshA != meshB)
+            return std::less<Mesh*>()(meshA, meshB);
+
+        if (a->subMeshIndex != b->subMeshIndex)
+            return a->subMeshIndex < b->subMeshIndex;
+
+        return a->object->GetLodLevel() < b->object->GetLodLevel();
+    });
+
+    GLuint groupStart = 0;
+    while (groupStart < m_batchScratch.size())
+    {
+        const RenderItem* first = m_batchScratch[groupStart];
+        GLuint groupEnd = groupStart + 1;
+        while (groupEnd < m_batchScratch.size() &&
+               m_batchScratch[groupEnd]->object->GetMesh() == first->object->GetMesh() &&
+               m_batchScratch[groupEnd]->subMeshIndex == first->subMeshIndex &&
+               m_batchScratch[groupEnd]->object->GetLodLevel() == first->object->GetLodLevel())
+        {
+            groupEnd++;
+        }
+
+        GLuint instanceCount = groupEnd - groupStart;
+        if (instanceCount >= s_minInstancedDraw)
+        {
+            m_drawBatches.emplace_back(first, m_instanceData.size(), instanceCount);
+            for (GLuint i = groupStart; i < groupEnd; i++)
+            {
+                Object* obj = m_batchScratch[i]->object;
+                m_instanceData.push_back({GetDrawWorldMatrix(obj, first->subMeshIndex), obj->GetInverseTransposeWorldMatrix()});
+            }
+        }
+        else
+            m_drawBatches.emplace_back(first, 0, 1);
+
+        groupStart = groupEnd;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetDrawWorldMatrix ()
+// Desc : the world matrix a subMesh of object is drawn with, quantized
+//        subMeshes have their position decode folded in. The normals are not
+//        quantized by position so the inverse transpose doesn't include it.
+//-----------------------------------------------------------------------------
+glm::mat4x4 Scene::GetDrawWorldMatrix(Object* object, GLuint subMeshIndex)
+{
+    const SubMesh& subMesh = object->GetMesh()->getSubMesh(subMeshIndex);
+    if (subMesh.GetVertexFormat() == VERTEX_FORMAT_QUANTIZED)
+        return object->GetWorldMatrix() * subMesh.GetDecodeMatrix();
+
+    return object->GetWorldMatrix();
+}
+
+//-----------------------------------------------------------------------------
+// Name : UploadInstanceData ()
+//-----------------------------------------------------------------------------
+void Scene::UploadInstanceData(const std::vector<InstanceData>& instanceData)
+{
+    if (instanceData.empty())
+        return;
+
+    // orphan the previous frame storage so the upload doesn't wait for the draws still using it
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer );
+    glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(InstanceData), instanceData.data(), GL_STREAM_DRAW);
+}
+
+//-----------------------------------------------------------------------------
+// Name : UploadIndirectCommands ()
+// Desc : writes a DrawElementsIndirectCommand for every command of the packet.
+//        The instance buffer holds the packet instances followed by the
+//        matrices of the single draws, baseInstance selects the draw matrices
+//        so the instanced shader can draw everything.
+//-----------------------------------------------------------------------------
+void Scene::UploadIndirectCommands(const ScenePacket& packet)
+{
+    GLuint singleDrawBase = packet.instances.size();
+    m_indirectInstances.assign(packet.instances.begin(), packet.instances.end());
+    for (const ObjectUniforms& object : packet.objects)
+        m_indirectInstances.push_back({object.world, object.worldInverseT});
+
+    m_indirectCommands.resize(packet.commands.size());
+    for (GLuint i = 0; i < packet.commands.size(); i++)
+    {
+        const DrawCommand& command = packet.commands[i];
+        GeometryAllocation geometry = command.mesh->getSubMesh(command.subMeshIndex).GetGeometry(command.lod);
+        DrawElementsIndirectCommand& indirect = m_indirectCommands[i];
+
+        indirect.count = geometry.indexCount;
+        indirect.firstIndex = geometry.firstIndex;
+        indirect.baseVertex = geometry.baseVertex;
+        if (command.instanceCount > 1)
+        {
+            indirect.instanceCount = command.instanceCount;
+            indirect.baseInstance = command.firstInstance;
+        }
+        else
+        {
+            indirect.instanceCount = 1;
+            indirect.baseInstance = singleDrawBase + command.firstInstance;
+        }
+    }
+
+    UploadInstanceData(m_indirectInstances);
+
+    if (m_indirectCommands.empty())
+        return;
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, m_indirectCommands.size() * sizeof(DrawElementsIndirectCommand),
+                 m_indirectCommands.data(), GL_STREAM_DRAW);
+}
+
+//-----------------------------------------------------------------------------
+// Name : UploadUniforms ()
+// Desc : writes the frame constants and the matrices of every non instanced
+//        draw command that isn't drawn indirectly to this frame segment of
+//        the uniform ring buffer, false if the segment couldn't be mapped
+//-----------------------------------------------------------------------------
+bool Scene::UploadUniforms(const ScenePacket& packet)
+{
+    GLuint objectCount = 0;
+    for (const DrawCommand& command : packet.commands)
+    {
+        if (command.instanceCount <= 1 && !IsIndirectCommand(packet, command))
+            objectCount++;
+    }
+
+    GLsizeiptr requiredSize = m_uniformRing.GetAlignedSize(sizeof(FrameUniforms)) +
+                              m_uniformRing.GetAlignedSize(sizeof(ObjectUniforms)) * objectCount;
+
+    m_objectUniformOffsets.resize(packet.objects.size());
+    if (!m_uniformRing.BeginFrame(requiredSize))
+    {
+        std::cout << "Failed to map the uniform ring buffer, the scene is not drawn this frame\n";
+        return false;
+    }
+
+    GLintptr frameOffset = m_uniformRing.Push(&packet.frame, sizeof(FrameUniforms));
+
+    for (const DrawCommand& command : packet.commands)
+    {
+        if (command.instanceCount <= 1 && !IsIndirectCommand(packet, command))
+            m_objectUniformOffsets[command.firstInstance] = m_uniformRing.Push(&packet.objects[command.firstInstance], sizeof(ObjectUniforms));
+    }
+
+    m_uniformRing.EndWrite();
+    m_uniformRing.BindRange(UB_FRAME, frameOffset, sizeof(FrameUniforms));
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ApplyDrawState ()
+// Desc : sets the parts of state that differ from lastState, shaderChanged
+//        forces the program and its uniforms to be set again. Instanced draws
+//        use the instanced variant of the program.
+//-----------------------------------------------------------------------------
+void Scene::ApplyDrawState(const ResolvedAttribute& state, bool instanced, const ResolvedAttribute* lastState, bool shaderChanged)
+{
+    GLuint program = state.program;
+    GLint texturedLoc = state.texturedLoc;
+    GLint materialIndexLoc = state.materialIndexLoc;
+    if (instanced)
+    {
+        program = m_instancedShader->Program;
+        texturedLoc = m_instancedTexturedLoc;
+        materialIndexLoc = m_instancedMaterialIndexLoc;
+    }
+
+    if (lastState == nullptr || lastState->program != state.program)
+        shaderChanged = true;
+
+    if (shaderChanged)
+        glUseProgram(program);
+
+    // the textured uniform is per program so it has to be set again on a shader change
+    if (shaderChanged || lastState->texture != state.texture || lastState->sampler != state.sampler)
+    {
+        // textures still streaming are replaced by the plain material
+        if (state.texture == NO_TEXTURE || (state.textureUpload && !state.textureUpload->IsReady()))
+            glUniform1i(texturedLoc, 0);
+        else
+        {
+            glBindTexture(GL_TEXTURE_2D, state.texture);
+            // the sampler holds the attribute wrap mode
+            glBindSampler(0, state.sampler);
+
+            glUniform1i(texturedLoc, 1);
+        }
+    }
+
+    // materialIndex is per program as well
+    if (shaderChanged || lastState->matIndex != state.matIndex)
+        glUniform1i(materialIndexLoc, m_materialTable.Bind(state.matIndex));
 }
 
 //-----------------------------------------------------------------------------
@@ -320,8 +924,8 @@ bool Scene::handleMouseEvent(MouseEvent event, const ModifierKeysStates &modifie
 
 //-----------------------------------------------------------------------------
 // Name : PickObject ()
+// Desc : returns the object nearest to the camera under the cursor
 //-----------------------------------------------------------------------------
-//TODO: make the picking process take the subMesh closes to camera first...
 Object* Scene::PickObject(Point &cursor, int& faceCount, int& meshIndex)
 {
     const glm::mat4x4& matPorj = m_camera.GetProjMatrix();
@@ -341,23 +945,156 @@ Object* Scene::PickObject(Point &cursor, int& faceCount, int& meshIndex)
 
     glm::vec3 rayOrigin(view[3][0], view[3][1], view [3][2]);
 
-    for (Object& obj : m_objects)
+    m_pickHit = RayHit();
+    Object* pickedObj = QueryRay(rayOrigin, rayDir, m_pickHit);
+
+    if (pickedObj)
     {
-        //if (!obj.IsObjectHidden())
-        {
-            glm::mat4x4 worldInverse = glm::inverse(obj.GetWorldMatrix());
-            glm::vec3 rayObjOrigin = worldInverse * glm::vec4(rayOrigin, 1.0f);
-            glm::vec3 rayObjDir = worldInverse * glm::vec4(rayDir, 0.0f);
+        faceCount = m_pickHit.faceIndex;
+        meshIndex = m_pickHit.subMeshIndex;
+        m_curObj = pickedObj;
+    }
 
-            if (obj.GetMesh()->IntersectTriangle(rayObjOrigin, rayObjDir, faceCount, meshIndex))
-            {
-                m_curObj = &obj;
-                return &obj;
-            }
-        }
+    return pickedObj;
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateSpatialIndex ()
+// Desc : adds proxies for new objects and updates the ones that moved
+//-----------------------------------------------------------------------------
+void Scene::UpdateSpatialIndex()
+{
+    // batch update the matrices of everything that moved before the bounds read them
+    Object::UpdateTransforms();
+
+    // objects with no mesh still get a point box so they can be found
+    auto indexBounds = [](Object& obj)
+    {
+        const AABB& bounds = obj.GetWorldBounds();
+        if (bounds.IsEmpty())
+            return AABB(obj.GetPosition(), obj.GetPosition());
+
+        return bounds;
+    };
+
+    // objects added since the last update, they are indexed by position in
+    // m_objects so reallocating the vector doesn't invalidate them
+    for (GLuint i = m_indexedObjectCount; i < m_objects.size(); i++)
+    {
+        m_objects[i].SetMoveBuffer(&m_movedObjects, i);
+        m_objects[i].SetProxyId(m_spatialIndex.CreateProxy(indexBounds(m_objects[i]), i));
     }
 
-    return nullptr;
+    m_indexedObjectCount = m_objects.size();
+
+    for (GLuint objIndex : m_movedObjects)
+    {
+        Object& obj = m_objects[objIndex];
+        obj.ClearMoved();
+        m_spatialIndex.MoveProxy(obj.GetProxyId(), indexBounds(obj));
+    }
+
+    m_movedObjects.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Name : QueryFrustum ()
+// Desc : objects whose enlarged bounds intersect the camera frustum
+//-----------------------------------------------------------------------------
+void Scene::QueryFrustum(std::vector<Object*>& objects)
+{
+    UpdateSpatialIndex();
+    objects.clear();
+
+    m_spatialIndex.Query([this](const AABB& box)
+    {
+        return m_camera.BoundsInFrustum(box.min, box.max);
+    },
+    [this, &objects](GLuint objIndex)
+    {
+        objects.push_back(&m_objects[objIndex]);
+    });
+}
+
+//-----------------------------------------------------------------------------
+// Name : QueryBox ()
+// Desc : objects whose world bounds overlap box
+//-----------------------------------------------------------------------------
+void Scene::QueryBox(const AABB& box, std::vector<Object*>& objects)
+{
+    UpdateSpatialIndex();
+    objects.clear();
+
+    auto overlaps = [&box](const AABB& other)
+    {
+        return other.min.x <= box.max.x && other.max.x >= box.min.x &&
+               other.min.y <= box.max.y && other.max.y >= box.min.y &&
+               other.min.z <= box.max.z && other.max.z >= box.min.z;
+    };
+
+    m_spatialIndex.Query(overlaps, [this, &objects, &overlaps](GLuint objIndex)
+    {
+        if (overlaps(m_objects[objIndex].GetWorldBounds()))
+            objects.push_back(&m_objects[objIndex]);
+    });
+}
+
+//-----------------------------------------------------------------------------
+// Name : QuerySphere ()
+// Desc : objects whose world bounds overlap the sphere
+//-----------------------------------------------------------------------------
+void Scene::QuerySphere(const glm::vec3& center, float radius, std::vector<Object*>& objects)
+{
+    UpdateSpatialIndex();
+    objects.clear();
+
+    float radiusSq = radius * radius;
+    auto overlaps = [&center, radiusSq](const AABB& box)
+    {
+        glm::vec3 closest = glm::clamp(center, box.min, box.max);
+        glm::vec3 diff = closest - center;
+        return glm::dot(diff, diff) <= radiusSq;
+    };
+
+    m_spatialIndex.Query(overlaps, [this, &objects, &overlaps](GLuint objIndex)
+    {
+        if (overlaps(m_objects[objIndex].GetWorldBounds()))
+            objects.push_back(&m_objects[objIndex]);
+    });
+}
+
+//-----------------------------------------------------------------------------
+// Name : QueryRay ()
+// Desc : returns the object with the nearest triangle hit by the ray
+//        the ray is transformed by an affine matrix so the hit distance is the
+//        same in object and world space and can be compared between objects
+//-----------------------------------------------------------------------------
+Object* Scene::QueryRay(const glm::vec3& origin, const glm::vec3& dir, RayHit& hit)
+{
+    UpdateSpatialIndex();
+
+    Object* hitObj = nullptr;
+    glm::vec3 invDir = 1.0f / dir;
+
+    m_spatialIndex.RayCast(origin, dir, hit.distance, [&](GLuint objIndex, float maxDist)
+    {
+        Object& obj = m_objects[objIndex];
+
+        float tNear;
+        if (!obj.GetWorldBounds().IntersectRay(origin, invDir, maxDist, tNear))
+            return maxDist;
+
+        glm::mat4x4 worldInverse = obj.GetInverseWorldMatrix();
+        glm::vec3 rayObjOrigin = worldInverse * glm::vec4(origin, 1.0f);
+        glm::vec3 rayObjDir = worldInverse * glm::vec4(dir, 0.0f);
+
+        if (obj.GetMesh() && obj.GetMesh()->IntersectTriangle(rayObjOrigin, rayObjDir, hit))
+            hitObj = &obj;
+
+        return hit.distance;
+    });
+
+    return hitObj;
 }
 
 //-----------------------------------------------------------------------------
@@ -376,6 +1113,44 @@ int Scene::getFaceCount()
     return m_faceCount;
 }
 
+//-----------------------------------------------------------------------------
+// Name : getPickHit ()
+// Desc : distance, face and barycentric coordinates of the last pick
+//-----------------------------------------------------------------------------
+const RayHit& Scene::getPickHit()
+{
+    return m_pickHit;
+}
+
+//-----------------------------------------------------------------------------
+// Name : getDrawCallCount ()
+// Desc : number of draw calls issued for the objects in the last submitted
+//        frame, counted on the thread that submits it
+//-----------------------------------------------------------------------------
+GLuint Scene::getDrawCallCount()
+{
+    return m_drawCallCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : getVisibleObjectCount ()
+// Desc : number of objects that passed frustum culling in the last frame
+//-----------------------------------------------------------------------------
+GLuint Scene::getVisibleObjectCount()
+{
+    return m_visibleObjectCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : getCulledObjectCount ()
+// Desc : number of objects that were hidden or outside of the frustum in the
+//        last frame
+//-----------------------------------------------------------------------------
+GLuint Scene::getCulledObjectCount()
+{
+    return m_culledObjectCount;
+}
+
 //-----------------------------------------------------------------------------
 // Name : getMeshIndex ()
 //-----------------------------------------------------------------------------
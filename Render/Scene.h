@@ -21,9 +21,15 @@
 #define  _SCENE_H
 
 #include <vector>
+#include <atomic>
 #include "../AssetLoading/AssetManager.h"
 #include "Camera/FreeCam.h"
 #include "Object.h"
+#include "RenderQueue.h"
+#include "RenderPacket.h"
+#include "UniformRingBuffer.h"
+#include "MaterialTable.h"
+#include "DynamicAABBTree.h"
 #include "../Input/input.h"
 #include "../Input/mouseEventsGame.h"
 
@@ -76,21 +82,53 @@ public:
 
     virtual void InitScene(int width, int height, const glm::vec3& cameraPosition = glm::vec3(0.0f, 20.0f, 70.0f), const glm::vec3& cameraLookat = glm::vec3(0.0f, 0.0f, 0.0f));
     virtual void InitObjects();
+    // the mesh is loaded on the asset manager workers and the object is added
+    // by the first frame after it is done. When attributes is empty the mesh
+    // attributes are made then, which can load its textures
+    void AddObjectAsync(const std::string& meshPath, const glm::vec3& pos, const glm::vec3& angle, const glm::vec3& scale,
+                        const std::string& shaderPath, std::vector<unsigned int> attributes = std::vector<unsigned int>());
+    void AddLoadedObjects();
+    void InitInstancing();
+    void UpdateAttributeKeys();
+    void BuildRenderQueue();
+    void SelectLod(Object& obj, const glm::vec3& eye, float pixelScale);
+    void BuildDrawBatches();
+    void AddInstancedBatches(GLuint runStart, GLuint runEnd);
+    void UploadInstanceData(const std::vector<InstanceData>& instanceData);
+    bool UploadUniforms(const ScenePacket& packet);
+    void UploadIndirectCommands(const ScenePacket& packet);
+    void UpdateSpatialIndex();
+    void BindUniformBlocks(GLuint program);
     void InitCamera(int width, int height, const glm::vec3& position, const glm::vec3& lookat);
     void InitLights();
 
     virtual void Drawing(double frameTimeDelta);
-    void SetAttribute(Attribute& attrib);
+    // BuildFramePacket makes no GL calls, SubmitFramePacket must run on the thread owning the context
+    void BuildFramePacket(ScenePacket& packet);
+    void SubmitFramePacket(const ScenePacket& packet);
+    void ApplyDrawState(const ResolvedAttribute& state, bool instanced, const ResolvedAttribute* lastState, bool shaderChanged);
+    bool IsIndirectCommand(const ScenePacket& packet, const DrawCommand& command) const;
+    glm::mat4x4 GetDrawWorldMatrix(Object* object, GLuint subMeshIndex);
 
     void reshape(int width, int height);
     void processInput (double timeDelta, bool keysStatus[], float X, float Y);
     virtual bool handleMouseEvent(MouseEvent event, const ModifierKeysStates &modifierStates);
 
     virtual Object *PickObject(Point& cursor, int& faceCount, int &meshIndex);
+
+    // spatial queries, the returned pointers are valid until objects are added
+    void    QueryFrustum(std::vector<Object*>& objects);
+    void    QueryBox    (const AABB& box, std::vector<Object*>& objects);
+    void    QuerySphere (const glm::vec3& center, float radius, std::vector<Object*>& objects);
+    Object* QueryRay    (const glm::vec3& origin, const glm::vec3& dir, RayHit& hit);
     Object& GetObject(int objIndex);
     
     int getFaceCount();
     int getMeshIndex();
+    const RayHit& getPickHit();
+    GLuint getDrawCallCount();
+    GLuint getVisibleObjectCount();
+    GLuint getCulledObjectCount();
     
     std::string& getStatus()
     {
@@ -101,29 +139,79 @@ public:
 protected:
     std::vector<Object> m_objects;
     AssetManager m_assetManager;
+
+    // objects whose mesh is still loading
+    struct PendingObject
+    {
+        MeshHandle mesh;
+        glm::vec3 pos;
+        glm::vec3 angle;
+        glm::vec3 scale;
+        std::string shaderPath;
+        std::vector<unsigned int> attributes;
+    };
+    std::vector<PendingObject> m_pendingObjects;
     static const std::string s_meshShaderPath2;
+    static const std::string s_instancedDefines;
+    // the least amount of objects sharing a subMesh and attribute that are drawn instanced
+    static const GLuint s_minInstancedDraw = 2;
+    // the largest error in pixels a level of detail may have on screen and
+    // how far past its threshold the projected size must go to change level
+    static const float s_lodPixelError;
+    static const float s_lodHysteresis;
     Object* m_curObj;
     
     FreeCam m_camera;
     int m_faceCount;
     int m_meshIndex;
+    RayHit m_pickHit;
     
     Shader* meshShader;
-    // cache for unifrom variable location
-    GLuint m_projectionLoc;
-    GLuint m_matWorldLoc;
-    GLuint m_matWorldInverseLoc;
-    GLuint m_vecEyeLoc;
 
-    GLuint m_ubMaterialIndex;
-    GLuint m_ubMaterial;
+    // every material of m_assetManager, draws only select an index
+    MaterialTable m_materialTable;
 
     LIGHT_PREFS m_light[4];
     int m_nActiveLights;
-    GLuint m_ubLightIndex;
     GLuint m_ubLight;
 
-    Attribute m_lastUsedAttrib;
+    // frame and object constants, every frame writes to its own fenced segment
+    UniformRingBuffer m_uniformRing;
+    // ObjectBlock offset in m_uniformRing for every draw batch
+    std::vector<GLintptr> m_objectUniformOffsets;
+
+    RenderQueue m_renderQueue;
+    // render state part of the sort key for every attribute in the asset manager
+    std::vector<uint64_t> m_attribStateKeys;
+
+    std::vector<DrawBatch> m_drawBatches;
+    std::vector<const RenderItem*> m_batchScratch;
+    std::vector<InstanceData> m_instanceData;
+    // written by SubmitFramePacket, which can run on the render thread
+    std::atomic<GLuint> m_drawCallCount;
+    GLuint m_visibleObjectCount;
+    GLuint m_culledObjectCount;
+
+    Shader* m_instancedShader;
+    GLint  m_instancedTexturedLoc;
+    GLint  m_instancedMaterialIndexLoc;
+    GLuint m_instanceBuffer;
+
+    // GL 4.3 path, each run of commands sharing a state is one glMultiDrawElementsIndirect
+    bool m_useIndirectDraw;
+    GLuint m_indirectBuffer;
+    std::vector<DrawElementsIndirectCommand> m_indirectCommands;
+    std::vector<InstanceData> m_indirectInstances;
+    
+    // tree over the objects world bounds, objects that moved since the last
+    // update are in m_movedObjects
+    DynamicAABBTree m_spatialIndex;
+    std::vector<GLuint> m_movedObjects;
+    GLuint m_indexedObjectCount;
+    std::vector<Object*> m_visibleObjects;
+
+    // packet used when the scene is drawn without a render thread
+    ScenePacket m_framePacket;
     
     std::string m_status;
 };
@@ -19,14 +19,17 @@
 //
 
 #include "Shader.h"
+#include "GLThread.h"
+#include <cassert>
 
 //TODO: change to std::string instead of raw string
 //TODO: add a shader valid var so outside caller can tell if shader was constructed successfully
 //-----------------------------------------------------------------------------
 // Name : Shader (constructor)
 //-----------------------------------------------------------------------------
-Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
+Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath, const std::string& defines/* = ""*/)
 {
+    assert(GLThread::IsCurrent());
 
     std::cout << "Shader const\n";
     std::cout << vertexPath << " " << fragmentPath << "\n";
@@ -54,6 +57,12 @@ Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
         // Convert stream into string
         vertexCode = vShaderStream.str();
         fragmentCode = fShaderStream.str();
+
+        if (defines != "")
+        {
+            vertexCode = AddDefines(vertexCode, defines);
+            fragmentCode = AddDefines(fragmentCode, defines);
+        }
     }
     catch (std::ifstream::failure e)
     {
@@ -114,6 +123,19 @@ Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
 
 }
 
+//-----------------------------------------------------------------------------
+// Name : AddDefines ()
+// Desc : #version has to stay the first line so the defines go right after it
+//-----------------------------------------------------------------------------
+std::string Shader::AddDefines(const std::string& shaderCode, const std::string& defines)
+{
+    std::size_t versionEnd = shaderCode.find('\n');
+    if (shaderCode.compare(0, 8, "#version") != 0 || versionEnd == std::string::npos)
+        return defines + shaderCode;
+
+    return shaderCode.substr(0, versionEnd + 1) + defines + shaderCode.substr(versionEnd + 1);
+}
+
 //-----------------------------------------------------------------------------
 // Name : Use ()
 //-----------------------------------------------------------------------------
@@ -31,11 +31,15 @@ class Shader
 public:
     GLuint Program;
     // Constructor generates the shader on the fly
-    Shader(const GLchar* vertexPath, const GLchar* fragmentPath);
+    // defines are added right after the #version line of both shaders
+    Shader(const GLchar* vertexPath, const GLchar* fragmentPath, const std::string& defines = "");
 
     // Uses the current shader
     void Use();
 
+private:
+    static std::string AddDefines(const std::string& shaderCode, const std::string& defines);
+
 };
 
 #endif // SHADER_H
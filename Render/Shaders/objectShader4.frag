@@ -1,16 +1,26 @@
 #version 330 core
 
 #define MAX_ACTIVE_LIGHTS 4
+// must match MaterialTable::WINDOW_SIZE
+#define MATERIAL_TABLE_SIZE 192
 
-uniform Material
+struct MaterialData
 {
-    vec4 mDiffuse;
-    vec4 mAmbient;
-    vec4 mSpecular;
-    vec4 mEmissive;
-    float mPower;
+    vec4 diffuse;
+    vec4 ambient;
+    vec4 specular;
+    vec4 emissive;
+    float power;
 };
 
+// a window of the scene material table, materialIndex is relative to it
+layout(std140) uniform Material
+{
+    MaterialData materials[MATERIAL_TABLE_SIZE];
+};
+
+uniform int materialIndex;
+
 struct LightData
 {
     // position and orientation
@@ -30,10 +40,13 @@ layout(std140) uniform lightBlock
     LightData lights[4];
 };
 
-uniform mat4 matWorldInverseT;
-uniform mat4 matWorld;
-
-uniform vec3 vecEye;
+layout(std140) uniform FrameBlock
+{
+    mat4 view;
+    mat4 proj;
+    mat4 viewProj;
+    vec4 eye;
+};
 
 uniform int nActiveLights;
 uniform sampler2D meshTexture;
@@ -56,7 +69,7 @@ vec4 calcLight(int i, vec3 posW, vec3 norm, vec3 viewDir)
     float diff = max( dot( norm, lightDir), 0);
             
     vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), mPower);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), materials[materialIndex].power);
             
     float distance = length(lights[i].pos - posW);
             
@@ -88,9 +101,9 @@ vec4 calcLight(int i, vec3 posW, vec3 norm, vec3 viewDir)
 //     vec3 ambient  = (lights[i].lAmbient * mAmbient).rgb;
 //     vec3 diffuse = (lights[i].lDiffuse * diff * mDiffuse).rgb;
 //     vec3 specular = (lights[i].lSpecular * spec * mSpecular).rgb;
-    vec4 ambient  = (lights[i].lAmbient * mAmbient);
-    vec4 diffuse = (lights[i].lDiffuse * diff * mDiffuse);
-    vec4 specular = (lights[i].lSpecular * spec * mSpecular);
+    vec4 ambient  = (lights[i].lAmbient * materials[materialIndex].ambient);
+    vec4 diffuse = (lights[i].lDiffuse * diff * materials[materialIndex].diffuse);
+    vec4 specular = (lights[i].lSpecular * spec * materials[materialIndex].specular);
             
     diffuse  *= intensity / attenuation;
     specular *= intensity / attenuation;
@@ -101,11 +114,11 @@ vec4 calcLight(int i, vec3 posW, vec3 norm, vec3 viewDir)
 
 void main()
 {
-    vec3 posW = (matWorld * vec4(pos, 1.0)).xyz;
-    vec3 norm = (matWorldInverseT * vec4(norm, 0.0)).xyz;
-    norm = normalize(norm);
+    // pos and norm are already in world space
+    vec3 posW = pos;
+    vec3 normW = normalize(norm);
 
-    vec3 viewDir = normalize(vecEye - posW);
+    vec3 viewDir = normalize(eye.xyz - posW);
     vec4 outColor = vec4(0.0, 0.0, 0.0, 0.0);
     
     color = vec4(0.0,0.0,0.0,1.0);
@@ -113,7 +126,7 @@ void main()
     int activeLights = min(nActiveLights, MAX_ACTIVE_LIGHTS);
     for (int i = 0; i < activeLights; i++)
     {
-        outColor += calcLight(i, posW, norm, viewDir);
+        outColor += calcLight(i, posW, normW, viewDir);
     }
     
     if (textured)
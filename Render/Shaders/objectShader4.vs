@@ -3,10 +3,25 @@ layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCords;
 
-uniform mat4 matWorldInverseT;
-uniform mat4 matWorld;
+layout(std140) uniform FrameBlock
+{
+    mat4 view;
+    mat4 proj;
+    mat4 viewProj;
+    vec4 eye;
+};
 
-uniform mat4 projection;
+#ifdef INSTANCED
+// per instance matrices, every mat4 takes 4 locations (3-6 and 7-10)
+layout (location = 3) in mat4 instanceWorld;
+layout (location = 7) in mat4 instanceWorldInverseT;
+#else
+layout(std140) uniform ObjectBlock
+{
+    mat4 matWorld;
+    mat4 matWorldInverseT;
+};
+#endif
 
 out vec3 pos; 
 out vec3 norm;
@@ -14,10 +29,13 @@ out vec2 texUV;
 
 void main()
 {
-	pos = position;
-	norm = normal;
+#ifdef INSTANCED
+	mat4 matWorld = instanceWorld;
+	mat4 matWorldInverseT = instanceWorldInverseT;
+#endif
+	gl_Position = viewProj * matWorld * vec4(position, 1.0);
+	// lighting is done in world space
+	pos = (matWorld * vec4(position, 1.0)).xyz;
+	norm = (matWorldInverseT * vec4(normal, 0.0)).xyz;
 	texUV = texCords;
-	gl_Position = projection * vec4(position, 1.0);
-	
-	
 } 
@@ -19,6 +19,8 @@
 //
 
 #include "Sprite.h"
+#include "GLThread.h"
+#include <cassert>
 #include <iostream>
 
 //-----------------------------------------------------------------------------
@@ -42,8 +44,14 @@ void StreamOfVertices::addQuad(const Rect& spriteRect, const Rect& texRect, cons
     // calculate how much to scale  the UV coordinates of the texture to fit the texRect
     if (texture.name != 0)
     {
-        // get the texture width and height
-        if (glGetTextureLevelParameteriv != nullptr)
+        // get the texture width and height, the GL query is only used when the size is unknown
+        // as the GUI can be built on a thread that has no GL context
+        if (texture.width != 0 && texture.height != 0)
+        {
+            textureWidth = texture.width;
+            textureHeight = texture.height;
+        }
+        else if (glGetTextureLevelParameteriv != nullptr)
         {
             glGetTextureLevelParameteriv(texture.name, 0, GL_TEXTURE_WIDTH, &textureWidth);
             glGetTextureLevelParameteriv(texture.name, 0, GL_TEXTURE_HEIGHT, &textureHeight);
@@ -140,6 +148,7 @@ Sprite::~Sprite()
 //-----------------------------------------------------------------------------
 bool Sprite::Init()
 {
+    assert(GLThread::IsCurrent());
     glGenVertexArrays(1, &m_vertexArrayObject);
     glBindVertexArray(m_vertexArrayObject);
     glGenBuffers(1, &m_vertexBuffer);
@@ -202,10 +211,20 @@ bool Sprite::AddQuad(const Rect& spriteRect, glm::vec4 tintColor, const Texture&
 // Name : Render ()
 //-----------------------------------------------------------------------------
 bool Sprite::Render(Shader* shader)
+{
+    return Render(shader, m_vertexStreams);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Render ()
+// Desc : draws streams that were taken from a sprite with MoveStreams
+//-----------------------------------------------------------------------------
+bool Sprite::Render(Shader* shader, const std::vector<StreamOfVertices>& vertexStreams)
 {
     shader->Use();
+    GLint texturedLoc = glGetUniformLocation(shader->Program, "textured");
 
-    for (StreamOfVertices& vertexStream : m_vertexStreams)
+    for (const StreamOfVertices& vertexStream : vertexStreams)
     {
         glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
          glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(VertexSprite) * vertexStream.vertices.size(),
@@ -216,11 +235,11 @@ bool Sprite::Render(Shader* shader)
 
         if (vertexStream.texture.name != 0)
         {
-             glUniform1i( glGetUniformLocation(shader->Program, "textured"), 1);
+             glUniform1i(texturedLoc, 1);
              glBindTexture(GL_TEXTURE_2D, vertexStream.texture.name);
         }
         else
-            glUniform1i( glGetUniformLocation(shader->Program, "textured"), 0);
+            glUniform1i(texturedLoc, 0);
 
         glBindVertexArray(m_vertexArrayObject);
         glDrawElements(GL_TRIANGLES, vertexStream.indices.size() , GL_UNSIGNED_INT, 0);
@@ -232,7 +251,18 @@ bool Sprite::Render(Shader* shader)
 }
 
 //-----------------------------------------------------------------------------
-// Name : Render ()
+// Name : MoveStreams ()
+// Desc : hands the queued quads over to streams and takes its old storage,
+//        streams is expected to have been cleared
+//-----------------------------------------------------------------------------
+void Sprite::MoveStreams(std::vector<StreamOfVertices>& streams)
+{
+    m_vertexStreams.swap(streams);
+    m_vertexStreams.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Clear ()
 //-----------------------------------------------------------------------------
 void Sprite::Clear()
 {
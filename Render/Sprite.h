@@ -86,9 +86,11 @@ public:
     bool AddTintedTexturedQuad(const Rect &spriteRect, glm::vec4 tintColor, const Texture& texture, const Rect &texRect = EMPTY_RECT);
     bool AddQuad(const Rect &spriteRect, glm::vec4 tintColor, const Texture& texture, const Rect &texRect, Point scale);
     void Clear();
+    void MoveStreams(std::vector<StreamOfVertices>& streams);
 
     bool Init();
     bool Render(Shader *shader);
+    bool Render(Shader *shader, const std::vector<StreamOfVertices>& vertexStreams);
 
 private:
 
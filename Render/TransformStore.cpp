@@ -0,0 +1,449 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TransformStore.h"
+#include <utility>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define TRANSFORM_STORE_SSE
+#include <xmmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Name : TransformStore (constructor)
+//-----------------------------------------------------------------------------
+TransformStore::TransformStore()
+{
+    m_slotCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Allocate ()
+// Desc : returns a slot with the identity transform
+//-----------------------------------------------------------------------------
+GLuint TransformStore::Allocate()
+{
+    GLuint slot;
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        if (m_slotCount == m_posX.size())
+        {
+            GLuint capacity = m_slotCount + SLOT_GROW;
+            for (std::vector<float>* component : {&m_posX, &m_posY, &m_posZ, &m_rotX, &m_rotY, &m_rotZ,
+                                                  &m_scaleX, &m_scaleY, &m_scaleZ})
+                component->resize(capacity, 0.0f);
+
+            m_rotW.resize(capacity, 1.0f);
+            m_world.resize(capacity, glm::mat4x4(1.0f));
+            m_worldInverseT.resize(capacity, glm::mat4x4(1.0f));
+            m_dirty.resize(capacity / 64, 0);
+
+            // unused slots still go through the SSE path so they must hold a valid scale
+            for (GLuint i = m_slotCount; i < capacity; i++)
+                ResetSlot(i);
+        }
+
+        slot = m_slotCount++;
+    }
+
+    MarkDirty(slot);
+    return slot;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Free ()
+//-----------------------------------------------------------------------------
+void TransformStore::Free(GLuint slot)
+{
+    ResetSlot(slot);
+    m_dirty[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    m_freeSlots.push_back(slot);
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetSlot ()
+//-----------------------------------------------------------------------------
+void TransformStore::ResetSlot(GLuint slot)
+{
+    m_posX[slot] = m_posY[slot] = m_posZ[slot] = 0.0f;
+    m_rotX[slot] = m_rotY[slot] = m_rotZ[slot] = 0.0f;
+    m_rotW[slot] = 1.0f;
+    m_scaleX[slot] = m_scaleY[slot] = m_scaleZ[slot] = 1.0f;
+    m_world[slot] = glm::mat4x4(1.0f);
+    m_worldInverseT[slot] = glm::mat4x4(1.0f);
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetPosition ()
+//-----------------------------------------------------------------------------
+void TransformStore::SetPosition(GLuint slot, const glm::vec3& pos)
+{
+    m_posX[slot] = pos.x;
+    m_posY[slot] = pos.y;
+    m_posZ[slot] = pos.z;
+    MarkDirty(slot);
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetRotation ()
+// Desc : rot is expected to be normalized
+//-----------------------------------------------------------------------------
+void TransformStore::SetRotation(GLuint slot, const glm::quat& rot)
+{
+    m_rotX[slot] = rot.x;
+    m_rotY[slot] = rot.y;
+    m_rotZ[slot] = rot.z;
+    m_rotW[slot] = rot.w;
+    MarkDirty(slot);
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetScale ()
+//-----------------------------------------------------------------------------
+void TransformStore::SetScale(GLuint slot, const glm::vec3& scale)
+{
+    m_scaleX[slot] = scale.x;
+    m_scaleY[slot] = scale.y;
+    m_scaleZ[slot] = scale.z;
+    MarkDirty(slot);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetPosition ()
+//-----------------------------------------------------------------------------
+glm::vec3 TransformStore::GetPosition(GLuint slot) const
+{
+    return glm::vec3(m_posX[slot], m_posY[slot], m_posZ[slot]);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetRotation ()
+//-----------------------------------------------------------------------------
+glm::quat TransformStore::GetRotation(GLuint slot) const
+{
+    return glm::quat(m_rotW[slot], m_rotX[slot], m_rotY[slot], m_rotZ[slot]);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetScale ()
+//-----------------------------------------------------------------------------
+glm::vec3 TransformStore::GetScale(GLuint slot) const
+{
+    return glm::vec3(m_scaleX[slot], m_scaleY[slot], m_scaleZ[slot]);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetWorldMatrix ()
+// Desc : the reference is valid until the next Allocate()
+//-----------------------------------------------------------------------------
+const glm::mat4x4& TransformStore::GetWorldMatrix(GLuint slot)
+{
+    if (IsDirty(slot))
+        UpdateSlot(slot);
+
+    return m_world[slot];
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetInverseTransposeMatrix ()
+// Desc : transpose of the world matrix inverse, transforms normals. Its
+//        transpose is the world matrix inverse.
+//-----------------------------------------------------------------------------
+const glm::mat4x4& TransformStore::GetInverseTransposeMatrix(GLuint slot)
+{
+    if (IsDirty(slot))
+        UpdateSlot(slot);
+
+    return m_worldInverseT[slot];
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsDirty ()
+//-----------------------------------------------------------------------------
+bool TransformStore::IsDirty(GLuint slot) const
+{
+    return (m_dirty[slot / 64] >> (slot % 64)) & 1;
+}
+
+//-----------------------------------------------------------------------------
+// Name : MarkDirty ()
+//-----------------------------------------------------------------------------
+void TransformStore::MarkDirty(GLuint slot)
+{
+    m_dirty[slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetSlotCount ()
+//-----------------------------------------------------------------------------
+GLuint TransformStore::GetSlotCount() const
+{
+    return m_slotCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateMatrices ()
+// Desc : rebuilds the matrices of every dirty slot, a group of 4 slots is
+//        updated together if any of them is dirty
+//-----------------------------------------------------------------------------
+void TransformStore::UpdateMatrices()
+{
+    for (GLuint word = 0; word < m_dirty.size(); word++)
+    {
+        uint64_t bits = m_dirty[word];
+        while (bits != 0)
+        {
+            GLuint bit = 0;
+            while (((bits >> bit) & 1) == 0)
+                bit++;
+
+            GLuint group = bit & ~3u;
+            UpdateGroup(word * 64 + group);
+            bits &= ~(uint64_t(0xF) << group);
+        }
+
+        m_dirty[word] = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateSlot ()
+// Desc : world = T * S * R, R is rotation matrix r[row][col] of the
+//        quaternion. The inverse is R^T * S^-1 so its transpose has the rows
+//        of R divided by the scale, and its translation is -R^T * (t / s).
+//-----------------------------------------------------------------------------
+void TransformStore::UpdateSlot(GLuint slot)
+{
+    float x = m_rotX[slot], y = m_rotY[slot], z = m_rotZ[slot], w = m_rotW[slot];
+    float r[3][3] =
+    {
+        {1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - w * z),        2.0f * (x * z + w * y)},
+        {2.0f * (x * y + w * z),        1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - w * x)},
+        {2.0f * (x * z - w * y),        2.0f * (y * z + w * x),        1.0f - 2.0f * (x * x + y * y)}
+    };
+
+    float s[3] = {m_scaleX[slot], m_scaleY[slot], m_scaleZ[slot]};
+    float t[3] = {m_posX[slot], m_posY[slot], m_posZ[slot]};
+    float u[3] = {t[0] / s[0], t[1] / s[1], t[2] / s[2]};
+
+    glm::mat4x4& world = m_world[slot];
+    glm::mat4x4& worldInverseT = m_worldInverseT[slot];
+
+    for (int col = 0; col < 3; col++)
+    {
+        for (int row = 0; row < 3; row++)
+        {
+            world[col][row] = s[row] * r[row][col];
+            worldInverseT[col][row] = r[row][col] / s[row];
+        }
+
+        world[col][3] = 0.0f;
+        worldInverseT[col][3] = -(r[0][col] * u[0] + r[1][col] * u[1] + r[2][col] * u[2]);
+    }
+
+    world[3] = glm::vec4(t[0], t[1], t[2], 1.0f);
+    worldInverseT[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    m_dirty[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+}
+
+#ifdef TRANSFORM_STORE_SSE
+//-----------------------------------------------------------------------------
+// Name : StoreColumn ()
+// Desc : every register holds one row of the column for 4 slots, transposes
+//        them so each slot gets its column
+//-----------------------------------------------------------------------------
+static inline void StoreColumn(glm::mat4x4* matrices, int col, __m128 row0, __m128 row1, __m128 row2, __m128 row3)
+{
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+    _mm_storeu_ps(&matrices[0][col][0], row0);
+    _mm_storeu_ps(&matrices[1][col][0], row1);
+    _mm_storeu_ps(&matrices[2][col][0], row2);
+    _mm_storeu_ps(&matrices[3][col][0], row3);
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateGroup ()
+// Desc : UpdateSlot for slots [firstSlot, firstSlot + 4), one slot per lane
+//-----------------------------------------------------------------------------
+void TransformStore::UpdateGroup(GLuint firstSlot)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 x = _mm_loadu_ps(&m_rotX[firstSlot]);
+    __m128 y = _mm_loadu_ps(&m_rotY[firstSlot]);
+    __m128 z = _mm_loadu_ps(&m_rotZ[firstSlot]);
+    __m128 w = _mm_loadu_ps(&m_rotW[firstSlot]);
+
+    __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+    __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+    __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+    __m128 r[3][3];
+    r[0][0] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+    r[0][1] = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+    r[0][2] = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+    r[1][0] = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+    r[1][1] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+    r[1][2] = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+    r[2][0] = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+    r[2][1] = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+    r[2][2] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+
+    __m128 s[3] = {_mm_loadu_ps(&m_scaleX[firstSlot]), _mm_loadu_ps(&m_scaleY[firstSlot]), _mm_loadu_ps(&m_scaleZ[firstSlot])};
+    __m128 t[3] = {_mm_loadu_ps(&m_posX[firstSlot]), _mm_loadu_ps(&m_posY[firstSlot]), _mm_loadu_ps(&m_posZ[firstSlot])};
+    __m128 invS[3] = {_mm_div_ps(one, s[0]), _mm_div_ps(one, s[1]), _mm_div_ps(one, s[2])};
+    __m128 u[3] = {_mm_mul_ps(t[0], invS[0]), _mm_mul_ps(t[1], invS[1]), _mm_mul_ps(t[2], invS[2])};
+
+    glm::mat4x4* world = &m_world[firstSlot];
+    glm::mat4x4* worldInverseT = &m_worldInverseT[firstSlot];
+
+    for (int col = 0; col < 3; col++)
+    {
+        StoreColumn(world, col, _mm_mul_ps(s[0], r[0][col]), _mm_mul_ps(s[1], r[1][col]), _mm_mul_ps(s[2], r[2][col]), zero);
+
+        __m128 invTranslation = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[0][col], u[0]), _mm_mul_ps(r[1][col], u[1])),
+                                           _mm_mul_ps(r[2][col], u[2]));
+        StoreColumn(worldInverseT, col, _mm_mul_ps(r[0][col], invS[0]), _mm_mul_ps(r[1][col], invS[1]),
+                    _mm_mul_ps(r[2][col], invS[2]), _mm_sub_ps(zero, invTranslation));
+    }
+
+    StoreColumn(world, 3, t[0], t[1], t[2], one);
+    StoreColumn(worldInverseT, 3, zero, zero, zero, one);
+}
+#else
+//-----------------------------------------------------------------------------
+// Name : UpdateGroup ()
+//-----------------------------------------------------------------------------
+void TransformStore::UpdateGroup(GLuint firstSlot)
+{
+    for (GLuint slot = firstSlot; slot < firstSlot + 4; slot++)
+        UpdateSlot(slot);
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// Name : TransformHandle (constructor)
+//-----------------------------------------------------------------------------
+TransformHandle::TransformHandle()
+{
+    m_store = nullptr;
+    m_slot = TransformStore::INVALID_SLOT;
+}
+
+//-----------------------------------------------------------------------------
+// Name : TransformHandle (constructor)
+//-----------------------------------------------------------------------------
+TransformHandle::TransformHandle(TransformStore* store)
+{
+    m_store = store;
+    m_slot = store->Allocate();
+}
+
+//-----------------------------------------------------------------------------
+// Name : TransformHandle (copy constructor)
+//-----------------------------------------------------------------------------
+TransformHandle::TransformHandle(const TransformHandle& other)
+{
+    m_store = nullptr;
+    m_slot = TransformStore::INVALID_SLOT;
+    CopyFrom(other);
+}
+
+//-----------------------------------------------------------------------------
+// Name : TransformHandle (move constructor)
+//-----------------------------------------------------------------------------
+TransformHandle::TransformHandle(TransformHandle&& other) noexcept
+{
+    m_store = other.m_store;
+    m_slot = other.m_slot;
+    other.m_store = nullptr;
+    other.m_slot = TransformStore::INVALID_SLOT;
+}
+
+//-----------------------------------------------------------------------------
+// Name : TransformHandle (destructor)
+//-----------------------------------------------------------------------------
+TransformHandle::~TransformHandle()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : operator= ()
+//-----------------------------------------------------------------------------
+TransformHandle& TransformHandle::operator=(const TransformHandle& other)
+{
+    if (this != &other)
+    {
+        Release();
+        CopyFrom(other);
+    }
+
+    return *this;
+}
+
+//-----------------------------------------------------------------------------
+// Name : operator= ()
+//-----------------------------------------------------------------------------
+TransformHandle& TransformHandle::operator=(TransformHandle&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        std::swap(m_store, other.m_store);
+        std::swap(m_slot, other.m_slot);
+    }
+
+    return *this;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+//-----------------------------------------------------------------------------
+void TransformHandle::Release()
+{
+    if (m_store != nullptr)
+        m_store->Free(m_slot);
+
+    m_store = nullptr;
+    m_slot = TransformStore::INVALID_SLOT;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CopyFrom ()
+//-----------------------------------------------------------------------------
+void TransformHandle::CopyFrom(const TransformHandle& other)
+{
+    if (other.m_store == nullptr)
+        return;
+
+    m_store = other.m_store;
+    m_slot = m_store->Allocate();
+    m_store->SetPosition(m_slot, m_store->GetPosition(other.m_slot));
+    m_store->SetRotation(m_slot, m_store->GetRotation(other.m_slot));
+    m_store->SetScale(m_slot, m_store->GetScale(other.m_slot));
+}
@@ -0,0 +1,109 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef  _TRANSFORMSTORE_H
+#define  _TRANSFORMSTORE_H
+
+#include <vector>
+#include <cinttypes>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+//-----------------------------------------------------------------------------
+// TransformStore - position, rotation and scale of many objects kept as
+// structure of arrays, every component in its own array, with a dirty bit per
+// slot. UpdateMatrices() rebuilds the world and inverse transpose matrices of
+// the dirty slots 4 at a time with SSE. The world matrix is T * S * R so its
+// inverse is built directly from the parts instead of a general 4x4 inverse.
+//-----------------------------------------------------------------------------
+class TransformStore
+{
+public:
+    static const GLuint INVALID_SLOT = 0xFFFFFFFF;
+    // slots are added in whole dirty words so the SSE groups never go past the arrays
+    static const GLuint SLOT_GROW = 64;
+
+    TransformStore();
+
+    GLuint Allocate();
+    void   Free    (GLuint slot);
+
+    void SetPosition(GLuint slot, const glm::vec3& pos);
+    void SetRotation(GLuint slot, const glm::quat& rot);
+    void SetScale   (GLuint slot, const glm::vec3& scale);
+
+    glm::vec3 GetPosition(GLuint slot) const;
+    glm::quat GetRotation(GLuint slot) const;
+    glm::vec3 GetScale   (GLuint slot) const;
+
+    const glm::mat4x4& GetWorldMatrix           (GLuint slot);
+    const glm::mat4x4& GetInverseTransposeMatrix(GLuint slot);
+
+    void   UpdateMatrices();
+    bool   IsDirty       (GLuint slot) const;
+    GLuint GetSlotCount  () const;
+
+private:
+    void MarkDirty  (GLuint slot);
+    void ResetSlot  (GLuint slot);
+    void UpdateSlot (GLuint slot);
+    void UpdateGroup(GLuint firstSlot);
+
+    GLuint m_slotCount;
+    std::vector<GLuint> m_freeSlots;
+
+    std::vector<float> m_posX, m_posY, m_posZ;
+    std::vector<float> m_rotX, m_rotY, m_rotZ, m_rotW;
+    std::vector<float> m_scaleX, m_scaleY, m_scaleZ;
+
+    std::vector<glm::mat4x4> m_world;
+    std::vector<glm::mat4x4> m_worldInverseT;
+    std::vector<uint64_t>    m_dirty;
+};
+
+//-----------------------------------------------------------------------------
+// TransformHandle - owns a slot in a TransformStore, copying the handle copies
+// the transform to a new slot and moving it keeps the slot
+//-----------------------------------------------------------------------------
+class TransformHandle
+{
+public:
+    TransformHandle();
+    explicit TransformHandle(TransformStore* store);
+    TransformHandle(const TransformHandle& other);
+    TransformHandle(TransformHandle&& other) noexcept;
+    ~TransformHandle();
+
+    TransformHandle& operator=(const TransformHandle& other);
+    TransformHandle& operator=(TransformHandle&& other) noexcept;
+
+    TransformStore* GetStore() const { return m_store; }
+    GLuint          GetSlot () const { return m_slot; }
+
+private:
+    void Release();
+    void CopyFrom(const TransformHandle& other);
+
+    TransformStore* m_store;
+    GLuint          m_slot;
+};
+
+#endif  //_TRANSFORMSTORE_H
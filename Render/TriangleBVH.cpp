@@ -0,0 +1,402 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TriangleBVH.h"
+#define GLM_ENABLE_EXPERIMENTAL // needed for gtx extensions
+#include <glm/gtx/intersect.hpp>
+
+//-----------------------------------------------------------------------------
+// Name : GetPosition ()
+//-----------------------------------------------------------------------------
+static inline const glm::vec3& GetPosition(const GLubyte* positions, GLuint stride, VertexIndex index)
+{
+    return *reinterpret_cast<const glm::vec3*>(positions + static_cast<size_t>(index) * stride);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Build ()
+// Desc : builds the tree over triangleCount triangles, positions points to
+//        the first vertex position and stride is the size of a whole vertex
+//-----------------------------------------------------------------------------
+void TriangleBVH::Build(const GLubyte* positions, GLuint stride, const VertexIndex* indices, GLuint triangleCount)
+{
+    Clear();
+    if (triangleCount == 0)
+        return;
+
+    m_triIndices.resize(triangleCount);
+    m_centroids.resize(triangleCount);
+    m_triBounds.resize(triangleCount);
+
+    for (GLuint i = 0; i < triangleCount; i++)
+    {
+        const glm::vec3& v0 = GetPosition(positions, stride, indices[i * 3]);
+        const glm::vec3& v1 = GetPosition(positions, stride, indices[i * 3 + 1]);
+        const glm::vec3& v2 = GetPosition(positions, stride, indices[i * 3 + 2]);
+
+        m_triBounds[i] = AABB(glm::min(v0, glm::min(v1, v2)), glm::max(v0, glm::max(v1, v2)));
+        m_centroids[i] = (v0 + v1 + v2) * (1.0f / 3.0f);
+        m_triIndices[i] = i;
+    }
+
+    // a binary tree with n leaves has at most 2n - 1 nodes
+    m_nodes.reserve(triangleCount * 2 - 1);
+
+    BVHNode root;
+    root.leftOrFirst = 0;
+    root.triCount = triangleCount;
+    m_nodes.push_back(root);
+    UpdateNodeBounds(0);
+
+    Subdivide();
+
+    m_nodes.shrink_to_fit();
+    m_centroids.clear();
+    m_centroids.shrink_to_fit();
+    m_triBounds.clear();
+    m_triBounds.shrink_to_fit();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Assign ()
+//-----------------------------------------------------------------------------
+void TriangleBVH::Assign(const BVHNode* nodes, GLuint nodeCount, const GLuint* triIndices, GLuint triangleCount)
+{
+    m_nodes.assign(nodes, nodes + nodeCount);
+    m_triIndices.assign(triIndices, triIndices + triangleCount);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Clear ()
+//-----------------------------------------------------------------------------
+void TriangleBVH::Clear()
+{
+    m_nodes.clear();
+    m_triIndices.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateNodeBounds ()
+//-----------------------------------------------------------------------------
+void TriangleBVH::UpdateNodeBounds(GLuint nodeIndex)
+{
+    BVHNode& node = m_nodes[nodeIndex];
+
+    AABB bounds;
+    for (GLuint i = 0; i < node.triCount; i++)
+        bounds.AddAABB(m_triBounds[m_triIndices[node.leftOrFirst + i]]);
+
+    node.boundsMin = bounds.min;
+    node.boundsMax = bounds.max;
+}
+
+//-----------------------------------------------------------------------------
+// Name : FindSplit ()
+// Desc : bins the node triangles by their centroids on every axis and finds
+//        the plane with the lowest surface area heuristic cost
+//        returns false when keeping the node as a leaf is cheaper
+//-----------------------------------------------------------------------------
+bool TriangleBVH::FindSplit(const BVHNode& node, int& axis, float& splitPos) const
+{
+    struct Bin
+    {
+        AABB bounds;
+        GLuint triCount = 0;
+    };
+
+    AABB centroidBounds;
+    for (GLuint i = 0; i < node.triCount; i++)
+        centroidBounds.AddPoint(m_centroids[m_triIndices[node.leftOrFirst + i]]);
+
+    float bestCost = std::numeric_limits<float>::max();
+
+    for (int a = 0; a < 3; a++)
+    {
+        float boundsMin = centroidBounds.min[a];
+        float boundsMax = centroidBounds.max[a];
+        if (boundsMin == boundsMax)
+            continue;
+
+        Bin bins[BIN_COUNT];
+        float scale = BIN_COUNT / (boundsMax - boundsMin);
+        for (GLuint i = 0; i < node.triCount; i++)
+        {
+            GLuint tri = m_triIndices[node.leftOrFirst + i];
+            GLuint binIndex = std::min(BIN_COUNT - 1, static_cast<GLuint>((m_centroids[tri][a] - boundsMin) * scale));
+            bins[binIndex].triCount++;
+            bins[binIndex].bounds.AddAABB(m_triBounds[tri]);
+        }
+
+        // sweep from both sides to get the area and count on each side of every plane
+        float leftArea[BIN_COUNT - 1], rightArea[BIN_COUNT - 1];
+        GLuint leftCount[BIN_COUNT - 1], rightCount[BIN_COUNT - 1];
+        AABB leftBox, rightBox;
+        GLuint leftSum = 0, rightSum = 0;
+        for (GLuint i = 0; i < BIN_COUNT - 1; i++)
+        {
+            leftSum += bins[i].triCount;
+            leftCount[i] = leftSum;
+            leftBox.AddAABB(bins[i].bounds);
+            leftArea[i] = leftBox.GetSurfaceArea();
+
+            rightSum += bins[BIN_COUNT - 1 - i].triCount;
+            rightCount[BIN_COUNT - 2 - i] = rightSum;
+            rightBox.AddAABB(bins[BIN_COUNT - 1 - i].bounds);
+            rightArea[BIN_COUNT - 2 - i] = rightBox.GetSurfaceArea();
+        }
+
+        for (GLuint i = 0; i < BIN_COUNT - 1; i++)
+        {
+            if (leftCount[i] == 0 || rightCount[i] == 0)
+                continue;
+
+            float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                axis = a;
+                splitPos = boundsMin + (i + 1) / scale;
+            }
+        }
+    }
+
+    // all the centroids are at the same spot
+    if (bestCost == std::numeric_limits<float>::max())
+        return false;
+
+    // cost of a leaf is testing all of its triangles, splitting adds one traversal step
+    float nodeArea = AABB(node.boundsMin, node.boundsMax).GetSurfaceArea();
+    if (nodeArea <= 0.0f)
+        return true;
+
+    float splitCost = 1.0f + bestCost / nodeArea;
+    return splitCost < node.triCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Subdivide ()
+// Desc : splits the nodes top down until SAH says a leaf is cheaper
+//-----------------------------------------------------------------------------
+void TriangleBVH::Subdivide()
+{
+    struct BuildEntry
+    {
+        GLuint nodeIndex;
+        GLuint depth;
+    };
+
+    std::vector<BuildEntry> stack;
+    stack.push_back({0, 0});
+
+    while (!stack.empty())
+    {
+        BuildEntry entry = stack.back();
+        stack.pop_back();
+
+        BVHNode node = m_nodes[entry.nodeIndex];
+        if (node.triCount <= LEAF_TRIANGLES || entry.depth >= MAX_DEPTH)
+            continue;
+
+        int axis = 0;
+        float splitPos = 0.0f;
+        if (!FindSplit(node, axis, splitPos))
+            continue;
+
+        // partition the triangles in place around the split plane
+        GLuint first = node.leftOrFirst;
+        GLuint last = first + node.triCount;
+        GLuint mid = first;
+        for (GLuint i = first; i < last; i++)
+        {
+            if (m_centroids[m_triIndices[i]][axis] < splitPos)
+                std::swap(m_triIndices[i], m_triIndices[mid++]);
+        }
+
+        GLuint leftCount = mid - first;
+        if (leftCount == 0 || leftCount == node.triCount)
+            continue;
+
+        // children are allocated next to each other so only the left index is stored
+        GLuint leftIndex = m_nodes.size();
+        BVHNode child;
+        child.leftOrFirst = first;
+        child.triCount = leftCount;
+        m_nodes.push_back(child);
+        child.leftOrFirst = mid;
+        child.triCount = node.triCount - leftCount;
+        m_nodes.push_back(child);
+
+        m_nodes[entry.nodeIndex].leftOrFirst = leftIndex;
+        m_nodes[entry.nodeIndex].triCount = 0;
+
+        UpdateNodeBounds(leftIndex);
+        UpdateNodeBounds(leftIndex + 1);
+
+        stack.push_back({leftIndex, entry.depth + 1});
+        stack.push_back({leftIndex + 1, entry.depth + 1});
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : Intersect ()
+// Desc : finds the nearest triangle hit by the ray that is closer than
+//        hit.distance, hit is only updated when such a triangle is found
+//        without positions the leaf boxes are hit instead of their triangles
+//-----------------------------------------------------------------------------
+bool TriangleBVH::Intersect(const glm::vec3& rayOrigin, const glm::vec3& rayDir,
+                            const GLubyte* positions, GLuint stride, const VertexIndex* indices, RayHit& hit) const
+{
+    if (m_nodes.empty())
+        return false;
+
+    struct StackEntry
+    {
+        GLuint nodeIndex;
+        float tNear;
+    };
+
+    glm::vec3 invDir = 1.0f / rayDir;
+    StackEntry stack[MAX_DEPTH + 2];
+    GLuint stackSize = 0;
+    bool found = false;
+
+    float tNear;
+    if (!AABB(m_nodes[0].boundsMin, m_nodes[0].boundsMax).IntersectRay(rayOrigin, invDir, hit.distance, tNear))
+        return false;
+
+    stack[stackSize++] = {0, tNear};
+
+    while (stackSize > 0)
+    {
+        StackEntry entry = stack[--stackSize];
+        // a closer hit was found since this node was pushed
+        if (entry.tNear > hit.distance)
+            continue;
+
+        const BVHNode& node = m_nodes[entry.nodeIndex];
+        if (node.triCount > 0 && !positions)
+        {
+            hit.distance = entry.tNear;
+            hit.faceIndex = m_triIndices[node.leftOrFirst];
+            hit.barycentric = glm::vec2(0.0f, 0.0f);
+            found = true;
+            continue;
+        }
+
+        if (node.triCount > 0)
+        {
+            for (GLuint i = 0; i < node.triCount; i++)
+            {
+                GLuint tri = m_triIndices[node.leftOrFirst + i];
+                const glm::vec3& v0 = GetPosition(positions, stride, indices[tri * 3]);
+                const glm::vec3& v1 = GetPosition(positions, stride, indices[tri * 3 + 1]);
+                const glm::vec3& v2 = GetPosition(positions, stride, indices[tri * 3 + 2]);
+
+                glm::vec2 bary;
+                float distance;
+                if (glm::intersectRayTriangle(rayOrigin, rayDir, v0, v1, v2, bary, distance) &&
+                    distance >= 0.0f && distance < hit.distance)
+                {
+                    hit.distance = distance;
+                    hit.faceIndex = tri;
+                    hit.barycentric = bary;
+                    found = true;
+                }
+            }
+
+            continue;
+        }
+
+        // push the farther child first so the nearer one is visited first
+        GLuint left = node.leftOrFirst;
+        GLuint right = left + 1;
+        float tLeft, tRight;
+        bool hitLeft = AABB(m_nodes[left].boundsMin, m_nodes[left].boundsMax).IntersectRay(rayOrigin, invDir, hit.distance, tLeft);
+        bool hitRight = AABB(m_nodes[right].boundsMin, m_nodes[right].boundsMax).IntersectRay(rayOrigin, invDir, hit.distance, tRight);
+
+        if (hitLeft && hitRight)
+        {
+            if (tLeft > tRight)
+            {
+                std::swap(left, right);
+                std::swap(tLeft, tRight);
+            }
+
+            stack[stackSize++] = {right, tRight};
+            stack[stackSize++] = {left, tLeft};
+        }
+        else if (hitLeft)
+            stack[stackSize++] = {left, tLeft};
+        else if (hitRight)
+            stack[stackSize++] = {right, tRight};
+    }
+
+    return found;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsEmpty ()
+//-----------------------------------------------------------------------------
+bool TriangleBVH::IsEmpty() const
+{
+    return m_nodes.empty();
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetNodeCount ()
+//-----------------------------------------------------------------------------
+GLuint TriangleBVH::GetNodeCount() const
+{
+    return m_nodes.size();
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetMemoryUsage ()
+//-----------------------------------------------------------------------------
+size_t TriangleBVH::GetMemoryUsage() const
+{
+    return m_nodes.capacity() * sizeof(BVHNode) + m_triIndices.capacity() * sizeof(GLuint);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBounds ()
+//-----------------------------------------------------------------------------
+AABB TriangleBVH::GetBounds() const
+{
+    if (m_nodes.empty())
+        return AABB();
+
+    return AABB(m_nodes[0].boundsMin, m_nodes[0].boundsMax);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetNodes ()
+//-----------------------------------------------------------------------------
+const std::vector<BVHNode>& TriangleBVH::GetNodes() const
+{
+    return m_nodes;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetTriangleIndices ()
+//-----------------------------------------------------------------------------
+const std::vector<GLuint>& TriangleBVH::GetTriangleIndices() const
+{
+    return m_triIndices;
+}
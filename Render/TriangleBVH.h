@@ -0,0 +1,85 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef  _TRIANGLEBVH_H
+#define  _TRIANGLEBVH_H
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "RenderTypes.h"
+
+// node of the flattened tree, 32 bytes so two nodes fit in a cache line
+// for a leaf triCount > 0 and leftOrFirst is the first triangle in
+// m_triIndices, otherwise leftOrFirst is the left child and the right child
+// is right after it
+struct BVHNode
+{
+    glm::vec3 boundsMin;
+    GLuint    leftOrFirst;
+    glm::vec3 boundsMax;
+    GLuint    triCount;
+};
+
+//-----------------------------------------------------------------------------
+// TriangleBVH - bounding volume hierarchy over the triangles of a subMesh.
+// Built with binned SAH splits, the vertices are not stored in the tree and
+// are passed to Intersect() as a position pointer and a stride so the same
+// tree works with any vertex layout.
+//-----------------------------------------------------------------------------
+class TriangleBVH
+{
+public:
+    static const GLuint BIN_COUNT = 12;
+    // nodes with this many triangles or less are never split
+    static const GLuint LEAF_TRIANGLES = 2;
+    static const GLuint MAX_DEPTH = 60;
+
+    void Build(const GLubyte* positions, GLuint stride, const VertexIndex* indices, GLuint triangleCount);
+    // copies a tree built before, used by cooked meshes instead of Build()
+    void Assign(const BVHNode* nodes, GLuint nodeCount, const GLuint* triIndices, GLuint triangleCount);
+    void Clear();
+
+    bool Intersect(const glm::vec3& rayOrigin, const glm::vec3& rayDir,
+                   const GLubyte* positions, GLuint stride, const VertexIndex* indices, RayHit& hit) const;
+
+    bool   IsEmpty       () const;
+    GLuint GetNodeCount  () const;
+    // bytes of the tree, the triangles are not part of it
+    size_t GetMemoryUsage() const;
+    AABB   GetBounds     () const;
+
+    const std::vector<BVHNode>& GetNodes          () const;
+    const std::vector<GLuint>&  GetTriangleIndices() const;
+
+private:
+    void  UpdateNodeBounds(GLuint nodeIndex);
+    bool  FindSplit       (const BVHNode& node, int& axis, float& splitPos) const;
+    void  Subdivide       ();
+
+    std::vector<BVHNode> m_nodes;
+    std::vector<GLuint> m_triIndices;
+
+    // build time only data
+    std::vector<glm::vec3> m_centroids;
+    std::vector<AABB> m_triBounds;
+};
+
+#endif  //_TRIANGLEBVH_H
@@ -0,0 +1,235 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "UniformRingBuffer.h"
+#include <cstring>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+// Name : UniformRingBuffer (constructor)
+//-----------------------------------------------------------------------------
+UniformRingBuffer::UniformRingBuffer()
+{
+    m_buffer = 0;
+    m_persistentPtr = nullptr;
+    m_framePtr = nullptr;
+    m_persistent = false;
+    m_frameSize = 0;
+    m_alignment = 256;
+    m_curFrame = 0;
+    m_frameStart = 0;
+    m_writeOffset = 0;
+
+    for (GLuint i = 0; i < FRAME_COUNT; i++)
+        m_fences[i] = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : UniformRingBuffer (destructor)
+//-----------------------------------------------------------------------------
+UniformRingBuffer::~UniformRingBuffer()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Init ()
+//-----------------------------------------------------------------------------
+void UniformRingBuffer::Init(GLsizeiptr frameSize)
+{
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_alignment);
+    m_persistent = GLEW_ARB_buffer_storage;
+    if (!m_persistent)
+        std::cout << "ARB_buffer_storage not supported, uniform ring buffer is mapped every frame\n";
+
+    Create(frameSize);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+//-----------------------------------------------------------------------------
+void UniformRingBuffer::Create(GLsizeiptr frameSize)
+{
+    m_frameSize = GetAlignedSize(frameSize);
+    GLsizeiptr totalSize = m_frameSize * FRAME_COUNT;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+
+    if (m_persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, totalSize, nullptr, flags);
+        m_persistentPtr = static_cast<GLubyte*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, totalSize, flags));
+    }
+    else
+        glBufferData(GL_UNIFORM_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+//-----------------------------------------------------------------------------
+void UniformRingBuffer::Release()
+{
+    for (GLuint i = 0; i < FRAME_COUNT; i++)
+        WaitFence(i);
+
+    if (m_buffer != 0)
+    {
+        if (m_persistentPtr || m_framePtr)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+        }
+
+        glDeleteBuffers(1, &m_buffer);
+    }
+
+    m_buffer = 0;
+    m_persistentPtr = nullptr;
+    m_framePtr = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Name : WaitFence ()
+// Desc : blocks until the GPU is done with the draws that read frame's segment
+//-----------------------------------------------------------------------------
+void UniformRingBuffer::WaitFence(GLuint frame)
+{
+    GLsync& fence = m_fences[frame];
+    if (fence == 0)
+        return;
+
+    GLbitfield flags = 0;
+    while (true)
+    {
+        GLenum result = glClientWaitSync(fence, flags, 1000000);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+            break;
+
+        // make sure the fence was sent to the GPU before waiting on it again
+        flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    }
+
+    glDeleteSync(fence);
+    fence = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BeginFrame ()
+// Desc : moves to the next segment and makes sure it can hold requiredSize
+//        bytes, the buffer is recreated when it is too small
+//-----------------------------------------------------------------------------
+bool UniformRingBuffer::BeginFrame(GLsizeiptr requiredSize)
+{
+    if (m_buffer == 0)
+        return false;
+
+    if (requiredSize > m_frameSize)
+    {
+        GLsizeiptr newSize = m_frameSize;
+        while (newSize < requiredSize)
+            newSize *= 2;
+
+        Release();
+        Create(newSize);
+    }
+
+    m_curFrame = (m_curFrame + 1) % FRAME_COUNT;
+    WaitFence(m_curFrame);
+    m_frameStart = m_curFrame * m_frameSize;
+    m_writeOffset = m_frameStart;
+
+    if (m_persistent)
+        m_framePtr = m_persistentPtr + m_frameStart;
+    else
+    {
+        // already synced by the fence, so no need for the driver to do it too
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        m_framePtr = static_cast<GLubyte*>(glMapBufferRange(GL_UNIFORM_BUFFER, m_frameStart, m_frameSize,
+                                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    }
+
+    return m_framePtr != nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Push ()
+// Desc : copies data to the current segment and returns its offset in the
+//        buffer, to be used with BindRange()
+//-----------------------------------------------------------------------------
+GLintptr UniformRingBuffer::Push(const void* data, GLsizeiptr size)
+{
+    GLintptr offset = m_writeOffset;
+    if (offset + size > m_frameStart + m_frameSize)
+    {
+        std::cout << "Uniform ring buffer frame overflow\n";
+        return m_frameStart;
+    }
+
+    std::memcpy(m_framePtr + (offset - m_frameStart), data, size);
+    m_writeOffset += GetAlignedSize(size);
+
+    return offset;
+}
+
+//-----------------------------------------------------------------------------
+// Name : EndWrite ()
+// Desc : has to be called after the last Push() and before the draws that
+//        read the pushed data
+//-----------------------------------------------------------------------------
+void UniformRingBuffer::EndWrite()
+{
+    if (!m_persistent && m_framePtr)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+
+    m_framePtr = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Name : EndFrame ()
+// Desc : fences the current segment, called after all the draws reading it
+//-----------------------------------------------------------------------------
+void UniformRingBuffer::EndFrame()
+{
+    if (m_buffer == 0)
+        return;
+
+    m_fences[m_curFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+//-----------------------------------------------------------------------------
+// Name : BindRange ()
+//-----------------------------------------------------------------------------
+void UniformRingBuffer::BindRange(GLuint bindingPoint, GLintptr offset, GLsizeiptr size)
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, m_buffer, offset, size);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetAlignedSize ()
+// Desc : size rounded up to the uniform buffer offset alignment
+//-----------------------------------------------------------------------------
+GLsizeiptr UniformRingBuffer::GetAlignedSize(GLsizeiptr size) const
+{
+    return ((size + m_alignment - 1) / m_alignment) * m_alignment;
+}
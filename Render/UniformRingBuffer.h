@@ -0,0 +1,69 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef  _UNIFORMRINGBUFFER_H
+#define  _UNIFORMRINGBUFFER_H
+
+#include <GL/glew.h>
+
+//-----------------------------------------------------------------------------
+// UniformRingBuffer - a uniform buffer split into FRAME_COUNT segments, each
+// frame writes into its own segment and fences it once its draws are issued.
+// The segment is only reused after its fence has signaled so writing never
+// stalls on draws that are still reading it.
+// When ARB_buffer_storage is available the buffer is mapped once persistently,
+// otherwise the frame segment is mapped unsynchronized in BeginFrame().
+//-----------------------------------------------------------------------------
+class UniformRingBuffer
+{
+public:
+    static const GLuint FRAME_COUNT = 3;
+
+    UniformRingBuffer();
+    ~UniformRingBuffer();
+
+    void Init(GLsizeiptr frameSize);
+
+    bool     BeginFrame (GLsizeiptr requiredSize);
+    GLintptr Push       (const void* data, GLsizeiptr size);
+    void     EndWrite   ();
+    void     EndFrame   ();
+    void     BindRange  (GLuint bindingPoint, GLintptr offset, GLsizeiptr size);
+
+    GLsizeiptr GetAlignedSize(GLsizeiptr size) const;
+
+private:
+    void Create   (GLsizeiptr frameSize);
+    void Release  ();
+    void WaitFence(GLuint frame);
+
+    GLuint     m_buffer;
+    GLubyte*   m_persistentPtr;
+    GLubyte*   m_framePtr;
+    bool       m_persistent;
+    GLsizeiptr m_frameSize;
+    GLint      m_alignment;
+    GLuint     m_curFrame;
+    GLintptr   m_frameStart;
+    GLintptr   m_writeOffset;
+    GLsync     m_fences[FRAME_COUNT];
+};
+
+#endif  //_UNIFORMRINGBUFFER_H
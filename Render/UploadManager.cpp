@@ -0,0 +1,411 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "UploadManager.h"
+#include "GLThread.h"
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <limits>
+
+//-----------------------------------------------------------------------------
+// Name : Get ()
+// Desc : the manager every asset streams through
+//-----------------------------------------------------------------------------
+UploadManager& UploadManager::Get()
+{
+    static UploadManager manager;
+    return manager;
+}
+
+//-----------------------------------------------------------------------------
+// Name : UploadManager (constructor)
+//-----------------------------------------------------------------------------
+UploadManager::UploadManager()
+{
+    m_ring = 0;
+    m_persistentPtr = nullptr;
+    m_persistent = false;
+    m_head = 0;
+    m_used = 0;
+    m_frameBudget = DEFAULT_FRAME_BUDGET;
+    m_queuedBytes = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : UploadManager (destructor)
+// Desc : runs during static destruction without a context, the GL objects
+//        were deleted by Shutdown()
+//-----------------------------------------------------------------------------
+UploadManager::~UploadManager()
+{
+}
+
+//-----------------------------------------------------------------------------
+// Name : Shutdown ()
+// Desc : drops the queued uploads and deletes the ring while the context is
+//        still current
+//-----------------------------------------------------------------------------
+void UploadManager::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.clear();
+        m_queuedBytes = 0;
+    }
+
+    for (StagingBatch& batch : m_batches)
+        glDeleteSync(batch.fence);
+
+    m_batches.clear();
+
+    if (m_ring != 0)
+    {
+        if (m_persistentPtr)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, m_ring);
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+        }
+
+        glDeleteBuffers(1, &m_ring);
+    }
+
+    m_ring = 0;
+    m_persistentPtr = nullptr;
+    m_head = 0;
+    m_used = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Init ()
+// Desc : the ring is created on the first Process() since the manager can be
+//        constructed before there is a context
+//-----------------------------------------------------------------------------
+void UploadManager::Init()
+{
+    if (m_ring != 0)
+        return;
+
+    m_persistent = GLEW_ARB_buffer_storage;
+    if (!m_persistent)
+        std::cout << "ARB_buffer_storage not supported, upload ring buffer is mapped on every write\n";
+
+    glGenBuffers(1, &m_ring);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_ring);
+
+    if (m_persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_READ_BUFFER, RING_SIZE, nullptr, flags);
+        m_persistentPtr = static_cast<GLubyte*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, RING_SIZE, flags));
+    }
+    else
+        glBufferData(GL_COPY_READ_BUFFER, RING_SIZE, nullptr, GL_STREAM_COPY);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Enqueue ()
+//-----------------------------------------------------------------------------
+void UploadManager::Enqueue(const UploadData& data, GLsizeiptr size, GLsizeiptr chunkAlignment, const CopyFunc& copy,
+                            const std::shared_ptr<UploadStatus>& status)
+{
+    if (size <= 0)
+        return;
+
+    UploadRequest request;
+    request.data = data;
+    request.size = size;
+    request.copied = 0;
+    request.chunkAlignment = std::max<GLsizeiptr>(chunkAlignment, 1);
+    request.copy = copy;
+    request.status = status;
+
+    status->pendingUploads++;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back(std::move(request));
+    m_queuedBytes += size;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetTextureRowSize ()
+// Desc : rows start on 4 bytes like the default GL_UNPACK_ALIGNMENT expects
+//-----------------------------------------------------------------------------
+GLsizeiptr UploadManager::GetTextureRowSize(GLsizei width, GLuint bytesPerPixel)
+{
+    return (GLsizeiptr(width) * bytesPerPixel + 3) & ~GLsizeiptr(3);
+}
+
+//-----------------------------------------------------------------------------
+// Name : EnqueueTexture ()
+// Desc : the texture is copied a few whole rows at a time
+//-----------------------------------------------------------------------------
+void UploadManager::EnqueueTexture(GLuint texture, GLint level, GLsizei width, GLsizei height, GLenum format, GLuint bytesPerPixel,
+                                   const UploadData& data, const std::shared_ptr<UploadStatus>& status)
+{
+    GLsizeiptr rowSize = GetTextureRowSize(width, bytesPerPixel);
+    Enqueue(data, rowSize * height, rowSize, [texture, level, width, format, rowSize](GLintptr stagingOffset, GLsizeiptr dataOffset, GLsizeiptr chunkSize)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, dataOffset / rowSize, width, chunkSize / rowSize, format, GL_UNSIGNED_BYTE,
+                        (const GLvoid*)stagingOffset);
+    }, status);
+}
+
+//-----------------------------------------------------------------------------
+// Name : EnqueueCompressedTexture ()
+// Desc : the texture is copied a few whole rows of blocks at a time, the last
+//        row of blocks may cover less than 4 rows of the level
+//-----------------------------------------------------------------------------
+void UploadManager::EnqueueCompressedTexture(GLuint texture, GLint level, GLsizei width, GLsizei height, GLenum internalFormat,
+                                             GLuint blockSize, const UploadData& data, const std::shared_ptr<UploadStatus>& status)
+{
+    GLsizeiptr blockRowSize = GLsizeiptr((width + 3) / 4) * blockSize;
+    GLsizeiptr blockRows = (height + 3) / 4;
+    Enqueue(data, blockRowSize * blockRows, blockRowSize, [texture, level, width, height, internalFormat, blockRowSize](GLintptr stagingOffset, GLsizeiptr dataOffset, GLsizeiptr chunkSize)
+    {
+        GLint y = GLint(dataOffset / blockRowSize) * 4;
+        GLsizei rows = std::min<GLsizei>(GLsizei(chunkSize / blockRowSize) * 4, height - y);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, rows, internalFormat, GLsizei(chunkSize),
+                                  (const GLvoid*)stagingOffset);
+    }, status);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Process ()
+// Desc : copies up to the frame budget of queued uploads
+//-----------------------------------------------------------------------------
+void UploadManager::Process()
+{
+    assert(GLThread::IsCurrent());
+    CopyQueued(m_frameBudget, false);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Flush ()
+// Desc : copies every queued upload, used when data has to be on the GPU now
+//-----------------------------------------------------------------------------
+void UploadManager::Flush()
+{
+    CopyQueued(std::numeric_limits<GLsizeiptr>::max(), true);
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetFrameBudget ()
+//-----------------------------------------------------------------------------
+void UploadManager::SetFrameBudget(GLsizeiptr bytes)
+{
+    m_frameBudget = bytes;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetFrameBudget ()
+//-----------------------------------------------------------------------------
+GLsizeiptr UploadManager::GetFrameBudget() const
+{
+    return m_frameBudget;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetQueuedBytes ()
+// Desc : bytes of the queued uploads that were not copied yet
+//-----------------------------------------------------------------------------
+GLsizeiptr UploadManager::GetQueuedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queuedBytes;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CopyQueued ()
+// Desc : writes queued uploads to the ring and issues their copies until
+//        budget bytes were copied. Without wait it stops when the ring is
+//        full, otherwise it waits for the oldest copies to finish.
+//-----------------------------------------------------------------------------
+void UploadManager::CopyQueued(GLsizeiptr budget, bool wait)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_queue.empty())
+    {
+        RetireBatches(false);
+        return;
+    }
+
+    Init();
+    RetireBatches(false);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, m_ring);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_ring);
+
+    GLsizeiptr maxChunkSize = MAX_CHUNK_SIZE;
+    GLsizeiptr batchSize = 0;
+    while (!m_queue.empty() && budget > 0)
+    {
+        UploadRequest& request = m_queue.front();
+        GLsizeiptr size = request.size;
+        if (request.status->cancelled)
+        {
+            m_queuedBytes -= size - request.copied;
+            request.status->pendingUploads--;
+            m_queue.pop_front();
+            continue;
+        }
+
+        GLsizeiptr chunkSize = std::min(std::min(size - request.copied, budget), maxChunkSize);
+        chunkSize -= chunkSize % request.chunkAlignment;
+        // the rest of the budget is too small for a texture row
+        if (chunkSize == 0)
+            break;
+
+        GLintptr stagingOffset = AllocStaging(chunkSize, batchSize);
+        if (stagingOffset == INVALID_OFFSET)
+        {
+            if (!wait)
+                break;
+
+            // the copies written so far are fenced so they can be waited on too
+            EndBatch(batchSize);
+            RetireBatches(true);
+            glBindBuffer(GL_COPY_READ_BUFFER, m_ring);
+            continue;
+        }
+
+        WriteStaging(stagingOffset, request.data.get() + request.copied, chunkSize);
+        request.copy(stagingOffset, request.copied, chunkSize);
+        // the copy can bind other buffers to the read target
+        glBindBuffer(GL_COPY_READ_BUFFER, m_ring);
+
+        request.copied += chunkSize;
+        m_queuedBytes -= chunkSize;
+        budget -= chunkSize;
+
+        if (request.copied == size)
+        {
+            request.status->pendingUploads--;
+            m_queue.pop_front();
+        }
+    }
+
+    EndBatch(batchSize);
+
+    // client memory pointers are used again by everyone else
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+//-----------------------------------------------------------------------------
+// Name : AllocStaging ()
+// Desc : returns where size bytes can be written in the ring, or
+//        INVALID_OFFSET when the GPU still reads too much of it. The written
+//        bytes are always one contiguous range ending at m_head, so the new
+//        range is free as long as it fits in what is left of the ring.
+//-----------------------------------------------------------------------------
+GLintptr UploadManager::AllocStaging(GLsizeiptr size, GLsizeiptr& batchSize)
+{
+    // 16 byte aligned so every vertex and index type can be copied from it
+    GLintptr offset = (m_head + 15) & ~GLintptr(15);
+    if (offset + size > RING_SIZE)
+        offset = 0;
+
+    // skipped bytes stay in use until the batch is retired
+    GLsizeiptr padding = (offset >= m_head) ? offset - m_head : RING_SIZE - m_head;
+    if (m_used + padding + size > RING_SIZE)
+        return INVALID_OFFSET;
+
+    m_used += padding + size;
+    batchSize += padding + size;
+    m_head = offset + size;
+
+    return offset;
+}
+
+//-----------------------------------------------------------------------------
+// Name : WriteStaging ()
+//-----------------------------------------------------------------------------
+void UploadManager::WriteStaging(GLintptr offset, const GLubyte* data, GLsizeiptr size)
+{
+    if (m_persistent)
+    {
+        std::memcpy(m_persistentPtr + offset, data, size);
+        return;
+    }
+
+    // the fences already make sure the GPU is done with this range
+    GLubyte* ptr = static_cast<GLubyte*>(glMapBufferRange(GL_COPY_READ_BUFFER, offset, size,
+                                                          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    if (ptr)
+    {
+        std::memcpy(ptr, data, size);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : EndBatch ()
+// Desc : fences the copies issued since the last batch
+//-----------------------------------------------------------------------------
+void UploadManager::EndBatch(GLsizeiptr& batchSize)
+{
+    if (batchSize == 0)
+        return;
+
+    StagingBatch batch;
+    batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    batch.size = batchSize;
+    m_batches.push_back(batch);
+    batchSize = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RetireBatches ()
+// Desc : frees the ring space of the batches the GPU finished, in the order
+//        they were written. With waitForOne it blocks until at least the
+//        oldest batch is done.
+//-----------------------------------------------------------------------------
+void UploadManager::RetireBatches(bool waitForOne)
+{
+    while (!m_batches.empty())
+    {
+        StagingBatch& batch = m_batches.front();
+
+        GLuint64 timeout = waitForOne ? 1000000000 : 0;
+        GLbitfield flags = waitForOne ? GL_SYNC_FLUSH_COMMANDS_BIT : 0;
+        GLenum result = glClientWaitSync(batch.fence, flags, timeout);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            if (waitForOne)
+                continue;
+
+            break;
+        }
+
+        waitForOne = false;
+        glDeleteSync(batch.fence);
+        m_used -= batch.size;
+        m_batches.pop_front();
+    }
+
+    // nothing is in flight so the next write can start at the beginning
+    if (m_batches.empty())
+    {
+        m_used = 0;
+        m_head = 0;
+    }
+}
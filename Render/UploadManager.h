@@ -0,0 +1,170 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef  _UPLOADMANAGER_H
+#define  _UPLOADMANAGER_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <GL/glew.h>
+
+// shared by whoever queued uploads and the UploadManager, ready once all of
+// them were copied. Cancelled uploads are dropped, used when the destination
+// is freed before its upload was done.
+struct UploadStatus
+{
+    std::atomic<GLuint> pendingUploads;
+    std::atomic<bool>   cancelled;
+
+    UploadStatus()
+        :pendingUploads(0), cancelled(false)
+    {}
+
+    bool IsReady() const { return pendingUploads == 0; }
+};
+
+// the bytes of an upload, kept alive until they were copied to the ring
+typedef std::shared_ptr<const GLubyte> UploadData;
+
+//-----------------------------------------------------------------------------
+// Name : MakeUploadData ()
+// Desc : takes over a vector so a buffer built only for the upload is never
+//        copied again
+//-----------------------------------------------------------------------------
+template<class T>
+UploadData MakeUploadData(std::vector<T>&& data)
+{
+    std::shared_ptr<std::vector<T>> owner = std::make_shared<std::vector<T>>(std::move(data));
+    return UploadData(owner, reinterpret_cast<const GLubyte*>(owner->data()));
+}
+
+//-----------------------------------------------------------------------------
+// Name : ShareUploadData ()
+// Desc : the upload shares a buffer its owner keeps, the owner must not
+//        change the buffer while it is shared
+//-----------------------------------------------------------------------------
+template<class T>
+UploadData ShareUploadData(const std::shared_ptr<std::vector<T>>& data)
+{
+    return UploadData(data, reinterpret_cast<const GLubyte*>(data->data()));
+}
+
+//-----------------------------------------------------------------------------
+// UploadManager - streams mesh and texture data to the GPU through a staging
+// ring buffer instead of uploading it at load time. Uploads are queued from
+// any thread and Process() copies at most the frame budget of them every
+// frame, so a big model is spread over several frames instead of hitching one.
+// Every frame of copies is fenced and its part of the ring is only reused once
+// the fence signaled, Process() never waits on the GPU and simply leaves the
+// rest of the queue to the next frame when the ring is full.
+// When ARB_buffer_storage is available the ring is mapped once persistently,
+// otherwise every write maps its range unsynchronized.
+//-----------------------------------------------------------------------------
+class UploadManager
+{
+public:
+    static const GLsizeiptr RING_SIZE = 16 << 20;
+    static const GLsizeiptr DEFAULT_FRAME_BUDGET = 4 << 20;
+    // a single copy is never bigger than this so the ring holds a few frames
+    static const GLsizeiptr MAX_CHUNK_SIZE = RING_SIZE / 4;
+
+    // called on the GL thread with the ring bound to GL_COPY_READ_BUFFER and
+    // GL_PIXEL_UNPACK_BUFFER, copies size bytes starting at dataOffset of the
+    // upload from stagingOffset of the ring to the destination
+    typedef std::function<void (GLintptr stagingOffset, GLsizeiptr dataOffset, GLsizeiptr size)> CopyFunc;
+
+    static UploadManager& Get();
+    // size of a row of texture data given to EnqueueTexture
+    static GLsizeiptr GetTextureRowSize(GLsizei width, GLuint bytesPerPixel);
+
+    UploadManager();
+    ~UploadManager();
+
+    // deletes the ring, called on the GL thread before the context is
+    // destroyed. Queued uploads are dropped
+    void Shutdown();
+
+    // chunks are always a multiple of chunkAlignment
+    void Enqueue       (const UploadData& data, GLsizeiptr size, GLsizeiptr chunkAlignment, const CopyFunc& copy,
+                        const std::shared_ptr<UploadStatus>& status);
+    // a level of a texture that already has its storage, every row of data
+    // starts on a 4 byte boundary
+    void EnqueueTexture(GLuint texture, GLint level, GLsizei width, GLsizei height, GLenum format, GLuint bytesPerPixel,
+                        const UploadData& data, const std::shared_ptr<UploadStatus>& status);
+    // the same for block compressed levels, data holds rows of 4x4 blocks
+    void EnqueueCompressedTexture(GLuint texture, GLint level, GLsizei width, GLsizei height, GLenum internalFormat,
+                                  GLuint blockSize, const UploadData& data, const std::shared_ptr<UploadStatus>& status);
+
+    // both run on the GL thread once per frame, Flush() copies everything
+    // that is queued and waits for the GPU when the ring is full
+    void Process();
+    void Flush  ();
+
+    void       SetFrameBudget(GLsizeiptr bytes);
+    GLsizeiptr GetFrameBudget() const;
+    GLsizeiptr GetQueuedBytes() const;
+
+private:
+    struct UploadRequest
+    {
+        UploadData data;
+        GLsizeiptr size;
+        GLsizeiptr copied;
+        GLsizeiptr chunkAlignment;
+        CopyFunc   copy;
+        std::shared_ptr<UploadStatus> status;
+    };
+
+    // the copies of one Process() call, m_ring bytes used by them including
+    // the padding skipped when wrapping around
+    struct StagingBatch
+    {
+        GLsync     fence;
+        GLsizeiptr size;
+    };
+
+    void     Init         ();
+    void     CopyQueued   (GLsizeiptr budget, bool wait);
+    GLintptr AllocStaging (GLsizeiptr size, GLsizeiptr& batchSize);
+    void     WriteStaging (GLintptr offset, const GLubyte* data, GLsizeiptr size);
+    void     EndBatch     (GLsizeiptr& batchSize);
+    void     RetireBatches(bool waitForOne);
+
+    static const GLintptr INVALID_OFFSET = -1;
+
+    GLuint   m_ring;
+    GLubyte* m_persistentPtr;
+    bool     m_persistent;
+    GLintptr m_head;
+    // bytes written and not yet retired
+    GLsizeiptr m_used;
+    std::deque<StagingBatch> m_batches;
+
+    GLsizeiptr m_frameBudget;
+    mutable std::mutex m_mutex;
+    std::deque<UploadRequest> m_queue;
+    GLsizeiptr m_queuedBytes;
+};
+
+#endif  //_UPLOADMANAGER_H
@@ -0,0 +1,103 @@
+//
+// GameEngine - A cross platform game engine made using OpenGL and c++
+// Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+//
+// This file is part of GameEngine.
+//
+// GameEngine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GameEngine is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "VertexFormat.h"
+#include <algorithm>
+#include <glm/gtc/packing.hpp>
+
+//-----------------------------------------------------------------------------
+// Name : ChooseVertexFormat ()
+// Desc : returns the smallest format that keeps the vertices close enough,
+//        the positions of large subMeshes and the texture coordinates can
+//        lose too much precision
+//-----------------------------------------------------------------------------
+VertexFormat ChooseVertexFormat(const std::vector<Vertex>& vertices)
+{
+    AABB bounds;
+    for (const Vertex& vertex : vertices)
+    {
+        bounds.AddPoint(vertex.Position);
+
+        for (int i = 0; i < 2; i++)
+        {
+            float texCoord = vertex.TexCoords[i];
+            float halfTexCoord = glm::unpackHalf1x16(glm::packHalf1x16(texCoord));
+            if (std::abs(halfTexCoord - texCoord) > MAX_TEXCOORD_QUANTIZATION_ERROR)
+                return VERTEX_FORMAT_FLOAT;
+        }
+    }
+
+    // the positions are spread over 65535 steps on every axis of the bounds
+    if (!bounds.IsEmpty())
+    {
+        glm::vec3 extent = bounds.max - bounds.min;
+        if (std::max(extent.x, std::max(extent.y, extent.z)) / 65535.0f > MAX_POSITION_QUANTIZATION_ERROR)
+            return VERTEX_FORMAT_FLOAT;
+    }
+
+    return VERTEX_FORMAT_QUANTIZED;
+}
+
+//-----------------------------------------------------------------------------
+// Name : QuantizeVertices ()
+//-----------------------------------------------------------------------------
+void QuantizeVertices(const std::vector<Vertex>& vertices, const AABB& bounds, std::vector<QuantizedVertex>& quantized)
+{
+    quantized.resize(vertices.size());
+    if (vertices.empty())
+        return;
+
+    // a flat axis has no size, every vertex is at its minimum
+    glm::vec3 size = bounds.max - bounds.min;
+    glm::vec3 scale;
+    for (int i = 0; i < 3; i++)
+        scale[i] = size[i] > 0.0f ? 1.0f / size[i] : 0.0f;
+
+    for (GLuint i = 0; i < vertices.size(); i++)
+    {
+        const Vertex& vertex = vertices[i];
+        QuantizedVertex& packed = quantized[i];
+
+        glm::vec3 position = glm::clamp((vertex.Position - bounds.min) * scale, glm::vec3(0.0f), glm::vec3(1.0f));
+        for (int j = 0; j < 3; j++)
+            packed.Position[j] = static_cast<GLushort>(position[j] * 65535.0f + 0.5f);
+        packed.Position[3] = 0;
+
+        packed.Normal = glm::packSnorm3x10_1x2(glm::vec4(vertex.Normal, 0.0f));
+        packed.TexCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+        packed.TexCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetQuantizationDecodeMatrix ()
+// Desc : maps the normalized quantized positions back into bounds
+//-----------------------------------------------------------------------------
+glm::mat4x4 GetQuantizationDecodeMatrix(const AABB& bounds)
+{
+    glm::vec3 size = bounds.max - bounds.min;
+
+    glm::mat4x4 decode(1.0f);
+    decode[0][0] = size.x;
+    decode[1][1] = size.y;
+    decode[2][2] = size.z;
+    decode[3] = glm::vec4(bounds.min, 1.0f);
+
+    return decode;
+}
@@ -0,0 +1,108 @@
+/* * GameEngine - A cross platform game engine made using OpenGL and c++
+ * Copyright (C) 2016-2020 Matan Keren <xmakerenx@gmail.com>
+ *
+ * This file is part of GameEngine.
+ *
+ * GameEngine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GameEngine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameEngine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef  _VERTEXFORMAT_H
+#define  _VERTEXFORMAT_H
+
+#include <vector>
+#include <cstddef>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "RenderTypes.h"
+
+struct Vertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+
+    Vertex() :Position(), Normal(), TexCoords() {}
+    
+    Vertex(glm::vec3 pos, glm::vec3 normal ,glm::vec2 texCord) 
+        :Position(pos), Normal(normal), TexCoords(texCord) {}
+};
+
+// half the size of Vertex. The position is unorm16 inside the subMesh bounds
+// and is decoded by GetQuantizationDecodeMatrix() folded into the world matrix,
+// the normal is a snorm 10_10_10_2 and the texture coordinates are half floats
+struct QuantizedVertex {
+    GLushort Position[4];
+    GLuint   Normal;
+    GLushort TexCoords[2];
+};
+static_assert(sizeof(QuantizedVertex) == 16, "QuantizedVertex must stay 16 bytes");
+
+enum VertexFormat
+{
+    VERTEX_FORMAT_FLOAT = 0,
+    VERTEX_FORMAT_QUANTIZED,
+    VERTEX_FORMAT_COUNT
+};
+
+// one glVertexAttribPointer call
+struct VertexAttributeDesc
+{
+    GLuint    location;
+    GLint     size;
+    GLenum    type;
+    GLboolean normalized;
+    GLuint    offset;
+};
+
+struct VertexFormatDesc
+{
+    GLsizei                    stride;
+    const VertexAttributeDesc* attributes;
+    GLuint                     attributeCount;
+};
+
+// the locations match objectShader4.vs, normalized attributes reach the
+// shader as floats so both formats work with the same shaders
+const VertexAttributeDesc FLOAT_VERTEX_ATTRIBUTES[] =
+{
+    {0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Position)},
+    {1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal)},
+    {2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords)}
+};
+
+const VertexAttributeDesc QUANTIZED_VERTEX_ATTRIBUTES[] =
+{
+    {0, 3, GL_UNSIGNED_SHORT,       GL_TRUE,  offsetof(QuantizedVertex, Position)},
+    {1, 4, GL_INT_2_10_10_10_REV,   GL_TRUE,  offsetof(QuantizedVertex, Normal)},
+    {2, 2, GL_HALF_FLOAT,           GL_FALSE, offsetof(QuantizedVertex, TexCoords)}
+};
+
+const VertexFormatDesc VERTEX_FORMATS[VERTEX_FORMAT_COUNT] =
+{
+    {sizeof(Vertex),          FLOAT_VERTEX_ATTRIBUTES,     3},
+    {sizeof(QuantizedVertex), QUANTIZED_VERTEX_ATTRIBUTES, 3}
+};
+
+// the largest texture coordinate error half floats may add for the
+// quantized format to be picked, half a texel of a 1024 texture
+const float MAX_TEXCOORD_QUANTIZATION_ERROR = 1.0f / 2048.0f;
+// the largest step between unorm16 positions in local space units for the
+// quantized format to be picked, subMeshes wider than 64 units keep floats
+const float MAX_POSITION_QUANTIZATION_ERROR = 1.0f / 1024.0f;
+
+VertexFormat ChooseVertexFormat         (const std::vector<Vertex>& vertices);
+void         QuantizeVertices           (const std::vector<Vertex>& vertices, const AABB& bounds, std::vector<QuantizedVertex>& quantized);
+glm::mat4x4  GetQuantizationDecodeMatrix(const AABB& bounds);
+
+#endif  //_VERTEXFORMAT_H
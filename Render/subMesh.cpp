@@ -19,42 +19,172 @@
 //
 
 #include "subMesh.h"
+#include <thread>
+#include <functional>
 #include <glm/ext/scalar_constants.hpp>
 
-struct OBJnode
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SUBMESH_SSE
+#include <xmmintrin.h>
+#endif
+
+// CalcVertexNormals only splits the smoothing between threads above this
+static const GLuint MIN_NORMAL_VERTICES_PER_THREAD = 16384;
+
+//-----------------------------------------------------------------------------
+// Name : GetArray
+// Desc : a null array is empty
+//-----------------------------------------------------------------------------
+template<class T>
+static const std::vector<T>& GetArray(const std::shared_ptr<std::vector<T>>& array)
+{
+    static const std::vector<T> empty;
+    return array ? *array : empty;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetUniqueArray
+// Desc : copies the array before it is changed if it is shared
+//-----------------------------------------------------------------------------
+template<class T>
+static std::vector<T>& GetUniqueArray(std::shared_ptr<std::vector<T>>& array)
+{
+    if (!array)
+        array = std::make_shared<std::vector<T>>();
+    else if (array.use_count() > 1)
+        array = std::make_shared<std::vector<T>>(*array);
+
+    return *array;
+}
+
+//-----------------------------------------------------------------------------
+// Name : PackIndices
+// Desc : 16 bit indices are converted, 32 bit ones are shared as they are
+//-----------------------------------------------------------------------------
+static UploadData PackIndices(GLenum indexType, const IndexArray& indices)
+{
+    if (!indices || indices->empty())
+        return UploadData();
+
+    if (indexType == GL_UNSIGNED_SHORT)
+        return MakeUploadData(std::vector<GLushort>(indices->begin(), indices->end()));
+
+    return ShareUploadData(indices);
+}
+
+//-----------------------------------------------------------------------------
+// Name : SubMeshGeometry (constructor)
+//-----------------------------------------------------------------------------
+SubMeshGeometry::SubMeshGeometry()
+    :upload(std::make_shared<UploadStatus>()), decodeMatrix(1.0f), lodFirstIndex(0), lodIndexCount(0)
 {
-    GLuint index;
-    GLboolean averaged;
-    OBJnode * next;
-};
+}
+
+//-----------------------------------------------------------------------------
+// Name : SubMeshGeometry (destructor)
+//-----------------------------------------------------------------------------
+SubMeshGeometry::~SubMeshGeometry()
+{
+    // the ranges can be reused before the queued uploads to them run
+    upload->cancelled = true;
+
+    GeometryArena& arena = GeometryArena::Get();
+    if (!geometry.IsEmpty() && lodIndexCount > 0)
+        arena.FreeIndices(geometry.indexType, lodFirstIndex, lodIndexCount);
+
+    arena.Free(geometry);
+}
 
 //-----------------------------------------------------------------------------
 // Name : SubMesh (constructor)
 //-----------------------------------------------------------------------------
-// TODO: make vertices and indices movable to reduce overhead
 SubMesh::SubMesh(const std::vector<Vertex>& vertices, const std::vector<VertexIndex>& indices)
+    :SubMesh(std::vector<Vertex>(vertices), std::vector<VertexIndex>(indices))
 {
-    this->m_vertices = vertices;
-    this->m_indices = indices;
 
-    this->m_VAO = 0;
-    this->m_VBO = 0;
-    this->m_EBO = 0;
+}
 
+//-----------------------------------------------------------------------------
+// Name : SubMesh (constructor)
+// Desc : takes the loader buffers without copying them
+//-----------------------------------------------------------------------------
+SubMesh::SubMesh(std::vector<Vertex>&& vertices, std::vector<VertexIndex>&& indices, bool upload/* = true*/)
+    :m_vertices(std::make_shared<std::vector<Vertex>>(std::move(vertices))),
+     m_indices(std::make_shared<std::vector<VertexIndex>>(std::move(indices)))
+{
+    this->m_residency = MESH_RESIDENCY_FULL;
+    this->m_vertexFormat = ChooseVertexFormat(*m_vertices);
+
+    this->calcBounds();
+    this->buildBVH();
     // Now that we have all the required data, set the vertex buffers and its attribute pointers.
-    this->setupMesh();
+    if (upload)
+        this->setupMesh();
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReadIndices
+// Desc : widens indices stored as indexType to VertexIndex
+//-----------------------------------------------------------------------------
+static void ReadIndices(GLenum indexType, const GLubyte* data, GLuint indexCount, std::vector<VertexIndex>& indices)
+{
+    if (indexType == GL_UNSIGNED_SHORT)
+    {
+        const GLushort* shortIndices = reinterpret_cast<const GLushort*>(data);
+        indices.assign(shortIndices, shortIndices + indexCount);
+    }
+    else
+    {
+        const GLuint* intIndices = reinterpret_cast<const GLuint*>(data);
+        indices.assign(intIndices, intIndices + indexCount);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : SubMesh (constructor)
+// Desc : the GPU data is streamed straight from the packed buffers
+//-----------------------------------------------------------------------------
+SubMesh::SubMesh(const PackedSubMesh& packed, MeshResidency residency)
+    :m_residency(residency), m_bounds(packed.bounds), m_boundingSphere(packed.boundingSphere),
+     m_vertexFormat(packed.vertexFormat)
+{
+    if (residency == MESH_RESIDENCY_FULL)
+    {
+        m_vertices = std::make_shared<std::vector<Vertex>>(packed.vertices, packed.vertices + packed.vertexCount);
+        m_lodIndices = std::make_shared<std::vector<VertexIndex>>();
+        ReadIndices(packed.indexType, packed.lodIndices.get(), packed.lodIndexCount, *m_lodIndices);
+    }
+    else if (residency == MESH_RESIDENCY_PICKING)
+    {
+        m_positions.reserve(packed.vertexCount);
+        for (GLuint i = 0; i < packed.vertexCount; i++)
+            m_positions.push_back(packed.vertices[i].Position);
+    }
+
+    if (residency != MESH_RESIDENCY_NONE)
+    {
+        m_indices = std::make_shared<std::vector<VertexIndex>>();
+        ReadIndices(packed.indexType, packed.indices.get(), packed.indexCount, *m_indices);
+    }
+
+    m_lods.assign(packed.lods, packed.lods + packed.lodCount);
+    m_bvh.Assign(packed.bvhNodes, packed.bvhNodeCount, packed.bvhTriangles, packed.bvhTriangleCount);
+
+    uploadPacked(packed);
 }
 
 //-----------------------------------------------------------------------------
 // Name : SubMesh (copy constructor)
+// Desc : the copy shares the GPU geometry and the memory copies until one of
+//        them changes them
 //-----------------------------------------------------------------------------
 SubMesh::SubMesh(const SubMesh& copySubMesh)
-    :m_vertices(copySubMesh.m_vertices), m_indices(copySubMesh.m_indices)
+    :m_vertices(copySubMesh.m_vertices), m_indices(copySubMesh.m_indices),
+     m_positions(copySubMesh.m_positions), m_residency(copySubMesh.m_residency),
+     m_bounds(copySubMesh.m_bounds), m_boundingSphere(copySubMesh.m_boundingSphere),
+     m_bvh(copySubMesh.m_bvh), m_gpu(copySubMesh.m_gpu), m_vertexFormat(copySubMesh.m_vertexFormat),
+     m_lodIndices(copySubMesh.m_lodIndices), m_lods(copySubMesh.m_lods)
 {
-    m_VAO = 0;
-    m_VBO = 0;
-    m_EBO = 0;
-    setupMesh();
 }
 
 //-----------------------------------------------------------------------------
@@ -64,11 +194,15 @@ SubMesh& SubMesh::operator=(const SubMesh& copy)
 {
     m_vertices = copy.m_vertices;
     m_indices = copy.m_indices;
-    
-    m_VAO = 0;
-    m_VBO = 0;
-    m_EBO = 0;
-    setupMesh();
+    m_positions = copy.m_positions;
+    m_residency = copy.m_residency;
+    m_bounds = copy.m_bounds;
+    m_boundingSphere = copy.m_boundingSphere;
+    m_bvh = copy.m_bvh;
+    m_gpu = copy.m_gpu;
+    m_vertexFormat = copy.m_vertexFormat;
+    m_lodIndices = copy.m_lodIndices;
+    m_lods = copy.m_lods;
     
     return *this;
 }
@@ -77,15 +211,13 @@ SubMesh& SubMesh::operator=(const SubMesh& copy)
 // Name : SubMesh (move constructor)
 //-----------------------------------------------------------------------------
 SubMesh::SubMesh(SubMesh&& moveSubMesh)
-    :m_vertices(std::move(moveSubMesh.m_vertices)), m_indices(std::move(moveSubMesh.m_indices))
+    :m_vertices(std::move(moveSubMesh.m_vertices)), m_indices(std::move(moveSubMesh.m_indices)),
+     m_positions(std::move(moveSubMesh.m_positions)), m_residency(moveSubMesh.m_residency),
+     m_bounds(moveSubMesh.m_bounds), m_boundingSphere(moveSubMesh.m_boundingSphere),
+     m_bvh(std::move(moveSubMesh.m_bvh)), m_gpu(std::move(moveSubMesh.m_gpu)),
+     m_vertexFormat(moveSubMesh.m_vertexFormat),
+     m_lodIndices(std::move(moveSubMesh.m_lodIndices)), m_lods(std::move(moveSubMesh.m_lods))
 {
-    m_VAO = moveSubMesh.m_VAO;
-    m_VBO = moveSubMesh.m_VBO;
-    m_EBO = moveSubMesh.m_EBO;
-    
-    moveSubMesh.m_VAO = 0;
-    moveSubMesh.m_VBO = 0;
-    moveSubMesh.m_EBO = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -95,14 +227,15 @@ SubMesh& SubMesh::operator=(SubMesh&& move)
 {
     m_vertices = std::move(move.m_vertices);
     m_indices = std::move(move.m_indices);
-    
-    m_VAO = move.m_VAO;
-    m_VBO = move.m_VBO;
-    m_EBO = move.m_EBO;
-    
-    move.m_VAO = 0;
-    move.m_VBO = 0;
-    move.m_EBO = 0;
+    m_positions = std::move(move.m_positions);
+    m_residency = move.m_residency;
+    m_bounds = move.m_bounds;
+    m_boundingSphere = move.m_boundingSphere;
+    m_bvh = std::move(move.m_bvh);
+    m_gpu = std::move(move.m_gpu);
+    m_vertexFormat = move.m_vertexFormat;
+    m_lodIndices = std::move(move.m_lodIndices);
+    m_lods = std::move(move.m_lods);
     
     return *this;
 }
@@ -112,207 +245,676 @@ SubMesh& SubMesh::operator=(SubMesh&& move)
 //-----------------------------------------------------------------------------
 SubMesh::~SubMesh()
 {
-    if (m_EBO != 0)
-        glDeleteBuffers(1, &m_EBO);
-    
-    if (m_VBO != 0)
-        glDeleteBuffers(1, &m_VBO);
-    
-    if (m_VAO != 0)
-        glDeleteVertexArrays(1, &m_VAO);
+    releaseMesh();
 }
 
 
+//-----------------------------------------------------------------------------
+// Name : calcBounds
+// Desc : calculates the local AABB and a bounding sphere around its center
+//-----------------------------------------------------------------------------
+void SubMesh::calcBounds()
+{
+    const std::vector<Vertex>& vertices = GetArray(m_vertices);
+    m_bounds = AABB();
+    for (const Vertex& vertex : vertices)
+        m_bounds.AddPoint(vertex.Position);
+
+    if (m_bounds.IsEmpty())
+    {
+        m_boundingSphere = BoundingSphere();
+        return;
+    }
+
+    glm::vec3 center = m_bounds.GetCenter();
+    float maxDistSq = 0.0f;
+    for (const Vertex& vertex : vertices)
+    {
+        glm::vec3 diff = vertex.Position - center;
+        maxDistSq = std::max(maxDistSq, glm::dot(diff, diff));
+    }
+
+    m_boundingSphere = BoundingSphere(center, std::sqrt(maxDistSq));
+}
+
+//-----------------------------------------------------------------------------
+// Name : buildBVH
+//-----------------------------------------------------------------------------
+void SubMesh::buildBVH()
+{
+    const std::vector<Vertex>& vertices = GetArray(m_vertices);
+    const std::vector<VertexIndex>& indices = GetArray(m_indices);
+    if (vertices.empty())
+    {
+        m_bvh.Clear();
+        return;
+    }
+
+    m_bvh.Build(reinterpret_cast<const GLubyte*>(&vertices[0].Position), sizeof(Vertex), indices.data(), indices.size() / 3);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBounds
+//-----------------------------------------------------------------------------
+const AABB& SubMesh::GetBounds() const
+{
+    return m_bounds;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBoundingSphere
+//-----------------------------------------------------------------------------
+const BoundingSphere& SubMesh::GetBoundingSphere() const
+{
+    return m_boundingSphere;
+}
+
 //-----------------------------------------------------------------------------
 // Name : Draw
 //-----------------------------------------------------------------------------
-void SubMesh::Draw()
+void SubMesh::Draw(GLuint lod /*= 0*/)
 {
-    // Draw mesh
-    glBindVertexArray(this->m_VAO );
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->m_EBO );
-    glDrawElements(GL_TRIANGLES, this->m_indices.size(), GL_UNSIGNED_INT, 0);
-    
-    glBindVertexArray(0);
+    GeometryAllocation geometry = GetGeometry(lod);
+    glDrawElementsBaseVertex(GL_TRIANGLES, geometry.indexCount, geometry.indexType,
+                             geometry.GetIndexOffset(), geometry.baseVertex);
 }
 
 //-----------------------------------------------------------------------------
-// Name : IntersectTriangle
+// Name : DrawInstanced
+// Desc : draws instanceCount copies of the mesh, the per instance matrices
+//        are read from instanceBuffer starting at firstInstance
+//-----------------------------------------------------------------------------
+void SubMesh::DrawInstanced(GLsizei instanceCount, GLuint instanceBuffer, GLuint firstInstance, GLuint lod /*= 0*/)
+{
+    GeometryAllocation geometry = GetGeometry(lod);
+
+    // point the instance attributes at this draw's range of the buffer
+    GeometryArena::Get().BindInstanceBuffer(instanceBuffer, firstInstance * sizeof(InstanceData));
+
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, geometry.indexCount, geometry.indexType,
+                                      geometry.GetIndexOffset(), instanceCount, geometry.baseVertex);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetGeometry
+// Desc : lods past the last level return the last level
+//-----------------------------------------------------------------------------
+GeometryAllocation SubMesh::GetGeometry(GLuint lod /*= 0*/) const
+{
+    if (!m_gpu)
+        return GeometryAllocation();
+
+    if (lod == 0 || m_gpu->lodIndexCount == 0 || m_gpu->geometry.IsEmpty())
+        return m_gpu->geometry;
+
+    const LodLevel& level = m_lods[std::min<GLuint>(lod, m_lods.size()) - 1];
+    GeometryAllocation geometry = m_gpu->geometry;
+    geometry.firstIndex = m_gpu->lodFirstIndex + level.firstIndex;
+    geometry.indexCount = level.indexCount;
+
+    return geometry;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsReady
+//-----------------------------------------------------------------------------
+bool SubMesh::IsReady() const
+{
+    return !m_gpu || m_gpu->upload->IsReady();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Upload
+// Desc : the lod chain set before is uploaded with the mesh
 //-----------------------------------------------------------------------------
-bool SubMesh::IntersectTriangle(glm::vec3& rayObjOrigin ,glm::vec3& rayObjDir, int& faceCount)
+void SubMesh::Upload()
 {
-    for (int i = 0; i < m_indices.size(); i += 3)
+    if (!m_gpu)
+        setupMesh();
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetLodChain
+// Desc : replaces the simplified levels, see MeshSimplifier::BuildLodChain
+//-----------------------------------------------------------------------------
+void SubMesh::SetLodChain(std::vector<VertexIndex>&& lodIndices, std::vector<LodLevel>&& lods)
+{
+    detachGeometry();
+    if (m_gpu && m_gpu->lodIndexCount > 0)
     {
-        glm::vec3& v0 = m_vertices[m_indices[i]].Position;
-        glm::vec3& v1 = m_vertices[m_indices[i+1]].Position;
-        glm::vec3& v2 = m_vertices[m_indices[i+2]].Position;
-        glm::vec2 bray;
+        GeometryArena::Get().FreeIndices(m_gpu->geometry.indexType, m_gpu->lodFirstIndex, m_gpu->lodIndexCount);
+        m_gpu->lodIndexCount = 0;
+    }
 
-        float distance;
-        if (glm::intersectRayTriangle(rayObjOrigin, rayObjDir, v0, v1,v2, bray, distance))
-        {
-            faceCount = i / 3;
-            return true;
-        }
+    m_lodIndices = std::make_shared<std::vector<VertexIndex>>(std::move(lodIndices));
+    m_lods = std::move(lods);
+    uploadLodIndices();
+
+    if (m_residency != MESH_RESIDENCY_FULL)
+        m_lodIndices.reset();
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetLodCount
+// Desc : the number of levels including the full mesh
+//-----------------------------------------------------------------------------
+GLuint SubMesh::GetLodCount() const
+{
+    return m_lods.size() + 1;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetLodError
+//-----------------------------------------------------------------------------
+float SubMesh::GetLodError(GLuint lod) const
+{
+    if (lod == 0 || m_lods.empty())
+        return 0.0f;
+
+    return m_lods[std::min<GLuint>(lod, m_lods.size()) - 1].error;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetVertexFormat
+// Desc : uploads the mesh again in format
+//-----------------------------------------------------------------------------
+void SubMesh::SetVertexFormat(VertexFormat format)
+{
+    if (format == m_vertexFormat)
+        return;
+
+    if (m_residency != MESH_RESIDENCY_FULL)
+    {
+        std::cout << "SetVertexFormat(): the mesh vertices were already released\n";
+        return;
     }
 
-    // ray didn't intersect with any triangle
-    return false;
+    m_vertexFormat = format;
+    releaseMesh();
+    setupMesh();
 }
 
 //-----------------------------------------------------------------------------
-// Name : CalcVertexNormals
+// Name : GetVertexFormat
 //-----------------------------------------------------------------------------
-void SubMesh::CalcVertexNormals(GLfloat angle)
+VertexFormat SubMesh::GetVertexFormat() const
 {
-    glm::vec3 u,v;
+    return m_vertexFormat;
+}
 
-    std::vector<glm::vec3> facenorms;
-    //GLuint   numfacetnorms;       /* number of facetnorms in model */
-    //GLfloat* facetnorms;          /* array of facetnorms */
+//-----------------------------------------------------------------------------
+// Name : GetDecodeMatrix
+//-----------------------------------------------------------------------------
+const glm::mat4x4& SubMesh::GetDecodeMatrix() const
+{
+    static const glm::mat4x4 identity(1.0f);
+    if (!m_gpu)
+        return identity;
 
-    glm::vec3 average;
-    GLuint avg;
+    return m_gpu->decodeMatrix;
+}
 
-    OBJnode** members;
-    OBJnode* node;
-    GLfloat dot, cos_angle;
+//-----------------------------------------------------------------------------
+// Name : IntersectTriangle
+// Desc : finds the nearest triangle hit closer than hit.distance
+//-----------------------------------------------------------------------------
+bool SubMesh::IntersectTriangle(const glm::vec3& rayObjOrigin, const glm::vec3& rayObjDir, RayHit& hit) const
+{
+    if (m_bvh.IsEmpty())
+        return false;
 
-    for (int i = 0; i < m_indices.size(); i += 3)
+    switch (m_residency)
     {
-        glm::vec3 faceNorm;
-
-        u.x = m_vertices[m_indices[i + 1]].Position.x -
-                m_vertices[m_indices[i + 0]].Position.x;
-        u.y = m_vertices[m_indices[i + 1]].Position.y -
-                m_vertices[m_indices[i + 0]].Position.y;
-        u.z = m_vertices[m_indices[i + 1]].Position.z -
-                m_vertices[m_indices[i + 0]].Position.z;
-
-        v.x = m_vertices[m_indices[i + 2]].Position.x -
-                m_vertices[m_indices[i + 0]].Position.x;
-        v.y = m_vertices[m_indices[i + 2]].Position.y -
-                m_vertices[m_indices[i + 0]].Position.y;
-        v.z = m_vertices[m_indices[i + 2]].Position.z -
-                m_vertices[m_indices[i + 0]].Position.z;
-
-        faceNorm = glm::cross(u,v);
-        faceNorm = glm::normalize(faceNorm);
-        facenorms.push_back(std::move(faceNorm));
+    case MESH_RESIDENCY_FULL:
+        return m_bvh.Intersect(rayObjOrigin, rayObjDir, reinterpret_cast<const GLubyte*>(&(*m_vertices)[0].Position), sizeof(Vertex),
+                               m_indices->data(), hit);
+
+    case MESH_RESIDENCY_PICKING:
+        return m_bvh.Intersect(rayObjOrigin, rayObjDir, reinterpret_cast<const GLubyte*>(m_positions.data()), sizeof(glm::vec3),
+                               m_indices->data(), hit);
+
+    default:
+        return m_bvh.Intersect(rayObjOrigin, rayObjDir, nullptr, 0, nullptr, hit);
     }
+}
 
-    // calculate the cosine of the angle (in degrees)
-    cos_angle = std::cos(angle * glm::pi<float>() / 180.0);
+//-----------------------------------------------------------------------------
+// Name : SetResidency
+// Desc : drops the memory copies not needed by residency, the GPU copy of the
+//        mesh is left as is
+//-----------------------------------------------------------------------------
+void SubMesh::SetResidency(MeshResidency residency)
+{
+    if (residency == m_residency)
+        return;
 
-    // allocate a structure that will hold a linked list of triangle indices for each vertex
-    members = new OBJnode*[m_vertices.size() + 1];
-    for (int i = 0; i <= m_vertices.size(); i++)
-        members[i] = nullptr;
+    if (residency < m_residency)
+    {
+        std::cout << "SetResidency(): released mesh data can't be restored\n";
+        return;
+    }
 
-    for (int i = 0; i < m_indices.size(); i += 3)
+    if (residency == MESH_RESIDENCY_PICKING)
     {
-       node = new OBJnode();
-       node->index = i;
-       node->next = members[m_indices[i]];
-       members[m_indices[i]] = node;
-
-       node = new OBJnode();
-       node->index = i;
-       node->next = members[m_indices[i + 1]];
-       members[m_indices[i + 1]] = node;
-
-       node = new OBJnode();
-       node->index = i;
-       node->next = members[m_indices[i + 2]];
-       members[m_indices[i + 2]] = node;
+        const std::vector<Vertex>& vertices = GetArray(m_vertices);
+        m_positions.reserve(vertices.size());
+        for (const Vertex& vertex : vertices)
+            m_positions.push_back(vertex.Position);
     }
+    else
+    {
+        std::vector<glm::vec3>().swap(m_positions);
+        m_indices.reset();
+    }
+
+    // uploads that still stream the arrays keep them until they are done
+    m_vertices.reset();
+    m_lodIndices.reset();
+    m_residency = residency;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetResidency
+//-----------------------------------------------------------------------------
+MeshResidency SubMesh::GetResidency() const
+{
+    return m_residency;
+}
 
-    for (int vIndex = 0; vIndex < m_vertices.size(); vIndex++)
+//-----------------------------------------------------------------------------
+// Name : GetMemoryUsage
+//-----------------------------------------------------------------------------
+MeshMemoryUsage SubMesh::GetMemoryUsage() const
+{
+    MeshMemoryUsage usage;
+    // like the geometry, shared arrays are counted by every SubMesh using them
+    usage.cpuBytes = GetArray(m_vertices).capacity() * sizeof(Vertex) +
+                     GetArray(m_indices).capacity() * sizeof(VertexIndex) +
+                     m_positions.capacity() * sizeof(glm::vec3) +
+                     GetArray(m_lodIndices).capacity() * sizeof(VertexIndex) +
+                     m_lods.capacity() * sizeof(LodLevel) +
+                     m_bvh.GetMemoryUsage();
+
+    // shared geometry is counted by every SubMesh using it
+    if (m_gpu && !m_gpu->geometry.IsEmpty())
     {
-        node = members[vIndex];
-        if (!node)
-            std::cerr << "CalcVertexNormals(): vertex without a triangle\n";
+        const GeometryAllocation& geometry = m_gpu->geometry;
+        usage.gpuBytes = size_t(geometry.vertexCount) * VERTEX_FORMATS[geometry.format].stride +
+                         size_t(geometry.indexCount + m_gpu->lodIndexCount) * geometry.GetIndexSize();
+    }
+
+    return usage;
+}
 
-        average.x = 0; average.y = 0; average.z = 0;
-        avg = 0;
-        while (node)
+//-----------------------------------------------------------------------------
+// Name : GetVertices
+//-----------------------------------------------------------------------------
+const std::vector<Vertex>& SubMesh::GetVertices() const
+{
+    return GetArray(m_vertices);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetIndices
+//-----------------------------------------------------------------------------
+const std::vector<VertexIndex>& SubMesh::GetIndices() const
+{
+    return GetArray(m_indices);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetLodIndices
+//-----------------------------------------------------------------------------
+const std::vector<VertexIndex>& SubMesh::GetLodIndices() const
+{
+    return GetArray(m_lodIndices);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetLods
+//-----------------------------------------------------------------------------
+const std::vector<LodLevel>& SubMesh::GetLods() const
+{
+    return m_lods;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBVH
+//-----------------------------------------------------------------------------
+const TriangleBVH& SubMesh::GetBVH() const
+{
+    return m_bvh;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CalcFaceNormals
+// Desc : unit normal and twice the area of every triangle, degenerate
+//        triangles get a zero normal
+//-----------------------------------------------------------------------------
+static void CalcFaceNormals(const std::vector<Vertex>& vertices, const std::vector<VertexIndex>& indices,
+                            std::vector<glm::vec3>& faceNormals, std::vector<float>& faceAreas)
+{
+    GLuint faceCount = indices.size() / 3;
+    faceNormals.resize(faceCount);
+    faceAreas.resize(faceCount);
+
+    GLuint face = 0;
+#ifdef SUBMESH_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    // 4 triangles at a time, one per lane
+    for (; face + 4 <= faceCount; face += 4)
+    {
+        // [corner][axis][lane]
+        alignas(16) float pos[3][3][4];
+        for (GLuint lane = 0; lane < 4; lane++)
         {
-            dot = glm::dot(facenorms[node->index], facenorms[members[vIndex]->index]);
-            if (dot > cos_angle)
+            for (GLuint corner = 0; corner < 3; corner++)
             {
-                node->averaged = GL_TRUE;
-                average.x += facenorms[node->index].x;
-                average.y += facenorms[node->index].y;
-                average.z += facenorms[node->index].z;
-                avg = 1; // we averaged at least one normal
+                const glm::vec3& p = vertices[indices[(face + lane) * 3 + corner]].Position;
+                pos[corner][0][lane] = p.x;
+                pos[corner][1][lane] = p.y;
+                pos[corner][2][lane] = p.z;
             }
-            else
-                node->averaged = GL_FALSE;
+        }
 
-            node = node->next;
+        __m128 ux = _mm_sub_ps(_mm_load_ps(pos[1][0]), _mm_load_ps(pos[0][0]));
+        __m128 uy = _mm_sub_ps(_mm_load_ps(pos[1][1]), _mm_load_ps(pos[0][1]));
+        __m128 uz = _mm_sub_ps(_mm_load_ps(pos[1][2]), _mm_load_ps(pos[0][2]));
+        __m128 vx = _mm_sub_ps(_mm_load_ps(pos[2][0]), _mm_load_ps(pos[0][0]));
+        __m128 vy = _mm_sub_ps(_mm_load_ps(pos[2][1]), _mm_load_ps(pos[0][1]));
+        __m128 vz = _mm_sub_ps(_mm_load_ps(pos[2][2]), _mm_load_ps(pos[0][2]));
+
+        __m128 nx = _mm_sub_ps(_mm_mul_ps(uy, vz), _mm_mul_ps(uz, vy));
+        __m128 ny = _mm_sub_ps(_mm_mul_ps(uz, vx), _mm_mul_ps(ux, vz));
+        __m128 nz = _mm_sub_ps(_mm_mul_ps(ux, vy), _mm_mul_ps(uy, vx));
+
+        __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+        __m128 length = _mm_sqrt_ps(lengthSq);
+        // the mask zeroes the inf of degenerate triangles
+        __m128 invLength = _mm_and_ps(_mm_div_ps(one, length), _mm_cmpgt_ps(lengthSq, zero));
+        _mm_storeu_ps(&faceAreas[face], length);
+
+        alignas(16) float normal[3][4];
+        _mm_store_ps(normal[0], _mm_mul_ps(nx, invLength));
+        _mm_store_ps(normal[1], _mm_mul_ps(ny, invLength));
+        _mm_store_ps(normal[2], _mm_mul_ps(nz, invLength));
+
+        for (GLuint lane = 0; lane < 4; lane++)
+            faceNormals[face + lane] = glm::vec3(normal[0][lane], normal[1][lane], normal[2][lane]);
+    }
+#endif
+
+    for (; face < faceCount; face++)
+    {
+        const glm::vec3& p0 = vertices[indices[face * 3]].Position;
+        glm::vec3 normal = glm::cross(vertices[indices[face * 3 + 1]].Position - p0,
+                                      vertices[indices[face * 3 + 2]].Position - p0);
+        float length = glm::length(normal);
+        faceNormals[face] = (length > 0.0f) ? normal / length : glm::vec3(0.0f);
+        faceAreas[face] = length;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : SmoothVertexNormals
+// Desc : sets the normals of vertices [first, last) from the faces around
+//        them. The faces less than the angle away from the largest face are
+//        averaged, so the result doesn't depend on the order of the faces and
+//        every face is only read twice.
+//-----------------------------------------------------------------------------
+static void SmoothVertexNormals(std::vector<Vertex>& vertices, const std::vector<GLuint>& faceOffsets,
+                                const std::vector<GLuint>& vertexFaces, const std::vector<glm::vec3>& faceNormals,
+                                const std::vector<float>& faceAreas, float cosAngle, GLuint first, GLuint last)
+{
+    for (GLuint vIndex = first; vIndex < last; vIndex++)
+    {
+        GLuint begin = faceOffsets[vIndex];
+        GLuint end = faceOffsets[vIndex + 1];
+
+        // degenerate faces have no area so they are never the reference
+        GLuint reference = 0;
+        float referenceArea = 0.0f;
+        for (GLuint i = begin; i < end; i++)
+        {
+            if (faceAreas[vertexFaces[i]] > referenceArea)
+            {
+                reference = vertexFaces[i];
+                referenceArea = faceAreas[reference];
+            }
         }
 
-        if (avg)
+        if (referenceArea == 0.0f)
+            continue;
+
+        const glm::vec3& referenceNormal = faceNormals[reference];
+        glm::vec3 sum(0.0f);
+        for (GLuint i = begin; i < end; i++)
         {
-            average = glm::normalize(average);
-            m_vertices[vIndex].Normal = average;
+            const glm::vec3& normal = faceNormals[vertexFaces[i]];
+            if (vertexFaces[i] == reference || glm::dot(normal, referenceNormal) > cosAngle)
+                sum += normal;
         }
 
+        vertices[vIndex].Normal = glm::normalize(sum);
     }
+}
 
-    for (int i = 0; i < m_vertices.size(); i++)
+//-----------------------------------------------------------------------------
+// Name : CalcVertexNormals
+// Desc : smooths the normals of faces less than angle degrees apart and
+//        uploads the vertices again
+//-----------------------------------------------------------------------------
+void SubMesh::CalcVertexNormals(GLfloat angle)
+{
+    if (m_residency != MESH_RESIDENCY_FULL)
     {
-        OBJnode* tail;
-        node = members[i];
-        while (node)
-        {
-            tail = node;
-            node = node->next;
-            delete tail;
-        }
+        std::cout << "CalcVertexNormals(): the mesh vertices were already released\n";
+        return;
+    }
+
+    if (GetArray(m_vertices).empty())
+        return;
+
+    // the uploads and the copies of this SubMesh keep the old normals
+    std::vector<Vertex>& vertices = GetUniqueArray(m_vertices);
+    const std::vector<VertexIndex>& indices = GetArray(m_indices);
+    GLuint vertexCount = vertices.size();
+
+    std::vector<glm::vec3> faceNormals;
+    std::vector<float> faceAreas;
+    CalcFaceNormals(vertices, indices, faceNormals, faceAreas);
+
+    // the faces of every vertex, sorted by vertex with a counting sort so the
+    // faces of vertex v are vertexFaces[faceOffsets[v], faceOffsets[v + 1])
+    std::vector<GLuint> faceOffsets(vertexCount + 1, 0);
+    GLuint cornerCount = faceNormals.size() * 3;
+    for (GLuint i = 0; i < cornerCount; i++)
+        faceOffsets[indices[i] + 1]++;
+
+    GLuint unusedVertices = 0;
+    for (GLuint v = 0; v < vertexCount; v++)
+    {
+        if (faceOffsets[v + 1] == 0)
+            unusedVertices++;
+
+        faceOffsets[v + 1] += faceOffsets[v];
+    }
+
+    if (unusedVertices > 0)
+        std::cout << "CalcVertexNormals(): " << unusedVertices << " vertices without a triangle\n";
+
+    std::vector<GLuint> vertexFaces(cornerCount);
+    std::vector<GLuint> cursor(faceOffsets.begin(), faceOffsets.end() - 1);
+    for (GLuint i = 0; i < cornerCount; i++)
+        vertexFaces[cursor[indices[i]]++] = i / 3;
+
+    // calculate the cosine of the angle (in degrees)
+    float cosAngle = std::cos(angle * glm::pi<float>() / 180.0f);
+
+    // every thread writes the normals of its own range of vertices
+    GLuint threadCount = std::max<GLuint>(1, std::thread::hardware_concurrency());
+    threadCount = std::max<GLuint>(1, std::min(threadCount, vertexCount / MIN_NORMAL_VERTICES_PER_THREAD));
+    GLuint rangeSize = (vertexCount + threadCount - 1) / threadCount;
+
+    std::vector<std::thread> workers;
+    for (GLuint t = 1; t < threadCount; t++)
+    {
+        GLuint first = t * rangeSize;
+        GLuint last = std::min(first + rangeSize, vertexCount);
+        workers.emplace_back(SmoothVertexNormals, std::ref(vertices), std::cref(faceOffsets), std::cref(vertexFaces),
+                             std::cref(faceNormals), std::cref(faceAreas), cosAngle, first, last);
+    }
+
+    SmoothVertexNormals(vertices, faceOffsets, vertexFaces, faceNormals, faceAreas, cosAngle, 0, std::min(rangeSize, vertexCount));
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    // the positions didn't change so the bounds and the BVH are still valid
+    detachGeometry();
+    if (!m_gpu)
+        return;
+
+    if (m_vertexFormat == VERTEX_FORMAT_QUANTIZED)
+    {
+        std::vector<QuantizedVertex> quantizedVertices;
+        QuantizeVertices(vertices, m_bounds, quantizedVertices);
+        GeometryArena::Get().StreamVertices(m_gpu->geometry, MakeUploadData(std::move(quantizedVertices)), m_gpu->upload);
+    }
+    else
+        GeometryArena::Get().StreamVertices(m_gpu->geometry, ShareUploadData(m_vertices), m_gpu->upload);
+}
+
+//-----------------------------------------------------------------------------
+// Name : PackGeometry
+// Desc : packs the mesh in m_vertexFormat, with 16 bit indices when every
+//        vertex can be addressed by them. Full precision vertices and 32 bit
+//        indices share the memory copies instead of copying them, only the
+//        converted buffers are allocated. Nothing here touches GL
+//-----------------------------------------------------------------------------
+PackedSubMesh SubMesh::PackGeometry() const
+{
+    const std::vector<Vertex>& vertices = GetArray(m_vertices);
+    const std::vector<VertexIndex>& indices = GetArray(m_indices);
+    const std::vector<VertexIndex>& lodIndices = GetArray(m_lodIndices);
+
+    PackedSubMesh packed;
+    packed.vertexFormat = m_vertexFormat;
+    packed.indexType = (vertices.size() <= 65536) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    packed.vertexCount = vertices.size();
+    packed.indexCount = indices.size();
+    packed.lodIndexCount = lodIndices.size();
+    packed.lodCount = m_lods.size();
+    packed.bvhNodeCount = m_bvh.GetNodeCount();
+    packed.bvhTriangleCount = m_bvh.GetTriangleIndices().size();
+
+    packed.vertices = vertices.data();
+    if (m_vertexFormat == VERTEX_FORMAT_QUANTIZED)
+    {
+        std::vector<QuantizedVertex> quantizedVertices;
+        QuantizeVertices(vertices, m_bounds, quantizedVertices);
+        packed.gpuVertices = MakeUploadData(std::move(quantizedVertices));
     }
-    delete[] members;
+    else if (!vertices.empty())
+        packed.gpuVertices = ShareUploadData(m_vertices);
+
+    packed.indices = PackIndices(packed.indexType, m_indices);
+    packed.lodIndices = PackIndices(packed.indexType, m_lodIndices);
+    packed.lods = m_lods.data();
+    packed.bvhNodes = m_bvh.GetNodes().data();
+    packed.bvhTriangles = m_bvh.GetTriangleIndices().data();
 
-    //setupMesh();
+    packed.bounds = m_bounds;
+    packed.boundingSphere = m_boundingSphere;
 
+    return packed;
 }
 
 //-----------------------------------------------------------------------------
 // Name : setupMesh
+// Desc : copies the mesh into the geometry arena
 //-----------------------------------------------------------------------------
 void SubMesh::setupMesh()
 {
-    // Create buffers/arrays
-    if (this->m_VAO == 0)
-        glGenVertexArrays(1, &this->m_VAO );
-
-    if (this->m_VBO == 0)
-        glGenBuffers(1, &this->m_VBO );
-
-    if (this->m_EBO == 0)
-        glGenBuffers(1, &this->m_EBO );
-
-    glBindVertexArray(this->m_VAO );
-    // Load data into vertex buffers
-    glBindBuffer(GL_ARRAY_BUFFER, this->m_VBO );
-    // A great thing about structs is that their memory layout is sequential for all its items.
-    // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-    // again translates to 3/2 floats which translates to a byte array.
-    glBufferData(GL_ARRAY_BUFFER, this->m_vertices.size() * sizeof(Vertex), this->m_vertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->m_EBO );
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->m_indices.size() * sizeof(VertexIndex), this->m_indices.data(), GL_STATIC_DRAW);
-
-    // Set the vertex attribute pointers
-    // Vertex Positions
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-    // Vertex Normals
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
-    glEnableVertexAttribArray(1);
-    // Vertex Texture Coords
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
-    glEnableVertexAttribArray(2);
-
-    glBindVertexArray(0);
+    uploadPacked(PackGeometry());
+}
+
+//-----------------------------------------------------------------------------
+// Name : uploadPacked
+// Desc : allocates the arena ranges of packed and streams its buffers to them
+//-----------------------------------------------------------------------------
+void SubMesh::uploadPacked(const PackedSubMesh& packed)
+{
+    m_gpu = std::make_shared<SubMeshGeometry>();
+    if (m_vertexFormat == VERTEX_FORMAT_QUANTIZED)
+        m_gpu->decodeMatrix = GetQuantizationDecodeMatrix(m_bounds);
+
+    GeometryArena& arena = GeometryArena::Get();
+    m_gpu->geometry = arena.Allocate(m_vertexFormat, nullptr, packed.vertexCount, packed.indexType, nullptr, packed.indexCount);
+    arena.StreamVertices(m_gpu->geometry, packed.gpuVertices, m_gpu->upload);
+    arena.StreamIndices(packed.indexType, m_gpu->geometry.firstIndex, packed.indexCount, packed.indices, m_gpu->upload);
+
+    if (packed.lodIndexCount > 0 && !m_gpu->geometry.IsEmpty())
+    {
+        m_gpu->lodFirstIndex = arena.AllocateIndices(packed.indexType, nullptr, packed.lodIndexCount);
+        m_gpu->lodIndexCount = packed.lodIndexCount;
+        arena.StreamIndices(packed.indexType, m_gpu->lodFirstIndex, packed.lodIndexCount, packed.lodIndices, m_gpu->upload);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name : uploadLodIndices
+// Desc : copies the lod indices to the arena using the full mesh index type,
+//        the geometry must not be shared
+//-----------------------------------------------------------------------------
+void SubMesh::uploadLodIndices()
+{
+    const std::vector<VertexIndex>& lodIndices = GetArray(m_lodIndices);
+    if (!m_gpu || m_gpu->geometry.IsEmpty() || lodIndices.empty())
+        return;
+
+    GLenum indexType = m_gpu->geometry.indexType;
+    m_gpu->lodFirstIndex = GeometryArena::Get().AllocateIndices(indexType, nullptr, lodIndices.size());
+    m_gpu->lodIndexCount = lodIndices.size();
+    GeometryArena::Get().StreamIndices(indexType, m_gpu->lodFirstIndex, lodIndices.size(), PackIndices(indexType, m_lodIndices),
+                                       m_gpu->upload);
+}
+
+//-----------------------------------------------------------------------------
+// Name : detachGeometry
+// Desc : gives this SubMesh its own copy of shared geometry before it is
+//        changed, the copy is made on the GPU
+//-----------------------------------------------------------------------------
+void SubMesh::detachGeometry()
+{
+    if (!m_gpu || m_gpu.use_count() == 1)
+        return;
+
+    // the GPU copy has to see the streamed data
+    if (!m_gpu->upload->IsReady())
+        UploadManager::Get().Flush();
+
+    GeometryArena& arena = GeometryArena::Get();
+    std::shared_ptr<SubMeshGeometry> copy = std::make_shared<SubMeshGeometry>();
+    copy->geometry = arena.Duplicate(m_gpu->geometry);
+    copy->decodeMatrix = m_gpu->decodeMatrix;
+
+    if (!copy->geometry.IsEmpty() && m_gpu->lodIndexCount > 0)
+    {
+        copy->lodFirstIndex = arena.DuplicateIndices(copy->geometry.indexType, m_gpu->lodFirstIndex, m_gpu->lodIndexCount);
+        copy->lodIndexCount = m_gpu->lodIndexCount;
+    }
+
+    m_gpu = copy;
+}
+
+//-----------------------------------------------------------------------------
+// Name : releaseMesh
+// Desc : the arena ranges are freed once no other copy uses them
+//-----------------------------------------------------------------------------
+void SubMesh::releaseMesh()
+{
+    m_gpu.reset();
 }
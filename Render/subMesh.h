@@ -22,29 +22,125 @@
 
 #include <iostream>
 #include <vector>
+#include <memory>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #define GLM_ENABLE_EXPERIMENTAL // needed for gtx extensions
 #include <glm/gtx/intersect.hpp>
 #include "RenderTypes.h"
+#include "TriangleBVH.h"
 #include "Shader.h"
+#include "GeometryArena.h"
 
-struct Vertex {
-    glm::vec3 Position;
-    glm::vec3 Normal;
-    glm::vec2 TexCoords;
+// a simplified version of a SubMesh drawn with its vertices, the indices are
+// [firstIndex, firstIndex + indexCount) of the subMesh lod indices. error is
+// how far in local space the surface may have moved from the full mesh.
+struct LodLevel
+{
+    GLuint firstIndex;
+    GLuint indexCount;
+    float  error;
+};
 
-    Vertex() :Position(), Normal(), TexCoords() {}
-    
-    Vertex(glm::vec3 pos, glm::vec3 normal ,glm::vec2 texCord) 
-        :Position(pos), Normal(normal), TexCoords(texCord) {}
+// what a SubMesh keeps in memory after it was copied to the GeometryArena,
+// a mesh can only move down the list since the dropped data is not read back
+enum MeshResidency
+{
+    // every vertex and index, needed to change the vertex format or normals
+    MESH_RESIDENCY_FULL,
+    // only the positions and indices, picking is still exact
+    MESH_RESIDENCY_PICKING,
+    // only the picking BVH, rays hit the boxes of its leaves
+    MESH_RESIDENCY_NONE
+};
+
+// bytes used by meshes in system memory and in the GeometryArena buffers
+struct MeshMemoryUsage
+{
+    size_t cpuBytes;
+    size_t gpuBytes;
+
+    MeshMemoryUsage()
+        :cpuBytes(0), gpuBytes(0)
+    {}
+
+    void Add(const MeshMemoryUsage& usage)
+    {
+        cpuBytes += usage.cpuBytes;
+        gpuBytes += usage.gpuBytes;
+    }
+};
+
+//-----------------------------------------------------------------------------
+// SubMeshGeometry - the arena ranges of a SubMesh, copies of a SubMesh share
+// one through a shared_ptr and the ranges are freed with the last of them.
+// It is never changed while shared, SubMesh makes its own copy on the GPU
+// before changing the geometry (copy on write).
+// The data is streamed by the UploadManager and can only be drawn once
+// upload is ready.
+//-----------------------------------------------------------------------------
+struct SubMeshGeometry
+{
+    GeometryAllocation geometry;
+    std::shared_ptr<UploadStatus> upload;
+    // maps the stored positions to local space, identity unless quantized
+    glm::mat4x4 decodeMatrix;
+    // the indices of every simplified level
+    GLuint lodFirstIndex;
+    GLuint lodIndexCount;
+
+    SubMeshGeometry();
+    ~SubMeshGeometry();
+
+    SubMeshGeometry(const SubMeshGeometry&) = delete;
+    SubMeshGeometry& operator=(const SubMeshGeometry&) = delete;
+};
+
+// a SubMesh that was already converted to its GPU layout, see CookedMesh.
+// The pointers only have to stay valid during the SubMesh constructor while
+// the UploadData keep their memory alive until the upload finished
+struct PackedSubMesh
+{
+    VertexFormat    vertexFormat;
+    GLenum          indexType;
+    GLuint          vertexCount;
+    GLuint          indexCount;
+    GLuint          lodIndexCount;
+    GLuint          lodCount;
+    GLuint          bvhNodeCount;
+    GLuint          bvhTriangleCount;
+
+    // full precision vertices, read for the residency that keeps them
+    const Vertex*   vertices;
+    // vertices in vertexFormat and indices in indexType
+    UploadData      gpuVertices;
+    UploadData      indices;
+    UploadData      lodIndices;
+    const LodLevel* lods;
+    const BVHNode*  bvhNodes;
+    const GLuint*   bvhTriangles;
+
+    AABB            bounds;
+    BoundingSphere  boundingSphere;
 };
 
+// the memory copies of the geometry, shared with the copies of a SubMesh and
+// with the uploads streaming them so they are never copied for the GPU. Like
+// SubMeshGeometry they are only changed when not shared, a null array is empty
+typedef std::shared_ptr<std::vector<Vertex>>      VertexArray;
+typedef std::shared_ptr<std::vector<VertexIndex>> IndexArray;
+
 class SubMesh {
 
 public:
+    // the vertex format is picked by ChooseVertexFormat()
     SubMesh(const std::vector<Vertex>& vertices, const std::vector<VertexIndex>& indices);
+    // without upload nothing touches GL, so the SubMesh can be built on any
+    // thread and Upload() is called on the GL thread later
+    SubMesh(std::vector<Vertex>&& vertices, std::vector<VertexIndex>&& indices, bool upload = true);
+    // only keeps the data residency needs, nothing is calculated again
+    SubMesh(const PackedSubMesh& packed, MeshResidency residency);
     SubMesh(const SubMesh& copySubMesh);
     SubMesh& operator=(const SubMesh& copy);
     SubMesh(SubMesh&& moveSubMesh);
@@ -52,20 +148,82 @@ public:
     
     ~SubMesh();
 
-    void Draw();
+    // both expect the GeometryArena VAO to be bound
+    void Draw(GLuint lod = 0);
+    void DrawInstanced(GLsizei instanceCount, GLuint instanceBuffer, GLuint firstInstance, GLuint lod = 0);
+
+    bool IntersectTriangle(const glm::vec3& rayObjOrigin, const glm::vec3& rayObjDir, RayHit& hit) const;
+
+    const AABB&           GetBounds        () const;
+    const BoundingSphere& GetBoundingSphere() const;
+    // lod 0 is the full mesh, the simplified levels only differ in their indices
+    GeometryAllocation    GetGeometry      (GLuint lod = 0) const;
+    // false until the geometry finished streaming to the GPU
+    bool                  IsReady          () const;
+    // creates the GPU copy of a SubMesh built without upload
+    void                  Upload           ();
+    // the GPU layout of the SubMesh without touching GL, needs
+    // MESH_RESIDENCY_FULL. The float vertices and 32 bit indices are shared
+    // with the SubMesh, only quantized and 16 bit buffers are made
+    PackedSubMesh         PackGeometry     () const;
 
-    bool IntersectTriangle(glm::vec3& rayObjOrigin, glm::vec3& rayObjDir, int& faceCount);
+    void   SetLodChain(std::vector<VertexIndex>&& lodIndices, std::vector<LodLevel>&& lods);
+    GLuint GetLodCount() const;
+    float  GetLodError(GLuint lod) const;
 
-    //TODO: cuase this functio to really work
+    void               SetVertexFormat(VertexFormat format);
+    VertexFormat       GetVertexFormat() const;
+    // maps the stored positions to local space, identity unless quantized
+    const glm::mat4x4& GetDecodeMatrix() const;
+
+    void            SetResidency  (MeshResidency residency);
+    MeshResidency   GetResidency  () const;
+    MeshMemoryUsage GetMemoryUsage() const;
+
+    // the data a cooked mesh is written from, the vertices and indices are
+    // only there with MESH_RESIDENCY_FULL
+    const std::vector<Vertex>&      GetVertices  () const;
+    const std::vector<VertexIndex>& GetIndices   () const;
+    const std::vector<VertexIndex>& GetLodIndices() const;
+    const std::vector<LodLevel>&    GetLods      () const;
+    const TriangleBVH&              GetBVH       () const;
+
+    // angle is in degrees, needs MESH_RESIDENCY_FULL
     void CalcVertexNormals(GLfloat angle);
 
 private:
-    std::vector<Vertex> m_vertices;
-    std::vector<VertexIndex> m_indices;
+    // only kept with MESH_RESIDENCY_FULL
+    VertexArray m_vertices;
+    // kept with MESH_RESIDENCY_FULL and MESH_RESIDENCY_PICKING
+    IndexArray m_indices;
+    // only kept with MESH_RESIDENCY_PICKING
+    std::vector<glm::vec3> m_positions;
+    MeshResidency m_residency;
     
-    GLuint m_VAO, m_VBO, m_EBO;
+    // local space bounds, calculated once the vertices are set
+    AABB m_bounds;
+    BoundingSphere m_boundingSphere;
+    // used for picking, built once the vertices are set
+    TriangleBVH m_bvh;
+
+    // the GPU copy of the mesh, shared with the copies of this SubMesh. It is
+    // in m_vertexFormat while m_vertices always keeps the full precision
+    std::shared_ptr<SubMeshGeometry> m_gpu;
+    VertexFormat m_vertexFormat;
+
+    // the simplified levels after the full mesh, all of their indices are
+    // in one range of the arena, m_lodIndices is only kept with
+    // MESH_RESIDENCY_FULL
+    IndexArray m_lodIndices;
+    std::vector<LodLevel> m_lods;
 
     void setupMesh();
+    void uploadPacked(const PackedSubMesh& packed);
+    void detachGeometry();
+    void releaseMesh();
+    void uploadLodIndices();
+    void calcBounds();
+    void buildBVH();
 };
 
 